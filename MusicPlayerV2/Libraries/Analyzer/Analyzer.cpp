@@ -0,0 +1,190 @@
+#include "Analyzer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+	constexpr double Pi = 3.14159265358979323846;
+}
+
+Analyzer_t::~Analyzer_t() {
+	this->Stop();
+}
+
+bool Analyzer_t::Start(int SampleRate, bool HasThread) {
+	if (SampleRate <= 0 || this->IsRunning)
+		return false;
+
+	this->SampleRate = SampleRate;
+
+	if (!this->FFT.Init(FFTSize) || !this->BeatDetector.Init(SampleRate))
+		return false;
+
+	this->Spectrum.resize(FFTSize);
+	this->BeatRead = this->RingWrite.load(std::memory_order_acquire);
+
+	this->BandCount = 0;
+	for (int i = 0; i < MaxBands; i++) {
+		float Frequency = MinFrequency * powf(2.0f, static_cast<float>(i) / BandsPerOctave);
+		if (Frequency > MaxFrequency * 1.001f || Frequency >= SampleRate / 2.0f)
+			break;
+
+		this->BandFrequency[i] = Frequency;
+		this->BandCount++;
+	}
+
+	this->BuildKernel();
+
+	if (HasThread) {
+		this->IsRunning = true;
+		this->Thread = std::thread(&Analyzer_t::ThreadMain, this);
+	}
+	return true;
+}
+
+void Analyzer_t::Stop() {
+	this->IsRunning = false;
+	if (this->Thread.joinable())
+		this->Thread.join();
+}
+
+void Analyzer_t::BuildKernel() {
+	const double Q = 1.0 / (pow(2.0, 1.0 / BandsPerOctave) - 1.0);
+	const float Threshold = 0.01f; // Relative to the strongest bin of each band
+
+	this->KernelOffsets.assign(1, 0);
+	this->KernelBins.clear();
+	this->KernelValues.clear();
+
+	std::vector<std::complex<float>> Temporal(FFTSize);
+	for (int Band = 0; Band < this->BandCount; Band++) {
+		// Lower bands need longer windows, capped at the FFT size
+		size_t Length = std::min(FFTSize, static_cast<size_t>(ceil(Q * this->SampleRate / this->BandFrequency[Band])));
+
+		// Hamming windowed complex exponential aligned to the newest samples, normalized so a
+		// full scale sine reads 0.5
+		std::fill(Temporal.begin(), Temporal.end(), std::complex<float>(0.0f, 0.0f));
+		double WindowSum = 0.0;
+		for (size_t n = 0; n < Length; n++)
+			WindowSum += 0.54 - 0.46 * cos(2.0 * Pi * n / (Length - 1));
+
+		for (size_t n = 0; n < Length; n++) {
+			double Window = (0.54 - 0.46 * cos(2.0 * Pi * n / (Length - 1))) / WindowSum;
+			double Phase = 2.0 * Pi * this->BandFrequency[Band] * n / this->SampleRate;
+			Temporal[FFTSize - Length + n] = std::complex<float>(static_cast<float>(Window * cos(Phase)), static_cast<float>(Window * sin(Phase)));
+		}
+
+		this->FFT.Forward(Temporal.data());
+
+		float Peak = 0.0f;
+		for (const std::complex<float>& Value : Temporal)
+			Peak = std::max(Peak, std::abs(Value));
+
+		// Parseval: sum(x * conj(t)) = sum(X * conj(T)) / N
+		for (size_t Bin = 0; Bin < FFTSize; Bin++) {
+			if (std::abs(Temporal[Bin]) < Peak * Threshold)
+				continue;
+
+			this->KernelBins.push_back(static_cast<uint32_t>(Bin));
+			this->KernelValues.push_back(std::conj(Temporal[Bin]) / static_cast<float>(FFTSize));
+		}
+		this->KernelOffsets.push_back(static_cast<uint32_t>(this->KernelBins.size()));
+	}
+}
+
+void Analyzer_t::Push(const float* Interleaved, size_t Frames, int Channels) {
+	uint64_t Write = this->RingWrite.load(std::memory_order_relaxed);
+	const float Scale = 1.0f / Channels;
+
+	for (size_t i = 0; i < Frames; i++) {
+		float Sum = 0.0f;
+		for (int c = 0; c < Channels; c++)
+			Sum += Interleaved[i * Channels + c];
+		this->Ring[(Write + i) % RingSize] = Sum * Scale;
+	}
+
+	this->RingWrite.store(Write + Frames, std::memory_order_release);
+}
+
+void Analyzer_t::Analyze() {
+	const auto Start = std::chrono::steady_clock::now();
+	const uint64_t Write = this->RingWrite.load(std::memory_order_acquire);
+
+	// Hand every complete hop to the beat detector, skip ahead if we ever fell behind the ring
+	if (Write - this->BeatRead > RingSize - FFTSize)
+		this->BeatRead = Write - (Write - this->BeatRead) % BeatDetector_t::HopSize - BeatDetector_t::HopSize * 4;
+
+	while (Write - this->BeatRead >= BeatDetector_t::HopSize) {
+		float Hop[BeatDetector_t::HopSize];
+		for (size_t i = 0; i < BeatDetector_t::HopSize; i++)
+			Hop[i] = this->Ring[(this->BeatRead + i) % RingSize];
+
+		this->BeatDetector.Process(Hop);
+		this->BeatRead += BeatDetector_t::HopSize;
+	}
+
+	// Newest FFTSize samples, zero padded at startup
+	for (size_t i = 0; i < FFTSize; i++) {
+		uint64_t Index = Write - FFTSize + i;
+		float Sample = (Write >= FFTSize - i) ? this->Ring[Index % RingSize] : 0.0f;
+		this->Spectrum[i] = std::complex<float>(Sample, 0.0f);
+	}
+
+	this->FFT.Forward(this->Spectrum.data());
+
+	for (int Band = 0; Band < this->BandCount; Band++) {
+		std::complex<float> Sum = 0.0f;
+		for (uint32_t i = this->KernelOffsets[Band]; i < this->KernelOffsets[Band + 1]; i++)
+			Sum += this->Spectrum[this->KernelBins[i]] * this->KernelValues[i];
+
+		float Decibel = 20.0f * log10f(std::max(std::abs(Sum) * 2.0f, 0.000001f));
+		this->Bands[Band].store(std::clamp((Decibel + 60.0f) / 60.0f, 0.0f, 1.0f), std::memory_order_relaxed);
+	}
+
+	const auto Elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Start).count();
+	this->UpdateNanoseconds.fetch_add(static_cast<uint64_t>(Elapsed), std::memory_order_relaxed);
+	this->Updates.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Analyzer_t::ThreadMain() {
+	const auto Interval = std::chrono::microseconds(1000000 / UpdateRate);
+	auto NextUpdate = std::chrono::steady_clock::now();
+
+	while (this->IsRunning) {
+		this->Analyze();
+
+		NextUpdate += Interval;
+		if (NextUpdate < std::chrono::steady_clock::now())
+			NextUpdate = std::chrono::steady_clock::now();
+		std::this_thread::sleep_until(NextUpdate);
+	}
+}
+
+int Analyzer_t::GetBandCount() const {
+	return this->BandCount;
+}
+
+float Analyzer_t::GetBandFrequency(int Band) const {
+	return this->BandFrequency[Band];
+}
+
+void Analyzer_t::GetBands(float* Out, int Count) const {
+	for (int i = 0; i < Count; i++)
+		Out[i] = i < this->BandCount ? this->Bands[i].load(std::memory_order_relaxed) : 0.0f;
+}
+
+uint64_t Analyzer_t::GetFeedPosition() const {
+	return this->RingWrite.load(std::memory_order_acquire);
+}
+
+int Analyzer_t::GetSampleRate() const {
+	return this->SampleRate;
+}
+
+double Analyzer_t::GetUpdateCost() const {
+	uint64_t Count = this->Updates.load(std::memory_order_relaxed);
+	if (!Count)
+		return 0.0;
+	return static_cast<double>(this->UpdateNanoseconds.load(std::memory_order_relaxed)) / Count / 1000.0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "FFT.hpp"
+#include "../BeatDetector/BeatDetector.hpp"
+
+// Constant-Q (1/3 octave) spectrum analyzer.
+// The output DSP pushes samples into a ring buffer, a dedicated analysis thread
+// runs one 8192 point FFT per update and projects it onto a precomputed sparse
+// spectral kernel (Brown & Puckette) to get the band magnitudes.
+class Analyzer_t {
+public:
+	enum class Mode_t {
+		Linear,		// The original 7 bar BASS FFT averaging
+		ConstantQ,
+	};
+
+	static constexpr int MaxBands = 32;
+	static constexpr int BandsPerOctave = 3;
+	static constexpr float MinFrequency = 31.25f;
+	static constexpr float MaxFrequency = 16000.0f;
+
+private:
+	static constexpr size_t FFTSize = 8192;
+	static constexpr size_t RingSize = FFTSize * 4;
+	static constexpr int UpdateRate = 60; // Hz
+
+	int SampleRate = 0;
+	int BandCount = 0;
+
+	// Mono samples written by the audio thread, read by the analysis thread
+	float Ring[RingSize] = {};
+	std::atomic<uint64_t> RingWrite = 0;
+
+	// Sparse kernel in CSR layout, band k owns [KernelOffsets[k], KernelOffsets[k + 1])
+	std::vector<uint32_t> KernelOffsets;
+	std::vector<uint32_t> KernelBins;
+	std::vector<std::complex<float>> KernelValues;
+
+	// Only touched by the analysis thread
+	FFT_t FFT;
+	std::vector<std::complex<float>> Spectrum;
+	uint64_t BeatRead = 0;
+
+	float BandFrequency[MaxBands] = {};
+	std::atomic<float> Bands[MaxBands] = {};
+
+	std::atomic<uint64_t> Updates = 0;
+	std::atomic<uint64_t> UpdateNanoseconds = 0;
+
+	std::atomic<bool> IsRunning = false;
+	std::thread Thread;
+
+	void BuildKernel();
+	void ThreadMain();
+
+public:
+	// Onset / tempo tracking on the same feed, runs on the analysis thread
+	BeatDetector_t BeatDetector;
+
+	~Analyzer_t();
+
+	// Without a thread nothing is analyzed until Analyze() is called
+	bool Start(int SampleRate, bool HasThread = true);
+	void Stop();
+
+	// One update over the newest samples, run 60 times a second by the analysis thread
+	void Analyze();
+
+	// Audio thread, interleaved float samples
+	void Push(const float* Interleaved, size_t Frames, int Channels);
+
+	int GetBandCount() const;
+	float GetBandFrequency(int Band) const;
+
+	// Band levels in 0..1, roughly -60 dB to 0 dB
+	void GetBands(float* Out, int Count) const;
+
+	// Total samples pushed so far, the time base of the beat timestamps
+	uint64_t GetFeedPosition() const;
+	int GetSampleRate() const;
+
+	// Average time spent per update in microseconds
+	double GetUpdateCost() const;
+};
@@ -0,0 +1,54 @@
+#include "FFT.hpp"
+
+#include <cmath>
+#include <utility>
+
+bool FFT_t::Init(size_t Size) {
+	if (Size < 2 || (Size & (Size - 1)) != 0)
+		return false;
+
+	this->Size = Size;
+
+	int Bits = 0;
+	while ((static_cast<size_t>(1) << Bits) < Size)
+		Bits++;
+
+	this->BitReverse.resize(Size);
+	for (size_t i = 0; i < Size; i++) {
+		uint32_t Reversed = 0;
+		for (int b = 0; b < Bits; b++)
+			Reversed |= ((i >> b) & 1) << (Bits - 1 - b);
+		this->BitReverse[i] = Reversed;
+	}
+
+	const double Pi = 3.14159265358979323846;
+	this->Twiddles.resize(Size / 2);
+	for (size_t i = 0; i < Size / 2; i++)
+		this->Twiddles[i] = std::polar(1.0f, static_cast<float>(-2.0 * Pi * i / Size));
+
+	return true;
+}
+
+void FFT_t::Forward(std::complex<float>* Data) const {
+	for (size_t i = 0; i < this->Size; i++) {
+		size_t j = this->BitReverse[i];
+		if (i < j)
+			std::swap(Data[i], Data[j]);
+	}
+
+	for (size_t Length = 2; Length <= this->Size; Length <<= 1) {
+		const size_t Half = Length / 2;
+		const size_t Stride = this->Size / Length;
+		for (size_t Start = 0; Start < this->Size; Start += Length) {
+			for (size_t k = 0; k < Half; k++) {
+				std::complex<float> Odd = Data[Start + k + Half] * this->Twiddles[k * Stride];
+				Data[Start + k + Half] = Data[Start + k] - Odd;
+				Data[Start + k] += Odd;
+			}
+		}
+	}
+}
+
+size_t FFT_t::GetSize() const {
+	return this->Size;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+// In-place iterative radix-2 FFT with precomputed tables, shared by the analyzers
+class FFT_t {
+private:
+	size_t Size = 0;
+	std::vector<uint32_t> BitReverse;
+	std::vector<std::complex<float>> Twiddles;
+
+public:
+	// Size has to be a power of two
+	bool Init(size_t Size);
+
+	void Forward(std::complex<float>* Data) const;
+
+	size_t GetSize() const;
+};
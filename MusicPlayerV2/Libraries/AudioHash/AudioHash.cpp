@@ -0,0 +1,143 @@
+#include "AudioHash.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+static constexpr uint64_t FnvOffset = 0xCBF29CE484222325ull;
+static constexpr uint64_t FnvPrime = 0x100000001B3ull;
+
+static float ToDb(double Level) {
+	return Level > 0.0 ? std::max(static_cast<float>(20.0 * std::log10(Level)), AudioHash_t::Floor) : AudioHash_t::Floor;
+}
+
+void AudioHash_t::Reset(uint32_t SampleRate, uint32_t Channels, uint32_t BlockFrames) {
+	this->SampleRate = SampleRate;
+	this->Channels = Channels;
+	this->BlockFrames = std::max<uint32_t>(BlockFrames, 1);
+	this->Blocks.clear();
+	this->Hash = FnvOffset;
+	this->SquareSum = 0.0;
+	this->Peak = 0.0f;
+	this->Frames = 0;
+}
+
+void AudioHash_t::FinishBlock() {
+	const double Samples = static_cast<double>(this->Frames) * this->Channels;
+	this->Blocks.push_back({ this->Hash, ToDb(std::sqrt(this->SquareSum / std::max(Samples, 1.0))), ToDb(this->Peak) });
+	this->Hash = FnvOffset;
+	this->SquareSum = 0.0;
+	this->Peak = 0.0f;
+	this->Frames = 0;
+}
+
+void AudioHash_t::Push(const float* Samples, uint64_t Frames) {
+	for (uint64_t f = 0; f < Frames; f++) {
+		for (uint32_t c = 0; c < this->Channels; c++) {
+			// Rounded to 24 bits, anything finer is below what a device would play anyway
+			const float Sample = *Samples++;
+			const int32_t Quantized = static_cast<int32_t>(std::lrint(std::clamp(Sample, -1.0f, 1.0f) * 8388607.0f));
+			for (int b = 0; b < 4; b++)
+				this->Hash = (this->Hash ^ ((static_cast<uint32_t>(Quantized) >> (b * 8)) & 0xFF)) * FnvPrime;
+
+			this->SquareSum += static_cast<double>(Sample) * Sample;
+			this->Peak = std::max(this->Peak, std::fabs(Sample));
+		}
+
+		if (++this->Frames == this->BlockFrames)
+			this->FinishBlock();
+	}
+}
+
+void AudioHash_t::Finish() {
+	if (this->Frames > 0)
+		this->FinishBlock();
+}
+
+bool AudioHash_t::Save(const std::filesystem::path& File) const {
+	std::ofstream Stream(File, std::ios::trunc);
+	if (!Stream) {
+		printf("Failed to open %s for writing\n", File.string().c_str());
+		return false;
+	}
+
+	Stream << "# block hash rms-db peak-db\n";
+	Stream << this->SampleRate << ' ' << this->Channels << ' ' << this->BlockFrames << '\n';
+	char Line[96];
+	for (size_t i = 0; i < this->Blocks.size(); i++) {
+		const Block_t& Block = this->Blocks[i];
+		snprintf(Line, sizeof(Line), "%zu %016" PRIx64 " %.2f %.2f\n", i, Block.Hash, Block.Rms, Block.Peak);
+		Stream << Line;
+	}
+	return static_cast<bool>(Stream);
+}
+
+bool AudioHash_t::Load(const std::filesystem::path& File) {
+	std::ifstream Stream(File);
+	if (!Stream)
+		return false;
+
+	std::string Line;
+	bool HasFormat = false;
+	while (std::getline(Stream, Line)) {
+		std::istringstream Fields(Line.substr(0, Line.find('#')));
+		if (!HasFormat) {
+			uint32_t Rate = 0, Channels = 0, BlockFrames = 0;
+			if (Fields >> Rate >> Channels >> BlockFrames) {
+				this->Reset(Rate, Channels, BlockFrames);
+				HasFormat = true;
+			}
+			continue;
+		}
+
+		size_t Index = 0;
+		std::string HashText;
+		Block_t Block;
+		if (!(Fields >> Index >> HashText >> Block.Rms >> Block.Peak))
+			continue;
+
+		if (Index != this->Blocks.size()) {
+			printf("%s: block %zu out of order\n", File.string().c_str(), Index);
+			return false;
+		}
+		Block.Hash = std::stoull(HashText, nullptr, 16);
+		this->Blocks.push_back(Block);
+	}
+	return HasFormat;
+}
+
+AudioHash_t::Difference_t AudioHash_t::Compare(const AudioHash_t& Golden, float ToleranceDb) const {
+	Difference_t Result;
+	Result.Blocks = std::max(this->Blocks.size(), Golden.Blocks.size());
+	const bool IsSameFormat = this->SampleRate == Golden.SampleRate && this->Channels == Golden.Channels && this->BlockFrames == Golden.BlockFrames;
+	for (size_t i = 0; i < Result.Blocks; i++) {
+		bool IsFailed = !IsSameFormat || i >= this->Blocks.size() || i >= Golden.Blocks.size();
+		if (!IsFailed) {
+			const Block_t& Block = this->Blocks[i];
+			const Block_t& Expected = Golden.Blocks[i];
+			if (Block.Hash == Expected.Hash)
+				Result.Exact++;
+			else if (std::fabs(Block.Rms - Expected.Rms) <= ToleranceDb && std::fabs(Block.Peak - Expected.Peak) <= ToleranceDb)
+				Result.Close++;
+			else
+				IsFailed = true;
+		}
+
+		if (IsFailed) {
+			Result.Failed++;
+			Result.FirstFailed = std::min(Result.FirstFailed, i);
+		}
+	}
+	return Result;
+}
+
+const std::vector<AudioHash_t::Block_t>& AudioHash_t::GetBlocks() const {
+	return this->Blocks;
+}
+
+double AudioHash_t::GetBlockSeconds() const {
+	return this->SampleRate ? static_cast<double>(this->BlockFrames) / this->SampleRate : 0.0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Fingerprint of a rendered mix, one entry per fixed size block of interleaved float frames.
+// Each block keeps a hash of its samples rounded to 24 bits, for exact comparisons, and its RMS
+// and peak level, for comparisons that allow for small numeric drift. Saved as plain text so a
+// changed golden shows up readably in a diff.
+class AudioHash_t {
+public:
+	struct Block_t {
+		uint64_t Hash = 0;
+		float Rms = 0.0f;	// dB, Floor for silence
+		float Peak = 0.0f;	// dB
+	};
+
+	struct Difference_t {
+		size_t Blocks = 0;
+		size_t Exact = 0;
+		size_t Close = 0;		// Hash differs, levels within the tolerance
+		size_t Failed = 0;		// Includes blocks only one of the two has
+		size_t FirstFailed = SIZE_MAX;
+	};
+
+	static constexpr float Floor = -120.0f;
+
+private:
+	uint32_t SampleRate = 0;
+	uint32_t Channels = 0;
+	uint32_t BlockFrames = 0;
+	std::vector<Block_t> Blocks;
+
+	// The block being filled
+	uint64_t Hash = 0;
+	double SquareSum = 0.0;
+	float Peak = 0.0f;
+	uint32_t Frames = 0;
+
+	void FinishBlock();
+
+public:
+	void Reset(uint32_t SampleRate, uint32_t Channels, uint32_t BlockFrames);
+	void Push(const float* Samples, uint64_t Frames);
+	// Hashes a trailing partial block too
+	void Finish();
+
+	bool Save(const std::filesystem::path& File) const;
+	bool Load(const std::filesystem::path& File);
+
+	// Fails every block if the two were cut at a different rate or block size
+	Difference_t Compare(const AudioHash_t& Golden, float ToleranceDb) const;
+
+	const std::vector<Block_t>& GetBlocks() const;
+	double GetBlockSeconds() const;
+};
@@ -0,0 +1,268 @@
+#include "BeatDetector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+bool BeatDetector_t::Init(int SampleRate) {
+	if (SampleRate <= 0 || !this->FFT.Init(FrameSize))
+		return false;
+
+	this->SampleRate = SampleRate;
+
+	const double Pi = 3.14159265358979323846;
+	this->Window.resize(FrameSize);
+	for (size_t i = 0; i < FrameSize; i++)
+		this->Window[i] = static_cast<float>(0.5 - 0.5 * cos(2.0 * Pi * i / FrameSize));
+
+	this->Frame.assign(FrameSize, 0.0f);
+	this->PrevMagnitude.assign(FrameSize / 2, 0.0f);
+	this->PrevLinear.assign(FrameSize / 2, 0.0f);
+	this->Spectrum.resize(FrameSize);
+	this->Odf.assign(HistoryHops, 0.0f);
+	this->Accents.assign(HistoryHops, 0.0f);
+
+	this->HopIndex = 0;
+	this->LastOnset = 0;
+	this->OdfPeak = 0.0f;
+	this->Period = 0.0f;
+	this->Confidence = 0.0f;
+	this->NextBeat = -1.0;
+	this->BeatIndex = 0;
+	this->LastBeat = 0;
+	std::fill(std::begin(this->BarStrength), std::end(this->BarStrength), 0.0f);
+	return true;
+}
+
+float BeatDetector_t::OdfAt(uint64_t Hop) const {
+	return this->Odf[Hop % HistoryHops];
+}
+
+void BeatDetector_t::Process(const float* Hop) {
+	if (!this->SampleRate)
+		return;
+
+	std::copy(this->Frame.begin() + HopSize, this->Frame.end(), this->Frame.begin());
+	std::copy(Hop, Hop + HopSize, this->Frame.end() - HopSize);
+
+	for (size_t i = 0; i < FrameSize; i++)
+		this->Spectrum[i] = std::complex<float>(this->Frame[i] * this->Window[i], 0.0f);
+	this->FFT.Forward(this->Spectrum.data());
+
+	// Half wave rectified flux of the log compressed magnitude, plus the uncompressed
+	// flux which keeps the loudness differences the downbeat estimate needs
+	float Flux = 0.0f;
+	float Accent = 0.0f;
+	for (size_t Bin = 1; Bin < FrameSize / 2; Bin++) {
+		float Linear = std::abs(this->Spectrum[Bin]);
+		float Magnitude = logf(1.0f + 100.0f * Linear);
+		Flux += std::max(Magnitude - this->PrevMagnitude[Bin], 0.0f);
+		Accent += std::max(Linear - this->PrevLinear[Bin], 0.0f);
+		this->PrevMagnitude[Bin] = Magnitude;
+		this->PrevLinear[Bin] = Linear;
+	}
+
+	this->Odf[this->HopIndex % HistoryHops] = Flux;
+	this->Accents[this->HopIndex % HistoryHops] = Accent;
+	this->OdfPeak = std::max(Flux, this->OdfPeak * 0.999f);
+
+	// Peak picking one hop behind, which bounds the onset latency to FrameSize / 2 + HopSize
+	if (this->HopIndex >= 16) {
+		const uint64_t Candidate = this->HopIndex - 1;
+		const float Value = this->OdfAt(Candidate);
+
+		float Mean = 0.0f;
+		for (uint64_t i = Candidate - 15; i <= Candidate; i++)
+			Mean += this->OdfAt(i);
+		Mean /= 16.0f;
+
+		const float Threshold = Mean * 1.4f + this->OdfPeak * 0.05f;
+		const uint64_t MinGap = static_cast<uint64_t>(0.05 * this->SampleRate / HopSize) + 1;
+		if (Value > this->OdfAt(Candidate - 1) && Value >= this->OdfAt(this->HopIndex) && Value > Threshold && Candidate - this->LastOnset >= MinGap) {
+			this->LastOnset = Candidate;
+			this->OnOnset(Candidate);
+		}
+	}
+
+	if (this->HopIndex % TempoInterval == 0 && this->HopIndex >= HistoryHops / 2)
+		this->EstimateTempo();
+
+	this->EmitBeats();
+	this->HopIndex++;
+}
+
+void BeatDetector_t::EstimateTempo() {
+	const size_t Count = static_cast<size_t>(std::min<uint64_t>(this->HopIndex + 1, HistoryHops));
+	const uint64_t First = this->HopIndex + 1 - Count;
+
+	float Mean = 0.0f;
+	for (uint64_t i = First; i <= this->HopIndex; i++)
+		Mean += this->OdfAt(i);
+	Mean /= Count;
+
+	float Centered[HistoryHops];
+	for (size_t i = 0; i < Count; i++)
+		Centered[i] = this->OdfAt(First + i) - Mean;
+
+	auto Correlate = [&](size_t Lag) {
+		float Sum = 0.0f;
+		for (size_t i = Lag; i < Count; i++)
+			Sum += Centered[i] * Centered[i - Lag];
+		return Sum / (Count - Lag);
+	};
+
+	const float HopsPerMinute = 60.0f * this->SampleRate / HopSize;
+	const size_t MinLag = static_cast<size_t>(floorf(HopsPerMinute / MaxBpm));
+	const size_t MaxLag = std::min(static_cast<size_t>(ceilf(HopsPerMinute / MinBpm)), Count / 2);
+	const float Energy = Correlate(0);
+	if (Energy <= 0.0f || MinLag < 2 || MaxLag <= MinLag + 1)
+		return;
+
+	// Log-Gaussian preference around 120 BPM to settle octave errors
+	const float PreferredLag = HopsPerMinute / 120.0f;
+	float Best = 0.0f;
+	float BestWeighted = 0.0f;
+	size_t BestLag = 0;
+	float Values[HistoryHops];
+	for (size_t Lag = MinLag - 1; Lag <= MaxLag + 1; Lag++) {
+		Values[Lag] = Correlate(Lag);
+		if (Lag < MinLag || Lag > MaxLag)
+			continue;
+
+		float Octaves = log2f(static_cast<float>(Lag) / PreferredLag);
+		float Weighted = Values[Lag] * expf(-0.5f * Octaves * Octaves);
+		if (Weighted > BestWeighted) {
+			BestWeighted = Weighted;
+			Best = Values[Lag];
+			BestLag = Lag;
+		}
+	}
+	if (!BestLag)
+		return;
+
+	// Parabolic interpolation for a fractional period
+	float Left = Values[BestLag - 1];
+	float Right = Values[BestLag + 1];
+	float Denominator = Left - 2.0f * Best + Right;
+	float Offset = Denominator != 0.0f ? std::clamp(0.5f * (Left - Right) / Denominator, -0.5f, 0.5f) : 0.0f;
+	float Period = static_cast<float>(BestLag) + Offset;
+
+	// Follow small drifts smoothly, jump on a real tempo change
+	if (this->Period > 0.0f && fabsf(Period - this->Period) < this->Period * 0.05f)
+		this->Period += (Period - this->Period) * 0.25f;
+	else
+		this->Period = Period;
+
+	// Beat phase from a comb over the onset history, re-anchors the prediction if it drifted off
+	{
+		const int Teeth = static_cast<int>(Count / this->Period) - 1;
+		float BestScore = -1.0f;
+		float BestPhase = 0.0f;
+		for (int Phase = 0; Phase < static_cast<int>(this->Period); Phase++) {
+			float Score = 0.0f;
+			for (int k = 0; k < Teeth; k++) {
+				uint64_t Back = static_cast<uint64_t>(Phase + k * this->Period + 0.5f);
+				if (Back >= Count)
+					break;
+				Score += this->OdfAt(this->HopIndex - Back);
+			}
+			if (Score > BestScore) {
+				BestScore = Score;
+				BestPhase = static_cast<float>(Phase);
+			}
+		}
+
+		const double Predicted = static_cast<double>(this->HopIndex) - BestPhase + this->Period;
+		if (this->NextBeat < 0.0) {
+			this->NextBeat = Predicted;
+		} else {
+			double Error = Predicted - this->NextBeat;
+			Error -= this->Period * std::round(Error / this->Period);
+			this->NextBeat += fabs(Error) > this->Period * 0.15 ? Error : Error * 0.5;
+		}
+	}
+
+	this->Confidence = std::clamp(Best / Energy, 0.0f, 1.0f);
+	this->PublishedBpm.store(HopsPerMinute / this->Period, std::memory_order_relaxed);
+	this->PublishedConfidence.store(this->Confidence, std::memory_order_relaxed);
+}
+
+void BeatDetector_t::OnOnset(uint64_t Hop) {
+	if (this->Period <= 0.0f)
+		return;
+
+	if (this->NextBeat < 0.0) {
+		this->NextBeat = static_cast<double>(Hop);
+		return;
+	}
+
+	// Distance to the closest predicted beat, pull the phase towards onsets near the grid
+	double Error = static_cast<double>(Hop) - this->NextBeat;
+	Error -= this->Period * std::round(Error / this->Period);
+	if (fabs(Error) < this->Period * 0.2)
+		this->NextBeat += Error * 0.3;
+}
+
+void BeatDetector_t::EmitBeats() {
+	if (this->NextBeat < 0.0 || this->Period <= 0.0f)
+		return;
+
+	while (this->NextBeat <= static_cast<double>(this->HopIndex)) {
+		const uint64_t Hop = static_cast<uint64_t>(this->NextBeat);
+		const int BarPosition = static_cast<int>(this->BeatIndex % 4);
+
+		// Downbeats are the bar position that keeps collecting the loudest onsets. The
+		// previous beat is scored since its surroundings are complete by now
+		if (this->BeatIndex > 0) {
+			const int PrevPosition = static_cast<int>((this->BeatIndex - 1) % 4);
+			float Strength = 0.0f;
+			for (uint64_t i = this->LastBeat > 2 ? this->LastBeat - 2 : 0; i <= this->LastBeat + 2 && i <= this->HopIndex; i++)
+				Strength = std::max(Strength, this->Accents[i % HistoryHops]);
+			this->BarStrength[PrevPosition] = this->BarStrength[PrevPosition] * 0.9f + Strength;
+		}
+		this->LastBeat = Hop;
+
+		int Downbeat = 0;
+		for (int i = 1; i < 4; i++) {
+			if (this->BarStrength[i] > this->BarStrength[Downbeat])
+				Downbeat = i;
+		}
+
+		Beat_t Beat;
+		Beat.Sample = Hop * HopSize + HopSize - FrameSize / 2;
+		Beat.Bpm = 60.0f * this->SampleRate / HopSize / this->Period;
+		Beat.Confidence = this->Confidence;
+		Beat.IsDownbeat = BarPosition == Downbeat;
+
+		// Drop the beat if the consumer stopped polling instead of blocking the analysis
+		const uint64_t Write = this->QueueWrite.load(std::memory_order_relaxed);
+		if (Write - this->QueueRead.load(std::memory_order_acquire) < QueueSize) {
+			this->Queue[Write % QueueSize] = Beat;
+			this->QueueWrite.store(Write + 1, std::memory_order_release);
+		}
+
+		this->BeatIndex++;
+		this->NextBeat += this->Period;
+	}
+}
+
+bool BeatDetector_t::PollBeat(Beat_t* Beat) {
+	const uint64_t Read = this->QueueRead.load(std::memory_order_relaxed);
+	if (Read == this->QueueWrite.load(std::memory_order_acquire))
+		return false;
+
+	*Beat = this->Queue[Read % QueueSize];
+	this->QueueRead.store(Read + 1, std::memory_order_release);
+	return true;
+}
+
+float BeatDetector_t::GetBpm() const {
+	return this->PublishedBpm.load(std::memory_order_relaxed);
+}
+
+float BeatDetector_t::GetConfidence() const {
+	return this->PublishedConfidence.load(std::memory_order_relaxed);
+}
+
+size_t BeatDetector_t::GetLatency() const {
+	return FrameSize / 2 + HopSize;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include "../Analyzer/FFT.hpp"
+
+// Streaming onset / beat detector.
+// Onsets come from log-magnitude spectral flux with an adaptive threshold, the tempo
+// from the autocorrelation of the onset function, and beats from a phase locked
+// prediction that onsets pull back in line. Fed hop by hop from the analysis thread,
+// beats are read by polling from any single consumer thread.
+class BeatDetector_t {
+public:
+	static constexpr size_t HopSize = 512;
+	static constexpr size_t FrameSize = 1024;
+
+	struct Beat_t {
+		uint64_t Sample = 0;		// Position in the analysis feed
+		float Bpm = 0.0f;
+		float Confidence = 0.0f;	// 0..1, strength of the tempo estimate
+		bool IsDownbeat = false;
+	};
+
+private:
+	static constexpr size_t HistoryHops = 512;	// ~6s of onset function at 44.1kHz
+	static constexpr size_t TempoInterval = 32;	// Hops between tempo estimates
+	static constexpr size_t QueueSize = 64;
+	static constexpr float MinBpm = 60.0f;
+	static constexpr float MaxBpm = 200.0f;
+
+	int SampleRate = 0;
+	FFT_t FFT;
+
+	std::vector<float> Frame;
+	std::vector<float> Window;
+	std::vector<float> PrevMagnitude;
+	std::vector<float> PrevLinear;
+	std::vector<std::complex<float>> Spectrum;
+
+	// Onset detection function and onset loudness, one value per hop
+	std::vector<float> Odf;
+	std::vector<float> Accents;
+	uint64_t HopIndex = 0;
+	uint64_t LastOnset = 0;
+	float OdfPeak = 0.0f;
+
+	// Tempo and beat phase, all in hops
+	float Period = 0.0f;
+	float Confidence = 0.0f;
+	double NextBeat = -1.0;
+	uint64_t BeatIndex = 0;
+	uint64_t LastBeat = 0;
+	float BarStrength[4] = {};
+
+	Beat_t Queue[QueueSize];
+	std::atomic<uint64_t> QueueWrite = 0;
+	std::atomic<uint64_t> QueueRead = 0;
+
+	std::atomic<float> PublishedBpm = 0.0f;
+	std::atomic<float> PublishedConfidence = 0.0f;
+
+	float OdfAt(uint64_t Hop) const;
+	void EstimateTempo();
+	void OnOnset(uint64_t Hop);
+	void EmitBeats();
+
+public:
+	bool Init(int SampleRate);
+
+	// Exactly HopSize mono samples
+	void Process(const float* Hop);
+
+	// Pops the oldest beat that has not been polled yet
+	bool PollBeat(Beat_t* Beat);
+
+	float GetBpm() const;
+	float GetConfidence() const;
+
+	// Reported processing latency of an onset in samples
+	size_t GetLatency() const;
+};
@@ -0,0 +1,540 @@
+#include "ControlServer.hpp"
+#include "../MusicPlayer_t/MusicPlayer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+ControlServer_t ControlServer;
+
+// Flat objects only, enough for requests. Values stay raw, strings without their quotes
+struct Request_t {
+	static constexpr int MaxFields = 8;
+	std::string_view Keys[MaxFields];
+	std::string_view Values[MaxFields];
+	bool IsQuoted[MaxFields] = {};
+	int Count = 0;
+
+	std::string_view Get(std::string_view Key) const {
+		for (int i = 0; i < this->Count; i++) {
+			if (this->Keys[i] == Key)
+				return this->Values[i];
+		}
+		return {};
+	}
+
+	bool IsString(std::string_view Key) const {
+		for (int i = 0; i < this->Count; i++) {
+			if (this->Keys[i] == Key)
+				return this->IsQuoted[i];
+		}
+		return false;
+	}
+};
+
+static bool ParseRequest(std::string_view Line, Request_t* Request) {
+	size_t i = 0;
+	const auto SkipSpace = [&] {
+		while (i < Line.size() && (Line[i] == ' ' || Line[i] == '\t' || Line[i] == '\r'))
+			i++;
+	};
+	const auto ReadString = [&](std::string_view* Out) {
+		const size_t Start = ++i;
+		while (i < Line.size() && Line[i] != '"')
+			i += Line[i] == '\\' ? 2 : 1;
+		if (i >= Line.size())
+			return false;
+		*Out = Line.substr(Start, i++ - Start);
+		return true;
+	};
+
+	SkipSpace();
+	if (i >= Line.size() || Line[i++] != '{')
+		return false;
+
+	for (;;) {
+		SkipSpace();
+		if (i < Line.size() && Line[i] == '}')
+			return true;
+		if (i >= Line.size() || Line[i] != '"' || Request->Count == Request_t::MaxFields)
+			return false;
+
+		std::string_view& Key = Request->Keys[Request->Count];
+		std::string_view& Value = Request->Values[Request->Count];
+		if (!ReadString(&Key))
+			return false;
+		SkipSpace();
+		if (i >= Line.size() || Line[i++] != ':')
+			return false;
+		SkipSpace();
+		if (i < Line.size() && Line[i] == '"') {
+			if (!ReadString(&Value))
+				return false;
+			Request->IsQuoted[Request->Count] = true;
+		} else {
+			const size_t Start = i;
+			while (i < Line.size() && Line[i] != ',' && Line[i] != '}' && Line[i] != ' ')
+				i++;
+			Value = Line.substr(Start, i - Start);
+			if (Value.empty())
+				return false;
+		}
+		Request->Count++;
+
+		SkipSpace();
+		if (i < Line.size() && Line[i] == ',')
+			i++;
+	}
+}
+
+static double ToNumber(std::string_view Text) {
+	char Buffer[32];
+	const size_t Length = std::min(Text.size(), sizeof(Buffer) - 1);
+	memcpy(Buffer, Text.data(), Length);
+	Buffer[Length] = '\0';
+	return atof(Buffer);
+}
+
+// Queue entries go over the wire as "index.generation"
+static void AppendEntry(std::string* Out, Handle_t Entry) {
+	char Text[32];
+	snprintf(Text, sizeof(Text), "\"%u.%u\"", Entry.Index, Entry.Generation);
+	Out->append(Text);
+}
+
+static bool ToEntry(std::string_view Text, Handle_t* Entry) {
+	const size_t Dot = Text.find('.');
+	if (Dot == std::string_view::npos || Dot == 0 || Dot + 1 == Text.size() || Text.find_first_not_of("0123456789.") != std::string_view::npos || Text.size() > 21)
+		return false;
+	Entry->Index = static_cast<uint32_t>(ToNumber(Text.substr(0, Dot)));
+	Entry->Generation = static_cast<uint32_t>(ToNumber(Text.substr(Dot + 1)));
+	return true;
+}
+
+// Inverse of AppendEscaped(), enough for names and rules
+static std::string Unescape(std::string_view Text) {
+	std::string Out;
+	Out.reserve(Text.size());
+	for (size_t i = 0; i < Text.size(); i++) {
+		if (Text[i] == '\\' && i + 1 < Text.size())
+			i++;
+		Out.push_back(Text[i]);
+	}
+	return Out;
+}
+
+void ControlServer_t::AppendEscaped(std::string* Out, std::string_view Text) {
+	for (const char c : Text) {
+		if (c == '"' || c == '\\') {
+			Out->push_back('\\');
+			Out->push_back(c);
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			char Escape[8];
+			snprintf(Escape, sizeof(Escape), "\\u%04x", c);
+			Out->append(Escape);
+		} else {
+			Out->push_back(c);
+		}
+	}
+}
+
+ControlServer_t::~ControlServer_t() {
+	this->Stop();
+}
+
+std::filesystem::path ControlServer_t::GetDefaultPath() {
+#ifdef _WIN32
+	return std::filesystem::temp_directory_path() / "MusicPlayerV2.sock";
+#else
+	const char* Runtime = getenv("XDG_RUNTIME_DIR");
+	if (Runtime && *Runtime)
+		return std::filesystem::path(Runtime) / "MusicPlayerV2.sock";
+	return std::filesystem::temp_directory_path() / ("MusicPlayerV2-" + std::to_string(getuid()) + ".sock");
+#endif
+}
+
+bool ControlServer_t::Start(const std::filesystem::path& Path) {
+	this->Stop();
+
+	this->Listener = ListenUnix(Path);
+	if (this->Listener == NoSocket) {
+		printf("Failed to listen on '%s'\n", Path.string().c_str());
+		return false;
+	}
+
+	// The engine's state changes wake poll() through this
+	if (!MakeSocketPair(&this->WakeRead, &this->WakeWrite)) {
+		printf("Failed to set up the control socket\n");
+		CloseSocket(this->Listener);
+		return false;
+	}
+
+	if (!this->IsListening)
+		this->IsListening = MusicPlayer.AddStateListener(&ControlServer_t::OnState, this);
+
+	this->Path = Path;
+	this->IsWakePending = false;
+	this->SentVersion = MusicPlayer.GetState()->Version;
+	this->IsRunning = true;
+	this->Thread = std::thread(&ControlServer_t::ServerMain, this);
+	return true;
+}
+
+void ControlServer_t::Stop() {
+	if (!this->IsRunning)
+		return;
+
+	this->IsRunning = false;
+	this->IsWakePending = false;
+	this->Wake();
+	this->Thread.join();
+
+	for (Client_t& Client : this->Clients)
+		CloseSocket(Client.Socket);
+	this->Clients.clear();
+	{
+		std::lock_guard<std::mutex> Guard(this->WakeLock);
+		CloseSocket(this->WakeWrite);
+		this->WakeWrite = NoSocket;
+	}
+	CloseSocket(this->WakeRead);
+	CloseSocket(this->Listener);
+
+	std::error_code Error;
+	std::filesystem::remove(this->Path, Error);
+}
+
+uint64_t ControlServer_t::GetCommands() const {
+	return this->Commands.load(std::memory_order_relaxed);
+}
+
+void ControlServer_t::OnState(void* User) {
+	ControlServer_t* Server = static_cast<ControlServer_t*>(User);
+	if (Server->IsRunning.load(std::memory_order_relaxed))
+		Server->Wake();
+}
+
+void ControlServer_t::Wake() {
+	// One byte in flight is enough, the server looks at the latest state anyway
+	if (this->IsWakePending.exchange(true))
+		return;
+
+	std::lock_guard<std::mutex> Guard(this->WakeLock);
+	const char Byte = 0;
+	if (this->WakeWrite != NoSocket)
+		SendSocket(this->WakeWrite, &Byte, 1);
+}
+
+void ControlServer_t::AppendState(std::string* Out) {
+	const std::shared_ptr<const PlayerState_t> State = MusicPlayer.GetState();
+	const double Position = State->Clock ? std::min(State->Clock->Peek(), State->Duration) : 0.0;
+
+	char Fields[320];
+	snprintf(Fields, sizeof(Fields), "{\"event\":\"state\",\"version\":%llu,\"track\":%u,\"playing\":%s,\"opening\":%s,\"position\":%.3f,\"duration\":%.3f,\"volume\":%.1f,\"next\":%u,\"queued\":%zu,\"shuffle\":\"%s\",\"queue\":[",
+		static_cast<unsigned long long>(State->Version), State->CurrentTrack, State->IsPlaying ? "true" : "false", State->IsOpening ? "true" : "false",
+		Position, State->Duration, State->Volume, State->NextTrack, State->QueueLength,
+		State->Shuffle == Shuffle_t::Mode_t::Fair ? "fair" : State->Shuffle == Shuffle_t::Mode_t::Weighted ? "weighted" : "off");
+	Out->append(Fields);
+	for (size_t i = 0; i < PlayerState_t::MaxQueuePreview && State->QueuePreview[i] != PlayerState_t::NoTrack; i++) {
+		Out->append(i ? ",{\"track\":" : "{\"track\":");
+		Out->append(std::to_string(State->QueuePreview[i]));
+		Out->append(",\"entry\":");
+		AppendEntry(Out, State->QueueEntries[i]);
+		Out->push_back('}');
+	}
+	Out->append("],\"title\":\"");
+	if (State->Track)
+		AppendEscaped(Out, State->Track->Title);
+	Out->append("\"}\n");
+}
+
+void ControlServer_t::AppendPlaylists(std::string* Out) {
+	const std::shared_ptr<const PlayerState_t> State = MusicPlayer.GetState();
+	Out->append("{\"event\":\"playlists\",\"playlists\":[");
+	if (State->Playlists) {
+		for (const std::shared_ptr<const Playlist_t>& Shared : *State->Playlists) {
+			const Playlist_t& Playlist = *Shared;
+			if (&Shared != &State->Playlists->front())
+				Out->push_back(',');
+			Out->append("{\"name\":\"");
+			AppendEscaped(Out, Playlist.Name);
+			Out->append("\",\"rule\":\"");
+			AppendEscaped(Out, Playlist.Rule);
+			Out->append("\",\"count\":");
+			Out->append(std::to_string(Playlist.Tracks.size()));
+			Out->append(",\"tracks\":[");
+			for (size_t i = 0; i < std::min(Playlist.Tracks.size(), MaxListed); i++) {
+				if (i)
+					Out->push_back(',');
+				Out->append(std::to_string(Playlist.Tracks[i]));
+			}
+			Out->append("]}");
+		}
+	}
+	Out->append("]}\n");
+}
+
+void ControlServer_t::HandleRequest(std::string_view Line, std::string* Out, bool* IsSubscribed) {
+	using Type_t = MusicPlayer_t::CommandType_t;
+
+	Request_t Request;
+	const bool IsParsed = ParseRequest(Line, &Request);
+	const std::string_view Command = Request.Get("cmd");
+	const std::string_view Id = Request.Get("id");
+
+	const char* Error = nullptr;
+	std::string RuleError;
+	bool IsState = false;
+	bool IsPlaylists = false;
+	MusicPlayer_t::Command_t Posted = { Type_t::TogglePause };
+	bool IsPosted = true;
+	if (!IsParsed || Command.empty())
+		Error = "malformed request";
+	else if (Command == "play")
+		Posted.Type = Type_t::Play;
+	else if (Command == "pause")
+		Posted.Type = Type_t::Pause;
+	else if (Command == "toggle")
+		Posted.Type = Type_t::TogglePause;
+	else if (Command == "next")
+		Posted.Type = Type_t::Next;
+	else if (Command == "clearqueue")
+		Posted.Type = Type_t::ClearQueue;
+	else if (Command == "shuffle" && !Request.Get("mode").empty()) {
+		const std::string_view Mode = Request.Get("mode");
+		Posted = { Type_t::SetShuffle, PlayerState_t::NoTrack, 0.0f, Mode == "fair" ? 1.0f : Mode == "weighted" ? 2.0f : 0.0f };
+		if (Mode != "off" && Mode != "fair" && Mode != "weighted")
+			Error = "unknown shuffle mode";
+	}
+	else if (Command == "prev")
+		Posted.Type = Type_t::Previous;
+	else if (Command == "seek" && !Request.Get("seconds").empty())
+		Posted = { Type_t::Seek, PlayerState_t::NoTrack, static_cast<float>(ToNumber(Request.Get("seconds"))) };
+	else if ((Command == "unqueue" || Command == "move") && !Request.Get("entry").empty()) {
+		// Without "after" a moved entry goes first
+		Posted.Type = Command == "move" ? Type_t::MoveQueued : Type_t::Unqueue;
+		if (!ToEntry(Request.Get("entry"), &Posted.Entry) || (!Request.Get("after").empty() && !ToEntry(Request.Get("after"), &Posted.After)))
+			Error = "malformed entry";
+	}
+	else if ((Command == "select" || Command == "enqueue" || Command == "playnext" || Command == "unqueue") && !Request.Get("track").empty()) {
+		const Type_t Type = Command == "select" ? Type_t::Select : Command == "enqueue" ? Type_t::Enqueue : Command == "playnext" ? Type_t::PlayNext : Type_t::Unqueue;
+		Posted = { Type, static_cast<uint32_t>(ToNumber(Request.Get("track"))) };
+		if (MusicPlayer.GetState()->Library->IndexOf(Posted.Track) < 0)
+			Error = "unknown track";
+	}
+	else if (Command == "volume" && !Request.Get("value").empty())
+		Posted = { Type_t::SetVolume, PlayerState_t::NoTrack, 0.0f, static_cast<float>(ToNumber(Request.Get("value"))) };
+	else if (Command == "playlist" && !Request.Get("name").empty()) {
+		// Handed straight to the player, which wakes the engine itself
+		IsPosted = false;
+		if (!MusicPlayer.SetPlaylist(Unescape(Request.Get("name")), Unescape(Request.Get("rule")), &RuleError))
+			Error = RuleError.c_str();
+	}
+	else if (Command == "playlists") {
+		IsPosted = false;
+		IsPlaylists = true;
+	}
+	else if (Command == "state" || Command == "subscribe" || Command == "unsubscribe") {
+		IsPosted = false;
+		IsState = Command == "state";
+		if (Command != "state")
+			*IsSubscribed = Command == "subscribe";
+	} else
+		Error = "unknown command";
+
+	if (!Error && IsPosted)
+		MusicPlayer.Post(Posted);
+
+	// String ids go back escaped, bare ids only when they are plain numbers
+	Out->append("{");
+	if (Request.IsString("id")) {
+		Out->append("\"id\":\"");
+		AppendEscaped(Out, Unescape(Id.substr(0, 256)));
+		Out->append("\",");
+	} else if (!Id.empty() && Id.size() <= 20 && Id.find_first_not_of("-0123456789") == std::string_view::npos) {
+		Out->append("\"id\":");
+		Out->append(Id);
+		Out->append(",");
+	}
+	if (Error) {
+		Out->append("\"ok\":false,\"error\":\"");
+		AppendEscaped(Out, Error);
+		Out->append("\"}\n");
+	} else {
+		Out->append("\"ok\":true}\n");
+	}
+	if (IsState)
+		AppendState(Out);
+	if (IsPlaylists)
+		AppendPlaylists(Out);
+}
+
+void ControlServer_t::Execute(Client_t& Client, std::string_view Line) {
+	this->Commands.fetch_add(1, std::memory_order_relaxed);
+
+	const bool WasSubscribed = Client.IsSubscribed;
+	HandleRequest(Line, &Client.Out, &Client.IsSubscribed);
+	if (Client.IsSubscribed && !WasSubscribed)
+		Client.WantsState = true;
+}
+
+void ControlServer_t::Accept() {
+	for (;;) {
+		const Socket_t Socket = AcceptSocket(this->Listener);
+		if (Socket == NoSocket)
+			return;
+
+		if (this->Clients.size() >= MaxClients) {
+			CloseSocket(Socket);
+			continue;
+		}
+		Client_t Client;
+		Client.Socket = Socket;
+		this->Clients.push_back(std::move(Client));
+	}
+}
+
+void ControlServer_t::Receive(Client_t& Client) {
+	char Buffer[16384];
+	for (;;) {
+		const int Received = ReceiveSocket(Client.Socket, Buffer, sizeof(Buffer));
+		if (Received == 0 || (Received < 0 && !IsWouldBlock())) {
+			Client.IsClosed = true;
+			return;
+		}
+		if (Received < 0)
+			break;
+		Client.In.append(Buffer, Received);
+		if (Received < static_cast<int>(sizeof(Buffer)))
+			break;
+	}
+
+	size_t Start = 0;
+	for (size_t End; (End = Client.In.find('\n', Start)) != std::string::npos; Start = End + 1)
+		this->Execute(Client, std::string_view(Client.In).substr(Start, End - Start));
+	Client.In.erase(0, Start);
+
+	// Whatever this is, it isn't a request
+	if (Client.In.size() > MaxLine || Client.Out.size() > MaxPending)
+		Client.IsClosed = true;
+}
+
+void ControlServer_t::Flush(Client_t& Client) {
+	// A subscriber that reads slowly skips to the latest state instead of piling them up
+	if (Client.WantsState && Client.Out.size() < MaxPending / 2) {
+		AppendState(&Client.Out);
+		Client.WantsState = false;
+	}
+
+	size_t Sent = 0;
+	while (Sent < Client.Out.size()) {
+		const int Result = SendSocket(Client.Socket, Client.Out.data() + Sent, Client.Out.size() - Sent);
+		if (Result <= 0) {
+			if (!IsWouldBlock())
+				Client.IsClosed = true;
+			break;
+		}
+		Sent += Result;
+	}
+	Client.Out.erase(0, Sent);
+}
+
+void ControlServer_t::ServerMain() {
+	std::vector<PollEntry_t> Entries;
+	while (this->IsRunning) {
+		Entries.clear();
+		Entries.push_back({ this->Listener });
+		Entries.push_back({ this->WakeRead });
+		for (const Client_t& Client : this->Clients)
+			Entries.push_back({ Client.Socket, !Client.Out.empty() });
+
+		if (PollSockets(Entries.data(), Entries.size(), -1) < 0 && !IsWouldBlock()) {
+			printf("Control socket poll failed\n");
+			break;
+		}
+
+		if (Entries[1].IsReadable) {
+			char Drain[64];
+			this->IsWakePending = false;
+			while (ReceiveSocket(this->WakeRead, Drain, sizeof(Drain)) > 0) {}
+
+			const uint64_t Version = MusicPlayer.GetState()->Version;
+			if (Version != this->SentVersion) {
+				this->SentVersion = Version;
+				for (Client_t& Client : this->Clients)
+					Client.WantsState |= Client.IsSubscribed;
+			}
+		}
+
+		// Clients accepted now weren't polled yet, they come around on the next pass
+		const size_t Polled = this->Clients.size();
+		for (size_t i = 0; i < Polled; i++) {
+			Client_t& Client = this->Clients[i];
+			if (Entries[i + 2].IsReadable)
+				this->Receive(Client);
+			if (!Client.IsClosed)
+				this->Flush(Client);
+		}
+		if (Entries[0].IsReadable)
+			this->Accept();
+
+		for (size_t i = 0; i < this->Clients.size();) {
+			if (this->Clients[i].IsClosed) {
+				CloseSocket(this->Clients[i].Socket);
+				this->Clients[i] = std::move(this->Clients.back());
+				this->Clients.pop_back();
+			} else {
+				i++;
+			}
+		}
+	}
+}
+
+ControlClient_t::~ControlClient_t() {
+	this->Close();
+}
+
+bool ControlClient_t::Connect(const std::filesystem::path& Path) {
+	this->Close();
+	this->Socket = ConnectUnix(Path);
+	if (this->Socket == NoSocket) {
+		printf("Failed to connect to '%s'\n", Path.string().c_str());
+		return false;
+	}
+	return true;
+}
+
+void ControlClient_t::Close() {
+	CloseSocket(this->Socket);
+	this->Socket = NoSocket;
+	this->In.clear();
+}
+
+bool ControlClient_t::Send(std::string_view Lines) {
+	while (!Lines.empty()) {
+		const int Sent = SendSocket(this->Socket, Lines.data(), Lines.size());
+		if (Sent <= 0)
+			return false;
+		Lines.remove_prefix(Sent);
+	}
+	return true;
+}
+
+bool ControlClient_t::ReadLine(std::string* Line) {
+	size_t End;
+	while ((End = this->In.find('\n')) == std::string::npos) {
+		char Buffer[16384];
+		const int Received = ReceiveSocket(this->Socket, Buffer, sizeof(Buffer));
+		if (Received <= 0)
+			return false;
+		this->In.append(Buffer, Received);
+	}
+	Line->assign(this->In, 0, End);
+	this->In.erase(0, End + 1);
+	return true;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../Socket/Socket.hpp"
+
+// Remote control over a local Unix domain socket, for running the player unattended.
+// One JSON object per line each way, requests are answered in order:
+//   {"cmd":"play"}  "pause"  "toggle"  "next"  "prev"   Transport
+//   {"cmd":"seek","seconds":12.5}                        Current track
+//   {"cmd":"select","track":3}  {"cmd":"enqueue","track":3}
+//   {"cmd":"playnext","track":3}  {"cmd":"unqueue","track":3}  {"cmd":"clearqueue"}
+//   {"cmd":"unqueue","entry":"4.1"}  {"cmd":"move","entry":"4.1","after":"2.1"}  Queue entries from the state,
+//                                                        a move without "after" goes first
+//   {"cmd":"volume","value":80}                          0 to 100
+//   {"cmd":"shuffle","mode":"fair"}                      "off", "fair" or "weighted"
+//   {"cmd":"playlist","name":"Warmup","rule":"bpm 120-126"}  Sets a smart playlist, no rule removes it
+//   {"cmd":"playlists"}                                  Replies with the smart playlists and their tracks
+//   {"cmd":"state"}                                      Replies with the current state
+//   {"cmd":"subscribe"}  {"cmd":"unsubscribe"}           State pushed on every change
+// An optional "id", a number or a string, is echoed in the reply, {"id":7,"ok":true} or {"ok":false,"error":"..."}.
+// Commands are posted to the engine like the UI's clicks, ok means accepted, not executed yet.
+// State lines look like {"event":"state","version":12,"track":3,"playing":true,...,"queue":[{"track":5,"entry":"4.1"}],"title":"..."},
+// where the queue holds its first few places. A subscriber that reads slowly only gets the latest one once it caught up.
+class ControlServer_t {
+public:
+	static constexpr size_t MaxClients = 64;
+	static constexpr size_t MaxLine = 1024;
+	static constexpr size_t MaxPending = 256 * 1024;	// Unsent replies before a client is dropped
+	static constexpr size_t MaxListed = 1000;			// Track ids per playlist in a reply, "count" has them all
+
+private:
+	struct Client_t {
+		Socket_t Socket;
+		std::string In;
+		std::string Out;
+		bool IsSubscribed = false;
+		bool WantsState = false;
+		bool IsClosed = false;
+	};
+
+	std::filesystem::path Path;
+	Socket_t Listener = NoSocket;
+	Socket_t WakeRead = NoSocket;
+	Socket_t WakeWrite = NoSocket;
+	std::vector<Client_t> Clients;
+	uint64_t SentVersion = 0;
+
+	std::atomic<bool> IsRunning = false;
+	std::atomic<bool> IsWakePending = false;
+	std::mutex WakeLock;	// WakeWrite against Stop() closing it
+	bool IsListening = false;
+	std::thread Thread;
+
+	std::atomic<uint64_t> Commands = 0;
+
+	void ServerMain();
+	void Wake();
+	void Accept();
+	void Receive(Client_t& Client);
+	void Flush(Client_t& Client);
+	void Execute(Client_t& Client, std::string_view Line);
+
+	static void OnState(void* User);
+
+public:
+	~ControlServer_t();
+
+	// Replaces a stale socket file at Path. Registers for state changes, so call it before MusicPlayer.Start()
+	bool Start(const std::filesystem::path& Path);
+	void Stop();
+
+	// Requests handled since startup
+	uint64_t GetCommands() const;
+
+	// Per-user default location of the socket
+	static std::filesystem::path GetDefaultPath();
+
+	// State as one line, the same that subscribers get
+	static void AppendState(std::string* Out);
+	static void AppendPlaylists(std::string* Out);
+
+	// Text for inside a JSON string
+	static void AppendEscaped(std::string* Out, std::string_view Text);
+
+	// Runs one request line and appends the reply line(s), shared with the other remotes.
+	// (Un)subscribing only flips *IsSubscribed, pushing the states is up to the caller
+	static void HandleRequest(std::string_view Line, std::string* Out, bool* IsSubscribed);
+
+} extern ControlServer;
+
+// Blocking client end, for tests and scripts
+class ControlClient_t {
+private:
+	Socket_t Socket = NoSocket;
+	std::string In;
+
+public:
+	~ControlClient_t();
+
+	bool Connect(const std::filesystem::path& Path);
+	void Close();
+
+	bool Send(std::string_view Lines);
+	// Without the newline, false once the server closed the connection
+	bool ReadLine(std::string* Line);
+};
@@ -0,0 +1,195 @@
+#include "FacetIndex.hpp"
+#include "../SmartPlaylist/SmartPlaylist.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+uint32_t FacetIndex_t::Intern(Field_t Field, const std::string& Value) {
+	Dictionary_t& Dictionary = this->Dictionaries[Field];
+	TrackColumns_t::Fold(Value, &this->FoldScratch);
+	const auto [Found, IsNew] = Dictionary.Lookup.try_emplace(this->FoldScratch, static_cast<uint32_t>(Dictionary.Values.size()));
+	if (IsNew) {
+		Dictionary.Values.push_back(Value);
+		Dictionary.Folded.push_back(this->FoldScratch);
+		Dictionary.Counts.push_back(0);
+		Dictionary.Order.push_back(Found->second);
+		Dictionary.IsOrdered = false;
+	}
+	return Found->second;
+}
+
+void FacetIndex_t::Remove(uint32_t Id) {
+	if (Id >= this->IsCounted.size() || !this->IsCounted[Id])
+		return;
+
+	for (int Field = 0; Field < Fields; Field++)
+		this->Dictionaries[Field].Counts[this->Codes[Field][Id]]--;
+	this->IsCounted[Id] = false;
+}
+
+void FacetIndex_t::Add(const LibraryTrack_t& Track) {
+	if (Track.Id >= this->IsCounted.size()) {
+		this->IsCounted.resize(Track.Id + 1, false);
+		for (std::vector<uint32_t>& Codes : this->Codes)
+			Codes.resize(Track.Id + 1, 0);
+	}
+	this->Remove(Track.Id);
+
+	const std::string* Texts[Fields] = { &Track.Genre, &Track.Artist, &Track.Album };
+	for (int Field = 0; Field < Fields; Field++) {
+		const uint32_t Code = this->Intern(static_cast<Field_t>(Field), *Texts[Field]);
+		this->Codes[Field][Track.Id] = Code;
+		this->Dictionaries[Field].Counts[Code]++;
+	}
+	this->IsCounted[Track.Id] = true;
+}
+
+void FacetIndex_t::Sync(const std::shared_ptr<const Library_t>& Library, const std::vector<uint32_t>* Order) {
+	if (!Library)
+		return;
+	if (Library == this->Library) {
+		if (Order != this->Order) {
+			this->Order = Order;
+			this->Filter();
+		}
+		return;
+	}
+
+	if (this->Library && Library->Version == this->Version + 1) {
+		for (const uint32_t Id : Library->Removed)
+			this->Remove(Id);
+		for (const uint32_t Row : Library->Added)
+			this->Add(Library->Tracks[Row]);
+	} else {
+		// Versions were skipped, the diffs in between are lost
+		for (Dictionary_t& Dictionary : this->Dictionaries)
+			std::fill(Dictionary.Counts.begin(), Dictionary.Counts.end(), 0);
+		std::fill(this->IsCounted.begin(), this->IsCounted.end(), false);
+		for (const LibraryTrack_t& Track : Library->Tracks)
+			this->Add(Track);
+	}
+	this->Library = Library;
+	this->Version = Library->Version;
+	this->Order = Order;
+	for (int Field = 0; Field < Fields; Field++) {
+		std::vector<uint32_t>& RowCodes = this->RowCodes[Field];
+		RowCodes.resize(Library->Tracks.size());
+		for (size_t Row = 0; Row < RowCodes.size(); Row++)
+			RowCodes[Row] = this->Codes[Field][Library->Tracks[Row].Id];
+	}
+
+	for (Dictionary_t& Dictionary : this->Dictionaries) {
+		if (Dictionary.IsOrdered)
+			continue;
+		std::sort(Dictionary.Order.begin(), Dictionary.Order.end(), [&](uint32_t Left, uint32_t Right) {
+			return Dictionary.Folded[Left] < Dictionary.Folded[Right];
+		});
+		Dictionary.IsOrdered = true;
+	}
+
+	// A selection whose tracks are all gone widens again
+	for (int Field = 0; Field < Fields; Field++) {
+		if (this->Selected[Field] != All && !this->Dictionaries[Field].Counts[this->Selected[Field]]) {
+			for (int Right = Field; Right < Fields; Right++)
+				this->Selected[Right] = All;
+			break;
+		}
+	}
+	this->Filter();
+}
+
+void FacetIndex_t::Filter() {
+	const size_t Tracks = this->Library->Tracks.size();
+	const uint32_t SelectedGenre = this->Selected[Genre];
+	const uint32_t SelectedArtist = this->Selected[Artist];
+	const uint32_t SelectedAlbum = this->Selected[Album];
+	const bool IsArtistNarrowed = SelectedGenre != All;
+	const bool IsAlbumNarrowed = IsArtistNarrowed || SelectedArtist != All;
+
+	this->Totals[Genre] = static_cast<uint32_t>(Tracks);
+	this->Totals[Artist] = 0;
+	this->Totals[Album] = 0;
+	this->Matches.clear();
+	if (IsArtistNarrowed)
+		this->Narrowed[Artist].assign(this->Dictionaries[Artist].Values.size(), 0);
+	if (IsAlbumNarrowed)
+		this->Narrowed[Album].assign(this->Dictionaries[Album].Values.size(), 0);
+
+	if (!IsAlbumNarrowed && SelectedAlbum == All) {
+		if (this->Order) {
+			this->Matches.assign(this->Order->begin(), this->Order->end());
+		} else {
+			this->Matches.resize(Tracks);
+			std::iota(this->Matches.begin(), this->Matches.end(), 0);
+		}
+		this->Totals[Artist] = this->Totals[Album] = this->Totals[Genre];
+	} else {
+		// Each column is narrowed by the ones to its left, the tracks by all three
+		const uint32_t* Genres = this->RowCodes[Genre].data();
+		const uint32_t* Artists = this->RowCodes[Artist].data();
+		const uint32_t* Albums = this->RowCodes[Album].data();
+		for (size_t i = 0; i < Tracks; i++) {
+			const size_t Row = this->Order ? (*this->Order)[i] : i;
+			if (SelectedGenre != All && Genres[Row] != SelectedGenre)
+				continue;
+			this->Totals[Artist]++;
+			if (IsArtistNarrowed)
+				this->Narrowed[Artist][Artists[Row]]++;
+
+			if (SelectedArtist != All && Artists[Row] != SelectedArtist)
+				continue;
+			this->Totals[Album]++;
+			if (IsAlbumNarrowed)
+				this->Narrowed[Album][Albums[Row]]++;
+
+			if (SelectedAlbum != All && Albums[Row] != SelectedAlbum)
+				continue;
+			this->Matches.push_back(static_cast<uint32_t>(Row));
+		}
+	}
+
+	for (int Field = 0; Field < Fields; Field++) {
+		this->Listed[Field].clear();
+		for (const uint32_t Code : this->Dictionaries[Field].Order) {
+			if (this->GetCount(static_cast<Field_t>(Field), Code))
+				this->Listed[Field].push_back(Code);
+		}
+	}
+}
+
+void FacetIndex_t::Select(Field_t Field, uint32_t Value) {
+	this->Selected[Field] = Value;
+	for (int Right = Field + 1; Right < Fields; Right++)
+		this->Selected[Right] = All;
+	if (this->Library)
+		this->Filter();
+}
+
+uint32_t FacetIndex_t::GetSelected(Field_t Field) const {
+	return this->Selected[Field];
+}
+
+const std::vector<uint32_t>& FacetIndex_t::GetValues(Field_t Field) const {
+	return this->Listed[Field];
+}
+
+uint32_t FacetIndex_t::GetCount(Field_t Field, uint32_t Value) const {
+	const bool IsNarrowed = Field == Artist ? this->Selected[Genre] != All : Field == Album ? this->Selected[Genre] != All || this->Selected[Artist] != All : false;
+	return IsNarrowed ? this->Narrowed[Field][Value] : this->Dictionaries[Field].Counts[Value];
+}
+
+uint32_t FacetIndex_t::GetTotal(Field_t Field) const {
+	return this->Totals[Field];
+}
+
+const std::string& FacetIndex_t::GetName(Field_t Field, uint32_t Value) const {
+	return this->Dictionaries[Field].Values[Value];
+}
+
+const std::vector<uint32_t>& FacetIndex_t::GetTracks() const {
+	return this->Matches;
+}
+
+const std::shared_ptr<const Library_t>& FacetIndex_t::GetLibrary() const {
+	return this->Library;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../PlayerState/PlayerState.hpp"
+
+// Genre, artist and album of every track with the number of tracks per value, for the column
+// browser. Values get a code the first time they show up and keep it, the counts follow the
+// scanner's diffs from one library to the next. A library that skipped versions is read in full.
+// Selecting a value narrows the columns to its right and the tracks in one pass over the library.
+// Not thread-safe, owned by the UI thread.
+class FacetIndex_t {
+public:
+	enum Field_t {
+		Genre,
+		Artist,
+		Album,
+		Fields,
+	};
+
+	static constexpr uint32_t All = UINT32_MAX;
+
+private:
+	struct Dictionary_t {
+		std::vector<std::string> Values;	// Spelled like the first track that had it
+		std::vector<std::string> Folded;
+		std::unordered_map<std::string, uint32_t> Lookup;
+		std::vector<uint32_t> Counts;		// Tracks in the whole library
+		std::vector<uint32_t> Order;		// Codes in alphabetical order
+		bool IsOrdered = true;
+	};
+
+	Dictionary_t Dictionaries[Fields];
+	std::string FoldScratch;
+
+	// By track id, what each track was counted under
+	std::vector<uint32_t> Codes[Fields];
+	std::vector<uint8_t> IsCounted;
+	// The same in library order, so filtering doesn't have to walk the tracks themselves
+	std::vector<uint32_t> RowCodes[Fields];
+
+	std::shared_ptr<const Library_t> Library;
+	uint64_t Version = 0;
+	const std::vector<uint32_t>* Order = nullptr;
+
+	uint32_t Selected[Fields] = { All, All, All };
+	// Tracks per value within the selection to the left of the column, and the column's total
+	std::vector<uint32_t> Narrowed[Fields];
+	uint32_t Totals[Fields] = {};
+	// Values with tracks there, in order
+	std::vector<uint32_t> Listed[Fields];
+	// Library rows of the tracks within the whole selection
+	std::vector<uint32_t> Matches;
+
+	uint32_t Intern(Field_t Field, const std::string& Value);
+	void Remove(uint32_t Id);
+	void Add(const LibraryTrack_t& Track);
+	void Filter();
+
+public:
+	// Catches up with Library, nothing happens if it's the one already indexed. Order holds Library's
+	// rows the way the tracks should be listed, null for library order. It has to stay valid until the next Sync()
+	void Sync(const std::shared_ptr<const Library_t>& Library, const std::vector<uint32_t>* Order = nullptr);
+
+	// All widens the column again. Either way the columns to its right go back to All
+	void Select(Field_t Field, uint32_t Value);
+	uint32_t GetSelected(Field_t Field) const;
+
+	const std::vector<uint32_t>& GetValues(Field_t Field) const;
+	// Within the selection to the left of the column
+	uint32_t GetCount(Field_t Field, uint32_t Value) const;
+	uint32_t GetTotal(Field_t Field) const;
+	const std::string& GetName(Field_t Field, uint32_t Value) const;
+
+	// Rows into the synced library, in the order given to Sync()
+	const std::vector<uint32_t>& GetTracks() const;
+	const std::shared_ptr<const Library_t>& GetLibrary() const;
+};
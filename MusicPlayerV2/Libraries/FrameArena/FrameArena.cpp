@@ -0,0 +1,73 @@
+#include "FrameArena.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+FrameArena_t FrameArena;
+
+FrameArena_t::FrameArena_t(size_t Capacity) : Block(new uint8_t[Capacity]), Capacity(Capacity) {
+}
+
+void FrameArena_t::Reset() {
+	// Grow so the whole previous frame would have fit, with some headroom
+	if (this->OverflowBytes) {
+		this->Capacity = (this->Used + this->OverflowBytes) * 2;
+		this->Block.reset(new uint8_t[this->Capacity]);
+		this->Overflow.clear();
+		this->OverflowBytes = 0;
+	}
+
+	this->Used = 0;
+}
+
+void* FrameArena_t::Allocate(size_t Size, size_t Alignment) {
+	const uintptr_t Base = reinterpret_cast<uintptr_t>(this->Block.get());
+	const uintptr_t Aligned = (Base + this->Used + Alignment - 1) & ~(static_cast<uintptr_t>(Alignment) - 1);
+	const size_t End = static_cast<size_t>(Aligned - Base) + Size;
+
+	if (End <= this->Capacity) {
+		this->Used = End;
+		return reinterpret_cast<void*>(Aligned);
+	}
+
+	// Doesn't fit, hand out heap memory until the next Reset() makes room
+	this->Overflow.emplace_back(new uint8_t[Size + Alignment]);
+	this->OverflowBytes += Size + Alignment;
+	const uintptr_t Fallback = reinterpret_cast<uintptr_t>(this->Overflow.back().get());
+	return reinterpret_cast<void*>((Fallback + Alignment - 1) & ~(static_cast<uintptr_t>(Alignment) - 1));
+}
+
+const char* FrameArena_t::Format(const char* Format, ...) {
+	va_list Args;
+	va_start(Args, Format);
+	va_list Measure;
+	va_copy(Measure, Args);
+	const int Length = vsnprintf(nullptr, 0, Format, Measure);
+	va_end(Measure);
+
+	if (Length < 0) {
+		va_end(Args);
+		return "";
+	}
+
+	char* Text = this->Allocate<char>(static_cast<size_t>(Length) + 1);
+	vsnprintf(Text, static_cast<size_t>(Length) + 1, Format, Args);
+	va_end(Args);
+	return Text;
+}
+
+const char* FrameArena_t::Copy(const char* Text, size_t Length) {
+	char* Out = this->Allocate<char>(Length + 1);
+	memcpy(Out, Text, Length);
+	Out[Length] = '\0';
+	return Out;
+}
+
+size_t FrameArena_t::GetUsed() const {
+	return this->Used;
+}
+
+size_t FrameArena_t::GetCapacity() const {
+	return this->Capacity;
+}
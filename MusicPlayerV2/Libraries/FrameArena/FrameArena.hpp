@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator for memory that only lives until the end of the UI frame, e.g. polygon
+// points and formatted text. Everything is released at once by Reset() at the start of
+// the next frame. If a frame needs more than the block holds, the rest comes from the heap
+// and the block grows to fit on the next Reset(), so a steady state frame never allocates.
+class FrameArena_t {
+private:
+	std::unique_ptr<uint8_t[]> Block;
+	size_t Capacity = 0;
+	size_t Used = 0;
+
+	// Requests that did not fit this frame
+	std::vector<std::unique_ptr<uint8_t[]>> Overflow;
+	size_t OverflowBytes = 0;
+
+public:
+	explicit FrameArena_t(size_t Capacity = 64 * 1024);
+
+	// Frees everything handed out since the last call, call once at the start of a frame
+	void Reset();
+
+	void* Allocate(size_t Size, size_t Alignment = alignof(std::max_align_t));
+
+	// Uninitialized storage for Count objects of a trivial type
+	template <typename T>
+	T* Allocate(size_t Count) {
+		return static_cast<T*>(this->Allocate(sizeof(T) * Count, alignof(T)));
+	}
+
+	// printf into the arena, valid until the next Reset()
+	const char* Format(const char* Format, ...);
+
+	// Copy of the first Length characters, null terminated
+	const char* Copy(const char* Text, size_t Length);
+
+	size_t GetUsed() const;
+	size_t GetCapacity() const;
+
+} extern FrameArena;
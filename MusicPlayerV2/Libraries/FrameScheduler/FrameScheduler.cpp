@@ -0,0 +1,71 @@
+#include "FrameScheduler.hpp"
+
+#include <algorithm>
+
+FrameScheduler_t FrameScheduler;
+
+int64_t FrameScheduler_t::ToNanoseconds(Clock_t::time_point Time) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Time.time_since_epoch()).count();
+}
+
+void FrameScheduler_t::RequestAt(int64_t Deadline) {
+	int64_t Current = this->NextFrame.load(std::memory_order_relaxed);
+	while (Deadline < Current) {
+		if (this->NextFrame.compare_exchange_weak(Current, Deadline, std::memory_order_relaxed)) {
+			if (this->WakeCallback)
+				this->WakeCallback();
+			break;
+		}
+	}
+}
+
+void FrameScheduler_t::RequestFrame() {
+	this->RequestAt(ToNanoseconds(Clock_t::now()));
+}
+
+void FrameScheduler_t::RequestFrameIn(float Seconds) {
+	const int64_t Delay = static_cast<int64_t>(std::max(Seconds, 0.0f) * 1e9f);
+	this->RequestAt(ToNanoseconds(Clock_t::now()) + Delay);
+}
+
+void FrameScheduler_t::RequestAnimationFrame() {
+	this->RequestAt(this->LastFrame + static_cast<int64_t>(1e9f / this->MaxFrameRate));
+}
+
+bool FrameScheduler_t::IsFrameDue(Clock_t::time_point Now) const {
+	return this->GetTimeUntilFrame(Now) == Clock_t::duration::zero();
+}
+
+FrameScheduler_t::Clock_t::duration FrameScheduler_t::GetTimeUntilFrame(Clock_t::time_point Now) const {
+	const int64_t Next = this->NextFrame.load(std::memory_order_relaxed);
+	if (Next == NoDeadline)
+		return Clock_t::duration::max();
+
+	// Never draw faster than the frame rate cap, even if requests keep coming in
+	const int64_t Earliest = std::max(Next, this->LastFrame + static_cast<int64_t>(1e9f / this->MaxFrameRate));
+	const int64_t Remaining = Earliest - ToNanoseconds(Now);
+	if (Remaining <= 0)
+		return Clock_t::duration::zero();
+
+	return std::chrono::duration_cast<Clock_t::duration>(std::chrono::nanoseconds(Remaining));
+}
+
+void FrameScheduler_t::BeginFrame(Clock_t::time_point Now) {
+	this->LastFrame = ToNanoseconds(Now);
+
+	// Only clear requests this frame satisfies, later deadlines stay pending
+	int64_t Current = this->NextFrame.load(std::memory_order_relaxed);
+	while (Current <= this->LastFrame && !this->NextFrame.compare_exchange_weak(Current, NoDeadline, std::memory_order_relaxed));
+	this->Frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameScheduler_t::CountWakeup() {
+	this->Wakeups.fetch_add(1, std::memory_order_relaxed);
+}
+
+FrameScheduler_t::Stats_t FrameScheduler_t::GetStats() const {
+	Stats_t Stats;
+	Stats.Frames = this->Frames.load(std::memory_order_relaxed);
+	Stats.Wakeups = this->Wakeups.load(std::memory_order_relaxed);
+	return Stats;
+}
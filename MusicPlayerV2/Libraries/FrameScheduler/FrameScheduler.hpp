@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Decides when the UI has to be redrawn.
+// Widgets ask for a frame when something changes or an animation needs its next step,
+// and the window loop sleeps until the earliest request instead of spinning.
+// Requests are thread-safe, so the engine can ask for a redraw from its own thread.
+class FrameScheduler_t {
+public:
+	using Clock_t = std::chrono::steady_clock;
+
+	struct Stats_t {
+		uint64_t Frames = 0;
+		uint64_t Wakeups = 0;
+	};
+
+private:
+	static constexpr int64_t NoDeadline = INT64_MAX;
+
+	// Nanoseconds on Clock_t of the earliest requested frame
+	std::atomic<int64_t> NextFrame = 0;
+	int64_t LastFrame = 0;
+
+	std::atomic<uint64_t> Frames = 0;
+	std::atomic<uint64_t> Wakeups = 0;
+
+	static int64_t ToNanoseconds(Clock_t::time_point Time);
+	void RequestAt(int64_t Deadline);
+
+public:
+	float MaxFrameRate = 60.0f;
+
+	// Set by the window loop, called when a request arrives from another thread while it sleeps
+	void (*WakeCallback)() = nullptr;
+
+	// Something changed, draw as soon as the frame rate cap allows
+	void RequestFrame();
+
+	// Draw again after the given time, e.g. when an animation resumes
+	void RequestFrameIn(float Seconds);
+
+	// Next step of a running animation, at the frame rate cap
+	void RequestAnimationFrame();
+
+	bool IsFrameDue(Clock_t::time_point Now) const;
+
+	// Time until the next frame is due, zero if it already is, max() if none is requested
+	Clock_t::duration GetTimeUntilFrame(Clock_t::time_point Now) const;
+
+	// Consumes the pending request, call right before building the frame
+	void BeginFrame(Clock_t::time_point Now);
+
+	void CountWakeup();
+
+	Stats_t GetStats() const;
+
+} extern FrameScheduler;
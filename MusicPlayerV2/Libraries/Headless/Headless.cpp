@@ -0,0 +1,2332 @@
+#include "Headless.hpp"
+#include "../ImGui/imgui.h"
+#include "../ImGui/imgui_impl_soft.h"
+#include "../Interface/Interface.hpp"
+#include "../MusicPlayer_t/MusicPlayer.hpp"
+#include "../PlaybackClock/PlaybackClock.hpp"
+#include "../SeekTable/SeekTable.hpp"
+#include "../Scrubber/Scrubber.hpp"
+#include "../MappedFile/MappedFile.hpp"
+#include "../WaveFile/WaveFile.hpp"
+#include "../AudioHash/AudioHash.hpp"
+#include "../ControlServer/ControlServer.hpp"
+#include "../RemoteServer/RemoteServer.hpp"
+#include "../PlayQueue/PlayQueue.hpp"
+#include "../Shuffle/Shuffle.hpp"
+#include "../PlayStats/PlayStats.hpp"
+#include "../SmartPlaylist/SmartPlaylist.hpp"
+#include "../FacetIndex/FacetIndex.hpp"
+#include "../TrackSort/TrackSort.hpp"
+#include "../TimerWheel/TimerWheel.hpp"
+#include "../LevelMeter/LevelMeter.hpp"
+#include "../Analyzer/Analyzer.hpp"
+#include "../BeatDetector/BeatDetector.hpp"
+#include "../FrameScheduler/FrameScheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <ctime>
+#endif
+
+Headless_t Headless;
+
+// Counts heap allocations made by the render thread during a frame, engine update included,
+// other threads (audio, analysis) are not part of the frame and stay uncounted
+static thread_local bool IsCountingAllocations = false;
+static thread_local uint64_t AllocationCount = 0;
+
+void* operator new(std::size_t Size) {
+	if (IsCountingAllocations)
+		AllocationCount++;
+
+	if (void* Memory = std::malloc(Size ? Size : 1))
+		return Memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* Memory) noexcept {
+	std::free(Memory);
+}
+
+void operator delete(void* Memory, std::size_t) noexcept {
+	std::free(Memory);
+}
+
+// ImGui goes straight to malloc unless told otherwise
+static void* CountingImGuiAlloc(size_t Size, void*) {
+	if (IsCountingAllocations)
+		AllocationCount++;
+	return std::malloc(Size);
+}
+
+static void CountingImGuiFree(void* Memory, void*) {
+	std::free(Memory);
+}
+
+void Headless_t::RenderFrame() {
+	const uint64_t AllocationsBefore = AllocationCount;
+	IsCountingAllocations = true;
+
+	MusicPlayer.Update();
+
+	ImGui_ImplSoft_NewFrame(this->DeltaTime);
+
+	const auto BuildStart = std::chrono::steady_clock::now();
+	ImGui::NewFrame();
+	Interface.Draw();
+	ImGui::Render();
+	const auto RasterStart = std::chrono::steady_clock::now();
+
+	ImGui_ImplSoft_Clear(IM_COL32(0, 0, 0, 255));
+	ImGui_ImplSoft_RenderDrawData(ImGui::GetDrawData());
+	const auto RasterEnd = std::chrono::steady_clock::now();
+
+	IsCountingAllocations = false;
+	this->Stats.Allocations += AllocationCount - AllocationsBefore;
+
+	const double Build = std::chrono::duration<double, std::micro>(RasterStart - BuildStart).count();
+	const double Raster = std::chrono::duration<double, std::micro>(RasterEnd - RasterStart).count();
+	this->Stats.Frames++;
+	this->Stats.BuildMicroseconds += Build;
+	this->Stats.RasterMicroseconds += Raster;
+	this->Stats.MaxBuildMicroseconds = std::max(this->Stats.MaxBuildMicroseconds, Build);
+	this->Stats.MaxRasterMicroseconds = std::max(this->Stats.MaxRasterMicroseconds, Raster);
+
+	// Same handling as the window, minus the things a framebuffer can't do
+	if (Interface.RequestedSize.x > 0.0f && Interface.RequestedSize.y > 0.0f) {
+		ImGui_ImplSoft_SetSize(static_cast<int>(Interface.RequestedSize.x), static_cast<int>(Interface.RequestedSize.y));
+		Interface.RequestedSize = ImVec2(0.0f, 0.0f);
+	}
+	Interface.WantsMinimize = false;
+}
+
+bool Headless_t::WriteImage(const std::string& Path) const {
+	int Width = 0;
+	int Height = 0;
+	const ImU32* Pixels = ImGui_ImplSoft_GetPixels(&Width, &Height);
+
+	std::ofstream File(Path, std::ios::binary);
+	if (!File) {
+		printf("Failed to open %s for writing\n", Path.c_str());
+		return false;
+	}
+
+	// Uncompressed 32 bit true color TGA, top-left origin
+	uint8_t Header[18] = {};
+	Header[2] = 2;
+	Header[12] = static_cast<uint8_t>(Width & 0xFF);
+	Header[13] = static_cast<uint8_t>(Width >> 8);
+	Header[14] = static_cast<uint8_t>(Height & 0xFF);
+	Header[15] = static_cast<uint8_t>(Height >> 8);
+	Header[16] = 32;
+	Header[17] = 0x28;
+	File.write(reinterpret_cast<const char*>(Header), sizeof(Header));
+
+	std::vector<uint8_t> Row(static_cast<size_t>(Width) * 4);
+	for (int y = 0; y < Height; y++) {
+		for (int x = 0; x < Width; x++) {
+			const ImU32 Color = Pixels[y * Width + x];
+			Row[x * 4 + 0] = static_cast<uint8_t>(Color >> IM_COL32_B_SHIFT);
+			Row[x * 4 + 1] = static_cast<uint8_t>(Color >> IM_COL32_G_SHIFT);
+			Row[x * 4 + 2] = static_cast<uint8_t>(Color >> IM_COL32_R_SHIFT);
+			Row[x * 4 + 3] = static_cast<uint8_t>(Color >> IM_COL32_A_SHIFT);
+		}
+		File.write(reinterpret_cast<const char*>(Row.data()), Row.size());
+	}
+
+	return File.good();
+}
+
+bool Headless_t::ReadImage(const std::string& Path, int* Width, int* Height, std::vector<uint32_t>* Pixels) {
+	std::ifstream File(Path, std::ios::binary);
+	if (!File)
+		return false;
+
+	uint8_t Header[18];
+	if (!File.read(reinterpret_cast<char*>(Header), sizeof(Header)))
+		return false;
+
+	// Only what WriteImage() produces, uncompressed 32 bit
+	if (Header[2] != 2 || Header[16] != 32)
+		return false;
+
+	File.seekg(Header[0], std::ios::cur);
+	*Width = Header[12] | (Header[13] << 8);
+	*Height = Header[14] | (Header[15] << 8);
+	const bool TopLeft = (Header[17] & 0x20) != 0;
+
+	std::vector<uint8_t> Data(static_cast<size_t>(*Width) * *Height * 4);
+	if (!File.read(reinterpret_cast<char*>(Data.data()), Data.size()))
+		return false;
+
+	Pixels->resize(static_cast<size_t>(*Width) * *Height);
+	for (int y = 0; y < *Height; y++) {
+		const uint8_t* Row = &Data[static_cast<size_t>(TopLeft ? y : *Height - 1 - y) * *Width * 4];
+		for (int x = 0; x < *Width; x++)
+			(*Pixels)[y * *Width + x] = IM_COL32(Row[x * 4 + 2], Row[x * 4 + 1], Row[x * 4 + 0], Row[x * 4 + 3]);
+	}
+	return true;
+}
+
+bool Headless_t::CompareImage(const std::string& Path, int Tolerance, double MaxFraction) const {
+	int GoldenWidth = 0;
+	int GoldenHeight = 0;
+	std::vector<uint32_t> Golden;
+	if (!ReadImage(Path, &GoldenWidth, &GoldenHeight, &Golden)) {
+		printf("Failed to load golden image %s\n", Path.c_str());
+		return false;
+	}
+
+	int Width = 0;
+	int Height = 0;
+	const ImU32* Pixels = ImGui_ImplSoft_GetPixels(&Width, &Height);
+	if (Width != GoldenWidth || Height != GoldenHeight) {
+		printf("%s: size %dx%d does not match %dx%d\n", Path.c_str(), Width, Height, GoldenWidth, GoldenHeight);
+		this->WriteImage(Path + ".actual.tga");
+		return false;
+	}
+
+	size_t Different = 0;
+	int MaxError = 0;
+	for (size_t i = 0; i < Golden.size(); i++) {
+		int PixelError = 0;
+		for (int Shift = 0; Shift < 32; Shift += 8)
+			PixelError = std::max(PixelError, std::abs(static_cast<int>((Pixels[i] >> Shift) & 0xFF) - static_cast<int>((Golden[i] >> Shift) & 0xFF)));
+
+		MaxError = std::max(MaxError, PixelError);
+		if (PixelError > Tolerance)
+			Different++;
+	}
+
+	const double Fraction = Golden.empty() ? 0.0 : static_cast<double>(Different) / Golden.size();
+	if (Fraction > MaxFraction) {
+		printf("%s: %zu pixels (%.3f%%) differ, max error %d\n", Path.c_str(), Different, Fraction * 100.0, MaxError);
+		this->WriteImage(Path + ".actual.tga");
+		return false;
+	}
+
+	printf("%s: match, max error %d\n", Path.c_str(), MaxError);
+	return true;
+}
+
+bool Headless_t::CheckMeter(double MaxLoadPercent) const {
+	constexpr double Pi = 3.14159265358979323846;
+	constexpr int SampleRate = 48000;
+
+	// EBU Tech 3341 cases, stereo with the same signal on both channels
+	struct Case_t {
+		const char* Name;
+		double Frequency;		// Hz, or a fraction of the sample rate if below 1
+		double PeakDb;			// Of the continuous sine
+		double PhaseDegrees;
+		double Seconds;
+		const char* Measure;	// "m" or "s" for momentary or short-term LUFS, "tp", "peak" or "rms" in dBFS
+		double Expected;
+		double Below;			// Allowed error under and over Expected
+		double Above;
+	};
+	static const Case_t Cases[] = {
+		{ "1 kHz at -23 dBFS, momentary", 1000.0, -23.0, 0.0, 20.0, "m", -23.0, 0.1, 0.1 },
+		{ "1 kHz at -23 dBFS, short-term", 1000.0, -23.0, 0.0, 20.0, "s", -23.0, 0.1, 0.1 },
+		{ "1 kHz at -33 dBFS, short-term", 1000.0, -33.0, 0.0, 20.0, "s", -33.0, 0.1, 0.1 },
+		{ "1 kHz at -23 dBFS, RMS", 1000.0, -23.0, 0.0, 1.0, "rms", -26.01, 0.05, 0.05 },
+		{ "fs/4 at -6 dBFS, phase 0, true peak", 0.25, -6.0, 0.0, 1.0, "tp", -6.0, 0.4, 0.2 },
+		{ "fs/4 at -6 dBFS, phase 45, true peak", 0.25, -6.0, 45.0, 1.0, "tp", -6.0, 0.4, 0.2 },
+		{ "fs/4 at -6 dBFS, phase 45, sample peak", 0.25, -6.0, 45.0, 1.0, "peak", -9.01, 0.05, 0.05 },
+		{ "fs/6 at -6 dBFS, phase 60, true peak", 1.0 / 6.0, -6.0, 60.0, 1.0, "tp", -6.0, 0.4, 0.2 },
+		{ "fs/8 at -6 dBFS, phase 67.5, true peak", 0.125, -6.0, 67.5, 1.0, "tp", -6.0, 0.4, 0.2 },
+		{ "fs/4 at +3 dBFS, phase 45, true peak", 0.25, 3.0, 45.0, 1.0, "tp", 3.0, 0.4, 0.2 },
+	};
+
+	bool IsPassed = true;
+	auto Meter = std::make_unique<LevelMeter_t>();
+	std::vector<float> Chunk(1024 * LevelMeter_t::MaxChannels);
+	for (const Case_t& Case : Cases) {
+		Meter->Configure(SampleRate, LevelMeter_t::MaxChannels);
+		const double Step = 2.0 * Pi * (Case.Frequency < 1.0 ? Case.Frequency : Case.Frequency / SampleRate);
+		const double Amplitude = pow(10.0, Case.PeakDb / 20.0);
+		const size_t Frames = static_cast<size_t>(Case.Seconds * SampleRate);
+
+		// Fed in output DSP sized chunks
+		for (size_t Done = 0; Done < Frames;) {
+			const size_t Count = std::min<size_t>(1024, Frames - Done);
+			for (size_t i = 0; i < Count; i++) {
+				const float Sample = static_cast<float>(Amplitude * sin(Step * static_cast<double>(Done + i) + Case.PhaseDegrees * Pi / 180.0));
+				for (int c = 0; c < LevelMeter_t::MaxChannels; c++)
+					Chunk[i * LevelMeter_t::MaxChannels + c] = Sample;
+			}
+			Meter->Process(Chunk.data(), Count);
+			Done += Count;
+		}
+
+		const LevelMeter_t::Levels_t Levels = Meter->GetLevels();
+		const std::string Measure = Case.Measure;
+		const double Reading = Measure == "m" ? Levels.Momentary : Measure == "s" ? Levels.ShortTerm
+			: 20.0 * log10(Measure == "tp" ? Levels.TruePeak[0] : Measure == "peak" ? Levels.Peak[0] : Levels.Rms[0]);
+		const bool IsInside = Reading >= Case.Expected - Case.Below && Reading <= Case.Expected + Case.Above;
+		printf("meter: %-40s %7.2f, %.2f expected%s\n", Case.Name, Reading, Case.Expected, IsInside ? "" : ", out of tolerance");
+		IsPassed = IsPassed && IsInside;
+	}
+
+	// The load over a minute of noise
+	Meter->Configure(SampleRate, LevelMeter_t::MaxChannels);
+	std::mt19937 Random(7);
+	std::uniform_real_distribution<float> Noise(-0.5f, 0.5f);
+	for (float& Sample : Chunk)
+		Sample = Noise(Random);
+	for (int i = 0; i < 60 * SampleRate / 1024; i++)
+		Meter->Process(Chunk.data(), 1024);
+	const double LoadPercent = Meter->GetLoad() * 100.0;
+	printf("meter: %.3f%% of a core at %d Hz stereo\n", LoadPercent, SampleRate);
+	return IsPassed && LoadPercent <= MaxLoadPercent;
+}
+
+bool Headless_t::CheckAnalyzer(double MaxMicroseconds) const {
+	constexpr double Pi = 3.14159265358979323846;
+	constexpr int SampleRate = 48000;
+	constexpr size_t Block = SampleRate / 60;
+
+	auto Analyzer = std::make_unique<Analyzer_t>();
+	if (!Analyzer->Start(SampleRate, false)) {
+		printf("analyzer: failed to start\n");
+		return false;
+	}
+
+	// A -6 dBFS sine on every band's center has to light up that band at -6 dB, and its neighbours well below it
+	bool IsPassed = true;
+	std::vector<float> Feed(Block * 2);
+	uint64_t Phase = 0;
+	const auto Play = [&](double Frequency, float Amplitude, size_t Frames) {
+		for (size_t Done = 0; Done < Frames; Done += Block) {
+			for (size_t i = 0; i < Block; i++, Phase++)
+				Feed[i * 2] = Feed[i * 2 + 1] = Amplitude * static_cast<float>(sin(2.0 * Pi * Frequency * Phase / SampleRate));
+			Analyzer->Push(Feed.data(), Block, 2);
+		}
+	};
+
+	const int BandCount = Analyzer->GetBandCount();
+	float Bands[Analyzer_t::MaxBands];
+	float MinSeparation = 1e9f;
+	for (int Band = 0; Band < BandCount; Band++) {
+		Play(Analyzer->GetBandFrequency(Band), 0.5f, 16384);
+		Analyzer->Analyze();
+		Analyzer->GetBands(Bands, BandCount);
+
+		const int Loudest = static_cast<int>(std::max_element(Bands, Bands + BandCount) - Bands);
+		const float Decibel = Bands[Band] * 60.0f - 60.0f;
+		float Neighbour = 0.0f;
+		if (Band > 0)
+			Neighbour = Bands[Band - 1];
+		if (Band + 1 < BandCount)
+			Neighbour = std::max(Neighbour, Bands[Band + 1]);
+		const float Separation = (Bands[Band] - Neighbour) * 60.0f;
+		MinSeparation = std::min(MinSeparation, Separation);
+
+		if (Loudest != Band || fabsf(Decibel + 6.0f) > 1.0f || Separation < 3.0f) {
+			printf("analyzer: %.1f Hz landed in the %.1f Hz band, %.1f dB there and %.1f dB over its neighbours\n",
+				Analyzer->GetBandFrequency(Band), Analyzer->GetBandFrequency(Loudest), Decibel, Separation);
+			IsPassed = false;
+		}
+	}
+
+	// Realtime pace, one update per 60th of a second of music
+	for (int i = 0; i < 600; i++) {
+		Play(1000.0, 0.5f, Block);
+		Analyzer->Analyze();
+	}
+
+	const double Microseconds = Analyzer->GetUpdateCost();
+	printf("analyzer: %d bands, neighbours at least %.1f dB down, %.1f us per update\n", BandCount, MinSeparation, Microseconds);
+	return IsPassed && Microseconds <= MaxMicroseconds;
+}
+
+bool Headless_t::CheckBeats(double Bpm, double MaxMilliseconds) const {
+	constexpr double Pi = 3.14159265358979323846;
+	constexpr int SampleRate = 44100;
+	constexpr double Seconds = 40.0;
+	constexpr double Settle = 12.0;		// Seconds before beats count
+
+	BeatDetector_t Detector;
+	if (!Detector.Init(SampleRate)) {
+		printf("beats: failed to start\n");
+		return false;
+	}
+
+	// 4/4 clicks, 20 ms 2 kHz bursts with the first of every bar twice as loud
+	const double Interval = 60.0 * SampleRate / Bpm;
+	const size_t ClickFrames = SampleRate / 50;
+	const auto GetSample = [&](uint64_t Sample) {
+		const uint64_t Click = static_cast<uint64_t>(Sample / Interval);
+		const double Offset = static_cast<double>(Sample) - std::ceil(Click * Interval);
+		if (Offset < 0.0 || Offset >= ClickFrames)
+			return 0.0f;
+		const double Gain = Click % 4 == 0 ? 0.8 : 0.4;
+		return static_cast<float>(Gain * exp(-Offset / (ClickFrames / 5.0)) * sin(2.0 * Pi * 2000.0 * Offset / SampleRate));
+	};
+
+	float Hop[BeatDetector_t::HopSize];
+	uint64_t Fed = 0;
+	size_t Beats = 0, Downbeats = 0, RightDownbeats = 0;
+	double ErrorSum = 0.0, MaxError = 0.0;
+	while (Fed < Seconds * SampleRate) {
+		for (size_t i = 0; i < BeatDetector_t::HopSize; i++)
+			Hop[i] = GetSample(Fed + i);
+		Detector.Process(Hop);
+		Fed += BeatDetector_t::HopSize;
+
+		BeatDetector_t::Beat_t Beat;
+		while (Detector.PollBeat(&Beat)) {
+			if (Beat.Sample < Settle * SampleRate)
+				continue;
+
+			// Against the closest click
+			const double Click = std::round(Beat.Sample / Interval);
+			const double Error = std::abs(static_cast<double>(Beat.Sample) - std::ceil(Click * Interval)) * 1000.0 / SampleRate;
+			ErrorSum += Error;
+			MaxError = std::max(MaxError, Error);
+			Beats++;
+			if (Beat.IsDownbeat) {
+				Downbeats++;
+				if (static_cast<uint64_t>(Click) % 4 == 0)
+					RightDownbeats++;
+			}
+		}
+	}
+
+	const double Expected = (Seconds - Settle) * Bpm / 60.0;
+	const double BpmError = std::abs(Detector.GetBpm() - Bpm) / Bpm;
+	printf("beats: %.0f BPM read as %.1f BPM, confidence %.2f, %zu beats of %.0f, %.1f ms off on average and %.1f ms at most, %zu of %zu downbeats on the bar, %zu samples latency\n",
+		Bpm, Detector.GetBpm(), Detector.GetConfidence(), Beats, Expected, ErrorSum / std::max<size_t>(Beats, 1), MaxError,
+		RightDownbeats, Downbeats, Detector.GetLatency());
+	return BpmError <= 0.02 && std::abs(Beats - Expected) <= 2.0 && MaxError <= MaxMilliseconds
+		&& Downbeats && RightDownbeats * 10 >= Downbeats * 9;
+}
+
+bool Headless_t::CheckClockDrift(double Seconds, double MaxErrorMilliseconds) const {
+	using Clock_t = PlaybackClock_t::Clock_t;
+
+	// The sink plays at a device clock 50 ppm off the nominal rate, reports its position in
+	// 64 frame steps and calls back every 10 ms with a few ms of jitter. The UI reads the
+	// clock at 60 Hz on its own schedule. Everything runs on virtual time, so it is repeatable.
+	constexpr uint32_t SampleRate = 44100;
+	constexpr double DeviceRate = SampleRate * (1.0 + 50e-6);
+	constexpr double CallbackPeriod = 0.010;
+	constexpr double FramePeriod = 1.0 / 60.0;
+
+	std::mt19937 Random(1234);
+	std::uniform_real_distribution<double> Jitter(-0.003, 0.003);
+
+	const Clock_t::time_point Origin = Clock_t::now();
+	auto At = [&](double Time) {
+		return Origin + std::chrono::duration_cast<Clock_t::duration>(std::chrono::duration<double>(Time));
+	};
+	auto SinkSeconds = [&](double Time) {
+		return std::floor(Time * DeviceRate / 64.0) * 64.0 / SampleRate;
+	};
+
+	PlaybackClock_t Clock;
+	Clock.Reset(SampleRate, At(0.0));
+	Clock.Start(At(0.0));
+
+	double NextCallback = CallbackPeriod;
+	double MaxError = 0.0;
+	double Error = 0.0;
+	for (double Frame = FramePeriod; Frame < Seconds; Frame += FramePeriod) {
+		while (NextCallback <= Frame) {
+			Clock.Publish(static_cast<uint64_t>(std::floor(NextCallback * DeviceRate / 64.0) * 64.0), At(NextCallback));
+			NextCallback += CallbackPeriod + Jitter(Random);
+		}
+
+		Error = Clock.GetSeconds(At(Frame)) - SinkSeconds(Frame);
+		MaxError = std::max(MaxError, std::abs(Error));
+	}
+
+	printf("clock: %.0f s, max error %.3f ms, final error %.3f ms\n", Seconds, MaxError * 1000.0, Error * 1000.0);
+	return MaxError * 1000.0 <= MaxErrorMilliseconds;
+}
+
+bool Headless_t::StressEngine(double Seconds, int Threads) const {
+	MusicPlayer.Start();
+
+	std::atomic<bool> IsDone = false;
+	std::atomic<uint64_t> Posted = 0;
+	std::vector<std::thread> Posters;
+	for (int t = 0; t < Threads; t++) {
+		Posters.emplace_back([&, t] {
+			std::mt19937 Random(t + 1);
+			while (!IsDone) {
+				const std::shared_ptr<const PlayerState_t> State = MusicPlayer.GetState();
+
+				MusicPlayer_t::Command_t Command = { static_cast<MusicPlayer_t::CommandType_t>(Random() % 4) };
+				if (Command.Type == MusicPlayer_t::CommandType_t::Select && !State->Library->Tracks.empty())
+					Command.Track = State->Library->Tracks[Random() % State->Library->Tracks.size()].Id;
+
+				MusicPlayer.Post(Command);
+				Posted++;
+				std::this_thread::sleep_for(std::chrono::microseconds(Random() % 500));
+			}
+		});
+	}
+
+	// Read like the UI does, as fast as possible
+	bool IsConsistent = true;
+	uint64_t Reads = 0;
+	uint64_t FirstVersion = MusicPlayer.GetState()->Version;
+	uint64_t LastVersion = FirstVersion;
+	const auto End = std::chrono::steady_clock::now() + std::chrono::duration<double>(Seconds);
+	while (IsConsistent && std::chrono::steady_clock::now() < End) {
+		const std::shared_ptr<const PlayerState_t> State = MusicPlayer.GetState();
+		Reads++;
+
+		if (State->Version < LastVersion) {
+			printf("stress: version went from %llu back to %llu\n", static_cast<unsigned long long>(LastVersion), static_cast<unsigned long long>(State->Version));
+			IsConsistent = false;
+		}
+		LastVersion = State->Version;
+
+		const bool HasTrack = State->CurrentTrack != PlayerState_t::NoTrack;
+		if (!State->Library || (HasTrack && !State->IsOpening) != static_cast<bool>(State->Clock) || (HasTrack && State->Library->IndexOf(State->CurrentTrack) < 0)) {
+			printf("stress: inconsistent state in version %llu\n", static_cast<unsigned long long>(State->Version));
+			IsConsistent = false;
+		}
+
+		if (State->Clock && State->Clock->GetSeconds() < 0.0)
+			IsConsistent = false;
+	}
+
+	IsDone = true;
+	for (std::thread& Poster : Posters)
+		Poster.join();
+	MusicPlayer.Stop();
+
+	printf("stress: %llu commands from %d threads, %llu reads, %llu versions\n", static_cast<unsigned long long>(Posted.load()), Threads,
+		static_cast<unsigned long long>(Reads), static_cast<unsigned long long>(LastVersion - FirstVersion));
+	return IsConsistent;
+}
+
+bool Headless_t::CheckTimers(int Count, uint64_t Span) const {
+	struct Check_t {
+		TimerWheel_t Wheel;
+		std::vector<uint64_t> Deadlines;
+		std::vector<bool> HasFired;
+		bool IsExact = true;
+	};
+	auto Check = std::make_unique<Check_t>();
+
+	const TimerWheel_t::Callback_t OnFire = [](void* User, uint64_t Data) {
+		Check_t* Check = static_cast<Check_t*>(User);
+		if (Check->HasFired[Data] || Check->Wheel.GetNow() != Check->Deadlines[Data])
+			Check->IsExact = false;
+		Check->HasFired[Data] = true;
+	};
+
+	// Rounds of up to Capacity timers, the wheel is fixed size
+	std::mt19937_64 Random(1);
+	double ScheduleNanoseconds = 0.0;
+	double AdvanceNanoseconds = 0.0;
+	int Scheduled = 0;
+	uint64_t Ticks = 0;
+	while (Check->IsExact && Scheduled < Count) {
+		const int Round = std::min<int>(Count - Scheduled, TimerWheel_t::Capacity);
+		const uint64_t Start = Check->Wheel.GetNow();
+		Check->Deadlines.assign(Round, 0);
+		Check->HasFired.assign(Round, false);
+		std::vector<Handle_t> Handles(Round);
+		for (int i = 0; i < Round; i++)
+			Check->Deadlines[i] = Start + 1 + Random() % std::max<uint64_t>(Span, 1);
+
+		auto Time = std::chrono::steady_clock::now();
+		for (int i = 0; i < Round; i++)
+			Handles[i] = Check->Wheel.Schedule(Check->Deadlines[i], OnFire, Check.get(), i);
+		for (int i = 0; i < Round; i += 3)
+			Check->Wheel.Cancel(Handles[i]);
+		ScheduleNanoseconds += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Time).count();
+
+		Time = std::chrono::steady_clock::now();
+		Check->Wheel.Advance(Start + Span);
+		AdvanceNanoseconds += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Time).count();
+
+		for (int i = 0; i < Round; i++) {
+			if (Check->HasFired[i] == (i % 3 == 0))
+				Check->IsExact = false;
+		}
+		Scheduled += Round;
+		Ticks += Span;
+	}
+
+	printf("timers: %d over %llu ms, %.1fns per schedule or cancel, %.1fns per elapsed tick%s\n", Scheduled, static_cast<unsigned long long>(Span),
+		ScheduleNanoseconds / (Scheduled + (Scheduled + 2) / 3), AdvanceNanoseconds / std::max<uint64_t>(Ticks, 1),
+		Check->IsExact ? "" : ", some fired late, early or after being cancelled");
+	return Check->IsExact;
+}
+
+bool Headless_t::BenchmarkVoices(size_t Max, int Updates) const {
+	if (MusicPlayer.GetState()->Library->Tracks.empty()) {
+		printf("voices: the music folder is empty\n");
+		return false;
+	}
+
+	const size_t Limit = MusicPlayer.VoiceLimit;
+	MusicPlayer.VoiceLimit = Max;
+
+	bool IsValid = true;
+	for (size_t Count = 1; Count <= Max; Count++) {
+		// Every selection leaves the previous tracks fading out
+		const std::shared_ptr<const Library_t> Library = MusicPlayer.GetState()->Library;
+		for (size_t i = 0; i < 64 && MusicPlayer.GetState()->Voices < Count; i++) {
+			MusicPlayer.Post({ MusicPlayer_t::CommandType_t::Select, Library->Tracks[i % Library->Tracks.size()].Id });
+			MusicPlayer.Update();
+		}
+
+		const size_t Voices = MusicPlayer.GetState()->Voices;
+		const auto Start = std::chrono::steady_clock::now();
+		for (int i = 0; i < Updates; i++)
+			MusicPlayer.Update();
+		const double Elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+
+		printf("voices %zu: %.2fus per update, mixer at %.1f%% CPU\n", Voices, Elapsed / std::max(Updates, 1), BASS_GetCPU());
+		if (Voices != Count) {
+			printf("voices: %zu voices sounding, %zu expected\n", Voices, Count);
+			IsValid = false;
+		}
+	}
+
+	MusicPlayer.VoiceLimit = Limit;
+	return IsValid;
+}
+
+bool Headless_t::BenchmarkSeek(const std::string& Path, int Count, double MaxMilliseconds) const {
+	const auto Milliseconds = [](std::chrono::steady_clock::time_point Start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+	};
+
+	SeekTable_t Table;
+	auto Time = std::chrono::steady_clock::now();
+	if (!Table.Build(Path)) {
+		printf("seek: no seek table for %s\n", Path.c_str());
+		return false;
+	}
+	const double BuildTime = Milliseconds(Time);
+
+	const std::filesystem::path CacheFile = SeekTable_t::GetCachePath(Path);
+	Time = std::chrono::steady_clock::now();
+	const bool IsCached = Table.Save(CacheFile) && Table.Load(CacheFile, Path);
+	const double CacheTime = Milliseconds(Time);
+	if (!IsCached) {
+		printf("seek: failed to cache the table in %s\n", CacheFile.string().c_str());
+		return false;
+	}
+
+	printf("seek: %zu frames, %.1f s, built in %.1f ms, saved and loaded in %.2f ms\n", Table.GetFrameCount(),
+		static_cast<double>(Table.GetSamples()) / Table.GetSampleRate(), BuildTime, CacheTime);
+
+	// Prescanning makes BASS itself exact, its output is what every seek has to match
+	const HSTREAM Reference = BASS_StreamCreateFile(FALSE, Path.c_str(), 0, 0, BASS_STREAM_DECODE | BASS_STREAM_PRESCAN | BASS_SAMPLE_FLOAT);
+	if (!Reference) {
+		printf("seek: BASS failed to open %s\n", Path.c_str());
+		return false;
+	}
+
+	BASS_CHANNELINFO Info = {};
+	BASS_ChannelGetInfo(Reference, &Info);
+	const DWORD BytesPerFrame = std::max<DWORD>(Info.chans, 1) * sizeof(float);
+	constexpr DWORD CompareFrames = 1152;
+	std::vector<float> Expected(CompareFrames * std::max<DWORD>(Info.chans, 1));
+	std::vector<float> Actual(Expected.size());
+
+	std::mt19937_64 Random(1);
+	double Total = 0.0, Slowest = 0.0;
+	int Mismatches = 0;
+	for (int i = 0; i < Count; i++) {
+		const uint64_t Sample = Random() % std::max<uint64_t>(Table.GetSamples() - CompareFrames, 1);
+
+		// Same steps as a seek during playback, on a decoding stream instead of a playing one
+		Time = std::chrono::steady_clock::now();
+		const SeekTable_t::Point_t Point = Table.Find(Sample);
+		const HSTREAM Stream = BASS_StreamCreateFile(FALSE, Path.c_str(), Point.Offset, 0, BASS_STREAM_DECODE | BASS_SAMPLE_FLOAT);
+		const bool IsPositioned = Stream && BASS_ChannelSetPosition(Stream, Point.Discard * BytesPerFrame, BASS_POS_BYTE | BASS_POS_DECODETO);
+		const double Elapsed = Milliseconds(Time);
+		Total += Elapsed;
+		Slowest = std::max(Slowest, Elapsed);
+
+		const DWORD Length = static_cast<DWORD>(Actual.size() * sizeof(float));
+		bool IsSame = IsPositioned && BASS_ChannelGetData(Stream, Actual.data(), Length) == Length
+			&& BASS_ChannelSetPosition(Reference, Sample * BytesPerFrame, BASS_POS_BYTE)
+			&& BASS_ChannelGetData(Reference, Expected.data(), Length) == Length;
+		for (size_t j = 0; IsSame && j < Actual.size(); j++)
+			IsSame = fabsf(Actual[j] - Expected[j]) < 1e-4f;
+		if (!IsSame && Mismatches++ < 5)
+			printf("seek: landed off target at sample %llu\n", static_cast<unsigned long long>(Sample));
+		BASS_StreamFree(Stream);
+	}
+	BASS_StreamFree(Reference);
+
+	printf("seek: %d seeks, %.3f ms avg / %.3f ms max, %d off target\n", Count, Total / std::max(Count, 1), Slowest, Mismatches);
+	return Mismatches == 0 && Slowest <= MaxMilliseconds;
+}
+
+// Read calls the whole process made so far
+static uint64_t GetReadCalls() {
+#ifdef _WIN32
+	IO_COUNTERS Counters;
+	return GetProcessIoCounters(GetCurrentProcess(), &Counters) ? Counters.ReadOperationCount : 0;
+#else
+	std::ifstream Stream("/proc/self/io");
+	std::string Key;
+	uint64_t Value = 0;
+	while (Stream >> Key >> Value) {
+		if (Key == "syscr:")
+			return Value;
+	}
+	return 0;
+#endif
+}
+
+bool Headless_t::CountReads(const std::string& Path, uint64_t MaxReads) const {
+	// Reading the counter may count itself
+	const uint64_t First = GetReadCalls();
+	const uint64_t Overhead = GetReadCalls() - First;
+
+	const auto DecodeAll = [](HSTREAM Stream) {
+		const QWORD Length = BASS_ChannelGetLength(Stream, BASS_POS_BYTE);
+		std::vector<uint8_t> Buffer(1 << 16);
+		QWORD Decoded = 0;
+		while (Decoded < Length) {
+			const DWORD Got = BASS_ChannelGetData(Stream, Buffer.data(), static_cast<DWORD>(Buffer.size()));
+			if (Got == static_cast<DWORD>(-1) || Got == 0)
+				break;
+			Decoded += Got;
+		}
+		BASS_StreamFree(Stream);
+		return Decoded;
+	};
+
+	struct Pass_t {
+		const char* Name;
+		uint64_t Reads;
+		double Milliseconds;
+		bool IsValid;
+	} Passes[3] = {};
+
+	for (int i = 0; i < 3; i++) {
+		const uint64_t Before = GetReadCalls();
+		const auto Start = std::chrono::steady_clock::now();
+		bool IsValid = false;
+		if (i == 0) {
+			Passes[i].Name = "file reader";
+			const HSTREAM Stream = BASS_StreamCreateFile(FALSE, Path.c_str(), 0, 0, BASS_STREAM_DECODE | BASS_SAMPLE_FLOAT);
+			IsValid = Stream && DecodeAll(Stream) > 0;
+		} else if (i == 1) {
+			Passes[i].Name = "mapping";
+			const std::shared_ptr<const MappedFile_t> Mapping = MappedFile_t::Map(Path);
+			const HSTREAM Stream = Mapping ? BASS_StreamCreateFile(TRUE, Mapping->GetData(), 0, Mapping->GetSize(), BASS_STREAM_DECODE | BASS_SAMPLE_FLOAT) : 0;
+			IsValid = Stream && DecodeAll(Stream) > 0;
+		} else {
+			Passes[i].Name = "seek table walk";
+			SeekTable_t Table;
+			IsValid = Table.Build(Path);
+		}
+		Passes[i].Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+		Passes[i].Reads = GetReadCalls() - Before - Overhead;
+		Passes[i].IsValid = IsValid;
+
+		printf("io: %-16s %6llu reads, %.1f ms%s\n", Passes[i].Name, static_cast<unsigned long long>(Passes[i].Reads),
+			Passes[i].Milliseconds, IsValid ? "" : ", failed");
+	}
+
+	return Passes[0].IsValid && Passes[1].IsValid && Passes[2].IsValid && Passes[1].Reads <= MaxReads;
+}
+
+bool Headless_t::CheckScrub(const std::string& Path, const std::string& WavePath, int Moves, double MaxMilliseconds) const {
+	auto Scrubber = std::make_unique<Scrubber_t>();
+	Scrubber->Start(Path, 0.0, false);
+	const auto Deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+	while (!Scrubber->GetIsReady() && std::chrono::steady_clock::now() < Deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	if (!Scrubber->GetIsReady()) {
+		printf("scrub: failed to open %s\n", Path.c_str());
+		return false;
+	}
+
+	// Stands in for the device: pulls small blocks exactly as fast as they would play
+	constexpr uint32_t SinkFrames = 256;
+	const uint32_t SampleRate = Scrubber->GetSampleRate();
+	const uint32_t Channels = Scrubber->GetChannels();
+	const uint64_t MoveFrames = SampleRate / 10;
+	const double Length = Scrubber->GetLength();
+	std::vector<float> Block(SinkFrames * Channels);
+
+	WaveFile_t Wave;
+	if (!Wave.Open(WavePath, SampleRate, Channels))
+		return false;
+
+	std::mt19937_64 Random(1);
+	std::uniform_real_distribution<double> Step(0.05, 0.3);
+	double Cursor = 0.0;
+	uint64_t Rendered = 0;
+	const uint64_t Total = (Moves + 2) * MoveFrames;
+	const auto Start = std::chrono::steady_clock::now();
+	while (Rendered < Total) {
+		if (Rendered % MoveFrames < SinkFrames && Rendered / MoveFrames < static_cast<uint64_t>(Moves)) {
+			// Mostly small drags, every fourth move a jump somewhere else entirely
+			const uint64_t Move = Rendered / MoveFrames;
+			Cursor = Move % 4 == 3 ? std::uniform_real_distribution<double>(0.0, Length)(Random) : Cursor + Step(Random);
+			Scrubber->SetPosition(Cursor);
+		}
+
+		std::this_thread::sleep_until(Start + std::chrono::duration<double>(static_cast<double>(Rendered) / SampleRate));
+		Scrubber->Render(Block.data(), SinkFrames);
+		Wave.Write(Block.data(), SinkFrames);
+		Rendered += SinkFrames;
+	}
+	Scrubber->Stop();
+
+	const bool IsWritten = Wave.Close();
+
+	// A block is only heard once the sink played it out
+	const double SinkLatency = 1000.0 * SinkFrames / SampleRate;
+	const double MaxLatency = Scrubber->GetMaxLatency() + SinkLatency;
+	printf("scrub: %d moves, %llu heard, latency %.1f ms avg / %.1f ms max, %llu grains missed\n", Moves,
+		static_cast<unsigned long long>(Scrubber->GetLatencyCount()), Scrubber->GetAverageLatency() + SinkLatency, MaxLatency,
+		static_cast<unsigned long long>(Scrubber->GetGrainsMissed()));
+	return Scrubber->GetLatencyCount() > 0 && MaxLatency <= MaxMilliseconds && IsWritten;
+}
+
+// Tones that differ per track and per channel, so every crossfade, skip and join changes the hashes
+static bool WriteFixtures(const std::filesystem::path& Folder, int Count, double Seconds) {
+	std::error_code Error;
+	std::filesystem::create_directories(Folder, Error);
+
+	constexpr uint32_t SampleRate = 44100;
+	constexpr double Pi = 3.14159265358979323846;
+	const uint64_t Frames = static_cast<uint64_t>(Seconds * SampleRate);
+	std::vector<float> Samples(Frames * 2);
+	for (int Track = 0; Track < Count; Track++) {
+		const double Frequency = 220.0 * (Track + 1);
+		for (uint64_t f = 0; f < Frames; f++) {
+			const double Time = static_cast<double>(f) / SampleRate;
+			Samples[f * 2] = static_cast<float>(0.25 * std::sin(2.0 * Pi * Frequency * Time));
+			Samples[f * 2 + 1] = static_cast<float>(0.25 * std::sin(2.0 * Pi * Frequency * 1.5 * Time));
+		}
+
+		char Name[32];
+		snprintf(Name, sizeof(Name), "%02d Tone.wav", Track + 1);
+		WaveFile_t Wave;
+		if (!Wave.Open(Folder / Name, SampleRate, 2) || !Wave.Write(Samples.data(), Frames) || !Wave.Close())
+			return false;
+	}
+	return true;
+}
+
+bool Headless_t::CheckGoldens(const std::string& Folder, float ToleranceDb, bool IsRecording) const {
+	using Type_t = MusicPlayer_t::CommandType_t;
+	struct Scenario_t {
+		const char* Name;
+		double Seconds;
+		float TrackFade;
+		std::vector<std::pair<double, Type_t>> Events;
+	};
+	const Scenario_t Scenarios[] = {
+		{ "crossfade", 30.0, 5.0f, {} },
+		{ "skip-mid-fade", 16.0, 5.0f, { { 8.0, Type_t::Next }, { 8.1, Type_t::Next } } },
+		{ "pause-resume", 12.0, 5.0f, { { 3.0, Type_t::TogglePause }, { 4.5, Type_t::TogglePause } } },
+		{ "gapless", 40.0, 0.0f, {} },
+	};
+
+	const std::filesystem::path Root = Folder;
+	const std::filesystem::path Fixtures = Root / "Fixtures";
+	if (!WriteFixtures(Fixtures, 3, 12.0)) {
+		printf("goldens: failed to write the fixtures\n");
+		return false;
+	}
+
+	const std::filesystem::path MusicFolder = MusicPlayer.GetMusicFolder();
+	MusicPlayer.SetMusicFolder(Fixtures);
+	MusicPlayer.Update();
+	const std::shared_ptr<const Library_t> Library = MusicPlayer.GetState()->Library;
+
+	bool IsPassed = !Library->Tracks.empty();
+	for (const Scenario_t& Scenario : Scenarios) {
+		if (!IsPassed)
+			break;
+
+		AudioHash_t Hash;
+		MusicPlayer_t::RenderJob_t Job;
+		Job.Seconds = Scenario.Seconds;
+		Job.FirstTrack = Library->Tracks.front().Id;
+		Job.TrackFade = Scenario.TrackFade;
+		Job.Hash = &Hash;
+		for (const auto& [Seconds, Type] : Scenario.Events)
+			Job.Events.push_back({ Seconds, { Type } });
+		if (!MusicPlayer.RenderOffline(Job, nullptr)) {
+			printf("goldens: %s failed to render\n", Scenario.Name);
+			IsPassed = false;
+			break;
+		}
+
+		// Recorded goldens get checked in once they have been listened to
+		const std::filesystem::path GoldenFile = Root / (std::string(Scenario.Name) + ".txt");
+		if (IsRecording) {
+			IsPassed = Hash.Save(GoldenFile);
+			printf("goldens: %s recorded, %zu blocks\n", Scenario.Name, Hash.GetBlocks().size());
+			continue;
+		}
+		AudioHash_t Golden;
+		if (!Golden.Load(GoldenFile)) {
+			printf("goldens: %s has no golden at %s\n", Scenario.Name, GoldenFile.string().c_str());
+			IsPassed = false;
+			break;
+		}
+
+		const AudioHash_t::Difference_t Difference = Hash.Compare(Golden, ToleranceDb);
+		printf("goldens: %s %zu blocks, %zu exact, %zu close, %zu failed", Scenario.Name, Difference.Blocks, Difference.Exact, Difference.Close, Difference.Failed);
+		if (Difference.Failed > 0)
+			printf(", first at %.1f s", Difference.FirstFailed * Golden.GetBlockSeconds());
+		printf("\n");
+		IsPassed = Difference.Failed == 0;
+	}
+
+	MusicPlayer.SetMusicFolder(MusicFolder);
+	MusicPlayer.Update();
+	return IsPassed;
+}
+
+bool Headless_t::BenchmarkControl(int Count, int Clients, double MinPerSecond) const {
+	const std::filesystem::path Path = std::filesystem::temp_directory_path() / "MusicPlayerV2-bench.sock";
+	if (!ControlServer.Start(Path))
+		return false;
+	MusicPlayer.Start();
+
+	// Counts what gets pushed while the others hammer the server
+	std::atomic<uint64_t> Pushed = 0;
+	ControlClient_t Subscriber;
+	bool IsPassed = Subscriber.Connect(Path) && Subscriber.Send("{\"cmd\":\"subscribe\"}\n");
+	std::thread Listener([&] {
+		std::string Line;
+		while (Subscriber.ReadLine(&Line)) {
+			if (Line.find("\"event\":\"state\"") != std::string::npos)
+				Pushed++;
+		}
+	});
+
+	// String ids come back as valid JSON strings, anything that is neither a string nor a number is dropped
+	{
+		ControlClient_t Client;
+		std::string Reply, Line;
+		IsPassed = IsPassed && Client.Connect(Path) && Client.Send("{\"id\":\"a\\\"b\",\"cmd\":\"play\"}\n{\"id\":x},y,\"cmd\":\"play\"}\n");
+		IsPassed = IsPassed && Client.ReadLine(&Reply) && Client.ReadLine(&Line);
+		printf("control: id echo %s %s\n", Reply.c_str(), Line.c_str());
+		IsPassed = IsPassed && Reply == "{\"id\":\"a\\\"b\",\"ok\":true}" && Line.find("\"id\"") == std::string::npos;
+	}
+
+	// Queue places by entry: A, B, A again, the second A moved first and the first A taken out leaves A, B
+	if (const std::vector<LibraryTrack_t>& Tracks = MusicPlayer.GetState()->Library->Tracks; IsPassed && Tracks.size() >= 2) {
+		ControlClient_t Client;
+		std::string Line;
+		const auto Queue = [&](std::vector<std::string>* Entries) {
+			std::string Tracks;
+			Entries->clear();
+			if (!Client.Send("{\"cmd\":\"state\"}\n") || !Client.ReadLine(&Line) || !Client.ReadLine(&Line))
+				return Tracks;
+			const size_t End = Line.find("],\"title\"");
+			for (size_t At = Line.find("\"queue\":["); (At = Line.find("{\"track\":", At + 1)) < End;) {
+				Tracks += Line.substr(At + 9, Line.find(',', At) - At - 9) + " ";
+				const size_t Entry = Line.find("\"entry\":\"", At) + 9;
+				Entries->push_back(Line.substr(Entry, Line.find('"', Entry) - Entry));
+			}
+			return Tracks;
+		};
+		const auto Await = [&](const std::string& Expected, std::vector<std::string>* Entries) {
+			for (int i = 0; i < 200; i++) {
+				if (Queue(Entries) == Expected)
+					return true;
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			return false;
+		};
+
+		const std::string A = std::to_string(Tracks[0].Id), B = std::to_string(Tracks[1].Id);
+		std::vector<std::string> Entries;
+		bool IsQueued = Client.Connect(Path) && Client.Send("{\"cmd\":\"clearqueue\"}\n{\"cmd\":\"enqueue\",\"track\":" + A + "}\n{\"cmd\":\"enqueue\",\"track\":" + B + "}\n{\"cmd\":\"enqueue\",\"track\":" + A + "}\n")
+			&& Client.ReadLine(&Line) && Client.ReadLine(&Line) && Client.ReadLine(&Line) && Client.ReadLine(&Line) && Await(A + " " + B + " " + A + " ", &Entries);
+		const std::vector<std::string> Queued = Entries;
+		IsQueued = IsQueued && Client.Send("{\"cmd\":\"move\",\"entry\":\"" + Queued[2] + "\"}\n{\"cmd\":\"unqueue\",\"entry\":\"" + Queued[0] + "\"}\n")
+			&& Client.ReadLine(&Line) && Client.ReadLine(&Line) && Await(A + " " + B + " ", &Entries) && Entries[0] == Queued[2] && Entries[1] == Queued[1];
+		printf("control: queue moved and unqueued by entry %s\n", IsQueued ? "in place" : "wrongly");
+		IsPassed = IsQueued && Client.Send("{\"cmd\":\"clearqueue\"}\n") && Client.ReadLine(&Line);
+	}
+
+	// Pipelined in batches, every fourth request asks for the state, which answers with two lines
+	constexpr int Batch = 64;
+	std::atomic<bool> IsFailed = !IsPassed;
+	std::atomic<uint64_t> Replies = 0;
+	std::vector<double> MaxRoundTrips(Clients, 0.0);
+	std::vector<std::thread> Senders;
+	const auto Start = std::chrono::steady_clock::now();
+	for (int c = 0; c < Clients; c++) {
+		Senders.emplace_back([&, c] {
+			ControlClient_t Client;
+			if (!Client.Connect(Path)) {
+				IsFailed = true;
+				return;
+			}
+
+			std::string Requests, Line;
+			char Request[96];
+			for (int Sent = 0; Sent < Count / Clients && !IsFailed; Sent += Batch) {
+				Requests.clear();
+				int Expected = 0;
+				for (int i = Sent; i < std::min(Sent + Batch, Count / Clients); i++) {
+					const char* Kinds[] = { "{\"id\":%d,\"cmd\":\"volume\",\"value\":%d}\n", "{\"id\":%d,\"cmd\":\"pause\"}\n", "{\"id\":%d,\"cmd\":\"play\"}\n", "{\"id\":%d,\"cmd\":\"state\"}\n" };
+					snprintf(Request, sizeof(Request), Kinds[i % 4], i, 50 + i % 50);
+					Requests += Request;
+					Expected += i % 4 == 3 ? 2 : 1;
+				}
+
+				const auto Sending = std::chrono::steady_clock::now();
+				if (!Client.Send(Requests))
+					IsFailed = true;
+				for (int i = 0; i < Expected && !IsFailed; i++) {
+					if (!Client.ReadLine(&Line) || Line.find("\"ok\":false") != std::string::npos)
+						IsFailed = true;
+				}
+				Replies += Expected;
+				MaxRoundTrips[c] = std::max(MaxRoundTrips[c], std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Sending).count());
+			}
+		});
+	}
+	for (std::thread& Sender : Senders)
+		Sender.join();
+	const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	const uint64_t Handled = ControlServer.GetCommands();
+	ControlServer.Stop();
+	Listener.join();
+	MusicPlayer.Post({ MusicPlayer_t::CommandType_t::SetVolume, PlayerState_t::NoTrack, 0.0f, 100.0f });
+	MusicPlayer.Stop();
+
+	const double PerSecond = (Count / Clients) * Clients / std::max(Seconds, 1e-9);
+	printf("control: %llu requests from %d clients in %.0f ms, %.0f per second, batch of %d round trip %.2f ms max, %llu states pushed\n",
+		static_cast<unsigned long long>(Handled), Clients, Seconds * 1000.0, PerSecond, Batch,
+		*std::max_element(MaxRoundTrips.begin(), MaxRoundTrips.end()), static_cast<unsigned long long>(Pushed.load()));
+	return !IsFailed && PerSecond >= MinPerSecond && Pushed > 0;
+}
+
+// Critical value of chi-square at p = 0.001, Wilson-Hilferty
+static double GetChiSquareLimit(double Degrees) {
+	const double Term = 2.0 / (9.0 * Degrees);
+	return Degrees * pow(1.0 - Term + 3.09 * sqrt(Term), 3.0);
+}
+
+bool Headless_t::CheckShuffle(int Tracks, int Picks, double MaxNanoseconds) const {
+	using Mode_t = Shuffle_t::Mode_t;
+	bool IsPassed = true;
+	const auto Range = [](uint32_t First, uint32_t Count) {
+		std::vector<uint32_t> Ids(Count);
+		for (uint32_t i = 0; i < Count; i++)
+			Ids[i] = First + i;
+		return Ids;
+	};
+
+	// Fair: every cycle is a permutation and a track comes back no sooner than the window allows.
+	// Each track is as likely at every place, measured over fresh shuffles since the window ties a cycle to the one before
+	{
+		constexpr uint32_t Count = 50;
+		constexpr int Cycles = 4000;
+		Shuffle_t Shuffle(1);
+		Shuffle.SetMode(Mode_t::Fair);
+		Shuffle.Sync(Range(1, Count));
+
+		std::vector<double> Places(Count * Count, 0.0);
+		std::vector<int> LastSeen(Count + 1, -1000000);
+		int ShortestGap = INT32_MAX, Repeats = 0;
+		for (int Cycle = 0, Pick = 0; Cycle < Cycles; Cycle++) {
+			Shuffle_t Fresh(100 + Cycle);
+			Fresh.SetMode(Mode_t::Fair);
+			Fresh.Sync(Range(1, Count));
+
+			std::vector<bool> IsSeen(Count + 1, false);
+			for (uint32_t Place = 0; Place < Count; Place++, Pick++) {
+				const uint32_t Id = Shuffle.Take();
+				if (Id < 1 || Id > Count || IsSeen[Id]) {
+					Repeats++;
+					continue;
+				}
+				IsSeen[Id] = true;
+				ShortestGap = std::min(ShortestGap, Pick - LastSeen[Id]);
+				LastSeen[Id] = Pick;
+				Places[(Fresh.Take() - 1) * Count + Place]++;
+			}
+		}
+
+		double ChiSquare = 0.0;
+		const double Expected = static_cast<double>(Cycles) / Count;
+		for (const double Observed : Places)
+			ChiSquare += (Observed - Expected) * (Observed - Expected) / Expected;
+		const double Limit = GetChiSquareLimit((Count - 1.0) * (Count - 1.0));
+		const int Window = static_cast<int>(std::min<size_t>(Shuffle_t::MaxWindow, Count / 4));
+		printf("shuffle: fair, %d cycles of %u, %d repeats, shortest gap %d (window %d), track by place chi-square %.0f (limit %.0f)\n",
+			Cycles, Count, Repeats, ShortestGap, Window, ChiSquare, Limit);
+		IsPassed = IsPassed && Repeats == 0 && ChiSquare < Limit && ShortestGap > Window;
+	}
+
+	// Fair under library changes: tracks added mid-cycle join it, removed ones never come up
+	{
+		Shuffle_t Shuffle(2);
+		Shuffle.SetMode(Mode_t::Fair);
+		Shuffle.Sync(Range(1, 1000));
+
+		std::vector<int> Plays(1501, 0);
+		for (int i = 0; i < 300; i++)
+			Plays[Shuffle.Take()]++;
+
+		// 1 to 1200 stay, except every unplayed track from 901 to 1000
+		std::vector<uint32_t> Ids;
+		for (uint32_t Id = 1; Id <= 1200; Id++) {
+			if (Id <= 900 || Id > 1000 || Plays[Id])
+				Ids.push_back(Id);
+		}
+		Shuffle.Sync(Ids);
+		for (size_t i = 300; i < Ids.size(); i++)
+			Plays[Shuffle.Take()]++;
+
+		int Wrong = 0;
+		for (uint32_t Id = 1; Id <= 1500; Id++) {
+			const bool IsListed = std::binary_search(Ids.begin(), Ids.end(), Id);
+			Wrong += Plays[Id] != (IsListed ? 1 : 0);
+		}
+		printf("shuffle: fair across a library change, %zu tracks in the cycle, %d played the wrong number of times\n", Ids.size(), Wrong);
+		IsPassed = IsPassed && Wrong == 0;
+	}
+
+	// Weighted: picks follow the weights
+	{
+		constexpr uint32_t Count = 10000;
+		constexpr int Draws = 2000000;
+		Shuffle_t Shuffle(3);
+		Shuffle.SetMode(Mode_t::Weighted);
+		std::vector<float> Weights(Count);
+		double Total = 0.0;
+		for (uint32_t i = 0; i < Count; i++)
+			Total += Weights[i] = static_cast<float>(i % 100 + 1);
+		Shuffle.Sync(Range(1, Count), Weights);
+
+		std::vector<double> Observed(Count, 0.0);
+		for (int i = 0; i < Draws; i++)
+			Observed[Shuffle.Take() - 1]++;
+
+		double ChiSquare = 0.0;
+		for (uint32_t i = 0; i < Count; i++) {
+			const double Expected = Draws * Weights[i] / Total;
+			ChiSquare += (Observed[i] - Expected) * (Observed[i] - Expected) / Expected;
+		}
+		const double Limit = GetChiSquareLimit(Count - 1.0);
+		printf("shuffle: weighted, %d draws over %u tracks, chi-square %.0f (limit %.0f)\n", Draws, Count, ChiSquare, Limit);
+		IsPassed = IsPassed && ChiSquare < Limit;
+	}
+
+	// Speed at the size asked for
+	std::mt19937 Random(4);
+	std::vector<float> Weights(Tracks);
+	for (float& Weight : Weights)
+		Weight = std::uniform_real_distribution<float>(0.1f, 10.0f)(Random);
+	const std::vector<uint32_t> Ids = Range(1, Tracks);
+
+	Shuffle_t Shuffle(5);
+	auto Start = std::chrono::steady_clock::now();
+	Shuffle.Sync(Ids, Weights);
+	const double SyncMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+	double Nanoseconds[2] = {};
+	uint64_t Sum = 0;
+	for (int Pass = 0; Pass < 2; Pass++) {
+		Shuffle.SetMode(Pass == 0 ? Mode_t::Fair : Mode_t::Weighted);
+		Shuffle.Take();
+		Start = std::chrono::steady_clock::now();
+		for (int i = 0; i < Picks; i++)
+			Sum += Shuffle.Take();
+		Nanoseconds[Pass] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count() / Picks;
+	}
+	printf("shuffle: %d tracks synced with weights in %.1f ms, %.1f ns per fair pick, %.1f ns per weighted pick (%llu)\n",
+		Tracks, SyncMilliseconds, Nanoseconds[0], Nanoseconds[1], static_cast<unsigned long long>(Sum % 10));
+	return IsPassed && Nanoseconds[0] <= MaxNanoseconds && Nanoseconds[1] <= MaxNanoseconds;
+}
+
+// Journal files of the queue benchmark are named after the track id
+static uint32_t ResolveBenchmarkTrack(void*, std::string_view File) {
+	return File.size() > 1 && File[0] == 't' ? static_cast<uint32_t>(strtoul(std::string(File.substr(1)).c_str(), nullptr, 10)) : PlayQueue_t::NoTrack;
+}
+
+bool Headless_t::BenchmarkQueue(int Count, double MaxNanoseconds) const {
+	using Clock_t = std::chrono::steady_clock;
+	const std::filesystem::path Journal = std::filesystem::temp_directory_path() / "MusicPlayerV2-bench.journal";
+	std::error_code Error;
+	std::filesystem::remove(Journal, Error);
+
+	// The same edits twice, in memory only and then through the journal
+	double Nanoseconds[2] = {};
+	PlayQueue_t Queues[2];
+	if (!Queues[1].Open(Journal, &ResolveBenchmarkTrack, nullptr))
+		return false;
+
+	for (int Pass = 0; Pass < 2; Pass++) {
+		PlayQueue_t& Queue = Queues[Pass];
+		std::mt19937 Random(7);
+		std::vector<Handle_t> Handles;
+		Handles.reserve(Count);
+		char File[16];
+		uint64_t Operations = 0;
+
+		const auto Start = Clock_t::now();
+		for (int i = 0; i < Count; i++) {
+			snprintf(File, sizeof(File), "t%d", i + 1);
+			Handles.push_back(i % 4 == 3 ? Queue.PushFront(i + 1, File) : Queue.PushBack(i + 1, File));
+		}
+		for (int i = 0; i < Count; i++)
+			Queue.MoveAfter(Handles[Random() % Handles.size()], Handles[Random() % Handles.size()]);
+		for (int i = 0; i < Count / 4; i++) {
+			const size_t Index = Random() % Handles.size();
+			Queue.Remove(Handles[Index]);
+			Handles[Index] = Handles.back();
+			Handles.pop_back();
+		}
+		for (int i = 0; i < Count / 4; i++)
+			Queue.PopFront();
+		Operations = static_cast<uint64_t>(Count) * 2 + Count / 4 * 2;
+		Nanoseconds[Pass] = std::chrono::duration<double, std::nano>(Clock_t::now() - Start).count() / Operations;
+	}
+
+	// A crash in the middle of a write leaves a torn line behind, which has to be ignored
+	const size_t Records = Queues[1].GetRecords();
+	Queues[1].Close();
+	const uintmax_t Bytes = std::filesystem::file_size(Journal, Error);
+	{
+		std::ofstream Torn(Journal, std::ios::binary | std::ios::app);
+		Torn << "a 999999999 0 t1";
+	}
+
+	PlayQueue_t Restored;
+	const auto Start = Clock_t::now();
+	bool IsPassed = Restored.Open(Journal, &ResolveBenchmarkTrack, nullptr);
+	const double RestoreMilliseconds = std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count();
+
+	IsPassed = IsPassed && Restored.GetSize() == Queues[0].GetSize() && Restored.GetSize() == Queues[1].GetSize();
+	for (Handle_t A = Queues[0].GetFront(), B = Restored.GetFront(); IsPassed && A.IsValid(); A = Queues[0].GetNext(A), B = Restored.GetNext(B))
+		IsPassed = Queues[0].GetTrack(A) == Restored.GetTrack(B);
+	Restored.Close();
+	std::filesystem::remove(Journal, Error);
+
+	printf("queue: %d entries, %.0f ns per edit in memory, %.0f ns journaled, %zu records in %.1f MB, restored %zu entries in %.1f ms\n",
+		Count, Nanoseconds[0], Nanoseconds[1], Records, Bytes / 1048576.0, Restored.GetSize(), RestoreMilliseconds);
+	if (!IsPassed)
+		printf("queue: the restored queue differs from the one journaled\n");
+	return IsPassed && Nanoseconds[0] <= MaxNanoseconds;
+}
+
+// Every track's stats as reopened against what was recorded
+static bool CompareStats(const PlayStats_t& Stats, const std::unordered_map<uint64_t, PlayStats_t::Stats_t>& Expected) {
+	PlayStats_t::Stats_t Found;
+	for (const auto& [Key, Recorded] : Expected) {
+		if (!Stats.Get(Key, &Found) || Found.Plays != Recorded.Plays || Found.Skips != Recorded.Skips || Found.ListenedMs != Recorded.ListenedMs || Found.LastPlayed <= 0)
+			return false;
+	}
+	return true;
+}
+
+bool Headless_t::BenchmarkStats(int Events, double MaxNanoseconds) const {
+	using Clock_t = std::chrono::steady_clock;
+	const std::filesystem::path Folder = std::filesystem::temp_directory_path() / "MusicPlayerV2-bench-stats";
+	std::error_code Error;
+	std::filesystem::remove_all(Folder, Error);
+
+	PlayStats_t Stats;
+	if (!Stats.Open(Folder))
+		return false;
+
+	// Recorded in bursts the stats thread catches up with in between, like a lot of very short tracks
+	const int Tracks = std::max(Events / 8, 1);
+	std::unordered_map<uint64_t, PlayStats_t::Stats_t> Expected;
+	std::mt19937 Random(11);
+	char File[16];
+	double Nanoseconds = 0.0;
+	for (int Done = 0; Done < Events;) {
+		const int Burst = std::min<int>(Events - Done, PlayStats_t::MaxPending / 2);
+		uint64_t Keys[PlayStats_t::MaxPending / 2];
+		PlayStats_t::Event_t Kinds[PlayStats_t::MaxPending / 2];
+		double Seconds[PlayStats_t::MaxPending / 2];
+		for (int i = 0; i < Burst; i++) {
+			snprintf(File, sizeof(File), "t%d", static_cast<int>(Random() % Tracks));
+			Keys[i] = PlayStats_t::GetKey(File);
+			Kinds[i] = Random() % 3 == 0 ? PlayStats_t::Event_t::Skipped : PlayStats_t::Event_t::Finished;
+			Seconds[i] = (Random() % 300000) / 1000.0;
+
+			PlayStats_t::Stats_t& Recorded = Expected[Keys[i]];
+			Recorded.Plays += Kinds[i] == PlayStats_t::Event_t::Finished;
+			Recorded.Skips += Kinds[i] == PlayStats_t::Event_t::Skipped;
+			Recorded.ListenedMs += static_cast<uint32_t>(Seconds[i] * 1000.0);
+		}
+
+		const auto Start = Clock_t::now();
+		for (int i = 0; i < Burst; i++)
+			Stats.Record(Keys[i], Kinds[i], Seconds[i]);
+		Nanoseconds += std::chrono::duration<double, std::nano>(Clock_t::now() - Start).count();
+		Done += Burst;
+		Stats.Flush();
+	}
+	Nanoseconds /= Events;
+	const uint64_t Dropped = Stats.GetDropped();
+	bool IsPassed = Dropped == 0 && CompareStats(Stats, Expected);
+	Stats.Close();
+
+	// A crash in the middle of a write leaves part of a record behind, which has to be ignored
+	const std::filesystem::path Log = Folder / "Stats.log";
+	const uintmax_t LogBytes = std::filesystem::file_size(Log, Error);
+	{
+		std::ofstream Torn(Log, std::ios::binary | std::ios::app);
+		Torn.write("torn record", 11);
+	}
+
+	const auto Start = Clock_t::now();
+	IsPassed = Stats.Open(Folder) && IsPassed;
+	const double OpenMilliseconds = std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count();
+	size_t Compacted = Stats.GetTable() ? Stats.GetTable()->Count : 0;
+	size_t Logged = Stats.GetTable() ? Stats.GetTable()->Recent.size() : 0;
+	IsPassed = IsPassed && CompareStats(Stats, Expected);
+
+	// The torn log is folded into the table right away, after which nothing is left to replay
+	Stats.Flush();
+	Stats.Close();
+	IsPassed = Stats.Open(Folder) && IsPassed && CompareStats(Stats, Expected) && Stats.GetTable()->Recent.empty() && Stats.GetTable()->Count == Expected.size();
+	Stats.Close();
+
+	// Every compaction wrote a table of its own, only the current one is left
+	size_t Tables = 0;
+	for (const std::filesystem::directory_entry& Entry : std::filesystem::directory_iterator(Folder, Error))
+		Tables += Entry.path().extension() == ".table";
+	IsPassed = IsPassed && Tables == 1;
+	std::filesystem::remove_all(Folder, Error);
+
+	printf("stats: %d events over %zu tracks, %.0f ns per record, %llu dropped, reopened in %.2f ms with %zu tracks mapped and %zu logged since (%.1f KB log), %zu table left\n",
+		Events, Expected.size(), Nanoseconds, static_cast<unsigned long long>(Dropped), OpenMilliseconds, Compacted, Logged, LogBytes / 1024.0, Tables);
+	if (!IsPassed)
+		printf("stats: the reopened stats differ from the ones recorded\n");
+	return IsPassed && Nanoseconds <= MaxNanoseconds;
+}
+
+bool Headless_t::BenchmarkPlaylists(int Tracks, double MaxMilliseconds) const {
+	using Clock_t = std::chrono::steady_clock;
+	constexpr int64_t Now = 1700000000;
+	constexpr int64_t Day = 86400;
+	static const char* const Genres[] = { "House", "Techno", "Jazz", "Hip-Hop", "Ambient", "Drum & Bass", "Trance", "Disco", "Funk", "Soul",
+		"Rock", "Pop", "Metal", "Classical", "Reggae", "Dub", "Garage", "Folk", "Blues", "Electro" };
+
+	// Tags drawn like a large collection: a few genres, many artists, more albums
+	auto Library = std::make_shared<Library_t>();
+	Library->Tracks.resize(Tracks);
+	std::mt19937 Random(21);
+	for (int i = 0; i < Tracks; i++) {
+		LibraryTrack_t& Track = Library->Tracks[i];
+		Track.Id = i + 1;
+		Track.Genre = Random() % 50 ? Genres[Random() % std::size(Genres)] : "";
+		Track.Artist = "Artist " + std::to_string(Random() % 1000);
+		Track.Album = "Album " + std::to_string(Random() % 5000);
+		Track.Bpm = 80.0f + (Random() % 1000) / 10.0f;
+		Track.Duration = 60.0 + Random() % 540;
+	}
+
+	Library->IndexRows();
+	auto Start = Clock_t::now();
+	auto Columns = TrackColumns_t::Build(Library->Tracks);
+	const double BuildMilliseconds = std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count();
+	Library->Columns = Columns;
+
+	struct Rule_t {
+		const char* Text;
+		bool (*Matches)(const LibraryTrack_t& Track, uint32_t Plays, uint32_t Skips, int64_t LastPlayed);
+	};
+	static const Rule_t Rules[] = {
+		{ "genre=House AND bpm 120-126 AND NOT played in 30 days", [](const LibraryTrack_t& Track, uint32_t, uint32_t, int64_t LastPlayed) {
+			return Track.Genre == "House" && Track.Bpm >= 120.0f && Track.Bpm <= 126.0f && !(LastPlayed && LastPlayed >= Now - 30 * Day);
+		} },
+		{ "(artist=\"artist 7\" OR album != 'Album 12') AND duration < 240", [](const LibraryTrack_t& Track, uint32_t, uint32_t, int64_t) {
+			return (Track.Artist == "Artist 7" || Track.Album != "Album 12") && Track.Duration < 240.0;
+		} },
+		{ "plays >= 3 OR skips > 2 AND NOT (genre = jazz OR genre = \"\")", [](const LibraryTrack_t& Track, uint32_t Plays, uint32_t Skips, int64_t) {
+			return Plays >= 3 || (Skips > 2 && Track.Genre != "Jazz" && !Track.Genre.empty());
+		} },
+	};
+
+	SmartPlaylists_t Playlists(nullptr);
+	Playlists.SetLibrary(Library, Now);
+	std::string Error;
+	for (const Rule_t& Rule : Rules) {
+		if (!Playlists.Set(Rule.Text, Rule.Text, &Error, Now)) {
+			printf("playlists: '%s' doesn't parse: %s\n", Rule.Text, Error.c_str());
+			return false;
+		}
+	}
+
+	// Listening history over the last three months, recorded as it would have happened
+	StatsColumns_t Stats;
+	const size_t Padded = TrackColumns_t::GetWords(Tracks) * 64;
+	Stats.Plays.assign(Padded, 0);
+	Stats.Skips.assign(Padded, 0);
+	Stats.LastPlayed.assign(Padded, 0);
+	const int Events = std::max(Tracks / 2, 1);
+	for (int i = 0; i < Events; i++) {
+		const size_t Row = Random() % Tracks;
+		const int64_t Time = Now - static_cast<int64_t>(Random() % (90 * Day));
+		const PlayStats_t::Event_t Event = Random() % 3 ? PlayStats_t::Event_t::Finished : PlayStats_t::Event_t::Skipped;
+		Playlists.Record(Row, Event, Time);
+		(Event == PlayStats_t::Event_t::Finished ? Stats.Plays : Stats.Skips)[Row]++;
+		Stats.LastPlayed[Row] = std::max<uint32_t>(Stats.LastPlayed[Row], static_cast<uint32_t>(Time));
+	}
+	Playlists.Update(Now);
+
+	const auto Compare = [&] {
+		const std::shared_ptr<const std::vector<std::shared_ptr<const Playlist_t>>> Published = Playlists.GetPlaylists();
+		bool IsSame = Published && Published->size() == std::size(Rules);
+		for (size_t r = 0; IsSame && r < std::size(Rules); r++) {
+			std::vector<uint32_t> Expected;
+			for (int i = 0; i < Tracks; i++) {
+				if (Rules[r].Matches(Library->Tracks[i], Stats.Plays[i], Stats.Skips[i], Stats.LastPlayed[i]))
+					Expected.push_back(Library->Tracks[i].Id);
+			}
+			IsSame = (*Published)[r]->Tracks == Expected;
+			if (!IsSame)
+				printf("playlists: '%s' matched %zu tracks instead of %zu\n", Rules[r].Text, (*Published)[r]->Tracks.size(), Expected.size());
+		}
+		return IsSame;
+	};
+	bool IsPassed = Compare();
+
+	// Every rule over the whole library, best of a few runs
+	std::vector<uint64_t> Bits(TrackColumns_t::GetWords(Tracks));
+	std::vector<uint64_t> Scratch;
+	double Milliseconds[std::size(Rules)] = {};
+	size_t Matched[std::size(Rules)] = {};
+	for (size_t r = 0; r < std::size(Rules); r++) {
+		Query_t Query;
+		Query.Parse(Rules[r].Text, &Error);
+		Milliseconds[r] = 1e9;
+		for (int Run = 0; Run < 5; Run++) {
+			Start = Clock_t::now();
+			Query.Evaluate(*Columns, Stats, Now, 0, Bits.size(), Bits.data(), &Scratch);
+			Milliseconds[r] = std::min(Milliseconds[r], std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count());
+		}
+		for (const uint64_t Word : Bits)
+			Matched[r] += std::popcount(Word);
+	}
+
+	// One play at a time, only its word of every stats rule is evaluated again
+	constexpr int Plays = 1000;
+	double IncrementalMicroseconds = 0.0;
+	for (int i = 0; i < Plays; i++) {
+		const size_t Row = Random() % Tracks;
+		Start = Clock_t::now();
+		Playlists.Record(Row, PlayStats_t::Event_t::Finished, Now);
+		Playlists.Update(Now);
+		IncrementalMicroseconds += std::chrono::duration<double, std::micro>(Clock_t::now() - Start).count();
+		Stats.Plays[Row]++;
+		Stats.LastPlayed[Row] = static_cast<uint32_t>(Now);
+	}
+	IncrementalMicroseconds /= Plays;
+	IsPassed = Compare() && IsPassed;
+
+	// A rescan that retagged a thousandth of the tracks with other genres and tempos. Only their words are
+	// evaluated again, and the playlist that looks at neither has to be shared with the last list
+	auto Retagged = std::make_shared<Library_t>(*Library);
+	Retagged->Version = Library->Version + 1;
+	for (int i = 0; i < Tracks / 1000 + 1; i++) {
+		const uint32_t Row = static_cast<uint32_t>(Random() % Tracks);
+		Retagged->Tracks[Row].Genre = Genres[Random() % std::size(Genres)];
+		Retagged->Tracks[Row].Bpm = 80.0f + (Random() % 1000) / 10.0f;
+		Retagged->Removed.push_back(Retagged->Tracks[Row].Id);
+		Retagged->Added.push_back(Row);
+	}
+	Retagged->Columns = TrackColumns_t::Build(Retagged->Tracks);
+	const std::shared_ptr<const std::vector<std::shared_ptr<const Playlist_t>>> Untagged = Playlists.GetPlaylists();
+	Start = Clock_t::now();
+	Playlists.SetLibrary(Retagged, Now);
+	const std::shared_ptr<const std::vector<std::shared_ptr<const Playlist_t>>> Tagged = Playlists.GetPlaylists();
+	const double RetagMilliseconds = std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count();
+	Library = Retagged;
+	if ((*Tagged)[1] != (*Untagged)[1]) {
+		printf("playlists: a playlist the retagging didn't touch was built again\n");
+		IsPassed = false;
+	}
+	IsPassed = Compare() && IsPassed;
+
+	// Long enough later that the window moved for every track
+	Playlists.Update(Now + 365 * Day);
+	const std::shared_ptr<const std::vector<std::shared_ptr<const Playlist_t>>> Later = Playlists.GetPlaylists();
+	size_t House = 0;
+	for (const LibraryTrack_t& Track : Library->Tracks)
+		House += Track.Genre == "House" && Track.Bpm >= 120.0f && Track.Bpm <= 126.0f;
+	if (Later->front()->Tracks.size() != House) {
+		printf("playlists: the last-played window didn't move with the clock\n");
+		IsPassed = false;
+	}
+
+	printf("playlists: %d tracks, columns built in %.1f ms, one play updated in %.2f us, a thousandth retagged updated in %.2f ms\n", Tracks, BuildMilliseconds,
+		IncrementalMicroseconds, RetagMilliseconds);
+	for (size_t r = 0; r < std::size(Rules); r++)
+		printf("  %.3f ms, %zu tracks: %s\n", Milliseconds[r], Matched[r], Rules[r].Text);
+	return IsPassed && *std::max_element(std::begin(Milliseconds), std::end(Milliseconds)) <= MaxMilliseconds;
+}
+
+// Both indexes show the same columns and tracks, their codes may differ
+static bool CompareFacets(const FacetIndex_t& Index, const FacetIndex_t& Expected) {
+	for (int Field = 0; Field < FacetIndex_t::Fields; Field++) {
+		const auto Column = static_cast<FacetIndex_t::Field_t>(Field);
+		const std::vector<uint32_t>& Values = Index.GetValues(Column);
+		const std::vector<uint32_t>& ExpectedValues = Expected.GetValues(Column);
+		if (Values.size() != ExpectedValues.size() || Index.GetTotal(Column) != Expected.GetTotal(Column))
+			return false;
+		for (size_t i = 0; i < Values.size(); i++) {
+			if (Index.GetName(Column, Values[i]) != Expected.GetName(Column, ExpectedValues[i]) || Index.GetCount(Column, Values[i]) != Expected.GetCount(Column, ExpectedValues[i]))
+				return false;
+		}
+	}
+	return Index.GetTracks() == Expected.GetTracks();
+}
+
+static void SelectFacet(FacetIndex_t* Index, FacetIndex_t::Field_t Field, const std::string& Name) {
+	for (const uint32_t Value : Index->GetValues(Field)) {
+		if (Index->GetName(Field, Value) == Name) {
+			Index->Select(Field, Value);
+			return;
+		}
+	}
+	Index->Select(Field, FacetIndex_t::All);
+}
+
+bool Headless_t::BenchmarkFacets(int Tracks, double MaxMilliseconds) const {
+	using Clock_t = std::chrono::steady_clock;
+	std::mt19937 Random(31);
+	uint32_t NextId = 1;
+	const auto MakeTrack = [&] {
+		LibraryTrack_t Track;
+		Track.Id = NextId++;
+		Track.Genre = Random() % 50 ? "Genre " + std::to_string(Random() % 20) : "";
+		Track.Artist = "Artist " + std::to_string(Random() % 1000);
+		Track.Album = "Album " + std::to_string(Random() % 5000);
+		return Track;
+	};
+
+	auto Library = std::make_shared<Library_t>();
+	Library->Version = 1;
+	Library->Tracks.reserve(Tracks);
+	for (int i = 0; i < Tracks; i++) {
+		Library->Tracks.push_back(MakeTrack());
+		Library->Added.push_back(i);
+	}
+
+	FacetIndex_t Index;
+	auto Start = Clock_t::now();
+	Index.Sync(Library);
+	const double FullMilliseconds = std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count();
+
+	// A rescan that lost a percent of the tracks, found as many new ones and retagged as many again
+	auto Rescanned = std::make_shared<Library_t>();
+	Rescanned->Version = 2;
+	Rescanned->Tracks.reserve(Tracks);
+	const int Changes = std::max(Tracks / 100, 1);
+	for (const LibraryTrack_t& Track : Library->Tracks) {
+		const uint32_t Roll = Random() % Tracks;
+		if (Roll < static_cast<uint32_t>(Changes)) {
+			Rescanned->Removed.push_back(Track.Id);
+			continue;
+		}
+		Rescanned->Tracks.push_back(Track);
+		if (Roll < static_cast<uint32_t>(Changes) * 2) {
+			LibraryTrack_t& Retagged = Rescanned->Tracks.back();
+			Retagged.Genre = "Genre " + std::to_string(Random() % 25);
+			Retagged.Album = "Album " + std::to_string(Random() % 5000);
+			Rescanned->Removed.push_back(Track.Id);
+			Rescanned->Added.push_back(static_cast<uint32_t>(Rescanned->Tracks.size() - 1));
+		}
+		if (Roll >= static_cast<uint32_t>(Tracks - Changes)) {
+			Rescanned->Tracks.push_back(MakeTrack());
+			Rescanned->Added.push_back(static_cast<uint32_t>(Rescanned->Tracks.size() - 1));
+		}
+	}
+
+	Index.Select(FacetIndex_t::Genre, Index.GetValues(FacetIndex_t::Genre)[1]);
+	const std::string Genre = Index.GetName(FacetIndex_t::Genre, Index.GetSelected(FacetIndex_t::Genre));
+	Start = Clock_t::now();
+	Index.Sync(Rescanned);
+	const double DiffMilliseconds = std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count();
+
+	// Against an index that read the rescanned library in one go
+	FacetIndex_t Expected;
+	Expected.Sync(Rescanned);
+	SelectFacet(&Expected, FacetIndex_t::Genre, Genre);
+	bool IsPassed = CompareFacets(Index, Expected);
+
+	// Narrowing down column by column, and widening again
+	const std::string Artist = Index.GetName(FacetIndex_t::Artist, Index.GetValues(FacetIndex_t::Artist).back());
+	double Milliseconds[4] = {};
+	const FacetIndex_t::Field_t Steps[4] = { FacetIndex_t::Genre, FacetIndex_t::Artist, FacetIndex_t::Album, FacetIndex_t::Genre };
+	for (int Step = 0; Step < 4; Step++) {
+		const FacetIndex_t::Field_t Field = Steps[Step];
+		const uint32_t Value = Step == 3 ? FacetIndex_t::All : Index.GetValues(Field)[Step == 0 ? 2 : 0];
+		Start = Clock_t::now();
+		Index.Select(Field, Value);
+		Milliseconds[Step] = std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count();
+		SelectFacet(&Expected, Field, Value == FacetIndex_t::All ? std::string() : Index.GetName(Field, Value));
+		if (Value == FacetIndex_t::All)
+			Expected.Select(Field, FacetIndex_t::All);
+		IsPassed = IsPassed && CompareFacets(Index, Expected);
+	}
+
+	// And once plainly over the tracks
+	SelectFacet(&Index, FacetIndex_t::Genre, Genre);
+	SelectFacet(&Index, FacetIndex_t::Artist, Artist);
+	std::vector<uint32_t> Rows;
+	for (size_t Row = 0; Row < Rescanned->Tracks.size(); Row++) {
+		if (Rescanned->Tracks[Row].Genre == Genre && Rescanned->Tracks[Row].Artist == Artist)
+			Rows.push_back(static_cast<uint32_t>(Row));
+	}
+	IsPassed = IsPassed && Index.GetTracks() == Rows;
+
+	printf("facets: %d tracks read in %.1f ms, a rescan of %zu removed and %zu added followed in %.2f ms\n",
+		Tracks, FullMilliseconds, Rescanned->Removed.size(), Rescanned->Added.size(), DiffMilliseconds);
+	printf("facets: selecting a genre %.2f ms, an artist %.2f ms, an album %.2f ms, all genres again %.2f ms\n", Milliseconds[0], Milliseconds[1], Milliseconds[2], Milliseconds[3]);
+	if (!IsPassed)
+		printf("facets: the index differs from one read in full\n");
+	return IsPassed && *std::max_element(std::begin(Milliseconds), std::end(Milliseconds)) <= MaxMilliseconds;
+}
+
+bool Headless_t::BenchmarkSort(int Tracks, double MaxMilliseconds) const {
+	using Clock_t = std::chrono::steady_clock;
+	using View_t = TrackViews_t::View_t;
+
+	// Spellings that have to land next to each other
+	static const char* const Collations[][2] = {
+		{ "The Beatles", "beatles" }, { "\xC3\x89mile", "emile" }, { "Stra\xC3\x9F" "e", "strasse" }, { "(Untitled)", "untitled)" },
+		{ "'The Who", "who" }, { "The", "the" }, { "\xC5\x81\xC3\xB3" "d\xC5\xBA", "lodz" }, { "", "\xFF" },
+	};
+	bool IsPassed = true;
+	std::string Key;
+	for (const auto& [Text, Expected] : Collations) {
+		SortKeys_t::Collate(Text, &Key);
+		if (Key != Expected) {
+			printf("sort: '%s' collates to '%s' instead of '%s'\n", Text, Key.c_str(), Expected);
+			IsPassed = false;
+		}
+	}
+
+	static const char* const Words[] = { "The ", "the ", "", "", "", "(", "\xC3\x89", "\xC3\xA9", "E", "e", "\xC3\x84", "a", "Z", "\xC3\x9F" };
+	std::mt19937 Random(41);
+	const auto MakeText = [&](const char* Stem, uint32_t Values) {
+		return std::string(Words[Random() % std::size(Words)]) + Stem + std::to_string(Random() % Values);
+	};
+	std::vector<LibraryTrack_t> Library(Tracks);
+	for (int i = 0; i < Tracks; i++) {
+		LibraryTrack_t& Track = Library[i];
+		Track.Id = i + 1;
+		Track.Title = MakeText("Song ", Tracks);
+		Track.Artist = Random() % 20 ? MakeText("Artist ", 1000) : "";
+		Track.Album = MakeText("Album ", 5000);
+		Track.Duration = (Random() % 600000) / 1000.0;
+		Track.Added = 1500000000 + Random() % 200000000;
+	}
+
+	auto Start = Clock_t::now();
+	const std::shared_ptr<const SortKeys_t> Keys = SortKeys_t::Build(Library);
+	const double BuildMilliseconds = std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count();
+
+	// Plain comparisons of the collated strings, no ranks, radix passes or merges
+	std::vector<std::string> Collated[SortKeys_t::Duration];
+	for (const SortKeys_t::Field_t Field : { SortKeys_t::Title, SortKeys_t::Artist, SortKeys_t::Album }) {
+		Collated[Field].resize(Tracks);
+		for (int i = 0; i < Tracks; i++)
+			SortKeys_t::Collate(Field == SortKeys_t::Title ? Library[i].Title : Field == SortKeys_t::Artist ? Library[i].Artist : Library[i].Album, &Collated[Field][i]);
+	}
+
+	static const char* const Names[] = { "file", "title", "artist", "album", "duration", "added" };
+	double Milliseconds[static_cast<int>(View_t::Views)] = {};
+	double SingleMilliseconds[static_cast<int>(View_t::Views)] = {};
+	std::vector<uint32_t> Order;
+	std::vector<uint32_t> Odd;
+	std::vector<uint32_t> Expected(Tracks);
+	for (int v = static_cast<int>(View_t::Title); v < static_cast<int>(View_t::Views); v++) {
+		const View_t View = static_cast<View_t>(v);
+		Milliseconds[v] = 1e9;
+		for (int Run = 0; Run < 3; Run++) {
+			Start = Clock_t::now();
+			TrackViews_t::Sort(*Keys, View, &Order);
+			Milliseconds[v] = std::min(Milliseconds[v], std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count());
+		}
+		Start = Clock_t::now();
+		TrackViews_t::Sort(*Keys, View, &Odd, 1);
+		SingleMilliseconds[v] = std::chrono::duration<double, std::milli>(Clock_t::now() - Start).count();
+		const bool IsSingleSame = Odd == Order;
+		TrackViews_t::Sort(*Keys, View, &Odd, 3);
+
+		const int Fields[3] = { v == static_cast<int>(View_t::Artist) ? SortKeys_t::Artist : v == static_cast<int>(View_t::Album) ? SortKeys_t::Album : SortKeys_t::Title,
+			v == static_cast<int>(View_t::Artist) ? SortKeys_t::Album : v == static_cast<int>(View_t::Album) ? SortKeys_t::Artist : SortKeys_t::Artist,
+			v == static_cast<int>(View_t::Title) ? SortKeys_t::Album : SortKeys_t::Title };
+		for (int i = 0; i < Tracks; i++)
+			Expected[i] = i;
+		std::sort(Expected.begin(), Expected.end(), [&](uint32_t Left, uint32_t Right) {
+			if (View == View_t::Duration || View == View_t::Added) {
+				const double LeftKey = View == View_t::Duration ? Library[Left].Duration : static_cast<double>(Library[Left].Added);
+				const double RightKey = View == View_t::Duration ? Library[Right].Duration : static_cast<double>(Library[Right].Added);
+				return LeftKey != RightKey ? LeftKey < RightKey : Left < Right;
+			}
+			for (const int Field : Fields) {
+				const int Compared = Collated[Field][Left].compare(Collated[Field][Right]);
+				if (Compared)
+					return Compared < 0;
+			}
+			return Left < Right;
+		});
+		if (Order != Expected || !IsSingleSame || Odd != Expected) {
+			printf("sort: the %s view is out of order\n", Names[v]);
+			IsPassed = false;
+		}
+	}
+
+	// Cached per view until the library changes
+	auto Shared = std::make_shared<Library_t>();
+	Shared->Tracks = std::move(Library);
+	Shared->SortKeys = Keys;
+	TrackViews_t Views;
+	Views.Sync(Shared);
+	const std::vector<uint32_t>* First = Views.Get(View_t::Title);
+	Start = Clock_t::now();
+	const std::vector<uint32_t>* Again = Views.Get(View_t::Title);
+	const double CachedMicroseconds = std::chrono::duration<double, std::micro>(Clock_t::now() - Start).count();
+	IsPassed = IsPassed && First == Again && *First == *Views.Get(View_t::Title) && !Views.Get(View_t::File);
+
+	printf("sort: %d tracks, keys built in %.1f ms, cached view in %.2f us, %u threads\n", Tracks, BuildMilliseconds, CachedMicroseconds, std::max(std::thread::hardware_concurrency(), 1u));
+	for (int v = static_cast<int>(View_t::Title); v < static_cast<int>(View_t::Views); v++)
+		printf("  %-8s %.1f ms, %.1f ms on one thread\n", Names[v], Milliseconds[v], SingleMilliseconds[v]);
+	return IsPassed && *std::max_element(std::begin(Milliseconds), std::end(Milliseconds)) <= MaxMilliseconds;
+}
+
+static bool SendAll(Socket_t Socket, std::string_view Data) {
+	while (!Data.empty()) {
+		const int Sent = SendSocket(Socket, Data.data(), Data.size());
+		if (Sent <= 0)
+			return false;
+		Data.remove_prefix(Sent);
+	}
+	return true;
+}
+
+// One response off a blocking socket, status line and headers in Head
+static bool ReadResponse(Socket_t Socket, std::string* Head, std::string* Body) {
+	std::string In;
+	size_t HeaderEnd;
+	char Buffer[4096];
+	while ((HeaderEnd = In.find("\r\n\r\n")) == std::string::npos) {
+		const int Received = ReceiveSocket(Socket, Buffer, sizeof(Buffer));
+		if (Received <= 0)
+			return false;
+		In.append(Buffer, Received);
+	}
+
+	Head->assign(In, 0, HeaderEnd);
+	const size_t Length = Head->find("Content-Length: ");
+	const size_t BodyLength = Length == std::string::npos ? 0 : strtoull(Head->c_str() + Length + 16, nullptr, 10);
+	while (In.size() < HeaderEnd + 4 + BodyLength) {
+		const int Received = ReceiveSocket(Socket, Buffer, sizeof(Buffer));
+		if (Received <= 0)
+			return false;
+		In.append(Buffer, Received);
+	}
+	Body->assign(In, HeaderEnd + 4, BodyLength);
+	return true;
+}
+
+bool Headless_t::BenchmarkRemote(int Clients, double Seconds, double MaxMilliseconds, double MaxCpuPercent) const {
+	using Clock_t = std::chrono::steady_clock;
+	if (!RemoteServer.Start(0))
+		return false;
+	MusicPlayer.Start();
+	MusicPlayer.Post({ MusicPlayer_t::CommandType_t::Play });
+	const uint16_t Port = RemoteServer.GetPort();
+	const std::string Host = "Host: 127.0.0.1:" + std::to_string(Port) + "\r\n";
+
+	// Other names, other origins and form posts are refused
+	bool IsPassed = true;
+	std::string Head, Body;
+	const std::pair<const char*, std::string> Refused[] = {
+		{ " 403 ", "GET /api/state HTTP/1.1\r\nHost: attacker.example:" + std::to_string(Port) + "\r\n\r\n" },
+		{ " 403 ", "GET /ws HTTP/1.1\r\n" + Host + "Origin: http://attacker.example\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n\r\n" },
+		{ " 415 ", "POST /api/command HTTP/1.1\r\n" + Host + "Content-Type: text/plain\r\nContent-Length: 15\r\n\r\n{\"cmd\":\"pause\"}" },
+	};
+	for (const auto& [Status, Request] : Refused) {
+		const Socket_t Socket = ConnectLoopback(Port);
+		if (Socket == NoSocket || !SendAll(Socket, Request) || !ReadResponse(Socket, &Head, &Body) || Head.find(Status) == std::string::npos) {
+			printf("remote: expected%sfor %s\n", Status, Request.substr(0, Request.find('\r')).c_str());
+			IsPassed = false;
+		}
+		CloseSocket(Socket);
+	}
+
+	// The library page has to come back as not modified when asked with its own ETag
+	const Socket_t Browser = ConnectLoopback(Port);
+	const std::string Page = "GET /api/library?offset=0&limit=50 HTTP/1.1\r\n" + Host;
+	if (Browser == NoSocket || !SendAll(Browser, Page + "\r\n") || !ReadResponse(Browser, &Head, &Body) || Head.find(" 200 ") == std::string::npos) {
+		printf("remote: library page failed\n");
+		IsPassed = false;
+	} else {
+		const size_t Tag = Head.find("ETag: ");
+		const std::string ETag = Tag == std::string::npos ? "" : Head.substr(Tag + 6, Head.find("\r\n", Tag) - Tag - 6);
+		if (ETag.empty() || !SendAll(Browser, Page + "If-None-Match: " + ETag + "\r\n\r\n") || !ReadResponse(Browser, &Head, &Body) || Head.find(" 304 ") == std::string::npos) {
+			printf("remote: library page was not cached\n");
+			IsPassed = false;
+		}
+	}
+
+	std::vector<Socket_t> Sockets;
+	for (int i = 0; i < Clients && IsPassed; i++) {
+		const Socket_t Socket = ConnectLoopback(Port);
+		const char* Key = "dGhlIHNhbXBsZSBub25jZQ==";
+		const std::string Upgrade = std::string("GET /ws HTTP/1.1\r\n") + Host + "Origin: http://localhost:" + std::to_string(Port) + "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: " + Key + "\r\n\r\n";
+		if (Socket == NoSocket || !SendAll(Socket, Upgrade) || !ReadResponse(Socket, &Head, &Body) || Head.find(" 101 ") == std::string::npos
+			|| Head.find(RemoteServer_t::GetAcceptKey(Key)) == std::string::npos) {
+			printf("remote: WebSocket handshake %d failed\n", i);
+			CloseSocket(Socket);
+			IsPassed = false;
+			break;
+		}
+		SetNonBlocking(Socket);
+		Sockets.push_back(Socket);
+	}
+
+	// Every step posts a volume of its own, so a pushed state tells which post it answers
+	constexpr int Steps = 800;
+	std::vector<std::atomic<int64_t>> Posted(Steps);
+	std::atomic<bool> IsDriving = IsPassed;
+	std::atomic<int> Driven = 0;
+	std::atomic<bool> IsDriverFailed = false;
+	std::thread Driver([&] {
+		const Socket_t Socket = ConnectLoopback(Port);
+		std::string Head, Body;
+		char Request[192];
+		for (int Step = 0; IsDriving && Socket != NoSocket; Step++) {
+			const double Volume = 10.0 + (Step % Steps) * 0.1;
+			const int Length = snprintf(Request, sizeof(Request), "{\"cmd\":\"volume\",\"value\":%.1f}", Volume);
+			std::string Post = "POST /api/command HTTP/1.1\r\n" + Host + "Content-Type: application/json\r\nContent-Length: " + std::to_string(Length) + "\r\n\r\n" + Request;
+			Posted[Step % Steps] = Clock_t::now().time_since_epoch().count();
+			if (!SendAll(Socket, Post) || !ReadResponse(Socket, &Head, &Body) || Body.find("\"ok\":true") == std::string::npos) {
+				printf("remote: command failed\n");
+				IsDriverFailed = true;
+				break;
+			}
+			Driven++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+		CloseSocket(Socket);
+	});
+
+	// Every WebSocket is read on this one thread, like a crowd of quiet phones
+	std::vector<double> Latencies;
+	std::vector<std::string> Buffers(Sockets.size());
+	std::vector<uint64_t> States(Sockets.size(), 0);
+	uint64_t Positions = 0;
+	std::vector<PollEntry_t> Entries(Sockets.size());
+	const double CpuStart = RemoteServer.GetCpuSeconds();
+	const auto Start = Clock_t::now();
+	while (IsPassed && Clock_t::now() - Start < std::chrono::duration<double>(Seconds)) {
+		for (size_t i = 0; i < Sockets.size(); i++)
+			Entries[i] = { Sockets[i] };
+		if (PollSockets(Entries.data(), Entries.size(), 50) <= 0)
+			continue;
+
+		const int64_t Now = Clock_t::now().time_since_epoch().count();
+		for (size_t i = 0; i < Sockets.size(); i++) {
+			if (!Entries[i].IsReadable)
+				continue;
+
+			char Buffer[16384];
+			int Received;
+			while ((Received = ReceiveSocket(Sockets[i], Buffer, sizeof(Buffer))) > 0)
+				Buffers[i].append(Buffer, Received);
+			if (Received == 0) {
+				printf("remote: WebSocket %zu was closed\n", i);
+				IsPassed = false;
+			}
+
+			std::string& In = Buffers[i];
+			while (In.size() >= 2) {
+				size_t Header = 2, Length = static_cast<uint8_t>(In[1]) & 0x7F;
+				if (Length == 126) {
+					if (In.size() < 4)
+						break;
+					Length = static_cast<uint8_t>(In[2]) << 8 | static_cast<uint8_t>(In[3]);
+					Header = 4;
+				}
+				if (In.size() < Header + Length)
+					break;
+
+				const std::string_view Message = std::string_view(In).substr(Header, Length);
+				const size_t Volume = Message.find("\"volume\":");
+				if (Message.find("\"event\":\"position\"") != std::string_view::npos) {
+					Positions++;
+				} else if (Volume != std::string_view::npos) {
+					States[i]++;
+					const double Value = strtod(std::string(Message.substr(Volume + 9, 8)).c_str(), nullptr);
+					const int Step = static_cast<int>(std::lround((Value - 10.0) * 10.0));
+					if (Step >= 0 && Step < Steps && Posted[Step] != 0)
+						Latencies.push_back(std::chrono::duration<double, std::milli>(Clock_t::duration(Now - Posted[Step])).count());
+				}
+				In.erase(0, Header + Length);
+			}
+		}
+	}
+	const double Elapsed = std::chrono::duration<double>(Clock_t::now() - Start).count();
+	const double CpuPercent = (RemoteServer.GetCpuSeconds() - CpuStart) / Elapsed * 100.0;
+
+	IsDriving = false;
+	Driver.join();
+	for (Socket_t Socket : Sockets)
+		CloseSocket(Socket);
+	CloseSocket(Browser);
+	const uint64_t Requests = RemoteServer.GetRequests();
+	const uint64_t Pushes = RemoteServer.GetPushes();
+	RemoteServer.Stop();
+	MusicPlayer.Post({ MusicPlayer_t::CommandType_t::SetVolume, PlayerState_t::NoTrack, 0.0f, 100.0f });
+	MusicPlayer.Stop();
+
+	std::sort(Latencies.begin(), Latencies.end());
+	const double Median = Latencies.empty() ? 0.0 : Latencies[Latencies.size() / 2];
+	const double P99 = Latencies.empty() ? 0.0 : Latencies[Latencies.size() * 99 / 100];
+	const double Max = Latencies.empty() ? 0.0 : Latencies.back();
+	const uint64_t Fewest = States.empty() ? 0 : *std::min_element(States.begin(), States.end());
+	printf("remote: %zu WebSockets for %.1f s, %d commands, %llu requests, %llu pushes, %llu positions read, push latency %.2f ms median / %.2f ms p99 / %.2f ms max, server thread %.1f%% CPU\n",
+		Sockets.size(), Elapsed, Driven.load(), static_cast<unsigned long long>(Requests), static_cast<unsigned long long>(Pushes),
+		static_cast<unsigned long long>(Positions), Median, P99, Max, CpuPercent);
+	if (IsPassed && Fewest == 0)
+		printf("remote: a WebSocket never got a state\n");
+	return IsPassed && !IsDriverFailed && Fewest > 0 && Max <= MaxMilliseconds && CpuPercent <= MaxCpuPercent;
+}
+
+static double GetProcessCpuSeconds() {
+#ifdef _WIN32
+	FILETIME Creation, Exit, Kernel, User;
+	if (!GetProcessTimes(GetCurrentProcess(), &Creation, &Exit, &Kernel, &User))
+		return 0.0;
+	const uint64_t Ticks = (static_cast<uint64_t>(Kernel.dwHighDateTime) << 32 | Kernel.dwLowDateTime) + (static_cast<uint64_t>(User.dwHighDateTime) << 32 | User.dwLowDateTime);
+	return Ticks / 1e7;
+#else
+	timespec Time;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &Time);
+	return Time.tv_sec + Time.tv_nsec / 1e9;
+#endif
+}
+
+// Stands in for the window's wake event while the load benchmark sleeps
+static std::mutex FrameWakeLock;
+static std::condition_variable FrameWakeSignal;
+static bool IsFrameWoken = false;
+
+bool Headless_t::BenchmarkLoad(double Seconds, double MaxIdleFps, double MaxIdleCpuPercent, double MaxPlayingFps, double MaxPlayingCpuPercent) const {
+	using Clock_t = std::chrono::steady_clock;
+
+	// Like the window, the engine runs on its own thread and a frame is drawn only when one was asked for
+	FrameScheduler.WakeCallback = [] {
+		{
+			std::lock_guard<std::mutex> Guard(FrameWakeLock);
+			IsFrameWoken = true;
+		}
+		FrameWakeSignal.notify_one();
+	};
+	MusicPlayer.Start();
+
+	Clock_t::time_point LastFrame = Clock_t::now();
+	const auto RunFor = [&](double Span, uint64_t* Frames) {
+		const Clock_t::time_point End = Clock_t::now() + std::chrono::duration_cast<Clock_t::duration>(std::chrono::duration<double>(Span));
+		for (Clock_t::time_point Now = Clock_t::now(); Now < End; Now = Clock_t::now()) {
+			const Clock_t::duration Wait = FrameScheduler.GetTimeUntilFrame(Now);
+			if (Wait == Clock_t::duration::zero()) {
+				FrameScheduler.BeginFrame(Now);
+				ImGui_ImplSoft_NewFrame(std::max(std::chrono::duration<float>(Now - LastFrame).count(), 1e-4f));
+				LastFrame = Now;
+				ImGui::NewFrame();
+				Interface.Draw();
+				ImGui::Render();
+				ImGui_ImplSoft_Clear(IM_COL32(0, 0, 0, 255));
+				ImGui_ImplSoft_RenderDrawData(ImGui::GetDrawData());
+				(*Frames)++;
+				continue;
+			}
+
+			std::unique_lock<std::mutex> Lock(FrameWakeLock);
+			FrameWakeSignal.wait_for(Lock, std::min(Wait, End - Now), [] { return IsFrameWoken; });
+			IsFrameWoken = false;
+			FrameScheduler.CountWakeup();
+		}
+	};
+
+	// Waits for the engine to get there, then lets the frames the change asked for settle before measuring
+	const auto Measure = [&](bool IsPlaying, double* Fps, double* CpuPercent) {
+		MusicPlayer.Post({ IsPlaying ? MusicPlayer_t::CommandType_t::Play : MusicPlayer_t::CommandType_t::Pause });
+		for (int i = 0; i < 200 && MusicPlayer.GetState()->IsPlaying != IsPlaying; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		uint64_t Frames = 0;
+		RunFor(0.5, &Frames);
+
+		Frames = 0;
+		const double CpuStart = GetProcessCpuSeconds();
+		const Clock_t::time_point Start = Clock_t::now();
+		RunFor(Seconds, &Frames);
+		const double Elapsed = std::chrono::duration<double>(Clock_t::now() - Start).count();
+		*Fps = Frames / Elapsed;
+		*CpuPercent = (GetProcessCpuSeconds() - CpuStart) / Elapsed * 100.0;
+		return MusicPlayer.GetState()->IsPlaying == IsPlaying;
+	};
+
+	double IdleFps = 0.0, IdleCpuPercent = 0.0, PlayingFps = 0.0, PlayingCpuPercent = 0.0;
+	const bool IsIdle = Measure(false, &IdleFps, &IdleCpuPercent);
+	const bool IsPlaying = Measure(true, &PlayingFps, &PlayingCpuPercent);
+
+	MusicPlayer.Post({ MusicPlayer_t::CommandType_t::Pause });
+	MusicPlayer.Stop();
+	FrameScheduler.WakeCallback = nullptr;
+
+	printf("load: idle %.1f fps, %.2f%% cpu, playing %.1f fps, %.2f%% cpu, %llu wakeups\n", IdleFps, IdleCpuPercent, PlayingFps, PlayingCpuPercent,
+		static_cast<unsigned long long>(FrameScheduler.GetStats().Wakeups));
+	if (!IsIdle || !IsPlaying)
+		printf("load: the engine didn't %s\n", IsIdle ? "start playing" : "pause");
+	return IsIdle && IsPlaying && IdleFps <= MaxIdleFps && IdleCpuPercent <= MaxIdleCpuPercent && PlayingFps <= MaxPlayingFps && PlayingCpuPercent <= MaxPlayingCpuPercent;
+}
+
+int Headless_t::Run(const std::string& ScriptPath) {
+	std::ifstream Script(ScriptPath);
+	if (!Script) {
+		printf("Failed to open script %s\n", ScriptPath.c_str());
+		return 1;
+	}
+
+	IMGUI_CHECKVERSION();
+	ImGui::SetAllocatorFunctions(&CountingImGuiAlloc, &CountingImGuiFree);
+	ImGui::CreateContext();
+
+	// Nothing from earlier runs may leak into the layout
+	ImGui::GetIO().IniFilename = nullptr;
+
+	Interface.LoadFonts(std::filesystem::current_path() / "Fonts");
+	Interface.SetStyle();
+	ImGui_ImplSoft_Init(508, 508);
+
+	this->CheckedOpens = MusicPlayer.GetStreamsOpened();
+
+	int Result = 0;
+	int LineNumber = 0;
+	std::string Line;
+	while (Result == 0 && std::getline(Script, Line)) {
+		LineNumber++;
+
+		std::istringstream Stream(Line.substr(0, Line.find('#')));
+		std::string Command;
+		if (!(Stream >> Command))
+			continue;
+
+		bool IsValid = true;
+		if (Command == "size") {
+			int Width = 0, Height = 0;
+			IsValid = static_cast<bool>(Stream >> Width >> Height) && Width > 0 && Height > 0;
+			if (IsValid)
+				ImGui_ImplSoft_SetSize(Width, Height);
+		} else if (Command == "delta") {
+			IsValid = static_cast<bool>(Stream >> this->DeltaTime) && this->DeltaTime > 0.0f;
+		} else if (Command == "frames") {
+			int Count = 0;
+			IsValid = static_cast<bool>(Stream >> Count);
+			for (int i = 0; IsValid && i < Count; i++)
+				this->RenderFrame();
+		} else if (Command == "move") {
+			float X = 0.0f, Y = 0.0f;
+			IsValid = static_cast<bool>(Stream >> X >> Y);
+			if (IsValid)
+				ImGui::GetIO().AddMousePosEvent(X, Y);
+		} else if (Command == "click") {
+			float X = 0.0f, Y = 0.0f;
+			IsValid = static_cast<bool>(Stream >> X >> Y);
+			if (IsValid) {
+				ImGui::GetIO().AddMousePosEvent(X, Y);
+				ImGui::GetIO().AddMouseButtonEvent(ImGuiMouseButton_Left, true);
+				this->RenderFrame();
+				ImGui::GetIO().AddMouseButtonEvent(ImGuiMouseButton_Left, false);
+				this->RenderFrame();
+			}
+		} else if (Command == "clicks") {
+			float X = 0.0f, Y = 0.0f;
+			int Count = 0, Between = 0;
+			IsValid = static_cast<bool>(Stream >> X >> Y >> Count >> Between);
+			ImGui::GetIO().AddMousePosEvent(X, Y);
+			for (int i = 0; IsValid && i < Count; i++) {
+				ImGui::GetIO().AddMouseButtonEvent(ImGuiMouseButton_Left, true);
+				this->RenderFrame();
+				ImGui::GetIO().AddMouseButtonEvent(ImGuiMouseButton_Left, false);
+				this->RenderFrame();
+				for (int f = 0; f < Between; f++)
+					this->RenderFrame();
+			}
+		} else if (Command == "rescan") {
+			MusicPlayer.RescanLibrary();
+		} else if (Command == "sleep" || Command == "wake") {
+			float Seconds = 0.0f;
+			IsValid = static_cast<bool>(Stream >> Seconds);
+			if (IsValid)
+				MusicPlayer.Post({ Command == "sleep" ? MusicPlayer_t::CommandType_t::Sleep : MusicPlayer_t::CommandType_t::Wake, PlayerState_t::NoTrack, Seconds });
+		} else if (Command == "snapshot") {
+			std::string Path;
+			IsValid = static_cast<bool>(Stream >> Path);
+			if (IsValid && !this->WriteImage(Path))
+				Result = 1;
+		} else if (Command == "warmup") {
+			int Count = 0;
+			IsValid = static_cast<bool>(Stream >> Count);
+			for (int i = 0; IsValid && i < Count; i++)
+				this->RenderFrame();
+			this->Stats = Stats_t();
+			this->CheckedAllocations = 0;
+		} else if (Command == "allocations") {
+			uint64_t Max = 0;
+			IsValid = static_cast<bool>(Stream >> Max);
+			if (IsValid) {
+				const uint64_t Allocations = this->Stats.Allocations - this->CheckedAllocations;
+				this->CheckedAllocations = this->Stats.Allocations;
+				if (Allocations > Max) {
+					printf("%s:%d: %llu allocations, at most %llu expected\n", ScriptPath.c_str(), LineNumber,
+						static_cast<unsigned long long>(Allocations), static_cast<unsigned long long>(Max));
+					Result = 1;
+				}
+			}
+		} else if (Command == "wait") {
+			double Seconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> Seconds);
+			if (IsValid) {
+				std::this_thread::sleep_for(std::chrono::duration<double>(Seconds));
+				this->RenderFrame();
+			}
+		} else if (Command == "opens") {
+			uint64_t Max = 0;
+			IsValid = static_cast<bool>(Stream >> Max);
+			if (IsValid) {
+				const uint64_t Opens = MusicPlayer.GetStreamsOpened() - this->CheckedOpens;
+				this->CheckedOpens = MusicPlayer.GetStreamsOpened();
+				if (Opens > Max) {
+					printf("%s:%d: %llu files opened, at most %llu expected\n", ScriptPath.c_str(), LineNumber,
+						static_cast<unsigned long long>(Opens), static_cast<unsigned long long>(Max));
+					Result = 1;
+				}
+			}
+		} else if (Command == "tracks") {
+			size_t Count = 0;
+			IsValid = static_cast<bool>(Stream >> Count);
+			if (IsValid) {
+				const std::shared_ptr<const PlayerState_t> State = MusicPlayer.GetState();
+				const size_t Tracks = State->Library ? State->Library->Tracks.size() : 0;
+				if (!State->Library || Tracks != Count) {
+					printf("%s:%d: %zu tracks in the library, %zu expected\n", ScriptPath.c_str(), LineNumber, Tracks, Count);
+					Result = 1;
+				}
+			}
+		} else if (Command == "meter") {
+			double MaxLoadPercent = 0.0;
+			IsValid = static_cast<bool>(Stream >> MaxLoadPercent);
+			if (IsValid && !this->CheckMeter(MaxLoadPercent))
+				Result = 1;
+		} else if (Command == "analyzer") {
+			double MaxMicroseconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> MaxMicroseconds);
+			if (IsValid && !this->CheckAnalyzer(MaxMicroseconds))
+				Result = 1;
+		} else if (Command == "beats") {
+			double Bpm = 0.0, MaxMilliseconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> Bpm >> MaxMilliseconds) && Bpm > 0.0;
+			if (IsValid && !this->CheckBeats(Bpm, MaxMilliseconds))
+				Result = 1;
+		} else if (Command == "clock") {
+			double Seconds = 0.0;
+			double MaxError = 0.0;
+			IsValid = static_cast<bool>(Stream >> Seconds >> MaxError);
+			if (IsValid && !this->CheckClockDrift(Seconds, MaxError))
+				Result = 1;
+		} else if (Command == "stress") {
+			double Seconds = 0.0;
+			int Threads = 0;
+			IsValid = static_cast<bool>(Stream >> Seconds >> Threads) && Threads > 0;
+			if (IsValid && !this->StressEngine(Seconds, Threads))
+				Result = 1;
+		} else if (Command == "timers") {
+			int Count = 0;
+			uint64_t Span = 0;
+			IsValid = static_cast<bool>(Stream >> Count >> Span) && Count > 0;
+			if (IsValid && !this->CheckTimers(Count, Span))
+				Result = 1;
+		} else if (Command == "voices") {
+			size_t Max = 0;
+			int Updates = 0;
+			IsValid = static_cast<bool>(Stream >> Max >> Updates) && Max > 0;
+			if (IsValid && !this->BenchmarkVoices(Max, Updates))
+				Result = 1;
+		} else if (Command == "seek") {
+			std::string Path;
+			int Count = 0;
+			double MaxMilliseconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> Path >> Count >> MaxMilliseconds) && Count > 0;
+			if (IsValid && !this->BenchmarkSeek(Path, Count, MaxMilliseconds))
+				Result = 1;
+		} else if (Command == "render") {
+			std::string Path;
+			double Seconds = 0.0;
+			size_t Track = 0;
+			IsValid = static_cast<bool>(Stream >> Path >> Seconds) && Seconds > 0.0;
+			Stream >> Track;
+
+			const std::shared_ptr<const Library_t> Library = MusicPlayer.GetState()->Library;
+			MusicPlayer_t::RenderJob_t Job;
+			Job.File = Path;
+			Job.Seconds = Seconds;
+			Job.FirstTrack = Track < Library->Tracks.size() ? Library->Tracks[Track].Id : PlayerState_t::NoTrack;
+			MusicPlayer_t::RenderStats_t Stats;
+			if (IsValid && !MusicPlayer.RenderOffline(Job, &Stats)) {
+				printf("render: failed\n");
+				Result = 1;
+			} else if (IsValid) {
+				const double Rendered = static_cast<double>(Stats.Frames) / Stats.SampleRate;
+				printf("render: %.1f s in %.3f s, %.1fx realtime, %llu streams opened\n", Rendered, Stats.WallSeconds,
+					Rendered / std::max(Stats.WallSeconds, 1e-9), static_cast<unsigned long long>(Stats.StreamsOpened));
+			}
+		} else if (Command == "goldens") {
+			std::string Folder;
+			float ToleranceDb = 0.0f;
+			IsValid = static_cast<bool>(Stream >> Folder);
+			Stream >> ToleranceDb;
+			if (IsValid && !this->CheckGoldens(Folder, ToleranceDb, false))
+				Result = 1;
+		} else if (Command == "record-goldens") {
+			std::string Folder;
+			IsValid = static_cast<bool>(Stream >> Folder);
+			if (IsValid && !this->CheckGoldens(Folder, 0.0f, true))
+				Result = 1;
+		} else if (Command == "control") {
+			int Count = 0, Clients = 0;
+			double MinPerSecond = 0.0;
+			IsValid = static_cast<bool>(Stream >> Count >> Clients >> MinPerSecond) && Count > 0 && Clients > 0;
+			if (IsValid && !this->BenchmarkControl(Count, Clients, MinPerSecond))
+				Result = 1;
+		} else if (Command == "remote") {
+			int Clients = 0;
+			double Seconds = 0.0, MaxMilliseconds = 0.0, MaxCpuPercent = 0.0;
+			IsValid = static_cast<bool>(Stream >> Clients >> Seconds >> MaxMilliseconds >> MaxCpuPercent) && Clients > 0 && Seconds > 0.0;
+			if (IsValid && !this->BenchmarkRemote(Clients, Seconds, MaxMilliseconds, MaxCpuPercent))
+				Result = 1;
+		} else if (Command == "load") {
+			double Seconds = 0.0, MaxIdleFps = 0.0, MaxIdleCpuPercent = 0.0, MaxPlayingFps = 0.0, MaxPlayingCpuPercent = 0.0;
+			IsValid = static_cast<bool>(Stream >> Seconds >> MaxIdleFps >> MaxIdleCpuPercent >> MaxPlayingFps >> MaxPlayingCpuPercent) && Seconds > 0.0;
+			if (IsValid && !this->BenchmarkLoad(Seconds, MaxIdleFps, MaxIdleCpuPercent, MaxPlayingFps, MaxPlayingCpuPercent))
+				Result = 1;
+		} else if (Command == "queue") {
+			int Count = 0;
+			double MaxNanoseconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> Count >> MaxNanoseconds) && Count > 0;
+			if (IsValid && !this->BenchmarkQueue(Count, MaxNanoseconds))
+				Result = 1;
+		} else if (Command == "stats") {
+			int Events = 0;
+			double MaxNanoseconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> Events >> MaxNanoseconds) && Events > 0;
+			if (IsValid && !this->BenchmarkStats(Events, MaxNanoseconds))
+				Result = 1;
+		} else if (Command == "playlists") {
+			int Tracks = 0;
+			double MaxMilliseconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> Tracks >> MaxMilliseconds) && Tracks > 0;
+			if (IsValid && !this->BenchmarkPlaylists(Tracks, MaxMilliseconds))
+				Result = 1;
+		} else if (Command == "facets") {
+			int Tracks = 0;
+			double MaxMilliseconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> Tracks >> MaxMilliseconds) && Tracks > 0;
+			if (IsValid && !this->BenchmarkFacets(Tracks, MaxMilliseconds))
+				Result = 1;
+		} else if (Command == "sort") {
+			int Tracks = 0;
+			double MaxMilliseconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> Tracks >> MaxMilliseconds) && Tracks > 0;
+			if (IsValid && !this->BenchmarkSort(Tracks, MaxMilliseconds))
+				Result = 1;
+		} else if (Command == "shuffle") {
+			int Tracks = 0, Picks = 0;
+			double MaxNanoseconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> Tracks >> Picks >> MaxNanoseconds) && Tracks > 0 && Picks > 0;
+			if (IsValid && !this->CheckShuffle(Tracks, Picks, MaxNanoseconds))
+				Result = 1;
+		} else if (Command == "io") {
+			std::string Path;
+			uint64_t MaxReads = 0;
+			IsValid = static_cast<bool>(Stream >> Path >> MaxReads);
+			if (IsValid && !this->CountReads(Path, MaxReads))
+				Result = 1;
+		} else if (Command == "scrub") {
+			std::string Path, WavePath;
+			int Moves = 0;
+			double MaxMilliseconds = 0.0;
+			IsValid = static_cast<bool>(Stream >> Path >> WavePath >> Moves >> MaxMilliseconds) && Moves > 0;
+			if (IsValid && !this->CheckScrub(Path, WavePath, Moves, MaxMilliseconds))
+				Result = 1;
+		} else if (Command == "compare") {
+			std::string Path;
+			int Tolerance = 0;
+			double MaxFraction = 0.0;
+			IsValid = static_cast<bool>(Stream >> Path);
+			Stream >> Tolerance >> MaxFraction;
+			if (IsValid && !this->CompareImage(Path, Tolerance, MaxFraction))
+				Result = 1;
+		} else {
+			IsValid = false;
+		}
+
+		if (!IsValid) {
+			printf("%s:%d: invalid command '%s'\n", ScriptPath.c_str(), LineNumber, Line.c_str());
+			Result = 1;
+		}
+
+		if (Interface.WantsClose) {
+			printf("%s:%d: the UI requested to close\n", ScriptPath.c_str(), LineNumber);
+			break;
+		}
+	}
+
+	if (this->Stats.Frames) {
+		printf("%llu frames, build %.1fus avg / %.1fus max, raster %.1fus avg / %.1fus max, %llu allocations\n",
+			static_cast<unsigned long long>(this->Stats.Frames),
+			this->Stats.BuildMicroseconds / this->Stats.Frames, this->Stats.MaxBuildMicroseconds,
+			this->Stats.RasterMicroseconds / this->Stats.Frames, this->Stats.MaxRasterMicroseconds,
+			static_cast<unsigned long long>(this->Stats.Allocations));
+	}
+
+	ImGui_ImplSoft_Shutdown();
+	ImGui::DestroyContext();
+	return Result;
+}
+
+const Headless_t::Stats_t& Headless_t::GetStats() const {
+	return this->Stats;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Runs the UI without a window on top of the software renderer, driven by a script.
+// Every frame uses the same fixed delta time and the same scripted input, so the output
+// is reproducible and can be compared against golden screenshots.
+//
+// Script commands, one per line, '#' starts a comment:
+//   size <width> <height>              Resize the framebuffer (default 508 x 508)
+//   delta <seconds>                    Delta time of every following frame (default 1/60)
+//   frames <count>                     Render frames without new input
+//   move <x> <y>                       Move the mouse, takes effect on the next frame
+//   click <x> <y>                      Press and release the left button at x, y over two frames
+//   clicks <x> <y> <count> <frames>    Click count times at x, y with that many frames in between
+//   rescan                             Rescan the music folder, the engine picks it up on the next frame
+//   sleep <seconds>                    Post a sleep timer, 0 cancels
+//   wake <seconds>                     Post a scheduled start, 0 cancels
+//   snapshot <file.tga>                Write the current framebuffer
+//   compare <file.tga> [tol] [frac]    Fail if more than frac of the pixels differ by more than tol in any channel
+//   warmup <count>                     Render frames, then forget their timings and allocations
+//   allocations <max>                  Fail if frames since the last check or warmup made more than max heap allocations
+//   wait <seconds>                     Sleep in real time, for the engine's own timers, then render a frame
+//   opens <max>                        Fail if more than max files were opened for playback since the last check
+//   tracks <count>                     Fail unless the engine's library holds count tracks
+//   meter <max load %>                 Feed the EBU Tech 3341 loudness and true-peak test signals through a level meter and
+//                                      check every reading against its tolerance, then time a minute of noise. Fail if a
+//                                      reading is off or the meter used more than max % of a core
+//   analyzer <max us>                  Play a -6 dBFS sine on the center of every constant-Q band and check it reads -6 dB
+//                                      in that band and stands out over its neighbours, then time updates at the realtime
+//                                      pace. Fail if a sine lands elsewhere or an update took longer than max us on average
+//   beats <bpm> <max ms>               Feed 40 s of a 4/4 click track with accented downbeats to a beat detector. Once it had
+//                                      12 s to settle, fail if the tempo is off by more than 2%, a beat is missing or more than
+//                                      max ms away from its click, or fewer than 9 in 10 downbeats fall on the accented click
+//   clock <seconds> <max ms>           Simulate a playback of that length against a sink with a drifting device clock,
+//                                      fail if the interpolated clock ever strays further than max ms from the sink
+//   stress <seconds> <threads>         Run the engine on its own thread while that many threads post random skips,
+//                                      fail if a published state is inconsistent or its version goes backwards
+//   timers <count> <span ms>           Schedule count timers over the span on a fresh timing wheel, cancel every third,
+//                                      fail unless every other one fires exactly on its tick
+//   voices <max> <updates>             Pile up 1 to max overlapping voices by selecting, time that many engine updates
+//                                      at each count and report them along with the BASS mixer load
+//   seek <file.mp3> <count> <max ms>   Build, cache and load the file's seek table, then seek count random spots through it.
+//                                      Fail if a seek takes longer than max ms or lands elsewhere than a prescanned reference
+//   scrub <file.mp3> <out.wav> <moves> <max ms>
+//                                      Drag a scrubber across the file that many times, pulling its grains in real time into a
+//                                      WAV file. Fail if a move takes longer than max ms to be heard
+//   render <out.wav> <seconds> [track] Play the library from the track-th one (default the first) on a virtual clock into a
+//                                      WAV or .raw file as fast as it decodes, and report the speed as a multiple of realtime
+//   goldens <folder> [tol dB]          Render the fixed audio scenarios (autoplay crossfade, skip mid-fade, pause and resume,
+//                                      gapless joins) over generated tone tracks and compare the hash of every 100 ms against
+//                                      <folder>/<scenario>.txt. A block whose hash differs passes if its RMS and peak are within
+//                                      tol dB (default 0). Fail if a block fails or a golden is missing
+//   record-goldens <folder>            Render the same scenarios and write their hashes as the new goldens
+//   control <count> <clients> <min/s>  Run the engine behind the control socket and send count requests spread over that many
+//                                      pipelining clients while one more subscribes. Fail if any request fails, fewer than
+//                                      min/s are answered, no state was pushed, a string id isn't echoed as one or queue
+//                                      entries don't move and go by handle
+//   remote <clients> <seconds> <max ms> <max cpu %>
+//                                      Play behind the HTTP remote with that many WebSockets open while a browser posts a volume
+//                                      every 20 ms. Fail if a foreign Host or Origin or a form post isn't refused, the library
+//                                      page isn't answered 304 for its own ETag, a push takes longer than max ms to arrive or
+//                                      the server thread uses more than max cpu % of a core
+//   load <seconds> <idle fps> <idle cpu %> <playing fps> <playing cpu %>
+//                                      Run the window's loop over the frame scheduler and the software renderer, with the engine
+//                                      on its own thread, that many seconds paused and as many playing. Fail if the engine doesn't
+//                                      get there or either state draws more frames a second or uses more of a core than its limits
+//   queue <count> <max ns>             Queue count tracks, move each of them once, remove and pop a quarter each by handle,
+//                                      in memory and through a journal, then restore the journal with a torn line at its end.
+//                                      Fail if the restored queue differs or an edit in memory took longer than max ns on average
+//   shuffle <tracks> <picks> <max ns>  Check that fair shuffling is uniform, repeats nothing within a cycle or the window and
+//                                      keeps up with a library change, and that weighted picks follow the weights (chi-square
+//                                      at p = 0.001). Then time picks over that many tracks, fail if either mode takes max ns
+//   stats <events> <max ns>            Record that many plays and skips in bursts over an eighth as many tracks, reopen the stats
+//                                      with a torn record at the end of the log and again once it was compacted. Fail if a record
+//                                      was dropped, the reopened stats differ, an old table was left behind or recording took
+//                                      longer than max ns on average
+//   playlists <tracks> <max ms>        Build a library of that many tagged tracks with a play history and check three smart
+//                                      playlists against a plain evaluation, after every play, a retagging of a thousandth of
+//                                      the tracks and once the clock moved on. Fail if they differ, a playlist the retagging didn't
+//                                      touch was built again or evaluating any rule over the whole library took longer than max ms
+//   facets <tracks> <max ms>           Index the genres, artists and albums of that many tracks, follow a rescan that removed,
+//                                      added and retagged a percent each, then narrow down column by column. Fail if the
+//                                      index differs from one read in full or a selection took longer than max ms
+//   sort <tracks> <max ms>             Check a few collation keys, then sort that many tracks with accented, cased and "The"
+//                                      titles into every view on all threads, on one and on three. Fail if any order differs
+//                                      from plainly sorting the collated strings or a view took longer than max ms to sort
+//   io <file.mp3> <max reads>          Decode the file through BASS's own file reader and through a mapping, and walk it
+//                                      for a seek table, counting read calls. Fail if the mapped decode made more than max reads
+class Headless_t {
+public:
+	struct Stats_t {
+		uint64_t Frames = 0;
+		double BuildMicroseconds = 0.0;		// NewFrame() to Render()
+		double RasterMicroseconds = 0.0;	// Rasterizing the draw data
+		double MaxBuildMicroseconds = 0.0;
+		double MaxRasterMicroseconds = 0.0;
+		uint64_t Allocations = 0;			// operator new calls on this thread during the engine update, UI and raster
+	};
+
+private:
+	float DeltaTime = 1.0f / 60.0f;
+	Stats_t Stats;
+	uint64_t CheckedAllocations = 0;
+	uint64_t CheckedOpens = 0;
+
+	void RenderFrame();
+
+	bool WriteImage(const std::string& Path) const;
+	static bool ReadImage(const std::string& Path, int* Width, int* Height, std::vector<uint32_t>* Pixels);
+	bool CompareImage(const std::string& Path, int Tolerance, double MaxFraction) const;
+
+	bool CheckMeter(double MaxLoadPercent) const;
+	bool CheckAnalyzer(double MaxMicroseconds) const;
+	bool CheckBeats(double Bpm, double MaxMilliseconds) const;
+	bool CheckClockDrift(double Seconds, double MaxErrorMilliseconds) const;
+	bool StressEngine(double Seconds, int Threads) const;
+	bool BenchmarkVoices(size_t Max, int Updates) const;
+	bool CheckTimers(int Count, uint64_t Span) const;
+	bool BenchmarkSeek(const std::string& Path, int Count, double MaxMilliseconds) const;
+	bool CountReads(const std::string& Path, uint64_t MaxReads) const;
+	bool CheckScrub(const std::string& Path, const std::string& WavePath, int Moves, double MaxMilliseconds) const;
+	bool CheckGoldens(const std::string& Folder, float ToleranceDb, bool IsRecording) const;
+	bool BenchmarkControl(int Count, int Clients, double MinPerSecond) const;
+	bool CheckShuffle(int Tracks, int Picks, double MaxNanoseconds) const;
+	bool BenchmarkQueue(int Count, double MaxNanoseconds) const;
+	bool BenchmarkStats(int Events, double MaxNanoseconds) const;
+	bool BenchmarkPlaylists(int Tracks, double MaxMilliseconds) const;
+	bool BenchmarkFacets(int Tracks, double MaxMilliseconds) const;
+	bool BenchmarkSort(int Tracks, double MaxMilliseconds) const;
+	bool BenchmarkRemote(int Clients, double Seconds, double MaxMilliseconds, double MaxCpuPercent) const;
+	bool BenchmarkLoad(double Seconds, double MaxIdleFps, double MaxIdleCpuPercent, double MaxPlayingFps, double MaxPlayingCpuPercent) const;
+
+public:
+	// Returns the process exit code, non-zero if the script failed or a comparison did not match
+	int Run(const std::string& ScriptPath);
+
+	const Stats_t& GetStats() const;
+
+} extern Headless;
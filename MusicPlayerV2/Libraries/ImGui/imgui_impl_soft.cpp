@@ -0,0 +1,393 @@
+// dear imgui: Platform + Renderer Backend for headless CPU rendering
+// Rasterizes ImDrawData into an RGBA8 framebuffer in system memory, no window, GPU or OS input needed.
+// Used to run the UI on machines without a display, e.g. for frame time benchmarks and screenshot diffs.
+
+// Implemented features:
+//  [X] Platform: Fixed, caller provided delta time so replays are deterministic.
+//  [X] Renderer: Large meshes support (64k+ vertices) with 16-bit indices.
+//  [X] Renderer: Scissor rectangles, bilinear texture sampling, same blend equation as imgui_impl_dx11.
+//  [ ] Renderer: User texture binding, only the font atlas can be sampled.
+
+#include "imgui.h"
+#ifndef IMGUI_DISABLE
+#include "imgui_impl_soft.h"
+
+#include <math.h>
+#include <string.h>
+
+struct ImGui_ImplSoft_Texture
+{
+    int                 Width;
+    int                 Height;
+    ImVector<ImU32>     Pixels;
+};
+
+// Software renderer data
+struct ImGui_ImplSoft_Data
+{
+    int                     Width;
+    int                     Height;
+    ImVector<ImU32>         Framebuffer;
+    ImGui_ImplSoft_Texture  FontTexture;
+    bool                    FontTextureBuilt;
+
+    ImGui_ImplSoft_Data()   { Width = Height = 0; FontTexture.Width = FontTexture.Height = 0; FontTextureBuilt = false; }
+};
+
+// Backend data stored in io.BackendRendererUserData to allow support for multiple Dear ImGui contexts
+static ImGui_ImplSoft_Data* ImGui_ImplSoft_GetBackendData()
+{
+    return ImGui::GetCurrentContext() ? (ImGui_ImplSoft_Data*)ImGui::GetIO().BackendRendererUserData : nullptr;
+}
+
+static inline float   ImGui_ImplSoft_Clampf(float v, float mn, float mx)    { return v < mn ? mn : v > mx ? mx : v; }
+static inline int     ImGui_ImplSoft_Clampi(int v, int mn, int mx)          { return v < mn ? mn : v > mx ? mx : v; }
+static inline float   ImGui_ImplSoft_Lerp(float a, float b, float t)        { return a + (b - a) * t; }
+
+// Colors are blended in float, one channel per component in 0..1
+struct ImGui_ImplSoft_Color
+{
+    float r, g, b, a;
+};
+
+static inline ImGui_ImplSoft_Color ImGui_ImplSoft_Unpack(ImU32 c)
+{
+    const float s = 1.0f / 255.0f;
+    ImGui_ImplSoft_Color out;
+    out.r = ((c >> IM_COL32_R_SHIFT) & 0xFF) * s;
+    out.g = ((c >> IM_COL32_G_SHIFT) & 0xFF) * s;
+    out.b = ((c >> IM_COL32_B_SHIFT) & 0xFF) * s;
+    out.a = ((c >> IM_COL32_A_SHIFT) & 0xFF) * s;
+    return out;
+}
+
+static inline ImU32 ImGui_ImplSoft_Pack(const ImGui_ImplSoft_Color& c)
+{
+    ImU32 r = (ImU32)(ImGui_ImplSoft_Clampf(c.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+    ImU32 g = (ImU32)(ImGui_ImplSoft_Clampf(c.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+    ImU32 b = (ImU32)(ImGui_ImplSoft_Clampf(c.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+    ImU32 a = (ImU32)(ImGui_ImplSoft_Clampf(c.a, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return (r << IM_COL32_R_SHIFT) | (g << IM_COL32_G_SHIFT) | (b << IM_COL32_B_SHIFT) | (a << IM_COL32_A_SHIFT);
+}
+
+// Bilinear filtering with clamped addressing, equivalent to D3D11_FILTER_MIN_MAG_MIP_LINEAR on a single mip
+static ImGui_ImplSoft_Color ImGui_ImplSoft_Sample(const ImGui_ImplSoft_Texture* tex, float u, float v)
+{
+    float x = u * tex->Width - 0.5f;
+    float y = v * tex->Height - 0.5f;
+    float fx = floorf(x);
+    float fy = floorf(y);
+    float tx = x - fx;
+    float ty = y - fy;
+    int x0 = ImGui_ImplSoft_Clampi((int)fx, 0, tex->Width - 1);
+    int y0 = ImGui_ImplSoft_Clampi((int)fy, 0, tex->Height - 1);
+    int x1 = ImGui_ImplSoft_Clampi((int)fx + 1, 0, tex->Width - 1);
+    int y1 = ImGui_ImplSoft_Clampi((int)fy + 1, 0, tex->Height - 1);
+
+    ImGui_ImplSoft_Color c00 = ImGui_ImplSoft_Unpack(tex->Pixels[y0 * tex->Width + x0]);
+    ImGui_ImplSoft_Color c10 = ImGui_ImplSoft_Unpack(tex->Pixels[y0 * tex->Width + x1]);
+    ImGui_ImplSoft_Color c01 = ImGui_ImplSoft_Unpack(tex->Pixels[y1 * tex->Width + x0]);
+    ImGui_ImplSoft_Color c11 = ImGui_ImplSoft_Unpack(tex->Pixels[y1 * tex->Width + x1]);
+
+    ImGui_ImplSoft_Color out;
+    out.r = ImGui_ImplSoft_Lerp(ImGui_ImplSoft_Lerp(c00.r, c10.r, tx), ImGui_ImplSoft_Lerp(c01.r, c11.r, tx), ty);
+    out.g = ImGui_ImplSoft_Lerp(ImGui_ImplSoft_Lerp(c00.g, c10.g, tx), ImGui_ImplSoft_Lerp(c01.g, c11.g, tx), ty);
+    out.b = ImGui_ImplSoft_Lerp(ImGui_ImplSoft_Lerp(c00.b, c10.b, tx), ImGui_ImplSoft_Lerp(c01.b, c11.b, tx), ty);
+    out.a = ImGui_ImplSoft_Lerp(ImGui_ImplSoft_Lerp(c00.a, c10.a, tx), ImGui_ImplSoft_Lerp(c01.a, c11.a, tx), ty);
+    return out;
+}
+
+// SrcBlend = SRC_ALPHA, DestBlend = INV_SRC_ALPHA, SrcBlendAlpha = ONE, DestBlendAlpha = INV_SRC_ALPHA, in 8 bit like an UNORM target
+static inline void ImGui_ImplSoft_Blend(ImU32* dst, ImU32 src)
+{
+    const ImU32 sa = (src >> IM_COL32_A_SHIFT) & 0xFF;
+    if (sa == 0)
+        return;
+    if (sa == 255)
+    {
+        *dst = src;
+        return;
+    }
+    const ImU32 d = *dst;
+    const ImU32 inv = 255 - sa;
+    const ImU32 r = (((src >> IM_COL32_R_SHIFT) & 0xFF) * sa + ((d >> IM_COL32_R_SHIFT) & 0xFF) * inv + 127) / 255;
+    const ImU32 g = (((src >> IM_COL32_G_SHIFT) & 0xFF) * sa + ((d >> IM_COL32_G_SHIFT) & 0xFF) * inv + 127) / 255;
+    const ImU32 b = (((src >> IM_COL32_B_SHIFT) & 0xFF) * sa + ((d >> IM_COL32_B_SHIFT) & 0xFF) * inv + 127) / 255;
+    const ImU32 a = (sa * 255 + ((d >> IM_COL32_A_SHIFT) & 0xFF) * inv + 127) / 255;
+    *dst = (r << IM_COL32_R_SHIFT) | (g << IM_COL32_G_SHIFT) | (b << IM_COL32_B_SHIFT) | (a << IM_COL32_A_SHIFT);
+}
+
+// Half-space rasterizer sampling at pixel centers. Positions are snapped to 1/256 pixel and the edge functions
+// evaluated in integers, so together with the top-left fill rule every pixel on an edge shared by two triangles
+// is blended exactly once. That matters for the translucent anti-aliasing fringes imgui emits.
+static void ImGui_ImplSoft_RasterizeTriangle(ImGui_ImplSoft_Data* bd, const ImGui_ImplSoft_Texture* tex, const ImDrawVert* v0, const ImDrawVert* v1, const ImDrawVert* v2, const ImVec2& offset, const int clip[4])
+{
+    const int sub_bits = 8;
+    const float sub_scale = (float)(1 << sub_bits);
+    const long long half = 1 << (sub_bits - 1);
+
+    // Reject what can't be represented before snapping, imgui never emits anything that far out
+    const float limit = 1 << 20;
+    if (fabsf(v0->pos.x - offset.x) > limit || fabsf(v0->pos.y - offset.y) > limit ||
+        fabsf(v1->pos.x - offset.x) > limit || fabsf(v1->pos.y - offset.y) > limit ||
+        fabsf(v2->pos.x - offset.x) > limit || fabsf(v2->pos.y - offset.y) > limit)
+        return;
+
+    long long x0 = (long long)floorf((v0->pos.x - offset.x) * sub_scale + 0.5f), y0 = (long long)floorf((v0->pos.y - offset.y) * sub_scale + 0.5f);
+    long long x1 = (long long)floorf((v1->pos.x - offset.x) * sub_scale + 0.5f), y1 = (long long)floorf((v1->pos.y - offset.y) * sub_scale + 0.5f);
+    long long x2 = (long long)floorf((v2->pos.x - offset.x) * sub_scale + 0.5f), y2 = (long long)floorf((v2->pos.y - offset.y) * sub_scale + 0.5f);
+
+    long long area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+    if (area == 0)
+        return;
+    if (area < 0)
+    {
+        long long t;
+        t = x1; x1 = x2; x2 = t;
+        t = y1; y1 = y2; y2 = t;
+        const ImDrawVert* v = v1; v1 = v2; v2 = v;
+        area = -area;
+    }
+
+    const long long min_fx = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+    const long long min_fy = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+    const long long max_fx = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+    const long long max_fy = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+    int min_x = ImGui_ImplSoft_Clampi((int)(min_fx >> sub_bits), clip[0], clip[2]);
+    int min_y = ImGui_ImplSoft_Clampi((int)(min_fy >> sub_bits), clip[1], clip[3]);
+    int max_x = ImGui_ImplSoft_Clampi((int)((max_fx >> sub_bits) + 1), clip[0], clip[2]);
+    int max_y = ImGui_ImplSoft_Clampi((int)((max_fy >> sub_bits) + 1), clip[1], clip[3]);
+    if (min_x >= max_x || min_y >= max_y)
+        return;
+
+    // Edge functions, E12 weights v0, E20 weights v1 and E01 weights v2
+    const long long ax[3] = { x1, x2, x0 }, ay[3] = { y1, y2, y0 };
+    const long long bx[3] = { x2, x0, x1 }, by[3] = { y2, y0, y1 };
+    long long edge_dx[3], edge_dy[3], bias[3];
+    for (int e = 0; e < 3; e++)
+    {
+        edge_dx[e] = bx[e] - ax[e];
+        edge_dy[e] = by[e] - ay[e];
+        bool top_left = edge_dy[e] < 0 || (edge_dy[e] == 0 && edge_dx[e] > 0);
+        bias[e] = top_left ? 0 : -1;
+    }
+
+    const float inv_area = 1.0f / (float)area;
+    const ImGui_ImplSoft_Color c0 = ImGui_ImplSoft_Unpack(v0->col);
+    const ImGui_ImplSoft_Color c1 = ImGui_ImplSoft_Unpack(v1->col);
+    const ImGui_ImplSoft_Color c2 = ImGui_ImplSoft_Unpack(v2->col);
+
+    // Most of imgui's geometry is flat colored and uses the white pixel of the atlas, sample that once
+    const bool solid = v0->col == v1->col && v1->col == v2->col && v0->uv.x == v1->uv.x && v1->uv.x == v2->uv.x && v0->uv.y == v1->uv.y && v1->uv.y == v2->uv.y;
+    ImGui_ImplSoft_Color solid_color = c0;
+    if (solid && tex)
+    {
+        ImGui_ImplSoft_Color t = ImGui_ImplSoft_Sample(tex, v0->uv.x, v0->uv.y);
+        solid_color.r *= t.r; solid_color.g *= t.g; solid_color.b *= t.b; solid_color.a *= t.a;
+    }
+    const ImU32 solid_packed = ImGui_ImplSoft_Pack(solid_color);
+    if (solid && ((solid_packed >> IM_COL32_A_SHIFT) & 0xFF) == 0)
+        return;
+
+    // Where each edge crosses the current row in pixels, stepped once per row. Only used to narrow the rows down
+    // to the covered span, imgui's fans have long thin triangles whose bounding boxes are mostly empty.
+    double cross[3], cross_step[3];
+    for (int e = 0; e < 3; e++)
+    {
+        if (edge_dy[e] == 0)
+            continue;
+        const long long py = ((long long)min_y << sub_bits) + half;
+        cross[e] = ((double)ax[e] + (double)(edge_dx[e] * (py - ay[e])) / (double)edge_dy[e] - half) / sub_scale;
+        cross_step[e] = (double)edge_dx[e] / (double)edge_dy[e];
+    }
+
+    for (int y = min_y; y < max_y; y++)
+    {
+        const long long py = ((long long)y << sub_bits) + half;
+
+        // The span is conservative, the exact test happens per pixel
+        int span_min = min_x;
+        int span_max = max_x;
+        for (int e = 0; e < 3; e++)
+        {
+            if (edge_dy[e] < 0)
+                span_min = (int)ImGui_ImplSoft_Clampf((float)floor(cross[e]) - 1.0f, (float)span_min, (float)span_max);
+            else if (edge_dy[e] > 0)
+                span_max = (int)ImGui_ImplSoft_Clampf((float)ceil(cross[e]) + 2.0f, (float)span_min, (float)span_max);
+            else if (edge_dx[e] * (py - ay[e]) + bias[e] < 0)
+                span_max = span_min;
+            cross[e] += cross_step[e];
+        }
+
+        long long w[3], step_x[3];
+        for (int e = 0; e < 3; e++)
+        {
+            w[e] = edge_dx[e] * (py - ay[e]) - edge_dy[e] * ((((long long)span_min) << sub_bits) + half - ax[e]) + bias[e];
+            step_x[e] = -edge_dy[e] << sub_bits;
+        }
+
+        ImU32* dst = bd->Framebuffer.Data + y * bd->Width + span_min;
+        for (int x = span_min; x < span_max; x++, dst++, w[0] += step_x[0], w[1] += step_x[1], w[2] += step_x[2])
+        {
+            if ((w[0] | w[1] | w[2]) < 0)
+                continue;
+
+            if (solid)
+            {
+                ImGui_ImplSoft_Blend(dst, solid_packed);
+                continue;
+            }
+
+            float b0 = (float)(w[0] - bias[0]) * inv_area;
+            float b1 = (float)(w[1] - bias[1]) * inv_area;
+            float b2 = 1.0f - b0 - b1;
+            ImGui_ImplSoft_Color src;
+            src.r = c0.r * b0 + c1.r * b1 + c2.r * b2;
+            src.g = c0.g * b0 + c1.g * b1 + c2.g * b2;
+            src.b = c0.b * b0 + c1.b * b1 + c2.b * b2;
+            src.a = c0.a * b0 + c1.a * b1 + c2.a * b2;
+            if (tex)
+            {
+                float u = v0->uv.x * b0 + v1->uv.x * b1 + v2->uv.x * b2;
+                float v = v0->uv.y * b0 + v1->uv.y * b1 + v2->uv.y * b2;
+                ImGui_ImplSoft_Color t = ImGui_ImplSoft_Sample(tex, u, v);
+                src.r *= t.r; src.g *= t.g; src.b *= t.b; src.a *= t.a;
+            }
+            ImGui_ImplSoft_Blend(dst, ImGui_ImplSoft_Pack(src));
+        }
+    }
+}
+
+static void ImGui_ImplSoft_CreateFontsTexture()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    bd->FontTexture.Width = width;
+    bd->FontTexture.Height = height;
+    bd->FontTexture.Pixels.resize(width * height);
+    memcpy(bd->FontTexture.Pixels.Data, pixels, (size_t)width * height * sizeof(ImU32));
+    bd->FontTextureBuilt = true;
+
+    io.Fonts->SetTexID((ImTextureID)&bd->FontTexture);
+}
+
+bool ImGui_ImplSoft_Init(int width, int height)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    IMGUI_CHECKVERSION();
+    IM_ASSERT(io.BackendRendererUserData == nullptr && "Already initialized a renderer backend!");
+    IM_ASSERT(io.BackendPlatformUserData == nullptr && "Already initialized a platform backend!");
+
+    ImGui_ImplSoft_Data* bd = IM_NEW(ImGui_ImplSoft_Data)();
+    io.BackendRendererUserData = (void*)bd;
+    io.BackendRendererName = "imgui_impl_soft";
+    io.BackendPlatformName = "imgui_impl_soft";
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;  // We can honor the ImDrawCmd::VtxOffset field, allowing for large meshes.
+
+    ImGui_ImplSoft_SetSize(width, height);
+    return true;
+}
+
+void ImGui_ImplSoft_Shutdown()
+{
+    ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+    IM_ASSERT(bd != nullptr && "No renderer backend to shutdown, or already shutdown?");
+    ImGuiIO& io = ImGui::GetIO();
+
+    if (bd->FontTextureBuilt)
+        io.Fonts->SetTexID(0);
+    io.BackendRendererName = nullptr;
+    io.BackendPlatformName = nullptr;
+    io.BackendRendererUserData = nullptr;
+    io.BackendFlags &= ~ImGuiBackendFlags_RendererHasVtxOffset;
+    IM_DELETE(bd);
+}
+
+void ImGui_ImplSoft_NewFrame(float delta_time)
+{
+    ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+    IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplSoft_Init()?");
+    IM_ASSERT(delta_time > 0.0f);
+
+    if (!bd->FontTextureBuilt)
+        ImGui_ImplSoft_CreateFontsTexture();
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)bd->Width, (float)bd->Height);
+    io.DisplayFramebufferScale = ImVec2(1.0f, 1.0f);
+    io.DeltaTime = delta_time;
+}
+
+void ImGui_ImplSoft_RenderDrawData(ImDrawData* draw_data)
+{
+    ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+    if (draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f || bd->Width <= 0 || bd->Height <= 0)
+        return;
+
+    const ImVec2 clip_off = draw_data->DisplayPos;
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+        {
+            const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+            if (pcmd->UserCallback != nullptr)
+            {
+                // There is no render state to reset
+                if (pcmd->UserCallback != ImDrawCallback_ResetRenderState)
+                    pcmd->UserCallback(cmd_list, pcmd);
+                continue;
+            }
+
+            // Project scissor/clipping rectangles into framebuffer space
+            int clip[4];
+            clip[0] = ImGui_ImplSoft_Clampi((int)(pcmd->ClipRect.x - clip_off.x), 0, bd->Width);
+            clip[1] = ImGui_ImplSoft_Clampi((int)(pcmd->ClipRect.y - clip_off.y), 0, bd->Height);
+            clip[2] = ImGui_ImplSoft_Clampi((int)(pcmd->ClipRect.z - clip_off.x), 0, bd->Width);
+            clip[3] = ImGui_ImplSoft_Clampi((int)(pcmd->ClipRect.w - clip_off.y), 0, bd->Height);
+            if (clip[2] <= clip[0] || clip[3] <= clip[1])
+                continue;
+
+            const ImGui_ImplSoft_Texture* tex = (const ImGui_ImplSoft_Texture*)pcmd->GetTexID();
+            const ImDrawVert* vtx = cmd_list->VtxBuffer.Data + pcmd->VtxOffset;
+            const ImDrawIdx* idx = cmd_list->IdxBuffer.Data + pcmd->IdxOffset;
+            for (unsigned int i = 0; i + 2 < pcmd->ElemCount; i += 3)
+                ImGui_ImplSoft_RasterizeTriangle(bd, tex, &vtx[idx[i]], &vtx[idx[i + 1]], &vtx[idx[i + 2]], clip_off, clip);
+        }
+    }
+}
+
+void ImGui_ImplSoft_SetSize(int width, int height)
+{
+    ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+    IM_ASSERT(bd != nullptr && width >= 0 && height >= 0);
+    bd->Width = width;
+    bd->Height = height;
+    bd->Framebuffer.resize(width * height);
+    ImGui_ImplSoft_Clear(IM_COL32(0, 0, 0, 255));
+}
+
+void ImGui_ImplSoft_Clear(ImU32 color)
+{
+    ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+    for (int i = 0; i < bd->Framebuffer.Size; i++)
+        bd->Framebuffer.Data[i] = color;
+}
+
+const ImU32* ImGui_ImplSoft_GetPixels(int* out_width, int* out_height)
+{
+    ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+    if (out_width)
+        *out_width = bd->Width;
+    if (out_height)
+        *out_height = bd->Height;
+    return bd->Framebuffer.Data;
+}
+
+//-----------------------------------------------------------------------------
+
+#endif // #ifndef IMGUI_DISABLE
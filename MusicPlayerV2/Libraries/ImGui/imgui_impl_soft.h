@@ -0,0 +1,28 @@
+// dear imgui: Platform + Renderer Backend for headless CPU rendering
+// Rasterizes ImDrawData into an RGBA8 framebuffer in system memory, no window, GPU or OS input needed.
+// Used to run the UI on machines without a display, e.g. for frame time benchmarks and screenshot diffs.
+
+// Implemented features:
+//  [X] Platform: Fixed, caller provided delta time so replays are deterministic.
+//  [X] Renderer: Large meshes support (64k+ vertices) with 16-bit indices.
+//  [X] Renderer: Scissor rectangles, bilinear texture sampling, same blend equation as imgui_impl_dx11.
+//  [ ] Renderer: User texture binding, only the font atlas can be sampled.
+
+// Input is whatever the caller queues with the regular io.AddMousePosEvent() / io.AddMouseButtonEvent() API
+// before calling ImGui::NewFrame().
+
+#pragma once
+#include "imgui.h"      // IMGUI_IMPL_API
+#ifndef IMGUI_DISABLE
+
+IMGUI_IMPL_API bool     ImGui_ImplSoft_Init(int width, int height);
+IMGUI_IMPL_API void     ImGui_ImplSoft_Shutdown();
+IMGUI_IMPL_API void     ImGui_ImplSoft_NewFrame(float delta_time);
+IMGUI_IMPL_API void     ImGui_ImplSoft_RenderDrawData(ImDrawData* draw_data);
+
+// Framebuffer access. Pixels are packed like IM_COL32(), tightly packed rows, top row first.
+IMGUI_IMPL_API void     ImGui_ImplSoft_SetSize(int width, int height);
+IMGUI_IMPL_API void     ImGui_ImplSoft_Clear(ImU32 color);
+IMGUI_IMPL_API const ImU32* ImGui_ImplSoft_GetPixels(int* out_width, int* out_height);
+
+#endif // #ifndef IMGUI_DISABLE
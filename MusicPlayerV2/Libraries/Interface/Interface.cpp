@@ -0,0 +1,343 @@
+#include "Interface.hpp"
+#include "../MusicPlayer_t/MusicPlayer.hpp"
+#include "../FrameScheduler/FrameScheduler.hpp"
+#include "../FrameArena/FrameArena.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+Interface_t Interface;
+
+void Interface_t::LoadFonts(const std::filesystem::path& Folder) {
+	ImGuiIO* io = &ImGui::GetIO();
+
+	if (!std::filesystem::exists(Folder)) {
+		printf("Font folder %s not found\n", Folder.string().c_str());
+		return;
+	}
+
+	for (const auto& Entry : std::filesystem::directory_iterator(Folder)) {
+		const std::string& Name = Entry.path().filename().string();
+		if (Name.find("Bold") != std::string::npos) {
+			this->BoldFont = io->Fonts->AddFontFromFileTTF(Entry.path().string().c_str(), 24.0f);
+		}
+
+		if (Name.find("Medium") != std::string::npos) {
+			this->MediumFont = io->Fonts->AddFontFromFileTTF(Entry.path().string().c_str(), 18.0f);
+		}
+	}
+}
+
+void Interface_t::SetStyle() {
+	ImGuiStyle* Style = &ImGui::GetStyle();
+
+	Style->WindowRounding = 20.0f;
+	Style->WindowMinSize = ImVec2(1.0f, 1.0f);
+
+	Style->Colors[ImGuiCol_WindowBg] = ImColor(1.0f, 1.0f, 1.0f, 0.03f);
+	Style->Colors[ImGuiCol_ResizeGrip] = ImColor(0.0f, 0.0f, 0.0f, 0.0f);
+	Style->Colors[ImGuiCol_ResizeGripActive] = ImColor(0.0f, 0.0f, 0.0f, 0.0f);
+	Style->Colors[ImGuiCol_ResizeGripHovered] = ImColor(0.0f, 0.0f, 0.0f, 0.0f);
+
+	Style->Colors[ImGuiCol_Separator] = ImColor(1.0f, 1.0f, 1.0f, 0.2f);
+	Style->Colors[ImGuiCol_SeparatorHovered] = ImColor(1.0f, 1.0f, 1.0f, 0.35f);
+	Style->Colors[ImGuiCol_SeparatorActive] = ImColor(1.0f, 1.0f, 1.0f, 0.5f);
+
+	Style->Colors[ImGuiCol_Header] = ImColor(1.0f, 1.0f, 1.0f, 0.2f);
+	Style->Colors[ImGuiCol_HeaderActive] = ImColor(1.0f, 1.0f, 1.0f, 0.35f);
+	Style->Colors[ImGuiCol_HeaderHovered] = ImColor(1.0f, 1.0f, 1.0f, 0.5f);
+
+	Style->ScrollbarSize = 2.0f;
+}
+
+void Interface_t::DrawFacet(FacetIndex_t::Field_t Field, const char* Name, const ImVec2& Size) {
+	const std::vector<uint32_t>& Values = this->Facets.GetValues(Field);
+	const uint32_t Selected = this->Facets.GetSelected(Field);
+
+	ImGui::BeginChild(Name, Size);
+	ImGuiListClipper Clipper;
+	Clipper.Begin(static_cast<int>(Values.size()) + 1);
+	while (Clipper.Step()) {
+		for (int i = Clipper.DisplayStart; i < Clipper.DisplayEnd; i++) {
+			// The first row is the whole column
+			const uint32_t Value = i ? Values[i - 1] : FacetIndex_t::All;
+			const std::string* Label = i ? &this->Facets.GetName(Field, Value) : nullptr;
+			char Text[160];
+			snprintf(Text, sizeof(Text), "%s (%u)##%d", !Label ? Name : Label->empty() ? "Unknown" : Label->c_str(),
+				i ? this->Facets.GetCount(Field, Value) : this->Facets.GetTotal(Field), i);
+			if (ImGui::Selectable(Text, Value == Selected) && Value != Selected)
+				this->Facets.Select(Field, Value);
+		}
+	}
+	ImGui::EndChild();
+}
+
+// Right click queues a track, with shift it plays next. Queued tracks show their place on the right,
+// ctrl + right click takes that place out of the queue and alt + right click moves it up one
+void Interface_t::DrawMusicPicker(const PlayerState_t& State) {
+	this->Views.Sync(State.Library);
+	this->Facets.Sync(State.Library, this->Views.Get(this->View));
+
+	const ImVec2 Available = ImGui::GetContentRegionAvail();
+	const float Spacing = ImGui::GetStyle().ItemSpacing.x;
+	const float FacetHeight = std::floor(Available.y * 0.4f);
+	if (FacetHeight > ImGui::GetTextLineHeightWithSpacing() * 3.0f) {
+		const ImVec2 Size = ImVec2(std::floor((Available.x - Spacing * 2.0f) / 3.0f), FacetHeight);
+		this->DrawFacet(FacetIndex_t::Genre, "Genres", Size);
+		ImGui::SameLine();
+		this->DrawFacet(FacetIndex_t::Artist, "Artists", Size);
+		ImGui::SameLine();
+		this->DrawFacet(FacetIndex_t::Album, "Albums", Size);
+	}
+
+	static constexpr const char* ViewNames[] = { "File", "Title", "Artist", "Album", "Time", "Added" };
+	for (int i = 0; i < static_cast<int>(TrackViews_t::View_t::Views); i++) {
+		const auto View = static_cast<TrackViews_t::View_t>(i);
+		if (i)
+			ImGui::SameLine();
+		if (ImGui::Selectable(ViewNames[i], View == this->View, 0, ImGui::CalcTextSize(ViewNames[i]))) {
+			this->IsDescending = View == this->View && !this->IsDescending;
+			this->View = View;
+		}
+	}
+
+	const std::vector<uint32_t>& Rows = this->Facets.GetTracks();
+	const std::vector<LibraryTrack_t>& Tracks = this->Facets.GetLibrary()->Tracks;
+	ImGui::BeginChild("Tracks");
+	ImGuiListClipper Clipper;
+	Clipper.Begin(static_cast<int>(Rows.size()));
+	while (Clipper.Step()) {
+		for (int i = Clipper.DisplayStart; i < Clipper.DisplayEnd; i++) {
+			const LibraryTrack_t& Track = Tracks[Rows[this->IsDescending ? Rows.size() - 1 - i : i]];
+			// Sorted by tags, listed by them too. The id tells rows with the same text apart
+			const char* Label = Track.Title.c_str();
+			if (this->View == TrackViews_t::View_t::File)
+				Label = Track.FileName.c_str();
+			else if (!Track.Artist.empty())
+				Label = FrameArena.Format("%s - %s", Track.Artist.c_str(), Track.Title.c_str());
+			ImGui::PushID(static_cast<int>(Track.Id));
+			if (ImGui::Selectable(Label, Track.Id == State.CurrentTrack))
+				MusicPlayer.Post({ MusicPlayer_t::CommandType_t::Select, Track.Id });
+			ImGui::PopID();
+			const size_t Place = std::find(State.QueuePreview, State.QueuePreview + PlayerState_t::MaxQueuePreview, Track.Id) - State.QueuePreview;
+			const bool IsQueued = Place < PlayerState_t::MaxQueuePreview;
+			if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) {
+				const ImGuiIO& IO = ImGui::GetIO();
+				MusicPlayer_t::Command_t Command = { IO.KeyShift ? MusicPlayer_t::CommandType_t::PlayNext : MusicPlayer_t::CommandType_t::Enqueue, Track.Id };
+				if (IsQueued && (IO.KeyCtrl || IO.KeyAlt)) {
+					Command.Type = IO.KeyCtrl ? MusicPlayer_t::CommandType_t::Unqueue : MusicPlayer_t::CommandType_t::MoveQueued;
+					Command.Entry = State.QueueEntries[Place];
+					if (Place >= 2)
+						Command.After = State.QueueEntries[Place - 2];
+				}
+				MusicPlayer.Post(Command);
+			}
+
+			if (IsQueued) {
+				char Number[8];
+				snprintf(Number, sizeof(Number), "%zu", Place + 1);
+				const ImVec2 Size = ImGui::CalcTextSize(Number);
+				ImGui::GetWindowDrawList()->AddText(ImVec2(ImGui::GetItemRectMax().x - Size.x - 4.0f, ImGui::GetItemRectMin().y), ImGui::GetColorU32(ImGuiCol_TextDisabled), Number);
+			}
+		}
+	}
+	ImGui::EndChild();
+}
+
+void Interface_t::DrawWindowFrame(const PlayerState_t& State) {
+	ImVec2 WindowPos = ImGui::GetWindowPos();
+	float HeightCenter = WindowPos.y + ImGui::GetWindowHeight() / 2.0f;
+
+	ImDrawList* DrawList = ImGui::GetWindowDrawList();
+	ImVec2 MousePos = ImGui::GetMousePos();
+
+	// Close button
+	{
+		ImVec2 CenterPos = { WindowPos.x + 10.0f, HeightCenter };
+		float Distance = static_cast<float>(sqrt(pow(CenterPos.x - MousePos.x, 2) + pow(CenterPos.y - MousePos.y, 2)));
+		if (Distance < 8.0f) {
+			DrawList->AddCircleFilled(CenterPos, 8.0f, ImColor(0.5f, 0.0f, 0.0f));
+			if (ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+				this->WantsClose = true;
+			}
+		} else {
+			DrawList->AddCircleFilled(CenterPos, 8.0f, ImColor(1.0f, 0.0f, 0.0f));
+		}
+	}
+
+	// Minimize
+	{
+		ImVec2 CenterPos = { WindowPos.x + 35.0f, HeightCenter };
+		float Distance = static_cast<float>(sqrt(pow(CenterPos.x - MousePos.x, 2) + pow(CenterPos.y - MousePos.y, 2)));
+		if (Distance < 8.0f) {
+			DrawList->AddCircleFilled(CenterPos, 8.0f, ImColor(0.5f, 0.25f, 0.0f));
+			if (ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+				this->WantsMinimize = true;
+			}
+		} else {
+			DrawList->AddCircleFilled(CenterPos, 8.0f, ImColor(1.0f, 0.5f, 0.0f));
+		}
+	}
+
+	// Fullscreen
+	DrawList->AddCircleFilled(ImVec2(WindowPos.x + 60.0f, HeightCenter), 8.0f, ImColor(0.3f, 0.3f, 0.3f));
+
+	// Shuffle, S cycles through the modes
+	if (State.Shuffle != Shuffle_t::Mode_t::Off) {
+		const char* Label = State.Shuffle == Shuffle_t::Mode_t::Fair ? "shuffle" : "weighted shuffle";
+		const ImVec2 Size = ImGui::CalcTextSize(Label);
+		DrawList->AddText(ImVec2(WindowPos.x + ImGui::GetWindowWidth() - Size.x - 4.0f, HeightCenter - Size.y / 2.0f), ImGui::GetColorU32(ImGuiCol_TextDisabled), Label);
+	}
+}
+
+void Interface_t::DrawTrackInfo(const PlayerState_t& State) {
+	if (!State.Track)
+		return;
+
+	ImGui::PushFont(this->BoldFont);
+
+	const ImVec2 Start = ImGui::GetWindowPos();
+
+	const std::string& TrackName = State.Track->Title;
+	const ImVec2 TextSize = ImGui::CalcTextSize(TrackName.c_str());
+
+	// If the textsize is too big, scroll. Timed with the ImGui clock so a replay with a fixed delta time scrolls the same
+	if (TextSize.x > ImGui::GetWindowWidth()) {
+		const double Now = ImGui::GetTime();
+
+		if (this->DidReset) {
+			// Make the text stay for a second
+			if (this->ScrollPx > -1.0f && this->ScrollPx < 1.0f) {
+				if (this->CanMove) {
+					this->CanMove = false;
+					this->NonMoveTime = Now;
+				}
+
+				if ((Now - this->NonMoveTime) > 1.0) {
+					this->CanMove = true;
+					this->DidReset = false;
+				}
+			}
+		}
+
+		if (this->CanMove) {
+			this->ScrollPx += ImGui::GetIO().DeltaTime * 64.0f;
+			FrameScheduler.RequestAnimationFrame();
+		} else {
+			// Check back regularly for the end of the pause
+			FrameScheduler.RequestFrameIn(0.25f);
+		}
+
+		if (this->ScrollPx >= TextSize.x) {
+			this->ScrollPx = -ImGui::GetWindowWidth() - 10.0f;
+			this->DidReset = true;
+		}
+
+		ImGui::GetWindowDrawList()->AddText(ImVec2(Start.x - this->ScrollPx, Start.y + ImGui::GetWindowHeight() / 2.0f - TextSize.y / 2.0f), ImColor(1.0f, 1.0f, 1.0f), TrackName.c_str());
+
+	} else {
+		this->ScrollPx = 0.0f;
+		ImGui::GetWindowDrawList()->AddText(ImVec2(Start.x + (ImGui::GetWindowWidth() + 75.0f) / 2.0f - TextSize.x / 2.0f, Start.y + ImGui::GetWindowHeight() / 2.0f - TextSize.y / 2.0f), ImColor(1.0f, 1.0f, 1.0f), TrackName.c_str());
+	}
+
+	ImGui::PopFont();
+}
+
+void Interface_t::Draw() {
+	FrameArena.Reset();
+
+	// One consistent view of the player for the whole frame
+	const std::shared_ptr<const PlayerState_t> State = MusicPlayer.GetState();
+
+	const ImGuiStyle* Style = &ImGui::GetStyle();
+	ImGui::SetNextWindowSizeConstraints(ImVec2(250, 203), ImVec2(500, 500));
+
+	ImGui::SetNextWindowPos(ImVec2(2, 2));
+
+	ImGui::SetNextWindowSize(ImVec2(500, 500), ImGuiCond_Once);
+	ImGui::Begin("MusicPlayer", nullptr, ImGuiWindowFlags_NoTitleBar);
+	{
+		// Resize the host window along with the UI
+		ImVec2 CurrentSize = ImGui::GetWindowSize();
+		if (CurrentSize.x != this->LastSize.x || CurrentSize.y != this->LastSize.y) {
+			this->LastSize = CurrentSize;
+			this->RequestedSize = ImVec2(CurrentSize.x + 10.0f, CurrentSize.y + 10.0f);
+		}
+
+		if (ImGui::IsKeyPressed(ImGuiKey_S, false))
+			MusicPlayer.Post({ MusicPlayer_t::CommandType_t::SetShuffle, PlayerState_t::NoTrack, 0.0f, static_cast<float>((static_cast<int>(State->Shuffle) + 1) % 3) });
+
+		ImGui::BeginChild("WindowFrame", ImVec2(0.0f, 20.0f));
+		{
+			this->DrawWindowFrame(*State);
+		}
+		ImGui::EndChild();
+
+		float Size = std::clamp(CurrentSize.y - 208.0f, 0.1f, 1000.0f);
+		if (Size > 19.0f) {
+			ImGui::PushFont(this->MediumFont);
+			ImGui::BeginChild("TrackPicker", ImVec2(0.0f, Size));
+			{
+				this->DrawMusicPicker(*State);
+			}
+			ImGui::EndChild();
+			ImGui::PopFont();
+		}
+
+		ImGui::BeginChild("TrackInfo", ImVec2(CurrentSize.x - 65.0f - Style->ItemSpacing.x * 2 - Style->WindowPadding.x, 60.0f));
+		{
+			this->DrawTrackInfo(*State);
+		}
+		ImGui::EndChild();
+
+		ImGui::SameLine();
+
+		ImGui::BeginChild("Visualizer", ImVec2(65.0f, 60.0f));
+		{
+			MusicPlayer.DrawFreqResponse(*State);
+		}
+		ImGui::EndChild();
+
+		ImGui::BeginChild("Duration", ImVec2(0.0f, 27.5f));
+		{
+			ImGui::PushFont(this->MediumFont);
+			MusicPlayer.DrawDuration(*State);
+			ImGui::PopFont();
+		}
+		ImGui::EndChild();
+
+		ImGui::BeginChild("LevelMeter", ImVec2(0.0f, 14.0f));
+		{
+			MusicPlayer.DrawLevelMeter();
+		}
+		ImGui::EndChild();
+
+		ImGui::BeginChild("Spacing", ImVec2(std::clamp(CurrentSize.x / 2.0f - 100.0f, 30.0f, 1000.0f), 50.0f));
+		ImGui::EndChild();
+
+		ImGui::SameLine();
+
+		ImGui::BeginChild("Beforebutton", ImVec2(50.0f, 50.0f));
+		{
+			MusicPlayer.DrawPrevButton(*State);
+		}
+		ImGui::EndChild();
+
+		ImGui::SameLine();
+
+		ImGui::BeginChild("PlayButton", ImVec2(50.0f, 50.0f));
+		{
+			MusicPlayer.DrawPlayButton(*State);
+		}
+		ImGui::EndChild();
+		ImGui::SameLine();
+		ImGui::BeginChild("NextButton", ImVec2(50.0f, 50.0f));
+		{
+			MusicPlayer.DrawNextButton(*State);
+		}
+		ImGui::EndChild();
+	}
+	ImGui::End();
+}
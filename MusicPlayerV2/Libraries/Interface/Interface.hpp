@@ -0,0 +1,50 @@
+#pragma once
+
+#include <filesystem>
+
+#include "../ImGui/imgui.h"
+#include "../PlayerState/PlayerState.hpp"
+#include "../FacetIndex/FacetIndex.hpp"
+#include "../TrackSort/TrackSort.hpp"
+
+// The player UI, built with ImGui only so it runs the same on top of the DX11 window
+// and the headless renderer. Anything that needs the OS window is only requested here
+// and carried out by whoever hosts the UI after the frame.
+class Interface_t {
+private:
+	ImVec2 LastSize = ImVec2(0.0f, 0.0f);
+
+	// Marquee state of the track title
+	float ScrollPx = 0.0f;
+	bool DidReset = true;
+	bool CanMove = false;
+	double NonMoveTime = 0.0;
+
+	// Genre, artist and album columns over the track list, all of them only draw the rows in view
+	FacetIndex_t Facets;
+	// Clicking the view's name again reverses it
+	TrackViews_t Views;
+	TrackViews_t::View_t View = TrackViews_t::View_t::File;
+	bool IsDescending = false;
+	void DrawFacet(FacetIndex_t::Field_t Field, const char* Name, const ImVec2& Size);
+	void DrawMusicPicker(const PlayerState_t& State);
+	void DrawWindowFrame(const PlayerState_t& State);
+	void DrawTrackInfo(const PlayerState_t& State);
+
+public:
+	ImFont* BoldFont = nullptr;
+	ImFont* MediumFont = nullptr;
+
+	// Set during Draw(), cleared by the host once handled
+	bool WantsClose = false;
+	bool WantsMinimize = false;
+	ImVec2 RequestedSize = ImVec2(0.0f, 0.0f);
+
+	// Loads the bundled fonts, call after the ImGui context exists and before the first frame
+	void LoadFonts(const std::filesystem::path& Folder);
+	void SetStyle();
+
+	// Builds the whole UI, between ImGui::NewFrame() and ImGui::Render()
+	void Draw();
+
+} extern Interface;
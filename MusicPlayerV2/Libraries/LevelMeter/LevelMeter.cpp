@@ -0,0 +1,319 @@
+#include "LevelMeter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <immintrin.h>
+#define LEVELMETER_SSE 1
+#endif
+
+namespace {
+
+	constexpr double Pi = 3.14159265358979323846;
+
+	// ITU-R BS.1770-4 Annex 2, 48 tap 4x oversampling filter split into its 4 phases
+	constexpr float TruePeakPhases[4][12] = {
+		{ 0.0017089843750f, 0.0109863281250f, -0.0196533203125f, 0.0332031250000f, -0.0594482421875f, 0.1373291015625f, 0.9721679687500f, -0.1022949218750f, 0.0476074218750f, -0.0266113281250f, 0.0148925781250f, -0.0083007812500f },
+		{ -0.0291748046875f, 0.0292968750000f, -0.0517578125000f, 0.0891113281250f, -0.1665039062500f, 0.4650878906250f, 0.7797851562500f, -0.2003173828125f, 0.1015625000000f, -0.0582275390625f, 0.0330810546875f, -0.0189208984375f },
+		{ -0.0189208984375f, 0.0330810546875f, -0.0582275390625f, 0.1015625000000f, -0.2003173828125f, 0.7797851562500f, 0.4650878906250f, -0.1665039062500f, 0.0891113281250f, -0.0517578125000f, 0.0292968750000f, -0.0291748046875f },
+		{ -0.0083007812500f, 0.0148925781250f, -0.0266113281250f, 0.0476074218750f, -0.1022949218750f, 0.9721679687500f, 0.1373291015625f, -0.0594482421875f, 0.0332031250000f, -0.0196533203125f, 0.0109863281250f, 0.0017089843750f },
+	};
+
+	float ToDecibel(float Linear) {
+		return Linear > 0.0000001f ? 20.0f * log10f(Linear) : -140.0f;
+	}
+
+	float ToLoudness(double MeanSquare) {
+		if (MeanSquare <= 0.0)
+			return -70.0f;
+		return std::max(static_cast<float>(-0.691 + 10.0 * log10(MeanSquare)), -70.0f);
+	}
+
+	double SumSquares(const float* Data, size_t Count) {
+		size_t i = 0;
+		double Sum = 0.0;
+#ifdef LEVELMETER_SSE
+		__m128 Acc0 = _mm_setzero_ps();
+		__m128 Acc1 = _mm_setzero_ps();
+		for (; i + 8 <= Count; i += 8) {
+			__m128 A = _mm_loadu_ps(Data + i);
+			__m128 B = _mm_loadu_ps(Data + i + 4);
+			Acc0 = _mm_add_ps(Acc0, _mm_mul_ps(A, A));
+			Acc1 = _mm_add_ps(Acc1, _mm_mul_ps(B, B));
+		}
+		alignas(16) float Lanes[4];
+		_mm_store_ps(Lanes, _mm_add_ps(Acc0, Acc1));
+		Sum = static_cast<double>(Lanes[0]) + Lanes[1] + Lanes[2] + Lanes[3];
+#endif
+		for (; i < Count; i++)
+			Sum += static_cast<double>(Data[i]) * Data[i];
+		return Sum;
+	}
+
+	float AbsMax(const float* Data, size_t Count) {
+		size_t i = 0;
+		float Max = 0.0f;
+#ifdef LEVELMETER_SSE
+		const __m128 SignMask = _mm_set1_ps(-0.0f);
+		__m128 Acc = _mm_setzero_ps();
+		for (; i + 4 <= Count; i += 4)
+			Acc = _mm_max_ps(Acc, _mm_andnot_ps(SignMask, _mm_loadu_ps(Data + i)));
+		alignas(16) float Lanes[4];
+		_mm_store_ps(Lanes, Acc);
+		Max = std::max(std::max(Lanes[0], Lanes[1]), std::max(Lanes[2], Lanes[3]));
+#endif
+		for (; i < Count; i++)
+			Max = std::max(Max, fabsf(Data[i]));
+		return Max;
+	}
+
+	// 'Data' points at the first new sample, the 12 samples before it are the filter history
+	float TruePeak(const float* Data, size_t Count) {
+		float Max = 0.0f;
+#ifdef LEVELMETER_SSE
+		// One register holds the output of all 4 phases for a single input sample
+		static const struct Taps_t {
+			__m128 Tap[12];
+			Taps_t() {
+				for (int j = 0; j < 12; j++)
+					Tap[j] = _mm_setr_ps(TruePeakPhases[0][11 - j], TruePeakPhases[1][11 - j], TruePeakPhases[2][11 - j], TruePeakPhases[3][11 - j]);
+			}
+		} Taps;
+
+		const __m128 SignMask = _mm_set1_ps(-0.0f);
+		__m128 Acc = _mm_setzero_ps();
+		for (size_t i = 0; i < Count; i++) {
+			const float* Window = Data + i - 11;
+			__m128 Sum = _mm_mul_ps(_mm_set1_ps(Window[0]), Taps.Tap[0]);
+			for (int j = 1; j < 12; j++)
+				Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_set1_ps(Window[j]), Taps.Tap[j]));
+			Acc = _mm_max_ps(Acc, _mm_andnot_ps(SignMask, Sum));
+		}
+		alignas(16) float Lanes[4];
+		_mm_store_ps(Lanes, Acc);
+		Max = std::max(std::max(Lanes[0], Lanes[1]), std::max(Lanes[2], Lanes[3]));
+#else
+		for (size_t i = 0; i < Count; i++) {
+			for (int Phase = 0; Phase < 4; Phase++) {
+				float Sum = 0.0f;
+				for (int k = 0; k < 12; k++)
+					Sum += TruePeakPhases[Phase][k] * Data[static_cast<ptrdiff_t>(i) - k];
+				Max = std::max(Max, fabsf(Sum));
+			}
+		}
+#endif
+		return Max;
+	}
+
+}
+
+bool LevelMeter_t::Configure(int SampleRate, int Channels) {
+	if (SampleRate <= 0 || Channels <= 0)
+		return false;
+
+	this->SampleRate = SampleRate;
+	this->Channels = std::min(Channels, MaxChannels);
+	this->BlockFrames = static_cast<size_t>(SampleRate / 10);
+	this->BlockFill = 0;
+	this->HistoryIndex = 0;
+	this->HistoryCount = 0;
+
+	// K-weighting, stage 1 is the head shelving filter and stage 2 the RLB high pass.
+	// Coefficients are derived for the actual rate instead of the 48kHz table in the spec
+	{
+		const double F0 = 1681.974450955533;
+		const double G = 3.999843853973347;
+		const double Q = 0.7071752369554196;
+
+		const double K = tan(Pi * F0 / SampleRate);
+		const double Vh = pow(10.0, G / 20.0);
+		const double Vb = pow(Vh, 0.4996667741545416);
+		const double A0 = 1.0 + K / Q + K * K;
+
+		Biquad_t Filter;
+		Filter.B0 = (Vh + Vb * K / Q + K * K) / A0;
+		Filter.B1 = 2.0 * (K * K - Vh) / A0;
+		Filter.B2 = (Vh - Vb * K / Q + K * K) / A0;
+		Filter.A1 = 2.0 * (K * K - 1.0) / A0;
+		Filter.A2 = (1.0 - K / Q + K * K) / A0;
+		for (Biquad_t& Shelf : this->Shelf)
+			Shelf = Filter;
+	}
+	{
+		const double F0 = 38.13547087602444;
+		const double Q = 0.5003270373238773;
+
+		const double K = tan(Pi * F0 / SampleRate);
+		const double A0 = 1.0 + K / Q + K * K;
+
+		Biquad_t Filter;
+		Filter.B0 = 1.0;
+		Filter.B1 = -2.0;
+		Filter.B2 = 1.0;
+		Filter.A1 = 2.0 * (K * K - 1.0) / A0;
+		Filter.A2 = (1.0 - K / Q + K * K) / A0;
+		for (Biquad_t& HighPass : this->HighPass)
+			HighPass = Filter;
+	}
+
+	for (int c = 0; c < MaxChannels; c++) {
+		this->BlockWeighted[c] = 0.0;
+		this->BlockSquares[c] = 0.0;
+		this->BlockPeak[c] = 0.0f;
+		this->BlockTruePeak[c] = 0.0f;
+		std::fill(std::begin(this->Scratch[c]), std::end(this->Scratch[c]), 0.0f);
+	}
+	return true;
+}
+
+void LevelMeter_t::Process(const float* Interleaved, size_t Frames) {
+	if (!this->BlockFrames)
+		return;
+
+	const auto Start = std::chrono::steady_clock::now();
+
+	const size_t FrameCount = Frames;
+	while (Frames) {
+		size_t Count = std::min({ Frames, ChunkFrames, this->BlockFrames - this->BlockFill });
+		this->ProcessChunk(Interleaved, Count);
+
+		Interleaved += Count * this->Channels;
+		Frames -= Count;
+
+		this->BlockFill += Count;
+		if (this->BlockFill == this->BlockFrames)
+			this->FinishBlock();
+	}
+
+	const auto Elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Start).count();
+	this->ProcessNanoseconds.fetch_add(static_cast<uint64_t>(Elapsed), std::memory_order_relaxed);
+	this->ProcessedFrames.fetch_add(FrameCount, std::memory_order_relaxed);
+}
+
+void LevelMeter_t::ProcessChunk(const float* Interleaved, size_t Frames) {
+	for (int c = 0; c < this->Channels; c++) {
+		float* Samples = this->Scratch[c] + TruePeakTaps;
+		for (size_t i = 0; i < Frames; i++)
+			Samples[i] = Interleaved[i * this->Channels + c];
+
+		// K-weighted signal for the loudness measurement
+		Biquad_t& Shelf = this->Shelf[c];
+		Biquad_t& HighPass = this->HighPass[c];
+		for (size_t i = 0; i < Frames; i++) {
+			double In = Samples[i];
+			double Mid = Shelf.B0 * In + Shelf.Z1;
+			Shelf.Z1 = Shelf.B1 * In - Shelf.A1 * Mid + Shelf.Z2;
+			Shelf.Z2 = Shelf.B2 * In - Shelf.A2 * Mid;
+
+			double Out = HighPass.B0 * Mid + HighPass.Z1;
+			HighPass.Z1 = HighPass.B1 * Mid - HighPass.A1 * Out + HighPass.Z2;
+			HighPass.Z2 = HighPass.B2 * Mid - HighPass.A2 * Out;
+			this->Weighted[i] = static_cast<float>(Out);
+		}
+
+		this->BlockWeighted[c] += SumSquares(this->Weighted, Frames);
+		this->BlockSquares[c] += SumSquares(Samples, Frames);
+		this->BlockPeak[c] = std::max(this->BlockPeak[c], AbsMax(Samples, Frames));
+		this->BlockTruePeak[c] = std::max(this->BlockTruePeak[c], TruePeak(Samples, Frames));
+
+		// Keep the tail around as history for the next chunk
+		std::copy(Samples + Frames - TruePeakTaps, Samples + Frames, this->Scratch[c]);
+	}
+}
+
+void LevelMeter_t::FinishBlock() {
+	for (int c = 0; c < this->Channels; c++) {
+		this->WeightedHistory[this->HistoryIndex][c] = this->BlockWeighted[c];
+		this->SquaresHistory[this->HistoryIndex][c] = this->BlockSquares[c];
+	}
+	this->HistoryIndex = (this->HistoryIndex + 1) % SubBlocks;
+	this->HistoryCount = std::min(this->HistoryCount + 1, SubBlocks);
+
+	// Sum up the newest N blocks of the history
+	auto Window = [this](const double (&History)[SubBlocks][MaxChannels], int Blocks, int Channel) {
+		double Sum = 0.0;
+		for (int i = 1; i <= Blocks; i++)
+			Sum += History[(this->HistoryIndex - i + SubBlocks) % SubBlocks][Channel];
+		return Sum;
+	};
+
+	const int MomentaryBlocks = std::min(this->HistoryCount, 4);
+	const int ShortTermBlocks = this->HistoryCount;
+	const int RmsBlocks = std::min(this->HistoryCount, 3);
+
+	double Momentary = 0.0;
+	double ShortTerm = 0.0;
+	for (int c = 0; c < this->Channels; c++) {
+		Momentary += Window(this->WeightedHistory, MomentaryBlocks, c) / static_cast<double>(MomentaryBlocks * this->BlockFrames);
+		ShortTerm += Window(this->WeightedHistory, ShortTermBlocks, c) / static_cast<double>(ShortTermBlocks * this->BlockFrames);
+
+		double MeanSquare = Window(this->SquaresHistory, RmsBlocks, c) / static_cast<double>(RmsBlocks * this->BlockFrames);
+		this->PublishedRms[c].store(static_cast<float>(sqrt(MeanSquare)), std::memory_order_relaxed);
+		this->PublishedPeak[c].store(this->BlockPeak[c], std::memory_order_relaxed);
+		this->PublishedTruePeak[c].store(this->BlockTruePeak[c], std::memory_order_relaxed);
+
+		this->BlockWeighted[c] = 0.0;
+		this->BlockSquares[c] = 0.0;
+		this->BlockPeak[c] = 0.0f;
+		this->BlockTruePeak[c] = 0.0f;
+	}
+
+	// Mono is measured as if it was played on both speakers
+	if (this->Channels == 1) {
+		Momentary *= 2.0;
+		ShortTerm *= 2.0;
+	}
+
+	this->PublishedMomentary.store(ToLoudness(Momentary), std::memory_order_relaxed);
+	this->PublishedShortTerm.store(ToLoudness(ShortTerm), std::memory_order_relaxed);
+	this->BlockFill = 0;
+}
+
+LevelMeter_t::Levels_t LevelMeter_t::GetLevels() const {
+	Levels_t Levels;
+	for (int c = 0; c < MaxChannels; c++) {
+		int Source = std::min(c, std::max(this->Channels - 1, 0));
+		Levels.Peak[c] = this->PublishedPeak[Source].load(std::memory_order_relaxed);
+		Levels.TruePeak[c] = this->PublishedTruePeak[Source].load(std::memory_order_relaxed);
+		Levels.Rms[c] = this->PublishedRms[Source].load(std::memory_order_relaxed);
+	}
+	Levels.Momentary = this->PublishedMomentary.load(std::memory_order_relaxed);
+	Levels.ShortTerm = this->PublishedShortTerm.load(std::memory_order_relaxed);
+	return Levels;
+}
+
+double LevelMeter_t::GetLoad() const {
+	uint64_t Frames = this->ProcessedFrames.load(std::memory_order_relaxed);
+	if (!Frames || !this->SampleRate)
+		return 0.0;
+
+	double AudioSeconds = static_cast<double>(Frames) / this->SampleRate;
+	return static_cast<double>(this->ProcessNanoseconds.load(std::memory_order_relaxed)) / 1e9 / AudioSeconds;
+}
+
+void LevelMeter_t::Display_t::Update(const Levels_t& Levels, float DeltaTime) {
+	const float FallRate = 24.0f;	// dB per second
+	const float HoldLength = 1.5f;	// Seconds
+
+	for (int c = 0; c < MaxChannels; c++) {
+		float Peak = std::max(ToDecibel(Levels.TruePeak[c]), -70.0f);
+		float Rms = std::max(ToDecibel(Levels.Rms[c]), -70.0f);
+
+		this->Peak[c] = std::max(Peak, this->Peak[c] - FallRate * DeltaTime);
+		this->Rms[c] = std::max(Rms, this->Rms[c] - FallRate * DeltaTime);
+
+		if (Peak >= this->PeakHold[c]) {
+			this->PeakHold[c] = Peak;
+			this->HoldTime[c] = HoldLength;
+		} else if (this->HoldTime[c] > 0.0f) {
+			this->HoldTime[c] -= DeltaTime;
+		} else {
+			this->PeakHold[c] = std::max(this->PeakHold[c] - FallRate * DeltaTime, Peak);
+		}
+	}
+
+	this->Momentary = Levels.Momentary;
+	this->ShortTerm = Levels.ShortTerm;
+}
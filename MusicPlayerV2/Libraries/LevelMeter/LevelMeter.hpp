@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Peak / true-peak / RMS / LUFS meter fed from the output DSP.
+// Process() runs on the audio thread and never allocates, the results are
+// published every 100ms block through atomics so the UI can read them any time.
+class LevelMeter_t {
+public:
+	static constexpr int MaxChannels = 2;
+	static constexpr size_t ChunkFrames = 512;
+
+	struct Levels_t {
+		float Peak[MaxChannels] = {};		// Linear sample peak of the last block
+		float TruePeak[MaxChannels] = {};	// Linear 4x oversampled peak of the last block
+		float Rms[MaxChannels] = {};		// Linear RMS over the last 300ms
+		float Momentary = -70.0f;			// LUFS over the last 400ms
+		float ShortTerm = -70.0f;			// LUFS over the last 3s
+	};
+
+	// Meter ballistics for drawing, all values in dBFS / LUFS. Updated from the UI thread
+	struct Display_t {
+		float Peak[MaxChannels] = { -70.0f, -70.0f };
+		float Rms[MaxChannels] = { -70.0f, -70.0f };
+		float PeakHold[MaxChannels] = { -70.0f, -70.0f };
+		float HoldTime[MaxChannels] = {};
+		float Momentary = -70.0f;
+		float ShortTerm = -70.0f;
+
+		void Update(const Levels_t& Levels, float DeltaTime);
+	};
+
+private:
+	struct Biquad_t {
+		double B0 = 1.0, B1 = 0.0, B2 = 0.0, A1 = 0.0, A2 = 0.0;
+		double Z1 = 0.0, Z2 = 0.0;
+	};
+
+	static constexpr int SubBlocks = 30;	// 3s of 100ms blocks for short-term loudness
+	static constexpr int TruePeakTaps = 12;
+
+	int SampleRate = 0;
+	int Channels = 0;
+	size_t BlockFrames = 0;
+	size_t BlockFill = 0;
+
+	Biquad_t Shelf[MaxChannels];
+	Biquad_t HighPass[MaxChannels];
+
+	// Running sums of the current 100ms block
+	double BlockWeighted[MaxChannels] = {};
+	double BlockSquares[MaxChannels] = {};
+	float BlockPeak[MaxChannels] = {};
+	float BlockTruePeak[MaxChannels] = {};
+
+	// History of finished 100ms blocks
+	double WeightedHistory[SubBlocks][MaxChannels] = {};
+	double SquaresHistory[SubBlocks][MaxChannels] = {};
+	int HistoryIndex = 0;
+	int HistoryCount = 0;
+
+	// Deinterleaved scratch with the true-peak filter history in front
+	alignas(16) float Scratch[MaxChannels][TruePeakTaps + ChunkFrames] = {};
+	alignas(16) float Weighted[ChunkFrames] = {};
+
+	std::atomic<float> PublishedPeak[MaxChannels] = {};
+	std::atomic<float> PublishedTruePeak[MaxChannels] = {};
+	std::atomic<float> PublishedRms[MaxChannels] = {};
+	std::atomic<float> PublishedMomentary = -70.0f;
+	std::atomic<float> PublishedShortTerm = -70.0f;
+
+	std::atomic<uint64_t> ProcessedFrames = 0;
+	std::atomic<uint64_t> ProcessNanoseconds = 0;
+
+	void ProcessChunk(const float* Interleaved, size_t Frames);
+	void FinishBlock();
+
+public:
+	// Must be called before the meter is attached to a stream
+	bool Configure(int SampleRate, int Channels);
+
+	void Process(const float* Interleaved, size_t Frames);
+
+	Levels_t GetLevels() const;
+
+	// Fraction of realtime spent inside Process(), e.g. 0.002 = 0.2% of one core
+	double GetLoad() const;
+};
@@ -0,0 +1,130 @@
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile_t::~MappedFile_t() {
+	this->Close();
+}
+
+bool MappedFile_t::Open(const std::filesystem::path& Path, bool IsSequential) {
+	this->Close();
+
+#ifdef _WIN32
+	HANDLE File = CreateFileW(Path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		IsSequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (File == INVALID_HANDLE_VALUE) {
+		printf("Failed to open '%s' for mapping\n", Path.string().c_str());
+		return false;
+	}
+
+	// Empty files can't be mapped, whoever asked falls back to reading them
+	LARGE_INTEGER Size;
+	if (!GetFileSizeEx(File, &Size) || Size.QuadPart == 0) {
+		CloseHandle(File);
+		return false;
+	}
+
+	HANDLE Mapping = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* Data = Mapping ? MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!Data) {
+		if (Mapping)
+			CloseHandle(Mapping);
+		CloseHandle(File);
+		printf("Failed to map '%s'\n", Path.string().c_str());
+		return false;
+	}
+
+	this->File = File;
+	this->Mapping = Mapping;
+	this->Size = static_cast<uint64_t>(Size.QuadPart);
+#else
+	const int File = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (File < 0) {
+		printf("Failed to open '%s' for mapping\n", Path.string().c_str());
+		return false;
+	}
+
+	// Empty files can't be mapped, whoever asked falls back to reading them
+	struct stat Info;
+	if (fstat(File, &Info) != 0 || Info.st_size == 0) {
+		close(File);
+		return false;
+	}
+
+	// The mapping keeps the file referenced, the descriptor isn't needed past mmap
+	void* Data = mmap(nullptr, Info.st_size, PROT_READ, MAP_SHARED, File, 0);
+	close(File);
+	if (Data == MAP_FAILED) {
+		printf("Failed to map '%s'\n", Path.string().c_str());
+		return false;
+	}
+
+	madvise(Data, Info.st_size, IsSequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+	this->Size = static_cast<uint64_t>(Info.st_size);
+#endif
+
+	this->Data = static_cast<const uint8_t*>(Data);
+	if (IsSequential)
+		this->Prefetch(0);
+	return true;
+}
+
+void MappedFile_t::Close() {
+	if (!this->Data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(this->Data);
+	CloseHandle(this->Mapping);
+	CloseHandle(this->File);
+	this->Mapping = nullptr;
+	this->File = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(this->Data), this->Size);
+#endif
+
+	this->Data = nullptr;
+	this->Size = 0;
+}
+
+void MappedFile_t::Prefetch(uint64_t Offset, uint64_t Length) const {
+	if (!this->Data || Offset >= this->Size)
+		return;
+
+	Length = std::min(Length, this->Size - Offset);
+
+#ifdef _WIN32
+	WIN32_MEMORY_RANGE_ENTRY Range = { const_cast<uint8_t*>(this->Data + Offset), static_cast<SIZE_T>(Length) };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+#else
+	// madvise wants a page aligned start
+	const uint64_t Page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+	const uint64_t Start = Offset / Page * Page;
+	madvise(const_cast<uint8_t*>(this->Data + Start), Length + (Offset - Start), MADV_WILLNEED);
+#endif
+}
+
+const uint8_t* MappedFile_t::GetData() const {
+	return this->Data;
+}
+
+uint64_t MappedFile_t::GetSize() const {
+	return this->Size;
+}
+
+std::shared_ptr<const MappedFile_t> MappedFile_t::Map(const std::filesystem::path& Path, bool IsSequential) {
+	auto File = std::make_shared<MappedFile_t>();
+	if (!File->Open(Path, IsSequential))
+		return nullptr;
+	return File;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+// Read-only view of a whole file. Decoders read straight from the page cache, so a track that
+// is already cached starts without a single read call, and the kernel is told the access is
+// sequential so a cold file streams in large readahead chunks instead of small reads.
+class MappedFile_t {
+public:
+	// Fetched ahead of the decoder on open and after every jump
+	static constexpr uint64_t PrefetchBytes = 4 << 20;
+
+private:
+	const uint8_t* Data = nullptr;
+	uint64_t Size = 0;
+
+#ifdef _WIN32
+	void* File = nullptr;
+	void* Mapping = nullptr;
+#endif
+
+public:
+	MappedFile_t() = default;
+	MappedFile_t(const MappedFile_t&) = delete;
+	MappedFile_t& operator=(const MappedFile_t&) = delete;
+	~MappedFile_t();
+
+	// Random access skips the readahead, for readers that jump around the file
+	bool Open(const std::filesystem::path& Path, bool IsSequential = true);
+	void Close();
+
+	// Asks for the range to be read in the background, never blocks
+	void Prefetch(uint64_t Offset, uint64_t Length = PrefetchBytes) const;
+
+	const uint8_t* GetData() const;
+	uint64_t GetSize() const;
+
+	// Shared so streams reading from it can keep it alive, nullptr if the file can't be mapped
+	static std::shared_ptr<const MappedFile_t> Map(const std::filesystem::path& Path, bool IsSequential = true);
+};
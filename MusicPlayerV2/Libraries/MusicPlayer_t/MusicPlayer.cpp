@@ -1,55 +1,124 @@
 #include "MusicPlayer.hpp"
 #include "../ImGui/imgui.h"
+#include "../FrameScheduler/FrameScheduler.hpp"
+#include "../FrameArena/FrameArena.hpp"
+#include "../WaveFile/WaveFile.hpp"
+#include "../Tags/Tags.hpp"
+#include "../TrackSort/TrackSort.hpp"
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <chrono>
 #include <iostream>
+#include <cstdlib>
 
 MusicPlayer_t MusicPlayer;
 
-bool MusicPlayer_t::Track_t::Init(const std::filesystem::directory_entry& Path, float Volume) {
-	this->Path = Path;
-	if (!this->Path.exists())
-		return false;
+std::atomic<uint64_t> MusicPlayer_t::StreamsOpened = 0;
 
-	this->TargetVolume = Volume;
-	this->InternalVolume = Volume;
-	this->IsFading = false;
+bool MusicPlayer_t::Track_t::Init(const std::shared_ptr<const Library_t>& Library, const LibraryTrack_t* Entry, float Volume) {
+	this->EntryLibrary = Library;
+	this->Entry = Entry;
+	this->Duration = 0.0;
+	this->BytesPerFrame = 0;
+	this->Volume = Volume;
 	this->Stream = NULL;
-	return true;
+	this->CrossfadeSync = 0;
+	this->SeekTable = nullptr;
+	this->SampleBase = 0;
+	this->Mapping = nullptr;
+	return std::filesystem::exists(Entry->Path);
+}
+HSTREAM MusicPlayer_t::Track_t::OpenStream(uint64_t Offset) {
+	StreamsOpened++;
+
+	if (!this->Mapping) {
+		auto Mapping = std::allocate_shared<MappedFile_t>(PoolAllocator_t<MappedFile_t>(&MusicPlayer.MappingBlocks));
+		if (Mapping->Open(this->Entry->Path))
+			this->Mapping = std::move(Mapping);
+	}
+
+	if (this->Mapping && Offset < this->Mapping->GetSize()) {
+		// A seek lands far from what was fetched on open
+		if (Offset)
+			this->Mapping->Prefetch(Offset);
+
+		const HSTREAM Stream = BASS_StreamCreateFile(TRUE, this->Mapping->GetData() + Offset, 0, this->Mapping->GetSize() - Offset, 0);
+		if (Stream) {
+			// A retired stream is freed by BASS long after the voice moved on
+			PoolAllocator_t<MappingReference_t> Allocator(&MusicPlayer.MappingBlocks);
+			MappingReference_t* Reference = new (Allocator.allocate(1)) MappingReference_t(this->Mapping);
+			if (BASS_ChannelSetSync(Stream, BASS_SYNC_FREE, 0, &Track_t::OnStreamFreed, Reference))
+				return Stream;
+
+			OnStreamFreed(0, Stream, 0, Reference);
+			BASS_StreamFree(Stream);
+		}
+	}
+
+	// Native path string, no conversion needed
+#ifdef _WIN32
+	return BASS_StreamCreateFile(FALSE, this->Entry->Path.c_str(), Offset, 0, BASS_UNICODE);
+#else
+	return BASS_StreamCreateFile(FALSE, this->Entry->Path.c_str(), Offset, 0, 0);
+#endif
+}
+void CALLBACK MusicPlayer_t::Track_t::OnStreamFreed(HSYNC, DWORD, DWORD, void* User) {
+	MappingReference_t* Reference = static_cast<MappingReference_t*>(User);
+	Reference->~MappingReference_t();
+	PoolAllocator_t<MappingReference_t>(&MusicPlayer.MappingBlocks).deallocate(Reference, 1);
 }
 bool MusicPlayer_t::Track_t::Play() {
 	if (!this->Stream) {
-		const std::string& Path = this->Path.path().string();
-		this->Stream = BASS_StreamCreateFile(FALSE, Path.c_str(), 0, 0, 0);
+		this->Stream = this->OpenStream(0);
 		if (!this->Stream) {
-			printf("Failed to create stream from file '%s'\n", Path.c_str());
+			printf("Failed to create stream from file '%s'\n", this->Entry->FileName.c_str());
 			return false;
 		}
 
+		// Length and format never change, query them once
+		BASS_CHANNELINFO Info;
+		if (BASS_ChannelGetInfo(this->Stream, &Info)) {
+			const DWORD SampleBytes = (Info.flags & BASS_SAMPLE_FLOAT) ? 4 : (Info.flags & BASS_SAMPLE_8BITS) ? 1 : 2;
+			this->BytesPerFrame = SampleBytes * Info.chans;
+			this->Clock->Reset(Info.freq);
+			this->Duration = BASS_ChannelBytes2Seconds(this->Stream, BASS_ChannelGetLength(this->Stream, BASS_POS_BYTE));
+			this->ClockHandle = BASS_ChannelSetDSP(this->Stream, &Track_t::ClockDSP, this, 0);
+			if (!this->ClockHandle)
+				printf("Failed to attach the playback clock\n");
+		}
+
 		if (!BASS_ChannelPlay(this->Stream, FALSE)) {
 			BASS_StreamFree(this->Stream);
 			printf("Failed to play stream\n");
 			return false;
 		}
+		this->Clock->Start();
 
-		if (!BASS_ChannelSetAttribute(this->Stream, BASS_ATTRIB_VOL, static_cast<float>(this->InternalVolume) / 100.0f)) {
+		if (!BASS_ChannelSetAttribute(this->Stream, BASS_ATTRIB_VOL, this->Volume / 100.0f)) {
 			BASS_StreamFree(this->Stream);
 			printf("Failed to set channel attributes\n");
 			return false;
 		}
 	} else {
+		// Stopped as well, a stream that replaced a paused one after a seek never started
 		int Activity = this->GetActivity();
-		if (Activity == 3) {
+		if (Activity == BASS_ACTIVE_PAUSED || Activity == BASS_ACTIVE_STOPPED) {
 			if (!BASS_ChannelPlay(this->Stream, FALSE)) {
 				BASS_StreamFree(this->Stream);
 				printf("Failed to play stream\n");
 				return false;
 			}
+			this->Clock->Start();
 		}
 	}
 	return true;
 }
 bool MusicPlayer_t::Track_t::Pause() {
+	this->Clock->Stop();
+	if (!this->Stream)
+		return true;
+
 	if (!BASS_ChannelPause(this->Stream)) {
 		printf("Failed to pause track\n");
 		return false;
@@ -57,261 +126,1192 @@ bool MusicPlayer_t::Track_t::Pause() {
 	return true;
 }
 
+bool MusicPlayer_t::Track_t::Seek(double Seconds) {
+	const uint32_t SampleRate = this->Clock->GetSampleRate();
+	if (!this->Stream || !this->BytesPerFrame || !SampleRate || !std::isfinite(Seconds))
+		return false;
+
+	// Before the start or past the end lands on it, whichever way the spot is found
+	Seconds = std::clamp(Seconds, 0.0, this->Duration);
+	const uint64_t Sample = static_cast<uint64_t>(Seconds * SampleRate);
+	if (!this->SeekTable)
+		this->SeekTable = SeekTable_t::Open(this->Entry->Path);
+
+	// No table yet, let BASS find the spot from the start of the file
+	if (!this->SeekTable || this->SeekTable->GetSampleRate() != SampleRate) {
+		const int64_t Bytes = this->GetStreamBytes(Seconds);
+		if (Bytes < 0 || !BASS_ChannelSetPosition(this->Stream, static_cast<QWORD>(Bytes), BASS_POS_BYTE)) {
+			printf("Failed to seek '%s'\n", this->Entry->FileName.c_str());
+			return false;
+		}
+		this->Clock->Jump(Sample);
+		return true;
+	}
+
+	// Opened right at the frame the table points to, then decoded forward to the exact sample
+	const SeekTable_t::Point_t Point = this->SeekTable->Find(Sample);
+	const HSTREAM Stream = this->OpenStream(Point.Offset);
+	if (!Stream) {
+		printf("Failed to create stream from file '%s'\n", this->Entry->FileName.c_str());
+		return false;
+	}
+	if (!BASS_ChannelSetPosition(Stream, Point.Discard * this->BytesPerFrame, BASS_POS_BYTE | BASS_POS_DECODETO)) {
+		BASS_StreamFree(Stream);
+		printf("Failed to seek '%s'\n", this->Entry->FileName.c_str());
+		return false;
+	}
+
+	const bool IsPlaying = this->GetActivity() == BASS_ACTIVE_PLAYING;
+	const float Volume = this->Volume;
+
+	// The old stream ramps out under the new one instead of cutting off
+	if (IsPlaying) {
+		this->Retire(SeekFade);
+	} else {
+		this->Free();
+	}
+
+	this->Stream = Stream;
+	this->SampleBase = Point.StreamStart;
+	this->Clock->Jump(Sample);
+	this->ClockHandle = BASS_ChannelSetDSP(Stream, &Track_t::ClockDSP, this, 0);
+	if (!this->ClockHandle)
+		printf("Failed to attach the playback clock\n");
+
+	BASS_ChannelSetAttribute(Stream, BASS_ATTRIB_VOL, 0.0f);
+	this->FadeIn(SeekFade, Volume);
+	if (IsPlaying && !BASS_ChannelPlay(Stream, FALSE)) {
+		printf("Failed to play stream\n");
+		return false;
+	}
+	return true;
+}
+
 bool MusicPlayer_t::Track_t::SetVolume(float Volume) {
-	this->InternalVolume = Volume;
-	if (!BASS_ChannelSetAttribute(this->Stream, BASS_ATTRIB_VOL, static_cast<float>(this->InternalVolume) / 100.0f)) {
+	this->Volume = Volume;
+	if (!BASS_ChannelSetAttribute(this->Stream, BASS_ATTRIB_VOL, this->Volume / 100.0f)) {
 		printf("Failed to set volume\n");
 		return false;
 	}
 	return true;
 }
 
+float MusicPlayer_t::Track_t::GetVolume() const {
+	// Somewhere along the slide while fading
+	float Volume = 0.0f;
+	if (this->Stream && BASS_ChannelGetAttribute(this->Stream, BASS_ATTRIB_VOL, &Volume))
+		return Volume * 100.0f;
+	return this->Volume;
+}
+
 bool MusicPlayer_t::Track_t::Free() {
-	if (!BASS_StreamFree(this->Stream)) {
+	// Never started
+	if (!this->Stream)
+		return true;
+
+	const HSTREAM Stream = this->Stream;
+	this->Stream = NULL;
+	this->CrossfadeSync = 0;
+	if (!BASS_StreamFree(Stream)) {
 		printf("Failed to free stream\n");
 		return false;
 	}
 	return true;
 }
 
-void MusicPlayer_t::Track_t::FadeIn(float Seconds, float Volume) {
-	if (this->IsFading)
+void MusicPlayer_t::Track_t::Retire(float Seconds) {
+	if (this->GetActivity() != BASS_ACTIVE_PLAYING) {
+		this->Free();
 		return;
-	
-	this->FadeLength = Seconds;
-	this->TargetVolume = Volume;
-	this->StartFade = std::chrono::high_resolution_clock::now();
-	this->IsFading = true;
-	this->OldVolume = this->InternalVolume;
-}
-void MusicPlayer_t::Track_t::FadeOut(float Seconds) {
-	if (this->IsFading)
+	}
+
+	// The DSP points at this voice, which is about to be reused
+	BASS_ChannelRemoveDSP(this->Stream, this->ClockHandle);
+	BASS_ChannelRemoveSync(this->Stream, this->CrossfadeSync);
+	BASS_ChannelFlags(this->Stream, BASS_STREAM_AUTOFREE, BASS_STREAM_AUTOFREE);
+
+	// Sliding the volume to -1 stops the channel at the end of the slide
+	if (!BASS_ChannelSlideAttribute(this->Stream, BASS_ATTRIB_VOL, -1.0f, static_cast<DWORD>(Seconds * 1000.0f))) {
+		this->Free();
 		return;
+	}
 
-	this->FadeLength = Seconds;
-	this->TargetVolume = 0.0f;
-	this->StartFade = std::chrono::high_resolution_clock::now();
-	this->IsFading = true;
-	this->OldVolume = this->InternalVolume;
+	this->Stream = NULL;
+	this->ClockHandle = 0;
+	this->CrossfadeSync = 0;
 }
 
-void MusicPlayer_t::Track_t::Copy(Track_t* Track) {
-	this->InternalVolume = Track->InternalVolume;
-	this->IsFading = Track->IsFading;
-	this->Stream = Track->Stream;
-	this->Path = Track->Path;
+void MusicPlayer_t::Track_t::FadeIn(float Seconds, float Volume) {
+	this->Volume = Volume;
+	if (this->Stream && !BASS_ChannelSlideAttribute(this->Stream, BASS_ATTRIB_VOL, Volume / 100.0f, static_cast<DWORD>(Seconds * 1000.0f)))
+		printf("Failed to slide volume\n");
+}
+void MusicPlayer_t::Track_t::FadeOut(float Seconds) {
+	this->FadeIn(Seconds, 0.0f);
+}
+bool MusicPlayer_t::Track_t::IsFading() const {
+	return this->Stream && BASS_ChannelIsSliding(this->Stream, BASS_ATTRIB_VOL);
 }
 
-int MusicPlayer_t::Track_t::GetActivity() {
+int MusicPlayer_t::Track_t::GetActivity() const {
 	return BASS_ChannelIsActive(this->Stream);
 }
+HSTREAM MusicPlayer_t::Track_t::GetStream() const {
+	return this->Stream;
+}
 
-double MusicPlayer_t::Track_t::GetDuration() {
-	QWORD BytesLength = BASS_ChannelGetLength(this->Stream, BASS_POS_BYTE);
-	return BASS_ChannelBytes2Seconds(this->Stream, BytesLength);
+double MusicPlayer_t::Track_t::GetDuration() const {
+	return this->Duration;
+}
+double MusicPlayer_t::Track_t::GetCurrentPosition() const {
+	return std::min(this->Clock->Peek(), this->Duration);
+}
+double MusicPlayer_t::Track_t::GetStreamPosition() const {
+	const QWORD Bytes = BASS_ChannelGetPosition(this->Stream, BASS_POS_BYTE);
+	const uint32_t SampleRate = this->Clock->GetSampleRate();
+	if (Bytes == static_cast<QWORD>(-1) || !this->BytesPerFrame || !SampleRate)
+		return this->GetCurrentPosition();
+	return static_cast<double>(static_cast<int64_t>(Bytes / this->BytesPerFrame) + this->SampleBase) / SampleRate;
+}
+int64_t MusicPlayer_t::Track_t::GetStreamBytes(double Seconds) const {
+	const int64_t Sample = static_cast<int64_t>(Seconds * this->Clock->GetSampleRate()) - this->SampleBase;
+	return Sample < 0 ? -1 : Sample * this->BytesPerFrame;
 }
-double MusicPlayer_t::Track_t::GetCurrentPosition() {
-	QWORD BytesPos = BASS_ChannelGetPosition(this->Stream, BASS_POS_BYTE);
-	return BASS_ChannelBytes2Seconds(this->Stream, BytesPos);
+const std::shared_ptr<PlaybackClock_t>& MusicPlayer_t::Track_t::GetClock() const {
+	return this->Clock;
 }
 
+void CALLBACK MusicPlayer_t::Track_t::ClockDSP(HDSP, DWORD Channel, void*, DWORD, void* User) {
+	Track_t* Track = static_cast<Track_t*>(User);
 
-void MusicPlayer_t::Track_t::Update() {
-	
-	if (this->IsFading) {
-		float Ratio = static_cast<float>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - this->StartFade).count());
-		Ratio /= 1000.0f;
-		Ratio /= static_cast<float>(this->FadeLength);
-		Ratio = std::clamp(Ratio, 0.0f, 1.0f);
-		
-		this->InternalVolume = this->TargetVolume * Ratio + this->OldVolume * (1.0f - Ratio);
-
-		if (!BASS_ChannelSetAttribute(this->Stream, BASS_ATTRIB_VOL, static_cast<float>(this->InternalVolume) / 100.0f)) {
-			printf("Failed to set attribute\n");
+	// The playback position, not the decode position, is what's audible right now
+	const QWORD Bytes = BASS_ChannelGetPosition(Channel, BASS_POS_BYTE);
+	if (Bytes != static_cast<QWORD>(-1) && Track->BytesPerFrame)
+		Track->Clock->Publish(static_cast<uint64_t>(std::max<int64_t>(static_cast<int64_t>(Bytes / Track->BytesPerFrame) + Track->SampleBase, 0)));
+}
+
+uint32_t MusicPlayer_t::GetNextTrack(uint32_t Id) const {
+	const std::vector<LibraryTrack_t>& Tracks = this->Library->Tracks;
+	if (Tracks.empty())
+		return PlayerState_t::NoTrack;
+
+	const int Index = this->Library->IndexOf(Id);
+	return Tracks[(Index + 1) % Tracks.size()].Id;
+}
+uint32_t MusicPlayer_t::TakeNextTrack(uint32_t Id) {
+	// Enqueued tracks that left the library in the meantime are dropped
+	while (this->Queue.GetSize()) {
+		const uint32_t Next = this->Queue.PopFront();
+		if (this->Library->IndexOf(Next) >= 0)
+			return Next;
+	}
+
+	const uint32_t Shuffled = this->Shuffle.Take();
+	return Shuffled != PlayerState_t::NoTrack ? Shuffled : this->GetNextTrack(Id);
+}
+void MusicPlayer_t::SyncShuffle() {
+	std::vector<uint32_t> Ids;
+	Ids.reserve(this->Library->Tracks.size());
+	for (const LibraryTrack_t& Track : this->Library->Tracks)
+		Ids.push_back(Track.Id);
+
+	// Tracks played through come up more often, the ones skipped less
+	std::vector<float> Weights;
+	if (const std::shared_ptr<const PlayStats_t::Table_t> Table = this->Stats.GetTable()) {
+		Weights.reserve(Ids.size());
+		PlayStats_t::Stats_t Played;
+		for (const LibraryTrack_t& Track : this->Library->Tracks) {
+			Table->Find(Track.Key, &Played);
+			Weights.push_back((1.0f + Played.Plays) / (1.0f + Played.Skips));
 		}
-		
-		if (Ratio == 1.0f)
-			this->IsFading = false;
 	}
+	this->Shuffle.Sync(Ids, Weights);
+}
+uint32_t MusicPlayer_t::TakePrevTrack(uint32_t Id) {
+	while (this->Queue.GetHistorySize()) {
+		const uint32_t Prev = this->Queue.PopHistory();
+		if (Prev != Id && this->Library->IndexOf(Prev) >= 0)
+			return Prev;
+	}
+	return this->GetPrevTrack(Id);
 }
+uint32_t MusicPlayer_t::GetPrevTrack(uint32_t Id) const {
+	const std::vector<LibraryTrack_t>& Tracks = this->Library->Tracks;
+	if (Tracks.empty())
+		return PlayerState_t::NoTrack;
 
-std::vector<float> MusicPlayer_t::Track_t::GetFFT(float DeltaTime) {
+	const int Index = this->Library->IndexOf(Id);
+	return Tracks[Index > 0 ? Index - 1 : Tracks.size() - 1].Id;
+}
 
-	// Predefined ranges and multipliers
-	const std::vector<std::vector<int>> VisualData = {
-		{ 0, 8, 31 },
-		{ 8, 10, 31 },
-		{ 16, 30, 25 },
-		{ 75, 300, 18 },
-		{ 300, 450, 15 },
-		{ 500, 600, 12 },
-		{ 650, 1024, 8 },
-	};
+void CALLBACK MusicPlayer_t::OutputDSP(HDSP, DWORD, void* Buffer, DWORD Length, void* User) {
+	MusicPlayer_t* Player = static_cast<MusicPlayer_t*>(User);
+	const size_t Frames = Length / sizeof(float) / LevelMeter_t::MaxChannels;
+	Player->LevelMeter.Process(static_cast<const float*>(Buffer), Frames);
+	Player->Analyzer.Push(static_cast<const float*>(Buffer), Frames, LevelMeter_t::MaxChannels);
+}
 
-	std::vector<float> Out;
-	Out.resize(VisualData.size());
+bool MusicPlayer_t::OpenOutput(int Device) {
+	if (!BASS_Init(Device, 44100, 0, 0, NULL)) {
+		printf("Failed to initialize BASS\n");
+		return false;
+	}
 
-	// Make sure to only query, when music is running
-	bool IsRunning = BASS_ChannelIsActive(this->Stream) == 1;
-	if (IsRunning) {
-		// Get music data
-		std::vector<float> MusicData;
-		MusicData.resize(2048);
-		BASS_ChannelGetData(this->Stream, MusicData.data(), BASS_DATA_FFT2048);
-
-		// Compress it into 7 bars
-		int Index = 0;
-		for (const std::vector<int>& Range : VisualData) {
-			float Average = 0.0f;
-			for (int i = Range[0]; i < Range[1]; i++)
-				Average += MusicData[i];
-			Out[Index] = sqrt(Average) * (static_cast<float>(Range[2]) / 100.0f);
-			Index++;
+	this->OutputStream = BASS_StreamCreate(0, 0, 0, STREAMPROC_DEVICE, 0);
+
+	BASS_CHANNELINFO Info;
+	if (!this->OutputStream || !BASS_ChannelGetInfo(this->OutputStream, &Info)) {
+		printf("Failed to get the device output stream\n");
+		return false;
+	} else if (Info.chans != LevelMeter_t::MaxChannels || !this->LevelMeter.Configure(Info.freq, Info.chans)) {
+		printf("Unsupported output format for metering\n");
+	} else if (!BASS_ChannelSetDSP(this->OutputStream, &MusicPlayer_t::OutputDSP, this, 0)) {
+		printf("Failed to attach the level meter\n");
+	} else if (this->Analyzer.GetSampleRate() != static_cast<int>(Info.freq)) {
+		// Survives the output being reopened unless the rate changed
+		this->Analyzer.Stop();
+		if (!this->Analyzer.Start(Info.freq))
+			printf("Failed to start the analyzer\n");
+	}
+	return true;
+}
+
+void MusicPlayer_t::CloseOutput() {
+	// Every stream goes with the device, the voices have to let go of theirs first
+	this->CurrentVoice = {};
+	this->PendingTrack = PlayerState_t::NoTrack;
+	this->Timers.Cancel(this->SettleTimer);
+	this->Voices.ForEach([this](Handle_t Voice, Track_t&) {
+		this->ReleaseVoice(Voice);
+	});
+
+	BASS_Free();
+	this->OutputStream = NULL;
+}
+
+MusicPlayer_t::MusicPlayer_t() {
+	// Room for a burst of clicks, so posting doesn't have to grow the queue
+	this->PendingCommands.reserve(64);
+	this->Commands.reserve(64);
+
+	// DSP callbacks always get float samples, the meters depend on it
+	BASS_SetConfig(BASS_CONFIG_FLOATDSP, TRUE);
+	this->OpenOutput(-1);
+
+	{
+#ifdef _WIN32
+		char UsernameBuf[MAX_PATH];
+		DWORD UsernameLen = MAX_PATH + 1;
+		GetUserNameA(UsernameBuf, &UsernameLen);
+
+		std::string FolderPath = "C:\\Users\\" + std::string(UsernameBuf, UsernameLen - 1) + "\\Music\\";
+#else
+		const char* Home = getenv("HOME");
+		std::string FolderPath = std::string(Home ? Home : ".") + "/Music/";
+#endif
+		this->MusicFolder = std::filesystem::directory_entry(FolderPath);
+	}
+
+	// Without a music folder there is nothing pending, the empty scanned library stands in
+	this->RescanLibrary();
+	this->Library = this->PendingLibrary ? this->PendingLibrary : this->ScannedLibrary;
+	this->PendingLibrary = nullptr;
+	this->SyncShuffle();
+	this->Playlists.SetLibrary(this->Library, GetUnixTime());
+
+	if (!this->Library->Tracks.empty()) {
+		this->CurrentVoice = this->Voices.Acquire();
+		this->Voices.Get(this->CurrentVoice)->Init(this->Library, &this->Library->Tracks.front(), this->Volume);
+		this->Shuffle.MarkPlayed(this->Library->Tracks.front().Id);
+	}
+	this->Timers.Reset(this->GetTick());
+	this->Timers.Schedule(this->GetTick(1.0f), &MusicPlayer_t::OnRescan, this);
+	this->PublishState();
+}
+
+MusicPlayer_t::~MusicPlayer_t() {
+	this->Stop();
+}
+
+bool MusicPlayer_t::RescanLibrary() {
+	if (!this->MusicFolder.exists())
+		return false;
+
+	std::vector<std::filesystem::path> Paths;
+	for (const auto& Entry : std::filesystem::directory_iterator(this->MusicFolder)) {
+		// Wave files too, the audio regression fixtures are written as WAV
+		if (Entry.path().extension() != ".mp3" && Entry.path().extension() != ".wav")
+			continue;
+
+		Paths.push_back(Entry.path());
+	}
+	// Directory order is up to the file system, the play order shouldn't be
+	std::sort(Paths.begin(), Paths.end());
+
+	const std::vector<LibraryTrack_t>& Current = this->ScannedLibrary->Tracks;
+	bool IsSame = Paths.size() == Current.size();
+	for (size_t i = 0; IsSame && i < Paths.size(); i++)
+		IsSame = Paths[i] == Current[i].Path;
+	if (IsSame)
+		return false;
+
+	// Tags already read stay, only new files wait for the scanner to get to them.
+	// Whatever is left in here once the listing is through was removed
+	std::unordered_map<uint32_t, const LibraryTrack_t*> Known;
+	for (const LibraryTrack_t& Track : Current)
+		Known.emplace(Track.Id, &Track);
+
+	auto Scanned = std::make_shared<Library_t>();
+	Scanned->Version = this->ScannedLibrary->Version + 1;
+	for (std::filesystem::path& Path : Paths) {
+		LibraryTrack_t Track;
+		auto [It, IsNew] = this->TrackIds.try_emplace(Path.string(), this->NextTrackId);
+		if (IsNew)
+			this->NextTrackId++;
+
+		Track.Id = It->second;
+		Track.Key = PlayStats_t::GetKey(Path.string());
+		Track.FileName = Path.filename().string();
+		Track.Title = Path.stem().string();
+		Track.Path = std::move(Path);
+		if (const auto Found = Known.find(Track.Id); Found != Known.end()) {
+			const LibraryTrack_t& Previous = *Found->second;
+			Track.Title = Previous.Title;
+			Track.Artist = Previous.Artist;
+			Track.Album = Previous.Album;
+			Track.Genre = Previous.Genre;
+			Track.Bpm = Previous.Bpm;
+			Track.Duration = Previous.Duration;
+			Track.IsTagged = Previous.IsTagged;
+			Track.Added = Previous.Added;
+			Known.erase(Found);
+		} else {
+			std::error_code Error;
+			const auto Written = std::filesystem::last_write_time(Track.Path, Error);
+			if (!Error)
+				Track.Added = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::file_clock::to_sys(Written).time_since_epoch()).count();
+			Scanned->Added.push_back(static_cast<uint32_t>(Scanned->Tracks.size()));
 		}
-	} else {
-		// Set music data to 0.0
-		for (size_t i = 0; i < VisualData.size(); i++) {
-			Out[i] = 0.0f;
+		Scanned->Tracks.push_back(std::move(Track));
+	}
+	for (const auto& [Id, Track] : Known)
+		Scanned->Removed.push_back(Id);
+	Scanned->IndexRows();
+	Scanned->Columns = TrackColumns_t::Build(Scanned->Tracks);
+	Scanned->SortKeys = SortKeys_t::Build(Scanned->Tracks);
+
+	this->ScannedLibrary = std::move(Scanned);
+
+	std::lock_guard<std::mutex> Guard(this->LibraryLock);
+	this->PendingLibrary = this->ScannedLibrary;
+	return true;
+}
+
+bool MusicPlayer_t::TagLibrary() {
+	const std::vector<LibraryTrack_t>& Current = this->ScannedLibrary->Tracks;
+	if (std::all_of(Current.begin(), Current.end(), [](const LibraryTrack_t& Track) { return Track.IsTagged; }))
+		return false;
+
+	auto Tagged = std::make_shared<Library_t>(*this->ScannedLibrary);
+	Tagged->Version++;
+	Tagged->Removed.clear();
+	Tagged->Added.clear();
+	for (LibraryTrack_t& Track : Tagged->Tracks) {
+		if (!this->IsEngineRunning)
+			return false;
+		if (Track.IsTagged)
+			continue;
+
+		// Unreadable files count as tagged too, or they'd be read again on every rescan
+		Tags_t Tags;
+		Track.IsTagged = true;
+		if (!Tags.Read(Track.Path))
+			continue;
+		Tagged->Removed.push_back(Track.Id);
+		Tagged->Added.push_back(static_cast<uint32_t>(&Track - Tagged->Tracks.data()));
+		if (!Tags.Title.empty())
+			Track.Title = std::move(Tags.Title);
+		Track.Artist = std::move(Tags.Artist);
+		Track.Album = std::move(Tags.Album);
+		Track.Genre = std::move(Tags.Genre);
+		Track.Bpm = Tags.Bpm;
+		Track.Duration = Tags.Duration;
+	}
+	Tagged->Columns = TrackColumns_t::Build(Tagged->Tracks);
+	Tagged->SortKeys = SortKeys_t::Build(Tagged->Tracks);
+
+	this->ScannedLibrary = std::move(Tagged);
+
+	std::lock_guard<std::mutex> Guard(this->LibraryLock);
+	this->PendingLibrary = this->ScannedLibrary;
+	return true;
+}
+
+uint32_t MusicPlayer_t::ResolveQueued(void* User, std::string_view File) {
+	const auto* Tracks = static_cast<const std::unordered_map<std::string_view, uint32_t>*>(User);
+	const auto Found = Tracks->find(File);
+	return Found != Tracks->end() ? Found->second : PlayerState_t::NoTrack;
+}
+
+bool MusicPlayer_t::OpenQueue(const std::filesystem::path& Journal) {
+	std::vector<std::string> Files;
+	Files.reserve(this->Library->Tracks.size());
+	std::unordered_map<std::string_view, uint32_t> Tracks;
+	for (const LibraryTrack_t& Track : this->Library->Tracks) {
+		Files.push_back(Track.Path.string());
+		Tracks.emplace(Files.back(), Track.Id);
+	}
+
+	const bool IsOpen = this->Queue.Open(Journal, &MusicPlayer_t::ResolveQueued, &Tracks);
+	this->PublishState();
+	return IsOpen;
+}
+
+bool MusicPlayer_t::OpenStats(const std::filesystem::path& Folder) {
+	if (!this->Stats.Open(Folder))
+		return false;
+
+	this->SyncShuffle();
+	return true;
+}
+
+bool MusicPlayer_t::OpenPlaylists(const std::filesystem::path& File) {
+	const bool IsOpen = this->Playlists.Open(File, GetUnixTime());
+	this->PublishState();
+	return IsOpen;
+}
+
+bool MusicPlayer_t::SetPlaylist(std::string_view Name, std::string_view Rule, std::string* Error) {
+	// Checked here so the caller hears about a bad rule, the engine parses it again
+	Query_t Query;
+	if (!Rule.empty() && !Query.Parse(Rule, Error))
+		return false;
+	if (Name.empty() || Name.find_first_of("\t\r\n") != std::string_view::npos) {
+		*Error = "playlist names can't be empty or contain tabs or line breaks";
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> Guard(this->LibraryLock);
+		this->PendingPlaylists.emplace_back(Name, Rule);
+	}
+	this->Post({ CommandType_t::UpdatePlaylists });
+	return true;
+}
+
+int64_t MusicPlayer_t::GetUnixTime() {
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void MusicPlayer_t::SetMusicFolder(const std::filesystem::path& Folder) {
+	this->MusicFolder = std::filesystem::directory_entry(Folder);
+	this->RescanLibrary();
+}
+
+std::filesystem::path MusicPlayer_t::GetMusicFolder() const {
+	return this->MusicFolder.path();
+}
+
+MusicPlayer_t::Track_t* MusicPlayer_t::GetCurrentTrack() {
+	return this->Voices.Get(this->CurrentVoice);
+}
+
+uint32_t MusicPlayer_t::GetTargetTrack() {
+	if (this->PendingTrack != PlayerState_t::NoTrack)
+		return this->PendingTrack;
+
+	const Track_t* Current = this->GetCurrentTrack();
+	return Current ? Current->Entry->Id : PlayerState_t::NoTrack;
+}
+
+void MusicPlayer_t::ReleaseVoice(Handle_t Voice) {
+	Track_t* Track = this->Voices.Get(Voice);
+	if (!Track)
+		return;
+
+	this->Timers.Cancel(Track->ReleaseTimer);
+	Track->Free();
+	Track->Entry = nullptr;
+	Track->EntryLibrary = nullptr;
+	Track->Mapping = nullptr;
+	this->Voices.Release(Voice);
+}
+
+void MusicPlayer_t::StartTrack(uint32_t Id, float FadeIn, float Volume) {
+	const int Index = this->Library->IndexOf(Id);
+	if (Index < 0)
+		return;
+
+	while (this->Voices.GetUsed() >= std::clamp<size_t>(this->VoiceLimit, 1, MaxVoices)) {
+		if (!this->StealVoice())
+			break;
+	}
+
+	const Handle_t Voice = this->Voices.Acquire();
+	if (!Voice.IsValid())
+		return;
+
+	Track_t* Track = this->Voices.Get(Voice);
+	this->CurrentVoice = Voice;
+	this->Shuffle.MarkPlayed(Id);
+	Track->Init(this->Library, &this->Library->Tracks[Index], Volume);
+	Track->Play();
+	Track->FadeIn(FadeIn, this->Volume);
+	this->ArmCrossfade(Track);
+}
+
+void MusicPlayer_t::ArmCrossfade(Track_t* Track) {
+	const HSTREAM Stream = Track->GetStream();
+	if (!Stream || Track->CrossfadeSync)
+		return;
+
+	// BASS calls back from its own thread as playback passes the point, the id says which track it was.
+	// Offline it calls back right as the mix passes it, on the thread that pulls the output
+	const double Point = std::max(Track->GetDuration() - std::max(this->TrackFade, JoinLead), 0.0);
+	const int64_t Bytes = Track->GetStreamBytes(Point);
+	if (Bytes < 0 || Point <= Track->GetCurrentPosition()) {
+		// Seeked past it already
+		Track->CrossfadeSync = 0;
+		this->Post({ CommandType_t::TrackEnding, Track->Entry->Id });
+		return;
+	}
+
+	const DWORD Mode = BASS_SYNC_POS | BASS_SYNC_ONETIME | (this->IsOffline ? BASS_SYNC_MIXTIME : 0);
+	Track->CrossfadeSync = BASS_ChannelSetSync(Stream, Mode, static_cast<QWORD>(Bytes),
+		&MusicPlayer_t::OnCrossfadePoint, reinterpret_cast<void*>(static_cast<uintptr_t>(Track->Entry->Id)));
+	if (!Track->CrossfadeSync)
+		printf("Failed to set the crossfade sync\n");
+}
+
+void CALLBACK MusicPlayer_t::OnCrossfadePoint(HSYNC, DWORD, DWORD, void* User) {
+	MusicPlayer.Post({ CommandType_t::TrackEnding, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(User)) });
+}
+
+bool MusicPlayer_t::StealVoice() {
+	// Whatever is closest to silence goes first, the current track only if nothing else is left
+	Handle_t Quietest = this->CurrentVoice;
+	float QuietestVolume = FLT_MAX;
+	this->Voices.ForEach([&](Handle_t Voice, Track_t& Track) {
+		if (!(Voice == this->CurrentVoice) && Track.GetVolume() < QuietestVolume) {
+			Quietest = Voice;
+			QuietestVolume = Track.GetVolume();
 		}
+	});
+
+	if (Quietest == this->CurrentVoice)
+		this->CurrentVoice = {};
+
+	Track_t* Track = this->Voices.Get(Quietest);
+	if (!Track)
+		return false;
+
+	Track->Retire(StealFade);
+	this->ReleaseVoice(Quietest);
+	return true;
+}
+
+void MusicPlayer_t::FadeOutVoice(Handle_t Voice, float Seconds) {
+	Track_t* Track = this->Voices.Get(Voice);
+	if (!Track)
+		return;
+
+	// Stays in the pool until it's silent
+	Track->FadeOut(Seconds);
+	this->Timers.Cancel(Track->ReleaseTimer);
+	Track->ReleaseTimer = this->Timers.Schedule(this->GetTick(Seconds), &MusicPlayer_t::OnVoiceFaded, this,
+		(static_cast<uint64_t>(Voice.Index) << 32) | Voice.Generation);
+}
+
+void MusicPlayer_t::FadeOutCurrent(float Seconds, bool IsFinished) {
+	Track_t* Current = this->GetCurrentTrack();
+	if (!Current)
+		return;
+
+	// Leaving a track is what counts it, however far it got is what was listened to
+	if (this->Stats.IsOpen()) {
+		const PlayStats_t::Event_t Event = IsFinished ? PlayStats_t::Event_t::Finished : PlayStats_t::Event_t::Skipped;
+		this->Stats.Record(Current->Entry->Key, Event, Current->GetCurrentPosition());
+
+		// The entry may be from the library before the last rescan
+		const int Row = Current->EntryLibrary == this->Library ? static_cast<int>(Current->Entry - this->Library->Tracks.data()) : this->Library->IndexOf(Current->Entry->Id);
+		if (Row >= 0)
+			this->Playlists.Record(Row, Event, GetUnixTime());
 	}
 
-	// Preinit FFT
-	if (this->FFT.empty()) {
-		this->FFT.resize(VisualData.size());
+	this->FadeOutVoice(this->CurrentVoice, Seconds);
+	this->LastFadingTrack = Current->Entry->Id;
+	this->CurrentVoice = {};
+}
+
+uint64_t MusicPlayer_t::GetTick(float SecondsFromNow) const {
+	// Offline, time is however much has been rendered
+	if (this->IsOffline)
+		return this->OfflineStart + this->OfflineFrames * 1000 / this->OfflineRate + static_cast<uint64_t>(SecondsFromNow * 1000.0f);
+
+	const auto Elapsed = std::chrono::steady_clock::now() - this->TimerEpoch + std::chrono::duration<float>(SecondsFromNow);
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(Elapsed).count()) + this->TickOffset;
+}
+
+void MusicPlayer_t::OnVoiceFaded(void* User, uint64_t Voice) {
+	MusicPlayer_t* Player = static_cast<MusicPlayer_t*>(User);
+	const Handle_t Handle = { static_cast<uint32_t>(Voice >> 32), static_cast<uint32_t>(Voice) };
+	if (Handle == Player->CurrentVoice)
+		return;
+
+	Player->ReleaseVoice(Handle);
+}
+
+void MusicPlayer_t::OnSettled(void* User, uint64_t) {
+	MusicPlayer_t* Player = static_cast<MusicPlayer_t*>(User);
+	Player->SettleTimer = {};
+	Player->StartPending();
+}
+
+void MusicPlayer_t::OnSleep(void* User, uint64_t) {
+	MusicPlayer_t* Player = static_cast<MusicPlayer_t*>(User);
+	Player->SleepTimer = {};
+	if (Player->PendingTrack != PlayerState_t::NoTrack)
+		Player->StartPending();
+
+	Track_t* Current = Player->GetCurrentTrack();
+	if (!Current || Current->GetActivity() != BASS_ACTIVE_PLAYING)
+		return;
+
+	Current->FadeOut(Player->TrackFade);
+	Player->SleepTimer = Player->Timers.Schedule(Player->GetTick(Player->TrackFade), &MusicPlayer_t::OnSleepFaded, Player);
+}
+
+void MusicPlayer_t::OnSleepFaded(void* User, uint64_t) {
+	MusicPlayer_t* Player = static_cast<MusicPlayer_t*>(User);
+	Player->SleepTimer = {};
+
+	// Back to full volume while paused, so pressing play doesn't come back silent
+	Track_t* Current = Player->GetCurrentTrack();
+	if (!Current)
+		return;
+
+	Current->Pause();
+	Current->SetVolume(Player->Volume);
+}
+
+void MusicPlayer_t::OnWake(void* User, uint64_t) {
+	MusicPlayer_t* Player = static_cast<MusicPlayer_t*>(User);
+	Player->WakeTimer = {};
+	if (Player->PendingTrack != PlayerState_t::NoTrack) {
+		Player->StartPending();
+		return;
 	}
 
-	// Smoothing of output
-	for (size_t i = 0; i < this->FFT.size(); i++) {
-		this->FFT[i] -= (this->FFT[i] - Out[i]) * DeltaTime;
+	Track_t* Current = Player->GetCurrentTrack();
+	if (!Current) {
+		if (!Player->Library->Tracks.empty())
+			Player->StartTrack(Player->Library->Tracks.front().Id, Player->TrackFade, 0.0f);
+		return;
 	}
 
-	return this->FFT;
+	if (Current->GetActivity() == BASS_ACTIVE_PLAYING)
+		return;
+
+	Current->SetVolume(0.0f);
+	Current->Play();
+	Current->FadeIn(Player->TrackFade, Player->Volume);
+	Player->ArmCrossfade(Current);
 }
 
+void MusicPlayer_t::OnRescan(void* User, uint64_t) {
+	MusicPlayer_t* Player = static_cast<MusicPlayer_t*>(User);
+	{
+		std::lock_guard<std::mutex> Guard(Player->ScanLock);
+		Player->IsScanRequested = true;
+	}
+	Player->ScanSignal.notify_one();
+	Player->Timers.Schedule(Player->GetTick(1.0f), &MusicPlayer_t::OnRescan, Player);
+}
+
+void MusicPlayer_t::SkipTo(uint32_t Id) {
+	if (Id == PlayerState_t::NoTrack)
+		return;
 
-std::filesystem::directory_entry MusicPlayer_t::GetNextTrack() {
-	std::filesystem::directory_entry NextTrack("NULL");
-	const std::string& CurrentTrackPath = this->CurrentTrack->Path.path().string();
-	for (const std::filesystem::directory_entry& MusicTrack : this->MusicTracks) {
+	// Silence right away, the old track doesn't wait for the new one
+	this->FadeOutCurrent(SkipFade);
 
-		if (NextTrack == std::filesystem::directory_entry("PICK")) {
-			NextTrack = MusicTrack;
+	const uint64_t Now = this->GetTick();
+	if (this->PendingTrack == PlayerState_t::NoTrack)
+		this->FirstSkip = Now;
+	this->PendingTrack = Id;
+
+	const uint64_t Settle = std::min(this->GetTick(SkipSettle), this->FirstSkip + static_cast<uint64_t>(SkipDeadline * 1000.0f));
+	this->Timers.Cancel(this->SettleTimer);
+	this->SettleTimer = this->Timers.Schedule(Settle, &MusicPlayer_t::OnSettled, this);
+}
+
+void MusicPlayer_t::StartPending() {
+	const uint32_t Id = this->PendingTrack;
+	this->PendingTrack = PlayerState_t::NoTrack;
+	this->Timers.Cancel(this->SettleTimer);
+	this->StartTrack(Id, 1.0f, 0.0f);
+}
+
+void MusicPlayer_t::Execute(const Command_t& Command) {
+	// Pressing play on a track that is still settling starts it now
+	if ((Command.Type == CommandType_t::TogglePause || Command.Type == CommandType_t::Play) && this->PendingTrack != PlayerState_t::NoTrack) {
+		this->StartPending();
+		return;
+	}
+
+	Track_t* Current = this->GetCurrentTrack();
+
+	switch (Command.Type) {
+	case CommandType_t::TogglePause:
+	case CommandType_t::Play:
+	case CommandType_t::Pause: {
+		if (!Current)
 			break;
+
+		const bool IsPlaying = Current->GetActivity() == BASS_ACTIVE_PLAYING;
+		if (IsPlaying && Command.Type != CommandType_t::Play) {
+			Current->Pause();
+		} else if (!IsPlaying && Command.Type != CommandType_t::Pause) {
+			Current->Play();
+			this->ArmCrossfade(Current);
 		}
+		break;
+	}
 
-		const std::string& TrackPath = MusicTrack.path().string();
-		if (strcmp(TrackPath.c_str(), CurrentTrackPath.c_str()) != 0)
-			continue;
+	// Quick crossfade, the new track comes in over a second once it's opened
+	case CommandType_t::Next:
+		this->Queue.PushHistory(this->GetTargetTrack());
+		this->SkipTo(this->TakeNextTrack(this->GetTargetTrack()));
+		break;
+
+	// Back through what was played before, the library order once that runs out
+	case CommandType_t::Previous:
+		this->SkipTo(this->TakePrevTrack(this->GetTargetTrack()));
+		break;
+
+	// Picking a track silences everything else right away
+	case CommandType_t::Select:
+		if (this->Library->IndexOf(Command.Track) < 0)
+			break;
 
-		if (MusicTrack == this->MusicTracks.back()) {
-			NextTrack = this->MusicTracks.front();
+		this->Queue.PushHistory(this->GetTargetTrack());
+		this->PendingTrack = PlayerState_t::NoTrack;
+		this->Timers.Cancel(this->SettleTimer);
+		this->FadeOutCurrent(SkipFade);
+		this->Voices.ForEach([this](Handle_t Voice, Track_t&) {
+			this->FadeOutVoice(Voice, SkipFade);
+		});
+		this->StartTrack(Command.Track, this->TrackFade, 0.0f);
+		break;
+
+	// Only the current track follows, the fading ones are on their way out anyway
+	case CommandType_t::SetVolume:
+		if (!std::isfinite(Command.Value))
 			break;
+		this->Volume = std::clamp(Command.Value, 0.0f, 100.0f);
+		if (Current)
+			Current->FadeIn(SeekFade, this->Volume);
+		break;
+
+	case CommandType_t::Enqueue:
+	case CommandType_t::PlayNext: {
+		const int Index = this->Library->IndexOf(Command.Track);
+		if (Index < 0)
+			break;
+
+		const std::string File = this->Library->Tracks[Index].Path.string();
+		if (Command.Type == CommandType_t::Enqueue)
+			this->Queue.PushBack(Command.Track, File);
+		else
+			this->Queue.PushFront(Command.Track, File);
+		break;
+	}
+
+	case CommandType_t::Unqueue:
+		this->Queue.Remove(Command.Entry.IsValid() ? Command.Entry : this->Queue.Find(Command.Track));
+		break;
+
+	case CommandType_t::MoveQueued:
+		this->Queue.MoveAfter(Command.Entry, Command.After);
+		break;
+
+	case CommandType_t::ClearQueue:
+		this->Queue.Clear();
+		break;
+
+	case CommandType_t::SetShuffle:
+		this->Shuffle.SetMode(static_cast<Shuffle_t::Mode_t>(std::clamp(static_cast<int>(Command.Value), 0, 2)));
+		break;
+
+	case CommandType_t::Sleep:
+		this->Timers.Cancel(this->SleepTimer);
+		this->SleepTimer = {};
+		if (Command.Seconds > 0.0f)
+			this->SleepTimer = this->Timers.Schedule(this->GetTick(Command.Seconds), &MusicPlayer_t::OnSleep, this);
+		break;
+
+	case CommandType_t::Wake:
+		this->Timers.Cancel(this->WakeTimer);
+		this->WakeTimer = {};
+		if (Command.Seconds > 0.0f)
+			this->WakeTimer = this->Timers.Schedule(this->GetTick(Command.Seconds), &MusicPlayer_t::OnWake, this);
+		break;
+
+	case CommandType_t::Seek:
+		if (!Current || this->PendingTrack != PlayerState_t::NoTrack)
+			break;
+
+		BASS_ChannelRemoveSync(Current->GetStream(), Current->CrossfadeSync);
+		Current->CrossfadeSync = 0;
+		Current->Seek(Command.Seconds);
+		this->ArmCrossfade(Current);
+		break;
+
+	case CommandType_t::BeginScrub:
+	case CommandType_t::EndScrub:
+		if (Current)
+			Current->FadeIn(SeekFade, Command.Type == CommandType_t::BeginScrub ? 0.0f : this->Volume);
+		break;
+
+	// Fade out over whatever is left so the old track is silent as it ends
+	case CommandType_t::TrackEnding: {
+		if (!Current || Current->Entry->Id != Command.Track || this->PendingTrack != PlayerState_t::NoTrack)
+			break;
+
+		// The clock extrapolates on wall time, offline only BASS's own position is reproducible
+		const double Left = Current->GetDuration() - (this->IsOffline ? Current->GetStreamPosition() : Current->GetCurrentPosition());
+		const uint32_t NextTrack = this->TakeNextTrack(Current->Entry->Id);
+		this->Queue.PushHistory(Current->Entry->Id);
+		this->FadeOutCurrent(static_cast<float>(std::max(Left, static_cast<double>(SkipFade))), true);
+		this->StartTrack(NextTrack, this->TrackFade, 0.0f);
+		break;
+	}
+
+	// Picked up by Update() already, the command only woke the engine
+	case CommandType_t::UpdatePlaylists:
+		break;
+	}
+}
+
+void MusicPlayer_t::PublishState() {
+	const std::shared_ptr<const PlayerState_t> Previous = this->State.load(std::memory_order_relaxed);
+
+	// Built on the stack first, most updates don't change anything
+	PlayerState_t Next;
+	Next.Library = this->Library;
+	Next.Volume = this->Volume;
+	if (const Track_t* Current = this->GetCurrentTrack()) {
+		Next.CurrentTrack = Current->Entry->Id;
+		Next.Track = Current->Entry;
+		Next.TrackLibrary = Current->EntryLibrary;
+		Next.Duration = Current->GetDuration();
+		Next.IsPlaying = Current->GetActivity() == BASS_ACTIVE_PLAYING;
+		Next.Clock = Current->GetClock();
+		Next.Stream = Current->GetStream();
+	} else if (this->PendingTrack != PlayerState_t::NoTrack) {
+		// Shown as playing while it settles, so the UI follows every click
+		const int Index = this->Library->IndexOf(this->PendingTrack);
+		if (Index >= 0) {
+			Next.CurrentTrack = this->PendingTrack;
+			Next.Track = &this->Library->Tracks[Index];
+			Next.TrackLibrary = this->Library;
+			Next.IsPlaying = true;
+			Next.IsOpening = true;
+		}
+	}
+	Next.NextTrack = this->GetNextTrack(Next.CurrentTrack);
+	size_t Previewed = 0;
+	for (Handle_t Queued = this->Queue.GetFront(); Queued.IsValid() && Previewed < PlayerState_t::MaxQueuePreview; Queued = this->Queue.GetNext(Queued)) {
+		const uint32_t Id = this->Queue.GetTrack(Queued);
+		if (this->Library->IndexOf(Id) >= 0) {
+			Next.QueueEntries[Previewed] = Queued;
+			Next.QueuePreview[Previewed++] = Id;
 		}
+	}
+	if (Previewed)
+		Next.NextTrack = Next.QueuePreview[0];
+	else if (const uint32_t Shuffled = this->Shuffle.Peek(); Shuffled != PlayerState_t::NoTrack)
+		Next.NextTrack = Shuffled;
+	Next.QueueLength = this->Queue.GetSize();
+	Next.Shuffle = this->Shuffle.GetMode();
+	Next.Playlists = this->Playlists.GetPlaylists();
+	Next.Voices = this->Voices.GetUsed();
+	Next.IsCrossfading = Next.Voices > (this->GetCurrentTrack() ? 1 : 0);
+	if (Next.IsCrossfading)
+		Next.FadingTrack = this->LastFadingTrack;
+
+	if (Previous) {
+		const bool IsSame = Next.Library == Previous->Library && Next.CurrentTrack == Previous->CurrentTrack &&
+			Next.Track == Previous->Track && Next.Duration == Previous->Duration && Next.IsPlaying == Previous->IsPlaying && Next.IsOpening == Previous->IsOpening &&
+			Next.Clock == Previous->Clock && Next.NextTrack == Previous->NextTrack && Next.Volume == Previous->Volume &&
+			Next.QueueLength == Previous->QueueLength && Next.Shuffle == Previous->Shuffle && Next.Playlists == Previous->Playlists && std::equal(std::begin(Next.QueuePreview), std::end(Next.QueuePreview), std::begin(Previous->QueuePreview)) &&
+			std::equal(std::begin(Next.QueueEntries), std::end(Next.QueueEntries), std::begin(Previous->QueueEntries)) &&
+			Next.IsCrossfading == Previous->IsCrossfading && Next.FadingTrack == Previous->FadingTrack && Next.Voices == Previous->Voices &&
+			Next.Stream == Previous->Stream;
+		if (IsSame)
+			return;
+
+		Next.Version = Previous->Version + 1;
+	}
 
-		NextTrack = std::filesystem::directory_entry("PICK");
+	this->State.store(std::allocate_shared<PlayerState_t>(PoolAllocator_t<PlayerState_t>(&this->StateBlocks), std::move(Next)), std::memory_order_release);
+	FrameScheduler.RequestFrame();
+	for (const StateListener_t& Listener : this->StateListeners) {
+		if (Listener.Callback)
+			Listener.Callback(Listener.User);
 	}
-	return NextTrack;
 }
-std::filesystem::directory_entry MusicPlayer_t::GetPrevTrack() {
-	std::filesystem::directory_entry NextTrack("NULL");
-	const std::string& CurrentTrackPath = this->CurrentTrack->Path.path().string();
-	for (const std::filesystem::directory_entry& MusicTrack : this->MusicTracks) {
-		const std::string& TrackPath = MusicTrack.path().string();
-		if (strcmp(TrackPath.c_str(), CurrentTrackPath.c_str()) != 0) {
-			NextTrack = MusicTrack;
-			continue;
+
+bool MusicPlayer_t::RenderOffline(const RenderJob_t& Job, RenderStats_t* Stats) {
+	if (this->IsEngineRunning) {
+		printf("Stop the engine before rendering offline\n");
+		return false;
+	}
+
+	// Picks up a rescanned library before looking for the track
+	this->Update();
+	if (this->Library->IndexOf(Job.FirstTrack) < 0) {
+		printf("Nothing to render\n");
+		return false;
+	}
+
+	// The mix of the "no sound" device only advances when it's pulled
+	const DWORD UpdatePeriod = BASS_GetConfig(BASS_CONFIG_UPDATEPERIOD);
+	const float TrackFade = this->TrackFade;
+	this->CloseOutput();
+	BASS_SetConfig(BASS_CONFIG_UPDATEPERIOD, 0);
+	if (Job.TrackFade >= 0.0f)
+		this->TrackFade = Job.TrackFade;
+
+	bool IsRendered = false;
+	BASS_CHANNELINFO Info;
+	WaveFile_t Wave;
+	if (this->OpenOutput(0) && BASS_ChannelGetInfo(this->OutputStream, &Info) && (Job.File.empty() || Wave.Open(Job.File, Info.freq, Info.chans))) {
+		this->OfflineStart = this->GetTick();
+		this->OfflineFrames = 0;
+		this->OfflineRate = Info.freq;
+		this->IsOffline = true;
+
+		const uint64_t Total = static_cast<uint64_t>(Job.Seconds * Info.freq);
+		const uint64_t Opened = StreamsOpened;
+		const auto Start = std::chrono::steady_clock::now();
+
+		// 10 ms blocks, the engine gets to run commands and timers in between like it would in real time
+		const DWORD BlockFrames = Info.freq / 100;
+		std::vector<float> Block(BlockFrames * Info.chans);
+		if (Job.Hash)
+			Job.Hash->Reset(Info.freq, Info.chans, Info.freq / 10);
+		this->StartTrack(Job.FirstTrack, 0.0f, 0.0f);
+
+		size_t NextEvent = 0;
+		IsRendered = true;
+		while (IsRendered && this->OfflineFrames < Total) {
+			const uint64_t BlockEnd = this->OfflineFrames + BlockFrames;
+			for (; NextEvent < Job.Events.size() && Job.Events[NextEvent].Seconds * Info.freq < BlockEnd; NextEvent++)
+				this->Post(Job.Events[NextEvent].Command);
+			this->Update();
+
+			const DWORD Frames = static_cast<DWORD>(std::min<uint64_t>(BlockFrames, Total - this->OfflineFrames));
+			const DWORD Bytes = BASS_ChannelGetData(this->OutputStream, Block.data(), (Frames * Info.chans * sizeof(float)) | BASS_DATA_FLOAT);
+			const uint64_t Rendered = Bytes == static_cast<DWORD>(-1) ? 0 : Bytes / (Info.chans * sizeof(float));
+			IsRendered = Bytes != static_cast<DWORD>(-1) && (Job.File.empty() || Wave.Write(Block.data(), Rendered));
+			if (Job.Hash)
+				Job.Hash->Push(Block.data(), Rendered);
+			this->OfflineFrames += Frames;
 		}
-		break;
+		if (!Job.File.empty())
+			IsRendered = Wave.Close() && IsRendered;
+		if (Job.Hash)
+			Job.Hash->Finish();
+
+		if (Stats) {
+			Stats->Frames = this->OfflineFrames;
+			Stats->SampleRate = Info.freq;
+			Stats->StreamsOpened = StreamsOpened - Opened;
+			Stats->WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+		}
+
+		// Timers scheduled while rendering are on the virtual clock, the wall clock continues from there
+		const uint64_t Rendered = this->GetTick();
+		this->IsOffline = false;
+		this->TickOffset += Rendered - std::min(Rendered, this->GetTick());
 	}
-	return NextTrack;
+
+	this->CloseOutput();
+	this->TrackFade = TrackFade;
+	BASS_SetConfig(BASS_CONFIG_UPDATEPERIOD, UpdatePeriod);
+	this->OpenOutput(-1);
+	this->PublishState();
+	return IsRendered;
 }
 
-MusicPlayer_t::MusicPlayer_t() {
-	if (!BASS_Init(-1, 44100, 0, 0, NULL)) {
-		printf("Failed to initialize BASS\n");
-		return;
+std::shared_ptr<const PlayerState_t> MusicPlayer_t::GetState() const {
+	return this->State.load(std::memory_order_acquire);
+}
+
+bool MusicPlayer_t::AddStateListener(void (*Callback)(void* User), void* User) {
+	for (StateListener_t& Listener : this->StateListeners) {
+		if (!Listener.Callback) {
+			Listener = { Callback, User };
+			return true;
+		}
 	}
+	return false;
+}
+
+uint64_t MusicPlayer_t::GetStreamsOpened() const {
+	return StreamsOpened.load(std::memory_order_relaxed);
+}
 
+void MusicPlayer_t::Post(const Command_t& Command) {
 	{
-		char UsernameBuf[MAX_PATH];
-		DWORD UsernameLen = MAX_PATH + 1;
-		GetUserNameA(UsernameBuf, &UsernameLen);
+		std::lock_guard<std::mutex> Lock(this->CommandLock);
+		this->PendingCommands.push_back(Command);
+	}
+	this->CommandSignal.notify_all();
+}
 
-		std::string FolderPath = "C:\\Users\\" + std::string(UsernameBuf, UsernameLen - 1) + "\\Music\\";
-		this->MusicFolder = std::filesystem::directory_entry(FolderPath);
+void MusicPlayer_t::Start() {
+	if (this->IsEngineRunning)
+		return;
+
+	this->IsEngineRunning = true;
+	this->EngineThread = std::thread(&MusicPlayer_t::EngineMain, this);
+	this->ScannerThread = std::thread(&MusicPlayer_t::ScannerMain, this);
+}
+
+void MusicPlayer_t::Stop() {
+	{
+		std::lock_guard<std::mutex> Lock(this->CommandLock);
+		this->IsEngineRunning = false;
 	}
+	this->CommandSignal.notify_all();
 
+	// Taking the lock once makes sure the scanner is either waiting or will see the flag
 	{
-		if (!this->MusicFolder.exists())
-			return;
+		std::lock_guard<std::mutex> Guard(this->ScanLock);
+	}
+	this->ScanSignal.notify_all();
 
-		for (const auto& Entry : std::filesystem::directory_iterator(this->MusicFolder)) {
-			if (Entry.path().extension() != ".mp3")
-				continue;
+	if (this->EngineThread.joinable())
+		this->EngineThread.join();
+	if (this->ScannerThread.joinable())
+		this->ScannerThread.join();
 
-			this->MusicTracks.push_back(Entry);
+	// Nothing records anymore, whatever is left goes to the log
+	this->Stats.Close();
+}
+
+void MusicPlayer_t::EngineMain() {
+	while (this->IsEngineRunning) {
+		this->Update();
 
-			if (this->CurrentTrack != nullptr)
-				continue;
+		// Sleeps until the next timer is due or a command comes in, nothing runs on a fixed rate
+		const uint64_t Deadline = this->Timers.GetNextDeadline();
+		const auto IsWoken = [this] {
+			return !this->PendingCommands.empty() || !this->IsEngineRunning;
+		};
 
-			this->CurrentTrack = new Track_t;
-			this->CurrentTrack->Init(Entry, this->Volume);
+		std::unique_lock<std::mutex> Lock(this->CommandLock);
+		if (Deadline == TimerWheel_t::Never)
+			this->CommandSignal.wait(Lock, IsWoken);
+		else
+			this->CommandSignal.wait_until(Lock, this->TimerEpoch + std::chrono::milliseconds(Deadline - std::min(Deadline, this->TickOffset)), IsWoken);
+	}
+}
+
+void MusicPlayer_t::ScannerMain() {
+	while (this->IsEngineRunning) {
+		// Directory listings allocate and can block, so they stay off the engine thread
+		std::unique_lock<std::mutex> Lock(this->ScanLock);
+		this->ScanSignal.wait(Lock, [this] {
+			return this->IsScanRequested || !this->IsEngineRunning;
+		});
+		this->IsScanRequested = false;
+		Lock.unlock();
+
+		if (!this->IsEngineRunning)
+			break;
+		this->RescanLibrary();
+
+		// Walking a file for its seek table takes a while, new tracks get theirs here rather than on their first seek
+		for (const LibraryTrack_t& Track : this->ScannedLibrary->Tracks) {
+			if (!this->IsEngineRunning)
+				break;
+			if (this->SeekTablesCached.insert(Track.Id).second)
+				SeekTable_t::Cache(Track.Path);
 		}
+
+		// After the seek tables, MP3 durations come from them
+		if (this->IsEngineRunning)
+			this->TagLibrary();
 	}
-	
+}
+
+void MusicPlayer_t::PollBeats() {
+	BeatDetector_t::Beat_t Beat;
+	while (this->Analyzer.BeatDetector.PollBeat(&Beat)) {
+		this->LastBeat = Beat;
+		if (Beat.IsDownbeat)
+			this->LastDownbeat = Beat;
+	}
+}
+
+float MusicPlayer_t::GetBeatPulse() {
+	if (this->LastBeat.Confidence < 0.3f || !this->Analyzer.GetSampleRate())
+		return 0.0f;
+
+	uint64_t Feed = this->Analyzer.GetFeedPosition();
+	if (Feed < this->LastBeat.Sample)
+		return 0.0f;
+
+	float Elapsed = static_cast<float>(Feed - this->LastBeat.Sample) / this->Analyzer.GetSampleRate();
+	return expf(-Elapsed * 8.0f) * (this->LastBeat.IsDownbeat ? 1.0f : 0.6f);
 }
 
 void MusicPlayer_t::Update() {
-	
-	static time_t LastQuery = time(nullptr);
-	if ((time(nullptr) - LastQuery) > 0) {
-		LastQuery = time(nullptr);
-		MusicTracks.clear();
-		for (const auto& Entry : std::filesystem::directory_iterator(this->MusicFolder)) {
-			if (Entry.path().extension() != ".mp3")
-				continue;
-
-			MusicTracks.push_back(Entry);
-		}
+	{
+		std::lock_guard<std::mutex> Lock(this->CommandLock);
+		this->Commands.swap(this->PendingCommands);
 	}
 
-	double CurrentDur = 0.0;
-	if (this->CurrentTrack) {
-		this->CurrentTrack->Update();
-		CurrentDur = this->CurrentTrack->GetDuration() - this->CurrentTrack->GetCurrentPosition();
+	std::shared_ptr<const Library_t> Scanned;
+	std::vector<std::pair<std::string, std::string>> Playlists;
+	{
+		std::lock_guard<std::mutex> Guard(this->LibraryLock);
+		Scanned = std::move(this->PendingLibrary);
+		Playlists.swap(this->PendingPlaylists);
 	}
 
-	double OldDur = 0.0;
-	if (this->OldTrack) {
-		this->OldTrack->Update();
-		OldDur = this->OldTrack->GetDuration() - this->OldTrack->GetCurrentPosition();
+	const int64_t Now = GetUnixTime();
+	if (Scanned) {
+		this->Library = std::move(Scanned);
+		this->SyncShuffle();
+		this->Playlists.SetLibrary(this->Library, Now);
 	}
-	
-	if (this->OldTrack && OldDur == 0.0 && this->OldTrack->IsFading) {
-		this->OldTrack->Free();
-		delete this->OldTrack;
-		this->OldTrack = nullptr;
-		return;
+
+	std::string Error;
+	for (const auto& [Name, Rule] : Playlists) {
+		if (!this->Playlists.Set(Name, Rule, &Error, Now))
+			printf("Failed to set playlist '%s': %s\n", Name.c_str(), Error.c_str());
 	}
-	
-	if (CurrentDur > this->TrackFade || CurrentDur == 0.0)
-		return;
-	
-	if (this->OldTrack != nullptr)
-		return;
 
-	std::filesystem::directory_entry NextTrack = this->GetNextTrack();
-	
-	this->OldTrack = this->CurrentTrack;
-	this->OldTrack->FadeOut(this->TrackFade);
+	this->Timers.Advance(this->GetTick());
+
+	for (const Command_t& Command : this->Commands)
+		this->Execute(Command);
+	this->Commands.clear();
 
-	this->CurrentTrack = new Track_t;
-	this->CurrentTrack->Init(NextTrack, 0.0f);
-	this->CurrentTrack->FadeIn(this->TrackFade, this->Volume);
-	this->CurrentTrack->Play();
+	// Plays above only marked their words, rules on time since the last play catch up with the clock too
+	this->Playlists.Update(Now);
+
+	this->PublishState();
 }
 
-void MusicPlayer_t::DrawDuration() {
+
+void MusicPlayer_t::DrawDuration(const PlayerState_t& State) {
+	if (State.CurrentTrack == PlayerState_t::NoTrack || !State.Clock)
+		return;
 
 	ImDrawList* DrawList = ImGui::GetWindowDrawList();
 	const ImVec2 Min = ImGui::GetWindowPos();
@@ -321,8 +1321,35 @@ void MusicPlayer_t::DrawDuration() {
 	float Width = Max.x - Min.x;
 	float Height = Max.y - Min.y;
 	
-	double CurrentPos = this->CurrentTrack->GetCurrentPosition();
-	double MaxDuration = this->CurrentTrack->GetDuration();
+	double MaxDuration = State.Duration;
+	double CurrentPos = std::min(State.Clock->GetSeconds(), MaxDuration);
+
+	const ImVec2& GapBorder = ImGui::CalcTextSize("88:88:88");
+	const ImVec2& AbsStart = ImVec2(Min.x + GapBorder.x + 5.0f, Max.y - Height / 2.0f - 5.0f);
+	const ImVec2& AbsEnd = ImVec2(Max.x - GapBorder.x - 5.0f, Max.y - Height / 2.0f + 5.0f);
+
+	// Click or drag anywhere along the bar, the track only jumps once the button is let go
+	ImVec2 MousePos = ImGui::GetMousePos();
+	const bool IsOverBar = MousePos.x > AbsStart.x - 5.0f && MousePos.x < AbsEnd.x + 5.0f && MousePos.y > Min.y && MousePos.y < Max.y;
+	if (IsOverBar && ImGui::IsMouseClicked(ImGuiMouseButton_Left) && MaxDuration > 0.0 && AbsEnd.x > AbsStart.x && State.Track) {
+		this->IsDraggingSeek = true;
+		this->Scrubber.Start(State.Track->Path, CurrentPos);
+		this->Post({ CommandType_t::BeginScrub });
+	}
+
+	if (this->IsDraggingSeek) {
+		const float Ratio = std::clamp((MousePos.x - AbsStart.x) / (AbsEnd.x - AbsStart.x), 0.0f, 1.0f);
+		this->SeekPreview = Ratio * MaxDuration;
+		this->Scrubber.SetPosition(this->SeekPreview);
+		CurrentPos = this->SeekPreview;
+
+		if (!ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+			this->IsDraggingSeek = false;
+			this->Scrubber.Stop();
+			this->Post({ CommandType_t::Seek, PlayerState_t::NoTrack, static_cast<float>(this->SeekPreview) });
+			this->Post({ CommandType_t::EndScrub });
+		}
+	}
 	
 	int CurHours = (static_cast<int>(CurrentPos) / 3600);
 	int CurMinutes = ((static_cast<int>(CurrentPos) % 3600) / 60);
@@ -333,29 +1360,29 @@ void MusicPlayer_t::DrawDuration() {
 	int MaxSeconds = (static_cast<int>(MaxDuration) % 60);
 	
 	{
-		char CurBuffer[9];
-		snprintf(CurBuffer, sizeof(CurBuffer), "%02d:%02d:%02d", CurHours, CurMinutes, CurSeconds);
-		const std::string CurPos(CurBuffer);
-	
-		char MaxBuffer[9];
-		snprintf(MaxBuffer, sizeof(MaxBuffer), "%02d:%02d:%02d", MaxHours, MaxMinutes, MaxSeconds);
-		const std::string MaxDur(MaxBuffer);
+		const char* CurPos = FrameArena.Format("%02d:%02d:%02d", CurHours, CurMinutes, CurSeconds);
+		const char* MaxDur = FrameArena.Format("%02d:%02d:%02d", MaxHours, MaxMinutes, MaxSeconds);
 	
-		const ImVec2& Text1Size = ImGui::CalcTextSize(CurPos.c_str());
+		const ImVec2& Text1Size = ImGui::CalcTextSize(CurPos);
 		const ImVec2& Text1Pos = ImVec2(Min.x, Max.y - Height / 2.0f - Text1Size.y / 2.0f);
-		DrawList->AddText(Text1Pos, ImColor(1.0f, 1.0f, 1.0f), CurPos.c_str());
+		DrawList->AddText(Text1Pos, ImColor(1.0f, 1.0f, 1.0f), CurPos);
 	
-		const ImVec2& Text2Size = ImGui::CalcTextSize(MaxDur.c_str());
+		const ImVec2& Text2Size = ImGui::CalcTextSize(MaxDur);
 		const ImVec2& Text2Pos = ImVec2(Max.x - Text2Size.x, Max.y - Height / 2.0f - Text2Size.y / 2.0f);
-		DrawList->AddText(Text2Pos, ImColor(1.0f, 1.0f, 1.0f), MaxDur.c_str());
+		DrawList->AddText(Text2Pos, ImColor(1.0f, 1.0f, 1.0f), MaxDur);
 	}
 	
 	{
-		const ImVec2& GapBorder = ImGui::CalcTextSize("88:88:88");
-		float Ratio = static_cast<float>(CurrentPos) / static_cast<float>(MaxDuration);
-	
-		const ImVec2& AbsStart = ImVec2(Min.x + GapBorder.x + 5.0f, Max.y - Height / 2.0f - 5.0f);
-		const ImVec2& AbsEnd = ImVec2(Max.x - GapBorder.x - 5.0f, Max.y - Height / 2.0f + 5.0f);
+		float Ratio = MaxDuration > 0.0 ? static_cast<float>(CurrentPos / MaxDuration) : 0.0f;
+
+		// Redraw when either the time text or the bar moves, whichever comes first
+		if (State.Clock->GetIsRunning() && MaxDuration > 0.0 && !this->IsDraggingSeek) {
+			double NextChange = 1.0 - fmod(CurrentPos, 1.0);
+			const float BarWidth = AbsEnd.x - AbsStart.x;
+			if (BarWidth >= 1.0f)
+				NextChange = std::min(NextChange, MaxDuration / BarWidth);
+			FrameScheduler.RequestFrameIn(static_cast<float>(NextChange));
+		}
 	
 		const ImVec2& ProgStart = AbsStart;
 		const ImVec2& ProgEnd = ImVec2(AbsStart.x + (AbsEnd.x - AbsStart.x) * Ratio, AbsEnd.y);
@@ -365,7 +1392,7 @@ void MusicPlayer_t::DrawDuration() {
 	}
 }
 
-void MusicPlayer_t::DrawNextButton() {
+void MusicPlayer_t::DrawNextButton(const PlayerState_t& State) {
 	ImDrawList* DrawList = ImGui::GetWindowDrawList();
 	const ImVec2 Min = ImGui::GetWindowPos();
 	const ImVec2 Max = { Min.x + ImGui::GetWindowWidth(), Min.y + ImGui::GetWindowHeight() };
@@ -379,51 +1406,38 @@ void MusicPlayer_t::DrawNextButton() {
 	static bool HasPressed = false;
 	static bool Animate = false;
 	ImVec2 MousePos = ImGui::GetMousePos();
-	if (MousePos.x > Min.x && MousePos.x < Max.x && MousePos.y > Min.y && MousePos.y < Max.y && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+	if (MousePos.x > Min.x && MousePos.x < Max.x && MousePos.y > Min.y && MousePos.y < Max.y && ImGui::IsMouseClicked(ImGuiMouseButton_Left) && State.CurrentTrack != PlayerState_t::NoTrack) {
 		HasPressed = true;
-
-		if (this->OldTrack) {
-			this->OldTrack->Free();
-			delete this->OldTrack;
-			this->OldTrack = nullptr;
-		}
-
-		std::filesystem::directory_entry NextTrack = this->GetNextTrack();
-
-		this->OldTrack = this->CurrentTrack;
-		this->OldTrack->FadeOut(this->TrackFade);
-
-		this->CurrentTrack = new Track_t;
-		this->CurrentTrack->Init(NextTrack, 0.0f);
-		this->CurrentTrack->FadeIn(1.0f, this->Volume);
-		this->CurrentTrack->Play();
+		this->Post({ CommandType_t::Next });
 	}
 
-	static std::chrono::steady_clock::time_point NextButtonChange;
+	// Animations run on the ImGui clock, which a headless replay advances by a fixed delta time
+	static double NextButtonChange = 0.0;
 	static bool OldShowPlayButton = false;
 	if (HasPressed) {
-		NextButtonChange = std::chrono::high_resolution_clock::now();
+		NextButtonChange = ImGui::GetTime();
 		HasPressed = false;
 		Animate = true;
 	}
 
 	float ButtonAnim = 0.0f;
-	float TimeDiff = static_cast<float>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - NextButtonChange).count()) / 150.0f;
+	float TimeDiff = static_cast<float>((ImGui::GetTime() - NextButtonChange) / 0.15);
 
 	if (Animate) {
 		ButtonAnim = std::clamp(TimeDiff, 0.0f, 1.0f);
+		if (ButtonAnim < 1.0f)
+			FrameScheduler.RequestAnimationFrame();
 	}
 	
 	// Draw arrow function
 	auto Arrow = [](ImVec2 Center, float Size, ImDrawList* Drawlist) {
 
-		std::vector<ImVec2> Offsets = {
-			{ Center.x, Center.y - Size / 2 },
-			{ Center.x + Size / 1.3f, Center.y },
-			{ Center.x, Center.y + Size / 2 },
-		};
+		ImVec2* Offsets = FrameArena.Allocate<ImVec2>(3);
+		Offsets[0] = { Center.x, Center.y - Size / 2 };
+		Offsets[1] = { Center.x + Size / 1.3f, Center.y };
+		Offsets[2] = { Center.x, Center.y + Size / 2 };
 
-		Drawlist->AddConcavePolyFilled(Offsets.data(), 3, ImColor(1.0f, 1.0f, 1.0f));
+		Drawlist->AddConcavePolyFilled(Offsets, 3, ImColor(1.0f, 1.0f, 1.0f));
 			
 	};
 
@@ -433,7 +1447,7 @@ void MusicPlayer_t::DrawNextButton() {
 	Arrow(ImVec2(LeftCenter.x, RightCenter.y), ButtonAnim * 25.0f, DrawList);
 }
 
-void MusicPlayer_t::DrawPrevButton() {
+void MusicPlayer_t::DrawPrevButton(const PlayerState_t& State) {
 	ImDrawList* DrawList = ImGui::GetWindowDrawList();
 	const ImVec2 Min = ImGui::GetWindowPos();
 	const ImVec2 Max = { Min.x + ImGui::GetWindowWidth(), Min.y + ImGui::GetWindowHeight() };
@@ -447,51 +1461,38 @@ void MusicPlayer_t::DrawPrevButton() {
 	static bool HasPressed = false;
 	static bool Animate = false;
 	ImVec2 MousePos = ImGui::GetMousePos();
-	if (MousePos.x > Min.x && MousePos.x < Max.x && MousePos.y > Min.y && MousePos.y < Max.y && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+	if (MousePos.x > Min.x && MousePos.x < Max.x && MousePos.y > Min.y && MousePos.y < Max.y && ImGui::IsMouseClicked(ImGuiMouseButton_Left) && State.CurrentTrack != PlayerState_t::NoTrack) {
 		HasPressed = true;
-
-		if (this->OldTrack) {
-			this->OldTrack->Free();
-			delete this->OldTrack;
-			this->OldTrack = nullptr;
-		}
-
-		std::filesystem::directory_entry PrevTrack = this->GetPrevTrack();
-
-		this->OldTrack = this->CurrentTrack;
-		this->OldTrack->FadeOut(this->TrackFade);
-
-		this->CurrentTrack = new Track_t;
-		this->CurrentTrack->Init(PrevTrack, 0.0f);
-		this->CurrentTrack->FadeIn(1.0f, this->Volume);
-		this->CurrentTrack->Play();
+		this->Post({ CommandType_t::Previous });
 	}
 
-	static std::chrono::steady_clock::time_point NextButtonChange;
+	// Animations run on the ImGui clock, which a headless replay advances by a fixed delta time
+	static double NextButtonChange = 0.0;
 	static bool OldShowPlayButton = false;
 	if (HasPressed) {
-		NextButtonChange = std::chrono::high_resolution_clock::now();
+		NextButtonChange = ImGui::GetTime();
 		HasPressed = false;
 		Animate = true;
 	}
 
 	float ButtonAnim = 0.0f;
-	float TimeDiff = static_cast<float>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - NextButtonChange).count()) / 150.0f;
+	float TimeDiff = static_cast<float>((ImGui::GetTime() - NextButtonChange) / 0.15);
 
 	if (Animate) {
 		ButtonAnim = std::clamp(TimeDiff, 0.0f, 1.0f);
+		if (ButtonAnim < 1.0f)
+			FrameScheduler.RequestAnimationFrame();
 	}
 
 	// Draw arrow function
 	auto Arrow = [](ImVec2 Center, float Size, ImDrawList* Drawlist) {
 
-		std::vector<ImVec2> Offsets = {
-			{ Center.x - Size / 1.3f, Center.y },
-			{ Center.x, Center.y - Size / 2 },
-			{ Center.x, Center.y + Size / 2 },
-		};
+		ImVec2* Offsets = FrameArena.Allocate<ImVec2>(3);
+		Offsets[0] = { Center.x - Size / 1.3f, Center.y };
+		Offsets[1] = { Center.x, Center.y - Size / 2 };
+		Offsets[2] = { Center.x, Center.y + Size / 2 };
 
-		Drawlist->AddConcavePolyFilled(Offsets.data(), 3, ImColor(1.0f, 1.0f, 1.0f));
+		Drawlist->AddConcavePolyFilled(Offsets, 3, ImColor(1.0f, 1.0f, 1.0f));
 
 	};
 
@@ -501,25 +1502,121 @@ void MusicPlayer_t::DrawPrevButton() {
 	Arrow(ImVec2(RightCenter.x, RightCenter.y), ButtonAnim * 25.0f, DrawList);
 }
 
-void MusicPlayer_t::DrawFreqResponse() {
+void MusicPlayer_t::UpdateLinearBars(const PlayerState_t& State, float DeltaTime) {
+
+	// Predefined ranges and multipliers
+	struct Range_t {
+		int Start;
+		int End;
+		int Multiplier;
+	};
+	static constexpr Range_t VisualData[LinearBarCount] = {
+		{ 0, 8, 31 },
+		{ 8, 10, 31 },
+		{ 16, 30, 25 },
+		{ 75, 300, 18 },
+		{ 300, 450, 15 },
+		{ 500, 600, 12 },
+		{ 650, 1024, 8 },
+	};
+
+	float Out[LinearBarCount] = {};
+
+	// Make sure to only query, when music is running
+	if (State.IsPlaying) {
+		// Get music data, only needed for this frame
+		float* MusicData = FrameArena.Allocate<float>(2048);
+		if (BASS_ChannelGetData(State.Stream, MusicData, BASS_DATA_FFT2048) != static_cast<DWORD>(-1)) {
+			// Compress it into 7 bars
+			for (int Index = 0; Index < LinearBarCount; Index++) {
+				const Range_t& Range = VisualData[Index];
+				float Average = 0.0f;
+				for (int i = Range.Start; i < Range.End; i++)
+					Average += MusicData[i];
+				Out[Index] = sqrt(Average) * (static_cast<float>(Range.Multiplier) / 100.0f);
+			}
+		}
+	}
+
+	// Smoothing of output
+	for (int i = 0; i < LinearBarCount; i++) {
+		this->LinearBars[i] -= (this->LinearBars[i] - Out[i]) * DeltaTime;
+	}
+}
+
+void MusicPlayer_t::DrawFreqResponse(const PlayerState_t& State) {
 
 	ImGuiIO* io = &ImGui::GetIO();
-	
-	// Deltatime for smoothing
-	const std::vector<float>& Data = this->CurrentTrack->GetFFT(io->DeltaTime * 16.0f);
+	this->PollBeats();
 	
 	ImDrawList* DrawList = ImGui::GetWindowDrawList();
 	const ImVec2 Min = ImGui::GetWindowPos();
 	const ImVec2 Max = { Min.x + ImGui::GetWindowWidth(), Min.y + ImGui::GetWindowHeight() };
+
+	// Clicking the visualizer switches between the analyzer modes
+	ImVec2 MousePos = ImGui::GetMousePos();
+	if (MousePos.x > Min.x && MousePos.x < Max.x && MousePos.y > Min.y && MousePos.y < Max.y && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+		this->AnalyzerMode = this->AnalyzerMode == Analyzer_t::Mode_t::Linear ? Analyzer_t::Mode_t::ConstantQ : Analyzer_t::Mode_t::Linear;
+	}
+
+	if (this->AnalyzerMode == Analyzer_t::Mode_t::ConstantQ) {
+		const int BandCount = this->Analyzer.GetBandCount();
+
+		float Bands[Analyzer_t::MaxBands];
+		this->Analyzer.GetBands(Bands, BandCount);
+
+		// Same smoothing as the linear bars
+		for (int i = 0; i < BandCount; i++)
+			this->AnalyzerBands[i] -= (this->AnalyzerBands[i] - Bands[i]) * std::clamp(io->DeltaTime * 16.0f, 0.0f, 1.0f);
+
+		float Width = Max.x - Min.x;
+		float Height = Max.y - Min.y;
+		float Padding = 1.0f;
+		float BarWidth = Width / BandCount - Padding + Padding / BandCount;
+
+		// Animate until the bars have settled
+		for (int i = 0; i < BandCount; i++) {
+			if (this->AnalyzerBands[i] > 0.001f || Bands[i] > 0.001f) {
+				FrameScheduler.RequestAnimationFrame();
+				break;
+			}
+		}
+
+		const float Pulse = 1.0f + this->GetBeatPulse() * 0.2f;
+		for (int i = 0; i < BandCount; i++) {
+			float BarHeight = std::clamp(this->AnalyzerBands[i] * Height * Pulse, BarWidth, Height);
+
+			float XStart = Min.x + i * (BarWidth + Padding);
+			float YCenter = Max.y - Height / 2.0f;
+
+			DrawList->AddRectFilled(ImVec2(XStart, YCenter - BarHeight / 2.0f), ImVec2(XStart + BarWidth, YCenter + BarHeight / 2.0f), ImColor(1.0f, 1.0f, 1.0f), BarWidth);
+		}
+		return;
+	}
+
+	if (State.CurrentTrack == PlayerState_t::NoTrack)
+		return;
+
+	// Deltatime for smoothing, clamped since frames can be far apart when idle
+	this->UpdateLinearBars(State, std::min(io->DeltaTime * 16.0f, 1.0f));
+	const float* Data = this->LinearBars;
+
+	for (float Value : this->LinearBars) {
+		if (Value > 0.001f) {
+			FrameScheduler.RequestAnimationFrame();
+			break;
+		}
+	}
 	
 	float Width = Max.x - Min.x;
 	float Height = Max.y - Min.y;
 	float Padding = 5.0f;
-	float BarWidth = Width / Data.size() - Padding + Padding / Data.size();
+	float BarWidth = Width / LinearBarCount - Padding + Padding / LinearBarCount;
 	
-	for (size_t i = 0; i < Data.size(); i++) {
+	const float Pulse = 1.0f + this->GetBeatPulse() * 0.2f;
+	for (int i = 0; i < LinearBarCount; i++) {
 	
-		float ModData = pow(Data[i], 0.7f) * 45.0f;
+		float ModData = pow(Data[i], 0.7f) * 45.0f * Pulse;
 	
 		float XStart = Min.x + i * (BarWidth + Padding);
 		float XEnd = XStart + BarWidth;
@@ -533,65 +1630,105 @@ void MusicPlayer_t::DrawFreqResponse() {
 	}
 }
 
-void MusicPlayer_t::DrawPlayButton() {
+void MusicPlayer_t::DrawPlayButton(const PlayerState_t& State) {
 	
 	ImDrawList* DrawList = ImGui::GetWindowDrawList();
 	const ImVec2 Min = ImGui::GetWindowPos();
 	const ImVec2 Max = { Min.x + ImGui::GetWindowWidth(), Min.y + ImGui::GetWindowHeight() };
 	
-	bool IsMusicPlaying = this->CurrentTrack->GetActivity() == 1;
+	bool IsMusicPlaying = State.IsPlaying;
 	
-	static std::chrono::steady_clock::time_point PlayStateChange;
+	static double PlayStateChange = 0.0;
 	static bool OldShowPlayButton = false;
 	if (OldShowPlayButton != IsMusicPlaying) {
-		PlayStateChange = std::chrono::high_resolution_clock::now();
+		PlayStateChange = ImGui::GetTime();
 		OldShowPlayButton = IsMusicPlaying;
 	}
 	
 	float ButtonAnim = 0.0f;
-	float TimeDiff = static_cast<float>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - PlayStateChange).count()) / 150.0f;
+	float TimeDiff = static_cast<float>((ImGui::GetTime() - PlayStateChange) / 0.15);
 	
 	if (IsMusicPlaying) {
 		ButtonAnim = std::clamp(1.0f - TimeDiff, 0.0f, 1.0f);
 	} else {
 		ButtonAnim = std::clamp(TimeDiff, 0.0f, 1.0f);
 	}
+
+	if (TimeDiff < 1.0f)
+		FrameScheduler.RequestAnimationFrame();
 	
 	const ImVec2 Center = ImVec2(Max.x - (Max.x - Min.x) / 2.0f, Max.y - (Max.y - Min.y) / 2.0f);
 	
 	if (ButtonAnim > 0.5f) {
 		float PlayButtonScale = std::clamp((ButtonAnim - 0.5f) * 2.0f, 0.0f, 1.0f);
-		const std::vector<ImVec2> PlayButton = {
-			ImVec2(Center.x - 15.0f * PlayButtonScale, Center.y - 15.0f * PlayButtonScale),
-			ImVec2(Center.x + 15.0f * PlayButtonScale, Center.y),
-			ImVec2(Center.x - 15.0f * PlayButtonScale, Center.y + 15.0f * PlayButtonScale)
-		};
-		DrawList->AddConvexPolyFilled(PlayButton.data(), 3, ImColor(1.0f, 1.0f, 1.0f));
+		ImVec2* PlayButton = FrameArena.Allocate<ImVec2>(3);
+		PlayButton[0] = ImVec2(Center.x - 15.0f * PlayButtonScale, Center.y - 15.0f * PlayButtonScale);
+		PlayButton[1] = ImVec2(Center.x + 15.0f * PlayButtonScale, Center.y);
+		PlayButton[2] = ImVec2(Center.x - 15.0f * PlayButtonScale, Center.y + 15.0f * PlayButtonScale);
+		DrawList->AddConvexPolyFilled(PlayButton, 3, ImColor(1.0f, 1.0f, 1.0f));
 	} else {
 		float PauseButtonScale = std::clamp((0.5f - ButtonAnim) * 2.0f, 0.0f, 1.0f);
-		const std::vector<ImVec2> PauseButtonL = {
-			ImVec2(Center.x - 10.0f * PauseButtonScale, Center.y + 15.0f * PauseButtonScale),
-			ImVec2(Center.x - 5.0f * PauseButtonScale, Center.y + 15.0f * PauseButtonScale),
-			ImVec2(Center.x - 5.0f * PauseButtonScale, Center.y - 15.0f * PauseButtonScale),
-			ImVec2(Center.x - 10.0f * PauseButtonScale, Center.y - 15.0f * PauseButtonScale),
-		};
-		const std::vector<ImVec2> PauseButtonR = {
-			ImVec2(Center.x + 11.0f * PauseButtonScale, Center.y + 15.0f * PauseButtonScale),
-			ImVec2(Center.x + 5.0f * PauseButtonScale, Center.y + 15.0f * PauseButtonScale),
-			ImVec2(Center.x + 5.0f * PauseButtonScale, Center.y - 16.0f * PauseButtonScale),
-			ImVec2(Center.x + 11.0f * PauseButtonScale, Center.y - 16.0f * PauseButtonScale),
-		};
+		ImVec2* PauseButtonL = FrameArena.Allocate<ImVec2>(4);
+		PauseButtonL[0] = ImVec2(Center.x - 10.0f * PauseButtonScale, Center.y + 15.0f * PauseButtonScale);
+		PauseButtonL[1] = ImVec2(Center.x - 5.0f * PauseButtonScale, Center.y + 15.0f * PauseButtonScale);
+		PauseButtonL[2] = ImVec2(Center.x - 5.0f * PauseButtonScale, Center.y - 15.0f * PauseButtonScale);
+		PauseButtonL[3] = ImVec2(Center.x - 10.0f * PauseButtonScale, Center.y - 15.0f * PauseButtonScale);
+
+		ImVec2* PauseButtonR = FrameArena.Allocate<ImVec2>(4);
+		PauseButtonR[0] = ImVec2(Center.x + 11.0f * PauseButtonScale, Center.y + 15.0f * PauseButtonScale);
+		PauseButtonR[1] = ImVec2(Center.x + 5.0f * PauseButtonScale, Center.y + 15.0f * PauseButtonScale);
+		PauseButtonR[2] = ImVec2(Center.x + 5.0f * PauseButtonScale, Center.y - 16.0f * PauseButtonScale);
+		PauseButtonR[3] = ImVec2(Center.x + 11.0f * PauseButtonScale, Center.y - 16.0f * PauseButtonScale);
 	
-		DrawList->AddConvexPolyFilled(PauseButtonL.data(), 4, ImColor(1.0f, 1.0f, 1.0f));
-		DrawList->AddConvexPolyFilled(PauseButtonR.data(), 4, ImColor(1.0f, 1.0f, 1.0f));
+		DrawList->AddConvexPolyFilled(PauseButtonL, 4, ImColor(1.0f, 1.0f, 1.0f));
+		DrawList->AddConvexPolyFilled(PauseButtonR, 4, ImColor(1.0f, 1.0f, 1.0f));
 	}
 	
 	ImVec2 MousePos = ImGui::GetMousePos();
-	if (MousePos.x > Min.x && MousePos.x < Max.x && MousePos.y > Min.y && MousePos.y < Max.y && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
-		if (this->CurrentTrack->GetActivity() == 1) {
-			this->CurrentTrack->Pause();
-		} else {
-			this->CurrentTrack->Play();
+	if (MousePos.x > Min.x && MousePos.x < Max.x && MousePos.y > Min.y && MousePos.y < Max.y && ImGui::IsMouseClicked(ImGuiMouseButton_Left) && State.CurrentTrack != PlayerState_t::NoTrack) {
+		this->Post({ CommandType_t::TogglePause });
+	}
+}
+
+void MusicPlayer_t::DrawLevelMeter() {
+
+	this->MeterDisplay.Update(this->LevelMeter.GetLevels(), ImGui::GetIO().DeltaTime);
+
+	for (int c = 0; c < LevelMeter_t::MaxChannels; c++) {
+		if (this->MeterDisplay.PeakHold[c] > -70.0f || this->MeterDisplay.Rms[c] > -70.0f) {
+			FrameScheduler.RequestAnimationFrame();
+			break;
 		}
 	}
-}
\ No newline at end of file
+
+	ImDrawList* DrawList = ImGui::GetWindowDrawList();
+	const ImVec2 Min = ImGui::GetWindowPos();
+	const ImVec2 Max = { Min.x + ImGui::GetWindowWidth(), Min.y + ImGui::GetWindowHeight() };
+
+	// Short-term loudness readout, drawn smaller than the current font to fit the strip
+	const char* Loudness = FrameArena.Format("%.1f LUFS", this->MeterDisplay.ShortTerm);
+	const float FontSize = Max.y - Min.y;
+	const ImVec2 TextSize = ImGui::GetFont()->CalcTextSizeA(FontSize, FLT_MAX, 0.0f, "-70.0 LUFS");
+	DrawList->AddText(ImGui::GetFont(), FontSize, ImVec2(Max.x - TextSize.x, Min.y + (Max.y - Min.y) / 2.0f - TextSize.y / 2.0f), ImColor(1.0f, 1.0f, 1.0f, 0.6f), Loudness);
+
+	// -60 dBFS on the left to 0 dBFS on the right
+	auto Scale = [](float Decibel) {
+		return std::clamp((Decibel + 60.0f) / 60.0f, 0.0f, 1.0f);
+	};
+
+	const float BarHeight = 3.0f;
+	const float BarEnd = Max.x - TextSize.x - 10.0f;
+	const float BarWidth = BarEnd - Min.x;
+	for (int c = 0; c < LevelMeter_t::MaxChannels; c++) {
+		const float Y = Min.y + (Max.y - Min.y) / 2.0f + (c == 0 ? -BarHeight - 1.0f : 1.0f);
+
+		DrawList->AddRectFilled(ImVec2(Min.x, Y), ImVec2(BarEnd, Y + BarHeight), ImColor(0.1f, 0.1f, 0.1f), BarHeight);
+		DrawList->AddRectFilled(ImVec2(Min.x, Y), ImVec2(Min.x + BarWidth * Scale(this->MeterDisplay.Peak[c]), Y + BarHeight), ImColor(1.0f, 1.0f, 1.0f, 0.35f), BarHeight);
+		DrawList->AddRectFilled(ImVec2(Min.x, Y), ImVec2(Min.x + BarWidth * Scale(this->MeterDisplay.Rms[c]), Y + BarHeight), ImColor(1.0f, 1.0f, 1.0f), BarHeight);
+
+		// Peak hold marker, red once the true peak goes over 0 dBTP
+		const float HoldX = Min.x + BarWidth * Scale(this->MeterDisplay.PeakHold[c]);
+		const ImColor HoldColor = this->MeterDisplay.PeakHold[c] >= 0.0f ? ImColor(1.0f, 0.0f, 0.0f) : ImColor(1.0f, 1.0f, 1.0f);
+		DrawList->AddRectFilled(ImVec2(HoldX - 1.0f, Y), ImVec2(HoldX + 1.0f, Y + BarHeight), HoldColor);
+	}
+}
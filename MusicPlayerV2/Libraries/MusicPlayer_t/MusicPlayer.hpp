@@ -1,82 +1,390 @@
 #ifndef MUSICPLAYER_HPP
 #define MUSICPLAYER_HPP
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <filesystem>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <bass/bass.h>
 #pragma comment(lib, "bass.lib")
 
+#include "../LevelMeter/LevelMeter.hpp"
+#include "../Analyzer/Analyzer.hpp"
+#include "../PlaybackClock/PlaybackClock.hpp"
+#include "../PlayerState/PlayerState.hpp"
+#include "../Pool/Pool.hpp"
+#include "../TimerWheel/TimerWheel.hpp"
+#include "../SeekTable/SeekTable.hpp"
+#include "../Scrubber/Scrubber.hpp"
+#include "../MappedFile/MappedFile.hpp"
+#include "../AudioHash/AudioHash.hpp"
+#include "../PlayQueue/PlayQueue.hpp"
+#include "../Shuffle/Shuffle.hpp"
+#include "../PlayStats/PlayStats.hpp"
+#include "../SmartPlaylist/SmartPlaylist.hpp"
+
 class MusicPlayer_t {
 public:
+	enum class CommandType_t {
+		TogglePause,
+		Next,
+		Previous,
+		Select,		// Track holds the library id
+		Play,
+		Pause,
+		SetVolume,	// Value from 0 to 100
+		Enqueue,	// Track plays after the current one and whatever was enqueued before it
+		PlayNext,	// Track plays right after the current one, ahead of the queue
+		Unqueue,	// Takes Entry out of the queue, without one the first queued entry of Track
+		MoveQueued,	// Entry goes right after After, without one it goes first
+		ClearQueue,
+		SetShuffle,	// Value holds the Shuffle_t::Mode_t
+		Sleep,		// Fade out and pause in Seconds, 0 cancels
+		Wake,		// Start playing in Seconds, 0 cancels
+		Seek,		// Current track to Seconds
+		BeginScrub,	// Silence the current track while the scrubber plays grains
+		EndScrub,
+		UpdatePlaylists,	// Wakes the engine to pick up SetPlaylist()
+		TrackEnding,	// Posted by BASS once Track reaches its crossfade point
+	};
+
+	struct Command_t {
+		CommandType_t Type;
+		uint32_t Track = PlayerState_t::NoTrack;
+		float Seconds = 0.0f;
+		float Value = 0.0f;
+		Handle_t Entry = {};	// From PlayerState_t::QueueEntries
+		Handle_t After = {};
+	};
 
+private:
+	// One playing (or fading) file, recycled through the voice pool
 	struct Track_t {
 	private:
 		HMUSIC Stream = NULL;
 
-		float OldVolume = 0.0f;
-		float InternalVolume = 0.0f;
-		float TargetVolume = 0.0f;
+		// Where the volume is headed, BASS slides it there on its own
+		float Volume = 0.0f;
 
-		float FadeLength = 0.0f;
-		std::chrono::steady_clock::time_point StartFade;
+		// Fed from the stream's own DSP callback, so position queries never reach BASS
+		std::shared_ptr<PlaybackClock_t> Clock = std::make_shared<PlaybackClock_t>();
+		HDSP ClockHandle = 0;
+		DWORD BytesPerFrame = 0;
+		double Duration = 0.0;
 
-		std::vector<float> FFT = {};
+		// After a seek the stream starts somewhere inside the file, the track sample its first byte stands for
+		std::shared_ptr<const SeekTable_t> SeekTable;
+		std::atomic<int64_t> SampleBase = 0;
+
+		using MappingReference_t = std::shared_ptr<const MappedFile_t>;
+		HSTREAM OpenStream(uint64_t Offset);
+		static void CALLBACK OnStreamFreed(HSYNC Handle, DWORD Channel, DWORD Data, void* User);
+
+		static void CALLBACK ClockDSP(HDSP Handle, DWORD Channel, void* Buffer, DWORD Length, void* User);
 	public:
-		bool IsFading = false;
-		std::filesystem::directory_entry Path = std::filesystem::directory_entry("NULL");
+		HSYNC CrossfadeSync = 0;
+		Handle_t ReleaseTimer;
+
+		// Library entry, kept alive by holding on to the library it came from
+		const LibraryTrack_t* Entry = nullptr;
+		std::shared_ptr<const Library_t> EntryLibrary;
+
+		// Streams decode from the mapped file, each keeps its own reference until BASS frees it
+		std::shared_ptr<const MappedFile_t> Mapping;
 
-		bool Init(const std::filesystem::directory_entry& Path, float Volume);
+		bool Init(const std::shared_ptr<const Library_t>& Library, const LibraryTrack_t* Entry, float Volume);
 		
 		bool Play();
 		bool Pause();
 
+		// Sample accurate when the file's seek table is cached, otherwise wherever BASS lands
+		bool Seek(double Seconds);
+
 		bool SetVolume(float Volume);
+		float GetVolume() const;
 
 		bool Free();
 
+		// Ramps down to silence and lets BASS free the stream once it stopped, the voice is free right away
+		void Retire(float Seconds);
+
+		// Both start from the current volume, so a fade can take over from another without a jump
 		void FadeIn(float Seconds, float Volume);
 		void FadeOut(float Seconds);
+		bool IsFading() const;
+
+		int GetActivity() const;
+		HSTREAM GetStream() const;
+
+		double GetDuration() const;
+		double GetCurrentPosition() const;
+		// Straight from BASS, exact but not for the UI thread
+		double GetStreamPosition() const;
+		// Byte position in the current stream of a point in the track, -1 if the stream starts past it
+		int64_t GetStreamBytes(double Seconds) const;
+		const std::shared_ptr<PlaybackClock_t>& GetClock() const;
+	};
+
+	// Engine side, only touched by whoever runs Update()
+
+	// Voices fade out over this long when skipped, short enough that mashing Next rarely hits the limit
+	static constexpr float SkipFade = 0.25f; // Seconds
+	// Ramp of a voice that is stolen, just long enough not to click
+	static constexpr float StealFade = 0.02f; // Seconds
+	// Overlap of the streams before and after a seek
+	static constexpr float SeekFade = 0.01f; // Seconds
+	// The next track starts at least this long before the end, a sync right at the end of a stream may never fire
+	static constexpr float JoinLead = 0.01f; // Seconds
+	static constexpr size_t MaxVoices = 16;
 
-		void Copy(Track_t* Track);
+	HandlePool_t<Track_t, MaxVoices> Voices;
+	Handle_t CurrentVoice;
+	uint32_t LastFadingTrack = PlayerState_t::NoTrack;
 
-		int GetActivity();
+	// Next and Previous only pick a target, its stream opens once the skipping settles
+	// or the burst of skips went on for too long
+	static constexpr float SkipSettle = 0.15f; // Seconds
+	static constexpr float SkipDeadline = 0.5f; // Seconds
+	uint32_t PendingTrack = PlayerState_t::NoTrack;
+	uint64_t FirstSkip = 0;
 
-		double GetDuration();
-		double GetCurrentPosition();
+	static std::atomic<uint64_t> StreamsOpened;
 
-		void Update();
+	std::shared_ptr<const Library_t> Library;
 
-		std::vector<float> GetFFT(float DeltaTime);
+	Track_t* GetCurrentTrack();
+	uint32_t GetTargetTrack();
+	uint32_t GetNextTrack(uint32_t Id) const;
+	uint32_t GetPrevTrack(uint32_t Id) const;
+
+	void StartTrack(uint32_t Id, float FadeIn, float Volume);
+	void FadeOutVoice(Handle_t Voice, float Seconds);
+	// Counts the track as skipped unless it's finished
+	void FadeOutCurrent(float Seconds, bool IsFinished = false);
+	void ArmCrossfade(Track_t* Track);
+	void SkipTo(uint32_t Id);
+	void StartPending();
+	void ReleaseVoice(Handle_t Voice);
+	bool StealVoice();
+	void Execute(const Command_t& Command);
+	void PublishState();
+
+	// Everything time based on the engine side runs off this, in milliseconds since startup
+	TimerWheel_t Timers;
+	const std::chrono::steady_clock::time_point TimerEpoch = std::chrono::steady_clock::now();
+	uint64_t TickOffset = 0;	// Time rendered offline ahead of the wall clock
+	uint64_t GetTick(float SecondsFromNow = 0.0f) const;
+
+	// Offline rendering swaps the wall clock for the frames pulled from the output so far
+	bool IsOffline = false;
+	uint64_t OfflineStart = 0;
+	uint64_t OfflineFrames = 0;
+	uint32_t OfflineRate = 0;
+
+	// Enqueued tracks, ahead of the library order, and the tracks skipped or played to the end
+	PlayQueue_t Queue;
+	uint32_t TakeNextTrack(uint32_t Id);
+	uint32_t TakePrevTrack(uint32_t Id);
+	static uint32_t ResolveQueued(void* User, std::string_view File);
+
+	// Takes over from the library order once the queue runs dry
+	Shuffle_t Shuffle;
+	void SyncShuffle();
+
+	// Weighs the shuffle, written out and compacted on its own thread
+	PlayStats_t Stats;
+
+	// Matched against the library and the stats above, which are kept mirrored in library order
+	SmartPlaylists_t Playlists = SmartPlaylists_t(&this->Stats);
+	static int64_t GetUnixTime();
+
+	Handle_t SettleTimer;
+	Handle_t SleepTimer;
+	Handle_t WakeTimer;
+
+	static void OnVoiceFaded(void* User, uint64_t Voice);
+	static void OnSettled(void* User, uint64_t);
+	static void OnSleep(void* User, uint64_t);
+	static void OnSleepFaded(void* User, uint64_t);
+	static void OnWake(void* User, uint64_t);
+	static void OnRescan(void* User, uint64_t);
+
+	static void CALLBACK OnCrossfadePoint(HSYNC Handle, DWORD Channel, DWORD Data, void* User);
+
+	// Commands from any thread, drained by Update()
+	std::mutex CommandLock;
+	std::condition_variable CommandSignal;
+	std::vector<Command_t> PendingCommands;
+	std::vector<Command_t> Commands;
+
+	// Published states are recycled through here instead of the heap
+	BlockPool_t StateBlocks = BlockPool_t(512, 8);
+	// Same for file mappings and the references streams keep on them
+	BlockPool_t MappingBlocks = BlockPool_t(128, 2 * MaxVoices);
+	std::atomic<std::shared_ptr<const PlayerState_t>> State;
+
+	struct StateListener_t {
+		void (*Callback)(void* User) = nullptr;
+		void* User = nullptr;
 	};
+	static constexpr int MaxStateListeners = 4;
+	StateListener_t StateListeners[MaxStateListeners];
+
+	std::atomic<bool> IsEngineRunning = false;
+	std::thread EngineThread;
+	void EngineMain();
 
-	// Internal music folder path
+	// Folder scanning, owned by the scanner thread (or whoever calls RescanLibrary())
 	std::filesystem::directory_entry MusicFolder;
-	std::vector<std::filesystem::directory_entry> MusicTracks = {};
+	std::unordered_map<std::string, uint32_t> TrackIds;
+	uint32_t NextTrackId = 1;
+	std::shared_ptr<const Library_t> ScannedLibrary = std::make_shared<Library_t>();
+
+	// Handed from the scanner to the engine
+	std::mutex LibraryLock;
+	std::shared_ptr<const Library_t> PendingLibrary;
+	// Name and rule, from SetPlaylist()
+	std::vector<std::pair<std::string, std::string>> PendingPlaylists;
 
-	std::filesystem::directory_entry GetNextTrack();
-	std::filesystem::directory_entry GetPrevTrack();
+	// Requested by the engine's rescan timer, the listing itself runs on the scanner thread
+	std::mutex ScanLock;
+	std::condition_variable ScanSignal;
+	bool IsScanRequested = false;
+
+	// Files whose seek table the scanner already made sure of
+	std::unordered_set<uint32_t> SeekTablesCached;
+	// Reads the tags of tracks that have none yet and hands the library over again, false if there were none to read
+	bool TagLibrary();
+
+	std::thread ScannerThread;
+	void ScannerMain();
+
+	// Final device mix, used to tap the output for metering and analysis
+	HSTREAM OutputStream = NULL;
+	bool OpenOutput(int Device);
+	void CloseOutput();
+	static void CALLBACK OutputDSP(HDSP Handle, DWORD Channel, void* Buffer, DWORD Length, void* User);
+
+	// UI side smoothing of the linear visualizer
+	static constexpr int LinearBarCount = 7;
+	float LinearBars[LinearBarCount] = {};
+	void UpdateLinearBars(const PlayerState_t& State, float DeltaTime);
+
+	// UI side, where the duration bar is being dragged to
+	bool IsDraggingSeek = false;
+	double SeekPreview = 0.0;
+
+	void PollBeats();
 
 public:
 
 	float TrackFade = 5.0f; // Seconds
-
 	float Volume = 100.0f;
-	Track_t* OldTrack = nullptr;
-	Track_t* CurrentTrack = nullptr;
+
+	// Tracks that may sound at once, up to MaxVoices. Starting one more steals the quietest fading voice
+	size_t VoiceLimit = 8;
+
+	LevelMeter_t LevelMeter;
+	LevelMeter_t::Display_t MeterDisplay;
+
+	Analyzer_t Analyzer;
+
+	// Plays grains at the cursor while the duration bar is dragged
+	Scrubber_t Scrubber;
+	Analyzer_t::Mode_t AnalyzerMode = Analyzer_t::Mode_t::ConstantQ;
+	float AnalyzerBands[Analyzer_t::MaxBands] = {};
+
+	// Most recent beats reported by the analyzer, polled by the UI
+	BeatDetector_t::Beat_t LastBeat;
+	BeatDetector_t::Beat_t LastDownbeat;
+
+	// 1.0 right on a confident beat, decays towards 0.0 until the next one
+	float GetBeatPulse();
 
 	MusicPlayer_t();
+	~MusicPlayer_t();
+
+	// Runs Update() and folder rescans on their own threads until Stop().
+	// Without it, the host has to call Update() and RescanLibrary() itself
+	void Start();
+	void Stop();
 
+	// One engine step: picks up a rescanned library, fires due timers, runs queued commands and publishes the state
 	void Update();
 
-	void DrawDuration();
-	void DrawNextButton();
-	void DrawPrevButton();
+	// Reads the music folder, the engine switches over on its next Update() if anything changed
+	bool RescanLibrary();
+
+	// Thread-safe, executed on the next Update()
+	void Post(const Command_t& Command);
+
+	// Posted once the render reaches Seconds, at the start of the 10 ms block that holds it
+	struct RenderEvent_t {
+		double Seconds = 0.0;
+		Command_t Command;
+	};
+
+	struct RenderJob_t {
+		std::filesystem::path File;		// Float WAV, or headerless .raw, none if empty
+		double Seconds = 0.0;
+		uint32_t FirstTrack = PlayerState_t::NoTrack;
+		std::vector<RenderEvent_t> Events;	// In order of time
+		float TrackFade = -1.0f;			// Crossfade length for the render, negative keeps the current one
+		AudioHash_t* Hash = nullptr;		// Reset to 100 ms blocks and fed the whole render when set
+	};
+
+	struct RenderStats_t {
+		uint64_t Frames = 0;
+		uint32_t SampleRate = 0;
+		uint64_t StreamsOpened = 0;
+		double WallSeconds = 0.0;
+	};
+
+	// Plays the library from the job's first track for its length as fast as it decodes.
+	// The engine runs on a virtual clock and BASS on its "no sound" device meanwhile, so the engine thread must not be running
+	bool RenderOffline(const RenderJob_t& Job, RenderStats_t* Stats);
+
+	// Restores the queue from its journal and keeps it there, only before Start().
+	// Entries whose file isn't in the library anymore are dropped
+	bool OpenQueue(const std::filesystem::path& Journal);
+
+	// Loads the play statistics kept in Folder and records every track played from then on, only before Start()
+	bool OpenStats(const std::filesystem::path& Folder);
+
+	// Loads the smart playlists saved in File and saves every change there, only before Start()
+	bool OpenPlaylists(const std::filesystem::path& File);
+	// Thread-safe, an empty rule removes the playlist. False with the reason in Error if the rule doesn't parse
+	bool SetPlaylist(std::string_view Name, std::string_view Rule, std::string* Error);
+
+	// Points the library at another folder and rescans it, not while the scanner thread runs
+	void SetMusicFolder(const std::filesystem::path& Folder);
+	std::filesystem::path GetMusicFolder() const;
+
+	// Latest published state, never null
+	std::shared_ptr<const PlayerState_t> GetState() const;
+
+	// Called on the engine thread right after every new state is published, keep it short.
+	// Only before Start(), false once all slots are taken
+	bool AddStateListener(void (*Callback)(void* User), void* User);
+
+	// Files opened for playback since startup
+	uint64_t GetStreamsOpened() const;
+
+	void DrawDuration(const PlayerState_t& State);
+	void DrawNextButton(const PlayerState_t& State);
+	void DrawPrevButton(const PlayerState_t& State);
 
-	void DrawFreqResponse();
-	void DrawPlayButton();
+	void DrawFreqResponse(const PlayerState_t& State);
+	void DrawPlayButton(const PlayerState_t& State);
+	void DrawLevelMeter();
 
 } extern MusicPlayer;
 
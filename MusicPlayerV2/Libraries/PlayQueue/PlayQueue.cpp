@@ -0,0 +1,315 @@
+#include "PlayQueue.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+PlayQueue_t::~PlayQueue_t() {
+	this->Close();
+}
+
+PlayQueue_t::Entry_t* PlayQueue_t::Get(Handle_t Handle) {
+	if (Handle.Index >= this->Entries.size())
+		return nullptr;
+
+	Entry_t& Entry = this->Entries[Handle.Index];
+	return Entry.IsUsed && Entry.Generation == Handle.Generation ? &Entry : nullptr;
+}
+
+const PlayQueue_t::Entry_t* PlayQueue_t::Get(Handle_t Handle) const {
+	return const_cast<PlayQueue_t*>(this)->Get(Handle);
+}
+
+Handle_t PlayQueue_t::Allocate(uint32_t Track, std::string_view File, uint64_t Key) {
+	if (this->FreeEntries.empty()) {
+		this->FreeEntries.push_back(static_cast<uint32_t>(this->Entries.size()));
+		this->Entries.emplace_back();
+	}
+
+	const uint32_t Index = this->FreeEntries.back();
+	this->FreeEntries.pop_back();
+
+	Entry_t& Entry = this->Entries[Index];
+	Entry.IsUsed = true;
+	Entry.Track = Track;
+	Entry.Key = Key;
+	Entry.File.assign(File);
+	this->NextKey = std::max(this->NextKey, Key + 1);
+	return { Index, Entry.Generation };
+}
+
+void PlayQueue_t::Release(Handle_t Handle) {
+	Entry_t& Entry = this->Entries[Handle.Index];
+	Entry.IsUsed = false;
+	Entry.Generation++;
+	Entry.File.clear();
+	this->FreeEntries.push_back(Handle.Index);
+}
+
+void PlayQueue_t::LinkAfter(Handle_t Handle, Handle_t After) {
+	Entry_t* Entry = this->Get(Handle);
+	Entry_t* Prev = this->Get(After);
+	const Handle_t Next = Prev ? Prev->Next : this->Front;
+
+	Entry->Prev = Prev ? After : Handle_t();
+	Entry->Next = Next;
+	if (Prev)
+		Prev->Next = Handle;
+	else
+		this->Front = Handle;
+	if (Entry_t* NextEntry = this->Get(Next))
+		NextEntry->Prev = Handle;
+	else
+		this->Back = Handle;
+	this->Size++;
+}
+
+void PlayQueue_t::Unlink(Handle_t Handle) {
+	Entry_t* Entry = this->Get(Handle);
+	if (Entry_t* Prev = this->Get(Entry->Prev))
+		Prev->Next = Entry->Next;
+	else
+		this->Front = Entry->Next;
+	if (Entry_t* Next = this->Get(Entry->Next))
+		Next->Prev = Entry->Prev;
+	else
+		this->Back = Entry->Prev;
+	Entry->Prev = Entry->Next = {};
+	this->Size--;
+}
+
+// One line per edit: type, key, the key it moved behind (0 for none) and the file of new entries
+void PlayQueue_t::Append(char Type, uint64_t Key, uint64_t Other, std::string_view File) {
+	if (!this->Journal.is_open())
+		return;
+
+	char Fields[64];
+	snprintf(Fields, sizeof(Fields), "%c %llu %llu ", Type, static_cast<unsigned long long>(Key), static_cast<unsigned long long>(Other));
+	this->Record.assign(Fields);
+	this->Record.append(File);
+	this->Record.push_back('\n');
+
+	// Written in one go, a crash can only cut off the end of the last line
+	this->Journal.write(this->Record.data(), static_cast<std::streamsize>(this->Record.size()));
+	this->Journal.flush();
+	this->Records++;
+
+	if (this->Records > 1024 && this->Records > this->Size * 4)
+		this->Compact();
+}
+
+bool PlayQueue_t::Compact() {
+	std::filesystem::path Temporary = this->JournalPath;
+	Temporary += ".tmp";
+	{
+		std::ofstream Stream(Temporary, std::ios::binary | std::ios::trunc);
+		char Fields[64];
+		for (Handle_t Handle = this->Front; const Entry_t* Entry = this->Get(Handle); Handle = Entry->Next) {
+			snprintf(Fields, sizeof(Fields), "a %llu 0 ", static_cast<unsigned long long>(Entry->Key));
+			Stream << Fields << Entry->File << '\n';
+		}
+		Stream.flush();
+		if (!Stream) {
+			printf("Failed to write %s\n", Temporary.string().c_str());
+			return false;
+		}
+	}
+
+	// Either the old journal or the new one, never half of each
+	this->Journal.close();
+	std::error_code Error;
+	std::filesystem::rename(Temporary, this->JournalPath, Error);
+	if (Error)
+		printf("Failed to replace %s\n", this->JournalPath.string().c_str());
+
+	this->Journal.open(this->JournalPath, std::ios::binary | std::ios::app);
+	this->Records = this->Size;
+	return !Error && this->Journal.is_open();
+}
+
+bool PlayQueue_t::Open(const std::filesystem::path& Path, Resolve_t Resolve, void* User) {
+	this->Close();
+	this->Clear();
+
+	std::error_code Error;
+	std::filesystem::create_directories(Path.parent_path(), Error);
+
+	// Keys of entries that didn't resolve stay unknown, edits to them are skipped
+	std::unordered_map<uint64_t, Handle_t> Keys;
+	std::ifstream Stream(Path, std::ios::binary);
+	std::string Line;
+	while (std::getline(Stream, Line)) {
+		if (Stream.eof())
+			break;
+
+		char Type = 0;
+		unsigned long long Key = 0, Other = 0;
+		int FileStart = 0;
+		if (sscanf(Line.c_str(), "%c %llu %llu %n", &Type, &Key, &Other, &FileStart) < 3 || !FileStart)
+			continue;
+
+		this->NextKey = std::max<uint64_t>(this->NextKey, Key + 1);
+		const auto Found = Keys.find(Key);
+		const Handle_t Handle = Found != Keys.end() ? Found->second : Handle_t();
+		if (Type == 'a' || Type == 'f') {
+			const std::string_view File = std::string_view(Line).substr(FileStart);
+			const uint32_t Track = Resolve(User, File);
+			if (Track == NoTrack || Found != Keys.end())
+				continue;
+
+			const Handle_t Added = this->Allocate(Track, File, Key);
+			this->LinkAfter(Added, Type == 'a' ? this->Back : Handle_t());
+			Keys.emplace(Key, Added);
+		} else if (Type == 'm' && this->Get(Handle)) {
+			const auto After = Keys.find(Other);
+			this->MoveAfter(Handle, After != Keys.end() ? After->second : Handle_t());
+		} else if (Type == 'r' && this->Get(Handle)) {
+			this->Remove(Handle);
+			Keys.erase(Key);
+		} else if (Type == 'c') {
+			this->Clear();
+			Keys.clear();
+		}
+	}
+	Stream.close();
+
+	// Starts from a clean file, which also drops a torn last line and unresolved entries
+	this->JournalPath = Path;
+	if (!this->Compact()) {
+		this->Journal.close();
+		return false;
+	}
+	return true;
+}
+
+void PlayQueue_t::Close() {
+	this->Journal.close();
+	this->Records = 0;
+}
+
+Handle_t PlayQueue_t::PushBack(uint32_t Track, std::string_view File) {
+	const Handle_t Handle = this->Allocate(Track, File, this->NextKey);
+	this->LinkAfter(Handle, this->Back);
+	this->Append('a', this->Get(Handle)->Key, 0, File);
+	return Handle;
+}
+
+Handle_t PlayQueue_t::PushFront(uint32_t Track, std::string_view File) {
+	const Handle_t Handle = this->Allocate(Track, File, this->NextKey);
+	this->LinkAfter(Handle, {});
+	this->Append('f', this->Get(Handle)->Key, 0, File);
+	return Handle;
+}
+
+bool PlayQueue_t::MoveAfter(Handle_t Handle, Handle_t After) {
+	const Entry_t* Entry = this->Get(Handle);
+	const Entry_t* Target = this->Get(After);
+	if (!Entry || Handle == After)
+		return false;
+
+	this->Unlink(Handle);
+	this->LinkAfter(Handle, Target ? After : Handle_t());
+	this->Append('m', Entry->Key, Target ? Target->Key : 0);
+	return true;
+}
+
+bool PlayQueue_t::Remove(Handle_t Handle) {
+	const Entry_t* Entry = this->Get(Handle);
+	if (!Entry)
+		return false;
+
+	const uint64_t Key = Entry->Key;
+	this->Unlink(Handle);
+	this->Release(Handle);
+	this->Append('r', Key, 0);
+	return true;
+}
+
+uint32_t PlayQueue_t::PopFront() {
+	const Entry_t* Entry = this->Get(this->Front);
+	if (!Entry)
+		return NoTrack;
+
+	const uint32_t Track = Entry->Track;
+	this->Remove(this->Front);
+	return Track;
+}
+
+void PlayQueue_t::Clear() {
+	if (this->Size == 0)
+		return;
+
+	for (Handle_t Handle = this->Front; Handle.IsValid();) {
+		const Handle_t Next = this->Get(Handle)->Next;
+		this->Release(Handle);
+		Handle = Next;
+	}
+	this->Front = this->Back = {};
+	this->Size = 0;
+	this->Append('c', 0, 0);
+}
+
+Handle_t PlayQueue_t::GetFront() const {
+	return this->Front;
+}
+
+Handle_t PlayQueue_t::GetNext(Handle_t Handle) const {
+	const Entry_t* Entry = this->Get(Handle);
+	return Entry ? Entry->Next : Handle_t();
+}
+
+uint32_t PlayQueue_t::GetTrack(Handle_t Handle) const {
+	const Entry_t* Entry = this->Get(Handle);
+	return Entry ? Entry->Track : NoTrack;
+}
+
+size_t PlayQueue_t::GetSize() const {
+	return this->Size;
+}
+
+Handle_t PlayQueue_t::Find(uint32_t Track) const {
+	for (Handle_t Handle = this->Front; const Entry_t* Entry = this->Get(Handle); Handle = Entry->Next) {
+		if (Entry->Track == Track)
+			return Handle;
+	}
+	return {};
+}
+
+void PlayQueue_t::PushHistory(uint32_t Track) {
+	if (Track == NoTrack)
+		return;
+
+	this->History[this->HistoryEnd] = Track;
+	this->HistoryEnd = (this->HistoryEnd + 1) % MaxHistory;
+	this->HistorySize = std::min(this->HistorySize + 1, MaxHistory);
+}
+
+uint32_t PlayQueue_t::PopHistory() {
+	if (this->HistorySize == 0)
+		return NoTrack;
+
+	this->HistoryEnd = (this->HistoryEnd + MaxHistory - 1) % MaxHistory;
+	this->HistorySize--;
+	return this->History[this->HistoryEnd];
+}
+
+size_t PlayQueue_t::GetHistorySize() const {
+	return this->HistorySize;
+}
+
+size_t PlayQueue_t::GetRecords() const {
+	return this->Records;
+}
+
+std::filesystem::path PlayQueue_t::GetDefaultPath() {
+#ifdef _WIN32
+	const char* Base = getenv("LOCALAPPDATA");
+	std::filesystem::path Folder = Base ? std::filesystem::path(Base) : std::filesystem::temp_directory_path();
+#else
+	const char* Base = getenv("XDG_DATA_HOME");
+	const char* Home = getenv("HOME");
+	std::filesystem::path Folder = Base ? std::filesystem::path(Base) : std::filesystem::path(Home ? Home : ".") / ".local" / "share";
+#endif
+	return Folder / "MusicPlayerV2" / "Queue.journal";
+}
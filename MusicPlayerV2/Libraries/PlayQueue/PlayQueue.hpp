@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../Pool/Pool.hpp"
+
+// Tracks waiting to play ahead of the library order, plus the ones played before.
+// Entries are linked through a growable slot array, so with a handle every edit is O(1).
+// Every edit is also appended to a journal as one line. Replaying it restores the queue,
+// a torn last line from a crash is skipped, and the journal is rewritten through a
+// temporary file and a rename once it holds mostly dead records.
+// Not thread-safe, owned by the engine thread.
+class PlayQueue_t {
+public:
+	static constexpr uint32_t NoTrack = 0;
+	static constexpr size_t MaxHistory = 256;
+
+	// Maps a file from the journal to a track id, NoTrack drops its entry
+	using Resolve_t = uint32_t (*)(void* User, std::string_view File);
+
+private:
+	struct Entry_t {
+		uint32_t Track = NoTrack;
+		uint32_t Generation = 1;
+		bool IsUsed = false;
+		uint64_t Key = 0;	// Names the entry in the journal, never reused
+		std::string File;
+		Handle_t Prev;
+		Handle_t Next;
+	};
+
+	std::vector<Entry_t> Entries;
+	std::vector<uint32_t> FreeEntries;
+	Handle_t Front;
+	Handle_t Back;
+	size_t Size = 0;
+	uint64_t NextKey = 1;
+
+	// Ring of the last tracks played, newest at HistoryEnd - 1
+	uint32_t History[MaxHistory] = {};
+	size_t HistoryEnd = 0;
+	size_t HistorySize = 0;
+
+	std::filesystem::path JournalPath;
+	std::ofstream Journal;
+	size_t Records = 0;
+	std::string Record;
+
+	Entry_t* Get(Handle_t Handle);
+	const Entry_t* Get(Handle_t Handle) const;
+	Handle_t Allocate(uint32_t Track, std::string_view File, uint64_t Key);
+	void LinkAfter(Handle_t Handle, Handle_t After);
+	void Unlink(Handle_t Handle);
+	void Release(Handle_t Handle);
+
+	void Append(char Type, uint64_t Key, uint64_t Other, std::string_view File = {});
+	bool Compact();
+
+public:
+	~PlayQueue_t();
+
+	// Replays the journal at Path into an empty queue and keeps appending to it from here on
+	bool Open(const std::filesystem::path& Path, Resolve_t Resolve, void* User);
+	void Close();
+
+	// File is what the journal remembers the track by, ids don't survive a restart
+	Handle_t PushBack(uint32_t Track, std::string_view File);
+	Handle_t PushFront(uint32_t Track, std::string_view File);
+	// Invalid After moves it to the front
+	bool MoveAfter(Handle_t Handle, Handle_t After);
+	bool Remove(Handle_t Handle);
+	// NoTrack if the queue is empty
+	uint32_t PopFront();
+	void Clear();
+
+	Handle_t GetFront() const;
+	Handle_t GetNext(Handle_t Handle) const;
+	uint32_t GetTrack(Handle_t Handle) const;
+	size_t GetSize() const;
+	// First entry of the track, O(n)
+	Handle_t Find(uint32_t Track) const;
+
+	// Only kept for the session
+	void PushHistory(uint32_t Track);
+	uint32_t PopHistory();
+	size_t GetHistorySize() const;
+
+	size_t GetRecords() const;
+
+	static std::filesystem::path GetDefaultPath();
+};
@@ -0,0 +1,476 @@
+#include "PlayStats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static void Merge(PlayStats_t::Stats_t* Into, const PlayStats_t::Stats_t& Stats) {
+	Into->Plays += Stats.Plays;
+	Into->Skips += Stats.Skips;
+	Into->LastPlayed = std::max(Into->LastPlayed, Stats.LastPlayed);
+	Into->ListenedMs += Stats.ListenedMs;
+}
+
+bool PlayStats_t::Table_t::Find(uint64_t Key, Stats_t* Stats) const {
+	*Stats = {};
+	bool IsFound = false;
+
+	const uint64_t* Found = std::lower_bound(this->Keys, this->Keys + this->Count, Key);
+	if (Found != this->Keys + this->Count && *Found == Key) {
+		const size_t Index = Found - this->Keys;
+		Stats->Plays = this->Plays[Index];
+		Stats->Skips = this->Skips[Index];
+		Stats->LastPlayed = this->LastPlayed[Index];
+		Stats->ListenedMs = this->ListenedMs[Index];
+		IsFound = true;
+	}
+
+	const auto Logged = this->Recent.find(Key);
+	if (Logged != this->Recent.end()) {
+		Merge(Stats, Logged->second);
+		IsFound = true;
+	}
+	return IsFound;
+}
+
+uint32_t PlayStats_t::Record_t::GetCheck() const {
+	// Mixes every field, and a record of zeros doesn't check out
+	uint64_t Hash = this->Key * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(this->Time);
+	Hash = (Hash ^ (static_cast<uint64_t>(this->ListenedMs) << 32 | static_cast<uint32_t>(this->Event))) * 0xBF58476D1CE4E5B9ull;
+	return static_cast<uint32_t>(Hash >> 32) ^ 0xA5A5A5A5u;
+}
+
+PlayStats_t::~PlayStats_t() {
+	this->Close();
+}
+
+void PlayStats_t::Fold(std::unordered_map<uint64_t, Stats_t>* Recent, const Record_t& Record) {
+	Stats_t Stats;
+	Stats.Plays = Record.Event == Event_t::Finished;
+	Stats.Skips = Record.Event == Event_t::Skipped;
+	Stats.LastPlayed = Record.Time;
+	Stats.ListenedMs = Record.ListenedMs;
+	Merge(&(*Recent)[Record.Key], Stats);
+}
+
+std::shared_ptr<PlayStats_t::Table_t> PlayStats_t::LoadTable(const std::filesystem::path& Path, TableHeader_t* Header) {
+	auto Table = std::make_shared<Table_t>();
+	*Header = {};
+
+	std::error_code Error;
+	if (!std::filesystem::exists(Path, Error))
+		return Table;
+
+	// Lookups jump around, readahead would only pull in columns nobody asked for
+	std::shared_ptr<const MappedFile_t> Mapping = MappedFile_t::Map(Path, false);
+	if (!Mapping)
+		return Table;
+
+	TableHeader_t Read;
+	constexpr size_t RowBytes = 3 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
+	if (Mapping->GetSize() >= sizeof(Read))
+		memcpy(&Read, Mapping->GetData(), sizeof(Read));
+	if (Mapping->GetSize() < sizeof(Read) || Read.Magic != TableMagic || Read.Version != Version || Mapping->GetSize() != sizeof(Read) + Read.Count * RowBytes) {
+		printf("Ignoring broken play stats in %s\n", Path.string().c_str());
+		return Table;
+	}
+
+	const uint8_t* Column = Mapping->GetData() + sizeof(Read);
+	const size_t Count = static_cast<size_t>(Read.Count);
+	Table->Keys = reinterpret_cast<const uint64_t*>(Column);
+	Table->LastPlayed = reinterpret_cast<const int64_t*>(Column += Count * sizeof(uint64_t));
+	Table->ListenedMs = reinterpret_cast<const uint64_t*>(Column += Count * sizeof(int64_t));
+	Table->Plays = reinterpret_cast<const uint32_t*>(Column += Count * sizeof(uint64_t));
+	Table->Skips = reinterpret_cast<const uint32_t*>(Column += Count * sizeof(uint32_t));
+	Table->Count = Count;
+	Table->Mapping = std::move(Mapping);
+	*Header = Read;
+	return Table;
+}
+
+std::filesystem::path PlayStats_t::GetTablePath(uint64_t Generation) const {
+	return this->Folder / ("Stats." + std::to_string(Generation) + ".table");
+}
+
+// Tables of earlier compactions, one that is still mapped somewhere stays until the next try
+void PlayStats_t::RemoveOldTables() {
+	std::error_code Error;
+	const std::filesystem::path Current = this->GetTablePath(this->TableGeneration);
+	std::vector<std::filesystem::path> Old;
+	for (const std::filesystem::directory_entry& Entry : std::filesystem::directory_iterator(this->Folder, Error)) {
+		if (Entry.path().extension() == ".table" && Entry.path() != Current)
+			Old.push_back(Entry.path());
+	}
+	for (const std::filesystem::path& Path : Old)
+		std::filesystem::remove(Path, Error);
+}
+
+bool PlayStats_t::Open(const std::filesystem::path& Folder) {
+	this->Close();
+
+	std::error_code Error;
+	std::filesystem::create_directories(Folder, Error);
+	this->Folder = Folder;
+	this->LogPath = Folder / "Stats.log";
+	this->LogId = 0;
+	this->LogRecords = 0;
+	this->IsLogBroken = false;
+	this->CompactBackoff = 0;
+	this->NextCompact = {};
+
+	// Without a pointer nothing was compacted yet
+	this->TableGeneration = 0;
+	{
+		std::ifstream Pointer(Folder / "Stats.current");
+		if (!(Pointer >> this->TableGeneration))
+			this->TableGeneration = 0;
+	}
+
+	TableHeader_t Header;
+	std::shared_ptr<Table_t> Opened = LoadTable(this->GetTablePath(this->TableGeneration), &Header);
+	this->RemoveOldTables();
+
+	// Only what the table doesn't hold yet is replayed
+	std::ifstream Stream(this->LogPath, std::ios::binary);
+	LogHeader_t LogHeader;
+	if (!Stream) {
+		if (!this->CreateLog())
+			return false;
+	} else if (!Stream.read(reinterpret_cast<char*>(&LogHeader), sizeof(LogHeader)) || LogHeader.Magic != LogMagic || LogHeader.Version != Version) {
+		this->IsLogBroken = true;
+	} else {
+		this->LogId = LogHeader.Id;
+		uint64_t Folded = LogHeader.Id == Header.LogId ? Header.LogRecords : 0;
+
+		Record_t Record;
+		while (Stream.read(reinterpret_cast<char*>(&Record), sizeof(Record))) {
+			if (Record.Check != Record.GetCheck()) {
+				this->IsLogBroken = true;
+				break;
+			}
+
+			this->LogRecords++;
+			if (Folded) {
+				Folded--;
+				continue;
+			}
+			Fold(&Opened->Recent, Record);
+		}
+
+		// A record torn by a crash, appending after it would shift every one that follows
+		if (Stream.gcount() != 0)
+			this->IsLogBroken = true;
+		if (!this->IsLogBroken)
+			this->Log.open(this->LogPath, std::ios::binary | std::ios::app);
+	}
+	Stream.close();
+
+	this->Table.store(std::move(Opened));
+	this->PendingTail.store(this->PendingHead.load());
+	{
+		std::lock_guard<std::mutex> Guard(this->WriterLock);
+		this->IsWriterRunning = true;
+	}
+	this->WriterThread = std::thread(&PlayStats_t::WriterMain, this);
+	this->IsRecording = true;
+	return true;
+}
+
+void PlayStats_t::Close() {
+	this->IsRecording = false;
+	{
+		std::lock_guard<std::mutex> Guard(this->WriterLock);
+		this->IsWriterRunning = false;
+	}
+	this->WriterSignal.notify_all();
+	if (this->WriterThread.joinable())
+		this->WriterThread.join();
+
+	this->Log.close();
+	this->Table.store(nullptr);
+}
+
+bool PlayStats_t::IsOpen() const {
+	return this->IsRecording;
+}
+
+bool PlayStats_t::Record(uint64_t Key, Event_t Event, double ListenedSeconds) {
+	if (!this->IsRecording.load(std::memory_order_relaxed))
+		return false;
+
+	// A full ring means the stats thread is stuck, the record is lost rather than the engine held up
+	const size_t Head = this->PendingHead.load(std::memory_order_relaxed);
+	if (Head - this->PendingTail.load(std::memory_order_acquire) >= MaxPending) {
+		this->Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	Record_t& Record = this->Pending[Head % MaxPending];
+	Record.Key = Key;
+	Record.Time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	Record.ListenedMs = static_cast<uint32_t>(std::clamp(ListenedSeconds * 1000.0, 0.0, 4e9));
+	Record.Event = Event;
+	Record.Check = Record.GetCheck();
+	this->PendingHead.store(Head + 1, std::memory_order_release);
+	return true;
+}
+
+void PlayStats_t::Flush() {
+	std::unique_lock<std::mutex> Lock(this->WriterLock);
+	if (!this->IsWriterRunning)
+		return;
+
+	const uint64_t Request = ++this->FlushRequests;
+	this->WriterSignal.notify_all();
+	this->FlushedSignal.wait(Lock, [this, Request] {
+		return this->FlushesDone >= Request || !this->IsWriterRunning;
+	});
+}
+
+void PlayStats_t::WriterMain() {
+	std::unique_lock<std::mutex> Lock(this->WriterLock);
+	while (true) {
+		const bool IsStopping = !this->IsWriterRunning;
+		const uint64_t Requests = this->FlushRequests;
+		Lock.unlock();
+
+		// A compaction that failed is retried later and later, rather than on every flush
+		this->WritePending();
+		if ((this->IsLogBroken || this->LogRecords >= CompactRecords) && std::chrono::steady_clock::now() >= this->NextCompact) {
+			if (this->Compact()) {
+				this->CompactBackoff = 0;
+			} else {
+				this->CompactBackoff = std::clamp(this->CompactBackoff * 2, FlushInterval, MaxCompactBackoff);
+				this->NextCompact = std::chrono::steady_clock::now() + std::chrono::milliseconds(this->CompactBackoff);
+			}
+		}
+
+		Lock.lock();
+		this->FlushesDone = Requests;
+		this->FlushedSignal.notify_all();
+		if (IsStopping)
+			break;
+
+		this->WriterSignal.wait_for(Lock, std::chrono::milliseconds(FlushInterval), [this] {
+			return this->FlushRequests != this->FlushesDone || !this->IsWriterRunning;
+		});
+	}
+}
+
+bool PlayStats_t::WritePending() {
+	const size_t Head = this->PendingHead.load(std::memory_order_acquire);
+	size_t Tail = this->PendingTail.load(std::memory_order_relaxed);
+	if (Head == Tail)
+		return true;
+
+	// Readers keep whatever view they loaded, the new one is a copy
+	auto Next = std::make_shared<Table_t>(*this->Table.load());
+	for (; Tail != Head; Tail++) {
+		const Record_t& Record = this->Pending[Tail % MaxPending];
+		Fold(&Next->Recent, Record);
+
+		// Records that can't go to the log are still in the view, the next compaction keeps them
+		if (!this->IsLogBroken) {
+			this->Log.write(reinterpret_cast<const char*>(&Record), sizeof(Record));
+			this->LogRecords++;
+		}
+	}
+	this->PendingTail.store(Tail, std::memory_order_release);
+	this->Table.store(std::move(Next));
+
+	// Into the page cache and no further, a crash of the machine may lose the last few
+	this->Log.flush();
+	if (!this->IsLogBroken && !this->Log) {
+		printf("Failed to append to %s\n", this->LogPath.string().c_str());
+		this->IsLogBroken = true;
+		return false;
+	}
+	return true;
+}
+
+bool PlayStats_t::CreateLog() {
+	this->Log.close();
+	this->IsLogBroken = true;
+
+	std::random_device Device;
+	LogHeader_t Header;
+	Header.Id = static_cast<uint64_t>(Device()) << 32 | Device();
+
+	std::filesystem::path Temporary = this->LogPath;
+	Temporary += ".tmp";
+	{
+		std::ofstream Stream(Temporary, std::ios::binary | std::ios::trunc);
+		Stream.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+		Stream.flush();
+		if (!Stream) {
+			printf("Failed to write %s\n", Temporary.string().c_str());
+			return false;
+		}
+	}
+
+	std::error_code Error;
+	std::filesystem::rename(Temporary, this->LogPath, Error);
+	if (Error) {
+		printf("Failed to replace %s\n", this->LogPath.string().c_str());
+		return false;
+	}
+
+	this->Log.open(this->LogPath, std::ios::binary | std::ios::app);
+	this->LogId = Header.Id;
+	this->LogRecords = 0;
+	this->IsLogBroken = !this->Log.is_open();
+	return !this->IsLogBroken;
+}
+
+bool PlayStats_t::Compact() {
+	const std::shared_ptr<const Table_t> Current = this->Table.load();
+
+	std::vector<std::pair<uint64_t, Stats_t>> Logged(Current->Recent.begin(), Current->Recent.end());
+	std::sort(Logged.begin(), Logged.end(), [](const auto& A, const auto& B) {
+		return A.first < B.first;
+	});
+
+	// Both sides are sorted by key, one pass merges them
+	const size_t Capacity = Current->Count + Logged.size();
+	std::vector<uint64_t> Keys;
+	std::vector<int64_t> LastPlayed;
+	std::vector<uint64_t> ListenedMs;
+	std::vector<uint32_t> Plays;
+	std::vector<uint32_t> Skips;
+	Keys.reserve(Capacity);
+	LastPlayed.reserve(Capacity);
+	ListenedMs.reserve(Capacity);
+	Plays.reserve(Capacity);
+	Skips.reserve(Capacity);
+
+	size_t i = 0;
+	size_t j = 0;
+	while (i < Current->Count || j < Logged.size()) {
+		const bool IsTable = j == Logged.size() || (i < Current->Count && Current->Keys[i] <= Logged[j].first);
+		const bool IsLogged = j < Logged.size() && (i == Current->Count || Logged[j].first <= Current->Keys[i]);
+
+		Stats_t Stats;
+		uint64_t Key = 0;
+		if (IsTable) {
+			Key = Current->Keys[i];
+			Stats.Plays = Current->Plays[i];
+			Stats.Skips = Current->Skips[i];
+			Stats.LastPlayed = Current->LastPlayed[i];
+			Stats.ListenedMs = Current->ListenedMs[i];
+			i++;
+		}
+		if (IsLogged) {
+			Key = Logged[j].first;
+			Merge(&Stats, Logged[j].second);
+			j++;
+		}
+
+		Keys.push_back(Key);
+		LastPlayed.push_back(Stats.LastPlayed);
+		ListenedMs.push_back(Stats.ListenedMs);
+		Plays.push_back(Stats.Plays);
+		Skips.push_back(Stats.Skips);
+	}
+
+	TableHeader_t Header;
+	Header.Count = Keys.size();
+	Header.LogId = this->LogId;
+	Header.LogRecords = this->LogRecords;
+
+	// A new file every time, nobody maps it yet and a torn one is never pointed at
+	const uint64_t Generation = this->TableGeneration + 1;
+	const std::filesystem::path TablePath = this->GetTablePath(Generation);
+	{
+		std::ofstream Stream(TablePath, std::ios::binary | std::ios::trunc);
+		Stream.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+		Stream.write(reinterpret_cast<const char*>(Keys.data()), Keys.size() * sizeof(uint64_t));
+		Stream.write(reinterpret_cast<const char*>(LastPlayed.data()), LastPlayed.size() * sizeof(int64_t));
+		Stream.write(reinterpret_cast<const char*>(ListenedMs.data()), ListenedMs.size() * sizeof(uint64_t));
+		Stream.write(reinterpret_cast<const char*>(Plays.data()), Plays.size() * sizeof(uint32_t));
+		Stream.write(reinterpret_cast<const char*>(Skips.data()), Skips.size() * sizeof(uint32_t));
+		Stream.flush();
+		if (!Stream) {
+			printf("Failed to write %s\n", TablePath.string().c_str());
+			return false;
+		}
+	}
+
+	// The pointer is never mapped, so it can be replaced while the old table is still read
+	const std::filesystem::path PointerPath = this->Folder / "Stats.current";
+	std::filesystem::path Temporary = PointerPath;
+	Temporary += ".tmp";
+	{
+		std::ofstream Stream(Temporary, std::ios::trunc);
+		Stream << Generation << '\n';
+		Stream.flush();
+		if (!Stream) {
+			printf("Failed to write %s\n", Temporary.string().c_str());
+			return false;
+		}
+	}
+
+	std::error_code Error;
+	std::filesystem::rename(Temporary, PointerPath, Error);
+	if (Error) {
+		printf("Failed to replace %s\n", PointerPath.string().c_str());
+		return false;
+	}
+	this->TableGeneration = Generation;
+
+	// A crash right here finds the old log, and the header says how much of it to skip
+	const bool IsLogCreated = this->CreateLog();
+
+	TableHeader_t Loaded;
+	std::shared_ptr<Table_t> Compacted = LoadTable(TablePath, &Loaded);
+	if (Loaded.Count != Keys.size()) {
+		// Nothing else to read from, the view just stays what it was
+		printf("Failed to map %s\n", TablePath.string().c_str());
+		return false;
+	}
+	this->Table.store(std::move(Compacted));
+	this->RemoveOldTables();
+	return IsLogCreated;
+}
+
+std::shared_ptr<const PlayStats_t::Table_t> PlayStats_t::GetTable() const {
+	return this->Table.load();
+}
+
+bool PlayStats_t::Get(uint64_t Key, Stats_t* Stats) const {
+	const std::shared_ptr<const Table_t> Current = this->Table.load();
+	if (!Current) {
+		*Stats = {};
+		return false;
+	}
+	return Current->Find(Key, Stats);
+}
+
+uint64_t PlayStats_t::GetDropped() const {
+	return this->Dropped;
+}
+
+uint64_t PlayStats_t::GetKey(std::string_view Path) {
+	// FNV-1a, same as the seek table cache names
+	uint64_t Hash = 0xCBF29CE484222325ull;
+	for (const char Character : Path) {
+		Hash ^= static_cast<uint8_t>(Character);
+		Hash *= 0x100000001B3ull;
+	}
+	return Hash;
+}
+
+std::filesystem::path PlayStats_t::GetDefaultFolder() {
+#ifdef _WIN32
+	const char* Base = getenv("LOCALAPPDATA");
+	std::filesystem::path Folder = Base ? std::filesystem::path(Base) : std::filesystem::temp_directory_path();
+#else
+	const char* Base = getenv("XDG_DATA_HOME");
+	const char* Home = getenv("HOME");
+	std::filesystem::path Folder = Base ? std::filesystem::path(Base) : std::filesystem::path(Home ? Home : ".") / ".local" / "share";
+#endif
+	return Folder / "MusicPlayerV2" / "PlayStats";
+}
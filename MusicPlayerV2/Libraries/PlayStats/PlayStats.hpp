@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "../MappedFile/MappedFile.hpp"
+
+// Play counts, skips, last played and listening time per track.
+// Recording copies a fixed-size record into a ring and returns, it never locks, allocates or
+// touches a file. The stats thread appends the ring to a log without syncing it, and once the
+// log holds CompactRecords it folds it into a table with one column per field, sorted by track
+// key. Every compaction writes a table file of its own and then points Stats.current at it, since
+// Windows can't replace a file that is still mapped, older ones are deleted once nobody maps them.
+// Startup maps the current table and only replays the log written since. Tracks are keyed by a
+// hash of their path, ids don't survive a restart.
+class PlayStats_t {
+public:
+	enum class Event_t : uint32_t {
+		Finished,	// Played up to the crossfade into the next track
+		Skipped,
+	};
+
+	struct Stats_t {
+		uint32_t Plays = 0;
+		uint32_t Skips = 0;
+		int64_t LastPlayed = 0;		// Unix seconds, 0 if never
+		uint64_t ListenedMs = 0;
+	};
+
+	// One published view of everything recorded, immutable
+	struct Table_t {
+		// Compacted part, straight from the mapping
+		std::shared_ptr<const MappedFile_t> Mapping;
+		size_t Count = 0;
+		const uint64_t* Keys = nullptr;
+		const int64_t* LastPlayed = nullptr;
+		const uint64_t* ListenedMs = nullptr;
+		const uint32_t* Plays = nullptr;
+		const uint32_t* Skips = nullptr;
+
+		// Logged since the table was written
+		std::unordered_map<uint64_t, Stats_t> Recent;
+
+		// False if the track was never recorded
+		bool Find(uint64_t Key, Stats_t* Stats) const;
+	};
+
+	static constexpr size_t MaxPending = 1024;
+	static constexpr size_t CompactRecords = 8192;
+	// How often the stats thread writes out what was recorded
+	static constexpr int FlushInterval = 1000; // Milliseconds
+	// Longest wait before a failed compaction is tried again, the wait doubles from FlushInterval
+	static constexpr int MaxCompactBackoff = 5 * 60 * 1000; // Milliseconds
+
+private:
+	static constexpr uint32_t TableMagic = 0x5350504D; // "MPPS"
+	static constexpr uint32_t LogMagic = 0x4C50504D; // "MPPL"
+	static constexpr uint32_t Version = 1;
+
+	// Columns follow in the order of Table_t, the 8 byte ones first so every column stays aligned
+	struct TableHeader_t {
+		uint32_t Magic = TableMagic;
+		uint32_t Version = PlayStats_t::Version;
+		uint64_t Count = 0;
+		// Records of that log already folded in, in case the rename of a fresh log never happened
+		uint64_t LogId = 0;
+		uint64_t LogRecords = 0;
+	};
+
+	struct LogHeader_t {
+		uint32_t Magic = LogMagic;
+		uint32_t Version = PlayStats_t::Version;
+		uint64_t Id = 0;
+	};
+
+	struct Record_t {
+		uint64_t Key = 0;
+		int64_t Time = 0;
+		uint32_t ListenedMs = 0;
+		Event_t Event = Event_t::Finished;
+		uint32_t Check = 0;		// Garbage after a crash doesn't pass for a record
+		uint32_t Reserved = 0;
+
+		uint32_t GetCheck() const;
+	};
+	static_assert(sizeof(Record_t) == 32);
+
+	// Engine to stats thread, single producer and single consumer
+	Record_t Pending[MaxPending];
+	std::atomic<size_t> PendingHead = 0;
+	std::atomic<size_t> PendingTail = 0;
+	std::atomic<uint64_t> Dropped = 0;
+
+	std::atomic<std::shared_ptr<const Table_t>> Table;
+	std::atomic<bool> IsRecording = false;
+
+	// Stats thread only
+	std::filesystem::path Folder;
+	std::filesystem::path LogPath;
+	uint64_t TableGeneration = 0;	// Of the current table file, 0 if there is none yet
+	int CompactBackoff = 0;
+	std::chrono::steady_clock::time_point NextCompact;
+	std::ofstream Log;
+	uint64_t LogId = 0;
+	uint64_t LogRecords = 0;
+	bool IsLogBroken = false;	// Ends in something that isn't a record, compacted away before appending to it
+
+	std::mutex WriterLock;
+	std::condition_variable WriterSignal;
+	std::condition_variable FlushedSignal;
+	bool IsWriterRunning = false;
+	uint64_t FlushRequests = 0;
+	uint64_t FlushesDone = 0;
+	std::thread WriterThread;
+	void WriterMain();
+
+	static void Fold(std::unordered_map<uint64_t, Stats_t>* Recent, const Record_t& Record);
+	static std::shared_ptr<Table_t> LoadTable(const std::filesystem::path& Path, TableHeader_t* Header);
+	std::filesystem::path GetTablePath(uint64_t Generation) const;
+	void RemoveOldTables();
+	bool WritePending();
+	bool CreateLog();
+	bool Compact();
+
+public:
+	~PlayStats_t();
+
+	// Maps the current table in Folder, replays the log and starts the stats thread
+	bool Open(const std::filesystem::path& Folder);
+	// Writes out what's still pending and stops the stats thread
+	void Close();
+	bool IsOpen() const;
+
+	// Engine thread only, false if the ring was full and the record was dropped
+	bool Record(uint64_t Key, Event_t Event, double ListenedSeconds);
+	// Blocks until everything recorded so far is in the log, not for the engine thread
+	void Flush();
+
+	// nullptr while closed
+	std::shared_ptr<const Table_t> GetTable() const;
+	bool Get(uint64_t Key, Stats_t* Stats) const;
+
+	uint64_t GetDropped() const;
+
+	// Stable across restarts, unlike track ids
+	static uint64_t GetKey(std::string_view Path);
+	static std::filesystem::path GetDefaultFolder();
+};
@@ -0,0 +1,125 @@
+#include "PlaybackClock.hpp"
+
+#include <algorithm>
+
+int64_t PlaybackClock_t::ToNanoseconds(Clock_t::time_point Time) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Time.time_since_epoch()).count();
+}
+
+PlaybackClock_t::State_t PlaybackClock_t::Load() const {
+	State_t State;
+	for (;;) {
+		const uint32_t Before = this->Sequence.load(std::memory_order_acquire);
+		if (Before & 1)
+			continue;
+
+		State.Sample = this->Sample.load(std::memory_order_relaxed);
+		State.Timestamp = this->Timestamp.load(std::memory_order_relaxed);
+		State.SampleRate = this->SampleRate.load(std::memory_order_relaxed);
+		State.Epoch = this->Epoch.load(std::memory_order_relaxed);
+		State.IsRunning = this->IsRunning.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (this->Sequence.load(std::memory_order_relaxed) == Before)
+			return State;
+	}
+}
+
+void PlaybackClock_t::Store(const State_t& State) {
+	const uint32_t Before = this->Sequence.load(std::memory_order_relaxed);
+	this->Sequence.store(Before + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	this->Sample.store(State.Sample, std::memory_order_relaxed);
+	this->Timestamp.store(State.Timestamp, std::memory_order_relaxed);
+	this->SampleRate.store(State.SampleRate, std::memory_order_relaxed);
+	this->Epoch.store(State.Epoch, std::memory_order_relaxed);
+	this->IsRunning.store(State.IsRunning, std::memory_order_relaxed);
+
+	this->Sequence.store(Before + 2, std::memory_order_release);
+}
+
+double PlaybackClock_t::Extrapolate(const State_t& State, int64_t Now) {
+	if (!State.SampleRate)
+		return 0.0;
+
+	double Seconds = static_cast<double>(State.Sample) / State.SampleRate;
+	if (State.IsRunning)
+		Seconds += std::clamp(static_cast<double>(Now - State.Timestamp) / 1e9, 0.0, MaxExtrapolation);
+	return Seconds;
+}
+
+void PlaybackClock_t::Reset(uint32_t SampleRate, Clock_t::time_point Now) {
+	while (this->WriteLock.test_and_set(std::memory_order_acquire)) {}
+
+	State_t State = this->Load();
+	this->Store({ 0, ToNanoseconds(Now), SampleRate, State.Epoch + 1, false });
+
+	this->WriteLock.clear(std::memory_order_release);
+}
+
+void PlaybackClock_t::Jump(uint64_t Sample, Clock_t::time_point Now) {
+	while (this->WriteLock.test_and_set(std::memory_order_acquire)) {}
+
+	State_t State = this->Load();
+	this->Store({ Sample, ToNanoseconds(Now), State.SampleRate, State.Epoch + 1, State.IsRunning });
+
+	this->WriteLock.clear(std::memory_order_release);
+}
+
+void PlaybackClock_t::Publish(uint64_t Sample, Clock_t::time_point Now) {
+	while (this->WriteLock.test_and_set(std::memory_order_acquire)) {}
+
+	State_t State = this->Load();
+	this->Store({ Sample, ToNanoseconds(Now), State.SampleRate, State.Epoch, State.IsRunning });
+
+	this->WriteLock.clear(std::memory_order_release);
+}
+
+void PlaybackClock_t::Stop(Clock_t::time_point Now) {
+	while (this->WriteLock.test_and_set(std::memory_order_acquire)) {}
+
+	State_t State = this->Load();
+	if (State.IsRunning) {
+		const int64_t Nanoseconds = ToNanoseconds(Now);
+		const uint64_t Frozen = static_cast<uint64_t>(Extrapolate(State, Nanoseconds) * State.SampleRate);
+		this->Store({ Frozen, Nanoseconds, State.SampleRate, State.Epoch, false });
+	}
+
+	this->WriteLock.clear(std::memory_order_release);
+}
+
+void PlaybackClock_t::Start(Clock_t::time_point Now) {
+	while (this->WriteLock.test_and_set(std::memory_order_acquire)) {}
+
+	State_t State = this->Load();
+	if (!State.IsRunning)
+		this->Store({ State.Sample, ToNanoseconds(Now), State.SampleRate, State.Epoch, true });
+
+	this->WriteLock.clear(std::memory_order_release);
+}
+
+double PlaybackClock_t::GetSeconds(Clock_t::time_point Now) {
+	const State_t State = this->Load();
+	const double Seconds = Extrapolate(State, ToNanoseconds(Now));
+
+	// A callback may land slightly behind what was already extrapolated, hold until it catches up
+	if (State.Epoch == this->LastEpoch && Seconds < this->LastSeconds)
+		return this->LastSeconds;
+
+	this->LastEpoch = State.Epoch;
+	this->LastSeconds = Seconds;
+	return Seconds;
+}
+
+double PlaybackClock_t::Peek(Clock_t::time_point Now) const {
+	return Extrapolate(this->Load(), ToNanoseconds(Now));
+}
+
+bool PlaybackClock_t::GetIsRunning() const {
+	return this->IsRunning.load(std::memory_order_relaxed);
+}
+
+uint32_t PlaybackClock_t::GetSampleRate() const {
+	return this->SampleRate.load(std::memory_order_relaxed);
+}
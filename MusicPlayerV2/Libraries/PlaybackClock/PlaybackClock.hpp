@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Playback position of one stream, published by the audio thread and read by the UI
+// without calling into the backend. Every audio callback stores the sample that is audible
+// right now together with the time it was captured, readers extrapolate from there.
+// Writers are serialized by a spinlock, the reader side is lock free (seqlock).
+class PlaybackClock_t {
+public:
+	using Clock_t = std::chrono::steady_clock;
+
+	// How far a reader extrapolates past the last callback before holding still.
+	// Has to cover the device buffer, callbacks stop that much before the audible end of a stream.
+	static constexpr double MaxExtrapolation = 1.0;
+
+private:
+	// Odd while a write is in progress
+	std::atomic<uint32_t> Sequence = 0;
+	std::atomic_flag WriteLock = ATOMIC_FLAG_INIT;
+
+	std::atomic<uint64_t> Sample = 0;
+	std::atomic<int64_t> Timestamp = 0;		// Nanoseconds on Clock_t
+	std::atomic<uint32_t> SampleRate = 0;
+	std::atomic<uint32_t> Epoch = 0;		// Bumped on Reset() and Jump(), position jumps are expected across it
+	std::atomic<bool> IsRunning = false;
+
+	// Only touched by the reading thread
+	double LastSeconds = 0.0;
+	uint32_t LastEpoch = 0;
+
+	struct State_t {
+		uint64_t Sample;
+		int64_t Timestamp;
+		uint32_t SampleRate;
+		uint32_t Epoch;
+		bool IsRunning;
+	};
+
+	State_t Load() const;
+	void Store(const State_t& State);
+	static double Extrapolate(const State_t& State, int64_t Now);
+	static int64_t ToNanoseconds(Clock_t::time_point Time);
+
+public:
+	// Back to sample 0 and stopped
+	void Reset(uint32_t SampleRate, Clock_t::time_point Now = Clock_t::now());
+
+	// Moves to Sample after a seek, keeps running or stopped as before
+	void Jump(uint64_t Sample, Clock_t::time_point Now = Clock_t::now());
+
+	// From the audio callback, Sample is audible at Now. Running state is left to Start() and Stop()
+	void Publish(uint64_t Sample, Clock_t::time_point Now = Clock_t::now());
+
+	// Freeze at the current position, e.g. on pause
+	void Stop(Clock_t::time_point Now = Clock_t::now());
+	// Continue from the frozen position until the next callback corrects it
+	void Start(Clock_t::time_point Now = Clock_t::now());
+
+	// Never runs backwards between calls unless the clock was reset. Meant for a single reader, the UI
+	double GetSeconds(Clock_t::time_point Now = Clock_t::now());
+	// Same without the guard, for any thread
+	double Peek(Clock_t::time_point Now = Clock_t::now()) const;
+
+	bool GetIsRunning() const;
+	uint32_t GetSampleRate() const;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <bass/bass.h>
+
+#include "../PlaybackClock/PlaybackClock.hpp"
+#include "../Pool/Pool.hpp"
+#include "../Shuffle/Shuffle.hpp"
+
+class TrackColumns_t;
+class SortKeys_t;
+
+// One mp3 or wav of the music folder. The id stays the same for a path for as long as the player runs.
+struct LibraryTrack_t {
+	uint32_t Id = 0;
+	uint64_t Key = 0;		// Hash of the path, the same across restarts unlike Id
+	std::filesystem::path Path;
+	std::string FileName;	// Picker label
+	std::string Title;		// From the tags, the file name without the extension if they have none
+	int64_t Added = 0;		// Unix seconds, when the file was last written
+
+	// Filled in by the scanner after the listing, empty until then and for files without tags
+	std::string Artist;
+	std::string Album;
+	std::string Genre;
+	float Bpm = 0.0f;
+	double Duration = 0.0;	// Seconds
+	bool IsTagged = false;
+};
+
+struct Library_t {
+	uint64_t Version = 0;
+	std::vector<LibraryTrack_t> Tracks;
+	// Tags laid out for queries, see SmartPlaylist.hpp
+	std::shared_ptr<const TrackColumns_t> Columns;
+	// Collation keys for the sorted views, see TrackSort.hpp
+	std::shared_ptr<const SortKeys_t> SortKeys;
+
+	// What changed since the library of Version - 1, so indexes can follow without reading it all again
+	std::vector<uint32_t> Removed;	// Ids that are gone or whose tags changed
+	std::vector<uint32_t> Added;	// Rows of the tracks that are new or got their tags since
+
+	// Row of every id, -1 for ids that aren't part of the library. Ids are handed out one after
+	// the other, so this stays about as long as Tracks
+	std::vector<int32_t> Rows;
+
+	// The scanner calls this once the tracks are listed
+	void IndexRows() {
+		uint32_t MaxId = 0;
+		for (const LibraryTrack_t& Track : this->Tracks)
+			MaxId = std::max(MaxId, Track.Id);
+		this->Rows.assign(this->Tracks.empty() ? 0 : MaxId + 1, -1);
+		for (size_t i = 0; i < this->Tracks.size(); i++)
+			this->Rows[this->Tracks[i].Id] = static_cast<int32_t>(i);
+	}
+
+	// -1 if the track is not (or no longer) part of the library
+	int IndexOf(uint32_t Id) const {
+		return Id < this->Rows.size() ? this->Rows[Id] : -1;
+	}
+};
+
+// Tracks a smart playlist's rule matches, in library order
+struct Playlist_t {
+	std::string Name;
+	std::string Rule;
+	std::vector<uint32_t> Tracks;
+};
+
+// Everything the UI needs to know about playback. The engine builds a new one whenever
+// something changes and never touches it again once published, so readers need no locks.
+struct PlayerState_t {
+	static constexpr uint32_t NoTrack = 0;
+
+	uint64_t Version = 0;
+	std::shared_ptr<const Library_t> Library;
+
+	uint32_t CurrentTrack = NoTrack;
+	double Duration = 0.0;
+	bool IsPlaying = false;
+	bool IsOpening = false;			// Skipped to but not opened yet, no Clock or Duration until it is
+
+	// Thread-safe on its own, shared so it stays valid after the engine dropped the track
+	std::shared_ptr<PlaybackClock_t> Clock;
+
+	// What plays once the current track runs out
+	uint32_t NextTrack = NoTrack;
+
+	// Start of the play queue, QueueLength counts all of it. The entries name each place for
+	// Unqueue and MoveQueued, a track queued twice has one per place
+	static constexpr size_t MaxQueuePreview = 8;
+	uint32_t QueuePreview[MaxQueuePreview] = {};
+	Handle_t QueueEntries[MaxQueuePreview] = {};
+	size_t QueueLength = 0;
+	Shuffle_t::Mode_t Shuffle = Shuffle_t::Mode_t::Off;
+	// A playlist whose tracks didn't change is shared with the previous state
+	std::shared_ptr<const std::vector<std::shared_ptr<const Playlist_t>>> Playlists;
+
+	float Volume = 0.0f;
+	bool IsCrossfading = false;
+	uint32_t FadingTrack = NoTrack;
+	size_t Voices = 0;				// Tracks still audible, the current one included
+
+	// Only for the linear visualizer, BASS fails gracefully if it was freed in the meantime
+	HSTREAM Stream = 0;
+
+	// Entry of the current track, from the library it was started from, which may be older than Library
+	const LibraryTrack_t* Track = nullptr;
+	std::shared_ptr<const Library_t> TrackLibrary;
+};
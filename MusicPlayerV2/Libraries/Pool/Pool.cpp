@@ -0,0 +1,39 @@
+#include "Pool.hpp"
+
+BlockPool_t::BlockPool_t(size_t BlockSize, size_t Preallocate) : BlockSize(BlockSize) {
+	this->Free.reserve(Preallocate * 2);
+	for (size_t i = 0; i < Preallocate; i++)
+		this->Free.push_back(::operator new(BlockSize));
+}
+
+BlockPool_t::~BlockPool_t() {
+	for (void* Block : this->Free)
+		::operator delete(Block);
+}
+
+void* BlockPool_t::Allocate(size_t Size) {
+	// Too big for a block, nothing to recycle
+	if (Size > this->BlockSize)
+		return ::operator new(Size);
+
+	{
+		std::lock_guard<std::mutex> Guard(this->Lock);
+		if (!this->Free.empty()) {
+			void* Block = this->Free.back();
+			this->Free.pop_back();
+			return Block;
+		}
+	}
+
+	return ::operator new(this->BlockSize);
+}
+
+void BlockPool_t::Deallocate(void* Block, size_t Size) {
+	if (Size > this->BlockSize) {
+		::operator delete(Block);
+		return;
+	}
+
+	std::lock_guard<std::mutex> Guard(this->Lock);
+	this->Free.push_back(Block);
+}
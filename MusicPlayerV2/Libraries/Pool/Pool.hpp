@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Reference to a pooled object. Once the slot is released and reused, old handles to it
+// stop resolving instead of pointing at the new occupant.
+struct Handle_t {
+	uint32_t Index = UINT32_MAX;
+	uint32_t Generation = 0;
+
+	bool IsValid() const {
+		return this->Index != UINT32_MAX;
+	}
+
+	bool operator==(const Handle_t& Other) const {
+		return this->Index == Other.Index && this->Generation == Other.Generation;
+	}
+};
+
+// Fixed number of objects that are constructed once and then recycled, never allocated again.
+// Not thread-safe, meant to be owned by a single thread.
+template <typename T, size_t Capacity>
+class HandlePool_t {
+private:
+	struct Slot_t {
+		T Value;
+		uint32_t Generation = 1;
+		bool IsUsed = false;
+	};
+
+	std::array<Slot_t, Capacity> Slots;
+	size_t Used = 0;
+
+	// Unused slot indices, lowest on top
+	std::array<uint32_t, Capacity> FreeSlots;
+
+public:
+	HandlePool_t() {
+		for (uint32_t i = 0; i < Capacity; i++)
+			this->FreeSlots[i] = static_cast<uint32_t>(Capacity - 1 - i);
+	}
+
+	// Invalid handle if every slot is taken
+	Handle_t Acquire() {
+		if (this->Used == Capacity)
+			return {};
+
+		const uint32_t Index = this->FreeSlots[Capacity - 1 - this->Used];
+		this->Slots[Index].IsUsed = true;
+		this->Used++;
+		return { Index, this->Slots[Index].Generation };
+	}
+
+	void Release(Handle_t Handle) {
+		if (!this->Get(Handle))
+			return;
+
+		Slot_t& Slot = this->Slots[Handle.Index];
+		Slot.IsUsed = false;
+		Slot.Generation++;
+		this->Used--;
+		this->FreeSlots[Capacity - 1 - this->Used] = Handle.Index;
+	}
+
+	// nullptr for stale or invalid handles
+	T* Get(Handle_t Handle) {
+		if (Handle.Index >= Capacity)
+			return nullptr;
+
+		Slot_t& Slot = this->Slots[Handle.Index];
+		return Slot.IsUsed && Slot.Generation == Handle.Generation ? &Slot.Value : nullptr;
+	}
+
+	const T* Get(Handle_t Handle) const {
+		return const_cast<HandlePool_t*>(this)->Get(Handle);
+	}
+
+	// Calls Function(Handle, T&) for every object in use
+	template <typename Function>
+	void ForEach(Function&& Callback) {
+		for (uint32_t i = 0; i < Capacity; i++) {
+			if (this->Slots[i].IsUsed)
+				Callback(Handle_t{ i, this->Slots[i].Generation }, this->Slots[i].Value);
+		}
+	}
+
+	size_t GetUsed() const {
+		return this->Used;
+	}
+
+	static constexpr size_t GetCapacity() {
+		return Capacity;
+	}
+};
+
+// Free list of equally sized blocks. Blocks come from the heap until enough of them
+// circulate, after that allocations are served from the list. Thread-safe.
+class BlockPool_t {
+private:
+	std::mutex Lock;
+	std::vector<void*> Free;
+	size_t BlockSize;
+
+public:
+	BlockPool_t(size_t BlockSize, size_t Preallocate);
+	~BlockPool_t();
+
+	void* Allocate(size_t Size);
+	void Deallocate(void* Block, size_t Size);
+};
+
+// Standard allocator on top of a BlockPool_t, e.g. for std::allocate_shared
+template <typename T>
+class PoolAllocator_t {
+public:
+	using value_type = T;
+
+	BlockPool_t* Pool;
+
+	explicit PoolAllocator_t(BlockPool_t* Pool) : Pool(Pool) {}
+
+	template <typename U>
+	PoolAllocator_t(const PoolAllocator_t<U>& Other) : Pool(Other.Pool) {}
+
+	T* allocate(size_t Count) {
+		return static_cast<T*>(this->Pool->Allocate(sizeof(T) * Count));
+	}
+
+	void deallocate(T* Pointer, size_t Count) {
+		this->Pool->Deallocate(Pointer, sizeof(T) * Count);
+	}
+
+	template <typename U>
+	bool operator==(const PoolAllocator_t<U>& Other) const {
+		return this->Pool == Other.Pool;
+	}
+};
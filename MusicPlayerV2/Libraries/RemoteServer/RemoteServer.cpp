@@ -0,0 +1,608 @@
+#include "RemoteServer.hpp"
+#include "../ControlServer/ControlServer.hpp"
+#include "../MusicPlayer_t/MusicPlayer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <ctime>
+#endif
+
+RemoteServer_t RemoteServer;
+
+static double GetThreadCpuSeconds() {
+#ifdef _WIN32
+	FILETIME Creation, Exit, Kernel, User;
+	if (!GetThreadTimes(GetCurrentThread(), &Creation, &Exit, &Kernel, &User))
+		return 0.0;
+	const uint64_t Ticks = (static_cast<uint64_t>(Kernel.dwHighDateTime) << 32 | Kernel.dwLowDateTime) + (static_cast<uint64_t>(User.dwHighDateTime) << 32 | User.dwLowDateTime);
+	return Ticks / 1e7;
+#else
+	timespec Time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Time);
+	return Time.tv_sec + Time.tv_nsec / 1e9;
+#endif
+}
+
+// Only for the WebSocket handshake
+static void Sha1(std::string_view Data, uint8_t Digest[20]) {
+	uint32_t H[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+	const auto Rotate = [](uint32_t Value, int Bits) { return (Value << Bits) | (Value >> (32 - Bits)); };
+
+	std::string Message(Data);
+	const uint64_t Bits = static_cast<uint64_t>(Data.size()) * 8;
+	Message.push_back(static_cast<char>(0x80));
+	while (Message.size() % 64 != 56)
+		Message.push_back('\0');
+	for (int i = 7; i >= 0; i--)
+		Message.push_back(static_cast<char>(Bits >> (i * 8)));
+
+	for (size_t Chunk = 0; Chunk < Message.size(); Chunk += 64) {
+		uint32_t W[80];
+		for (int i = 0; i < 16; i++) {
+			const uint8_t* Word = reinterpret_cast<const uint8_t*>(Message.data() + Chunk + i * 4);
+			W[i] = static_cast<uint32_t>(Word[0]) << 24 | Word[1] << 16 | Word[2] << 8 | Word[3];
+		}
+		for (int i = 16; i < 80; i++)
+			W[i] = Rotate(W[i - 3] ^ W[i - 8] ^ W[i - 14] ^ W[i - 16], 1);
+
+		uint32_t A = H[0], B = H[1], C = H[2], D = H[3], E = H[4];
+		for (int i = 0; i < 80; i++) {
+			uint32_t F, K;
+			if (i < 20) {
+				F = (B & C) | (~B & D);
+				K = 0x5A827999;
+			} else if (i < 40) {
+				F = B ^ C ^ D;
+				K = 0x6ED9EBA1;
+			} else if (i < 60) {
+				F = (B & C) | (B & D) | (C & D);
+				K = 0x8F1BBCDC;
+			} else {
+				F = B ^ C ^ D;
+				K = 0xCA62C1D6;
+			}
+			const uint32_t Next = Rotate(A, 5) + F + E + K + W[i];
+			E = D;
+			D = C;
+			C = Rotate(B, 30);
+			B = A;
+			A = Next;
+		}
+		H[0] += A;
+		H[1] += B;
+		H[2] += C;
+		H[3] += D;
+		H[4] += E;
+	}
+
+	for (int i = 0; i < 20; i++)
+		Digest[i] = static_cast<uint8_t>(H[i / 4] >> (24 - (i % 4) * 8));
+}
+
+static std::string Base64(const uint8_t* Data, size_t Length) {
+	static const char Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string Out;
+	for (size_t i = 0; i < Length; i += 3) {
+		const uint32_t Triple = Data[i] << 16 | (i + 1 < Length ? Data[i + 1] << 8 : 0) | (i + 2 < Length ? Data[i + 2] : 0);
+		Out.push_back(Alphabet[(Triple >> 18) & 63]);
+		Out.push_back(Alphabet[(Triple >> 12) & 63]);
+		Out.push_back(i + 1 < Length ? Alphabet[(Triple >> 6) & 63] : '=');
+		Out.push_back(i + 2 < Length ? Alphabet[Triple & 63] : '=');
+	}
+	return Out;
+}
+
+std::string RemoteServer_t::GetAcceptKey(std::string_view Key) {
+	std::string Text(Key);
+	Text += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+	uint8_t Digest[20];
+	Sha1(Text, Digest);
+	return Base64(Digest, sizeof(Digest));
+}
+
+// Value of a header, case-insensitive on the name, empty if it's missing
+static std::string_view GetHeader(std::string_view Headers, std::string_view Name) {
+	size_t Start = 0;
+	while (Start < Headers.size()) {
+		size_t End = Headers.find("\r\n", Start);
+		if (End == std::string_view::npos)
+			End = Headers.size();
+
+		const std::string_view Line = Headers.substr(Start, End - Start);
+		const size_t Colon = Line.find(':');
+		if (Colon == Name.size() && std::equal(Name.begin(), Name.end(), Line.begin(), [](char a, char b) { return tolower(a) == tolower(b); })) {
+			std::string_view Value = Line.substr(Colon + 1);
+			while (!Value.empty() && Value.front() == ' ')
+				Value.remove_prefix(1);
+			return Value;
+		}
+		Start = End + 2;
+	}
+	return {};
+}
+
+static size_t GetQueryNumber(std::string_view Query, std::string_view Name, size_t Default) {
+	size_t Start = 0;
+	while (Start < Query.size()) {
+		size_t End = Query.find('&', Start);
+		if (End == std::string_view::npos)
+			End = Query.size();
+
+		const std::string_view Pair = Query.substr(Start, End - Start);
+		if (Pair.size() > Name.size() && Pair.substr(0, Name.size()) == Name && Pair[Name.size()] == '=')
+			return strtoull(std::string(Pair.substr(Name.size() + 1)).c_str(), nullptr, 10);
+		Start = End + 1;
+	}
+	return Default;
+}
+
+// Host header or origin host naming this server, so a page that rebinds its own name to 127.0.0.1 is refused
+static bool IsLoopbackHost(std::string_view Host, uint16_t Port) {
+	char Suffix[8];
+	snprintf(Suffix, sizeof(Suffix), ":%u", Port);
+	for (const std::string_view Name : { "127.0.0.1", "localhost" }) {
+		if (Host.size() > Name.size() && Host.substr(0, Name.size()) == Name && Host.substr(Name.size()) == Suffix)
+			return true;
+	}
+	return false;
+}
+
+static void AppendResponse(std::string* Out, const char* Status, std::string_view Headers, std::string_view Body) {
+	char Head[160];
+	snprintf(Head, sizeof(Head), "HTTP/1.1 %s\r\nContent-Length: %zu\r\n", Status, Body.size());
+	Out->append(Head);
+	Out->append(Headers);
+	Out->append("\r\n");
+	Out->append(Body);
+}
+
+// Server frames are never masked
+static void AppendFrame(std::string* Out, uint8_t Opcode, std::string_view Payload) {
+	Out->push_back(static_cast<char>(0x80 | Opcode));
+	if (Payload.size() < 126) {
+		Out->push_back(static_cast<char>(Payload.size()));
+	} else if (Payload.size() < 65536) {
+		Out->push_back(126);
+		Out->push_back(static_cast<char>(Payload.size() >> 8));
+		Out->push_back(static_cast<char>(Payload.size()));
+	} else {
+		Out->push_back(127);
+		for (int i = 7; i >= 0; i--)
+			Out->push_back(static_cast<char>(static_cast<uint64_t>(Payload.size()) >> (i * 8)));
+	}
+	Out->append(Payload);
+}
+
+// Request and reply lines end in a newline, WebSocket messages don't
+static void AppendLineFrames(std::string* Out, std::string_view Lines) {
+	size_t Start = 0;
+	for (size_t End; (End = Lines.find('\n', Start)) != std::string_view::npos; Start = End + 1)
+		AppendFrame(Out, 0x1, Lines.substr(Start, End - Start));
+}
+
+RemoteServer_t::~RemoteServer_t() {
+	this->Stop();
+}
+
+bool RemoteServer_t::Start(uint16_t Port) {
+	this->Stop();
+
+	this->Listener = ListenLoopback(&Port);
+	if (this->Listener == NoSocket) {
+		printf("Failed to listen on port %u\n", Port);
+		return false;
+	}
+	if (!MakeSocketPair(&this->WakeRead, &this->WakeWrite)) {
+		printf("Failed to set up the remote server\n");
+		CloseSocket(this->Listener);
+		return false;
+	}
+
+	if (!this->IsListening)
+		this->IsListening = MusicPlayer.AddStateListener(&RemoteServer_t::OnState, this);
+
+	this->Port = Port;
+	this->IsWakePending = false;
+	this->SentVersion = MusicPlayer.GetState()->Version;
+	this->IsRunning = true;
+	this->Thread = std::thread(&RemoteServer_t::ServerMain, this);
+	return true;
+}
+
+void RemoteServer_t::Stop() {
+	if (!this->IsRunning)
+		return;
+
+	this->IsRunning = false;
+	this->IsWakePending = false;
+	this->Wake();
+	this->Thread.join();
+
+	for (Client_t& Client : this->Clients)
+		CloseSocket(Client.Socket);
+	this->Clients.clear();
+	{
+		std::lock_guard<std::mutex> Guard(this->WakeLock);
+		CloseSocket(this->WakeWrite);
+		this->WakeWrite = NoSocket;
+	}
+	CloseSocket(this->WakeRead);
+	CloseSocket(this->Listener);
+	this->WakeRead = this->Listener = NoSocket;
+}
+
+uint16_t RemoteServer_t::GetPort() const {
+	return this->Port;
+}
+
+uint64_t RemoteServer_t::GetRequests() const {
+	return this->Requests.load(std::memory_order_relaxed);
+}
+
+uint64_t RemoteServer_t::GetPushes() const {
+	return this->Pushes.load(std::memory_order_relaxed);
+}
+
+double RemoteServer_t::GetCpuSeconds() const {
+	return this->CpuSeconds.load(std::memory_order_relaxed);
+}
+
+void RemoteServer_t::OnState(void* User) {
+	RemoteServer_t* Server = static_cast<RemoteServer_t*>(User);
+	if (Server->IsRunning.load(std::memory_order_relaxed))
+		Server->Wake();
+}
+
+void RemoteServer_t::Wake() {
+	if (this->IsWakePending.exchange(true))
+		return;
+
+	std::lock_guard<std::mutex> Guard(this->WakeLock);
+	const char Byte = 0;
+	if (this->WakeWrite != NoSocket)
+		SendSocket(this->WakeWrite, &Byte, 1);
+}
+
+void RemoteServer_t::Route(Client_t& Client, std::string_view Method, std::string_view Target, std::string_view Headers, std::string_view Body) {
+	const size_t QueryStart = Target.find('?');
+	const std::string_view Path = Target.substr(0, QueryStart);
+	const std::string_view Query = QueryStart == std::string_view::npos ? std::string_view() : Target.substr(QueryStart + 1);
+
+	// Browsers always send the Origin of cross-site requests, pages of this server are the only ones let through
+	const std::string_view Origin = GetHeader(Headers, "Origin");
+	if (!IsLoopbackHost(GetHeader(Headers, "Host"), this->Port)
+		|| (!Origin.empty() && (Origin.substr(0, 7) != "http://" || !IsLoopbackHost(Origin.substr(7), this->Port)))) {
+		AppendResponse(&Client.Out, "403 Forbidden", "", "");
+		return;
+	}
+
+	if (Method == "GET" && Path == "/ws") {
+		const std::string_view Key = GetHeader(Headers, "Sec-WebSocket-Key");
+		if (Key.empty()) {
+			AppendResponse(&Client.Out, "400 Bad Request", "", "");
+			return;
+		}
+
+		Client.Out.append("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ");
+		Client.Out.append(GetAcceptKey(Key));
+		Client.Out.append("\r\n\r\n");
+		Client.IsWebSocket = true;
+		Client.WantsState = true;
+	} else if (Method == "GET" && Path == "/api/library") {
+		// The page only changes with the library, so its version makes the ETag
+		const std::shared_ptr<const PlayerState_t> State = MusicPlayer.GetState();
+		const std::vector<LibraryTrack_t>& Tracks = State->Library->Tracks;
+		const size_t Offset = std::min(GetQueryNumber(Query, "offset", 0), Tracks.size());
+		const size_t Limit = std::clamp<size_t>(GetQueryNumber(Query, "limit", 100), 1, MaxPage);
+
+		char Tag[80];
+		snprintf(Tag, sizeof(Tag), "\"%llu-%zu-%zu\"", static_cast<unsigned long long>(State->Library->Version), Offset, Limit);
+		std::string Extra = "Content-Type: application/json\r\nCache-Control: no-cache\r\nETag: ";
+		Extra += Tag;
+		Extra += "\r\n";
+		if (GetHeader(Headers, "If-None-Match") == Tag) {
+			AppendResponse(&Client.Out, "304 Not Modified", Extra.substr(Extra.find("Cache-Control")), "");
+			return;
+		}
+
+		char Head[96];
+		snprintf(Head, sizeof(Head), "{\"version\":%llu,\"total\":%zu,\"offset\":%zu,\"tracks\":[", static_cast<unsigned long long>(State->Library->Version), Tracks.size(), Offset);
+		std::string Page = Head;
+		for (size_t i = Offset; i < std::min(Offset + Limit, Tracks.size()); i++) {
+			char Id[32];
+			snprintf(Id, sizeof(Id), "%s{\"id\":%u,\"title\":\"", i > Offset ? "," : "", Tracks[i].Id);
+			Page += Id;
+			ControlServer_t::AppendEscaped(&Page, Tracks[i].Title);
+			Page += "\"}";
+		}
+		Page += "]}";
+		AppendResponse(&Client.Out, "200 OK", Extra, Page);
+	} else if (Method == "GET" && Path == "/api/state") {
+		std::string Line;
+		ControlServer_t::AppendState(&Line);
+		Line.pop_back();
+		AppendResponse(&Client.Out, "200 OK", "Content-Type: application/json\r\nCache-Control: no-store\r\n", Line);
+	} else if (Method == "POST" && Path == "/api/command") {
+		// Forms can't send JSON, and other pages have to ask first, which nothing here answers
+		const std::string_view Type = GetHeader(Headers, "Content-Type");
+		if (Type.substr(0, Type.find(';')) != "application/json") {
+			AppendResponse(&Client.Out, "415 Unsupported Media Type", "", "");
+			return;
+		}
+
+		std::string Request(Body);
+		if (Request.empty() || Request.back() != '\n')
+			Request.push_back('\n');
+
+		std::string Reply;
+		bool IsSubscribed = false;
+		ControlServer_t::HandleRequest(Request.substr(0, Request.find('\n')), &Reply, &IsSubscribed);
+		AppendResponse(&Client.Out, "200 OK", "Content-Type: application/json\r\n", Reply);
+	} else {
+		AppendResponse(&Client.Out, "404 Not Found", "", "");
+	}
+}
+
+bool RemoteServer_t::HandleHttp(Client_t& Client) {
+	const size_t HeaderEnd = Client.In.find("\r\n\r\n");
+	if (HeaderEnd == std::string::npos) {
+		if (Client.In.size() > MaxRequest)
+			Client.IsClosed = true;
+		return false;
+	}
+
+	const std::string_view Head = std::string_view(Client.In).substr(0, HeaderEnd);
+	const size_t LineEnd = Head.find("\r\n");
+	const std::string_view RequestLine = Head.substr(0, LineEnd);
+	const std::string_view Headers = LineEnd == std::string_view::npos ? std::string_view() : Head.substr(LineEnd + 2);
+	const size_t MethodEnd = RequestLine.find(' ');
+	const size_t TargetEnd = RequestLine.find(' ', MethodEnd + 1);
+	const std::string_view Length = GetHeader(Headers, "Content-Length");
+	const size_t BodyLength = Length.empty() ? 0 : strtoull(std::string(Length).c_str(), nullptr, 10);
+	if (MethodEnd == std::string_view::npos || TargetEnd == std::string_view::npos || BodyLength > MaxRequest) {
+		Client.IsClosed = true;
+		return false;
+	}
+	if (Client.In.size() < HeaderEnd + 4 + BodyLength)
+		return false;
+
+	this->Requests.fetch_add(1, std::memory_order_relaxed);
+	this->Route(Client, RequestLine.substr(0, MethodEnd), RequestLine.substr(MethodEnd + 1, TargetEnd - MethodEnd - 1), Headers,
+		std::string_view(Client.In).substr(HeaderEnd + 4, BodyLength));
+	if (GetHeader(Headers, "Connection") == "close")
+		Client.IsClosing = true;
+	Client.In.erase(0, HeaderEnd + 4 + BodyLength);
+	return !Client.IsClosing;
+}
+
+bool RemoteServer_t::HandleFrame(Client_t& Client) {
+	const std::string& In = Client.In;
+	if (In.size() < 2)
+		return false;
+
+	const uint8_t First = static_cast<uint8_t>(In[0]);
+	const uint8_t Second = static_cast<uint8_t>(In[1]);
+	size_t Header = 2;
+	uint64_t Length = Second & 0x7F;
+	if (Length == 126) {
+		if (In.size() < 4)
+			return false;
+		Length = static_cast<uint8_t>(In[2]) << 8 | static_cast<uint8_t>(In[3]);
+		Header = 4;
+	} else if (Length == 127) {
+		if (In.size() < 10)
+			return false;
+		Length = 0;
+		for (int i = 0; i < 8; i++)
+			Length = Length << 8 | static_cast<uint8_t>(In[2 + i]);
+		Header = 10;
+	}
+
+	// Clients have to mask, and nothing here needs fragmented messages
+	if (!(Second & 0x80) || !(First & 0x80) || Length > MaxRequest) {
+		Client.IsClosed = true;
+		return false;
+	}
+	if (In.size() < Header + 4 + Length)
+		return false;
+
+	std::string Payload = In.substr(Header + 4, static_cast<size_t>(Length));
+	for (size_t i = 0; i < Payload.size(); i++)
+		Payload[i] ^= In[Header + i % 4];
+	Client.In.erase(0, Header + 4 + static_cast<size_t>(Length));
+
+	switch (First & 0x0F) {
+	case 0x1: {
+		this->Requests.fetch_add(1, std::memory_order_relaxed);
+		if (Payload.empty() || Payload.back() != '\n')
+			Payload.push_back('\n');
+
+		std::string Replies;
+		bool IsSubscribed = true;
+		size_t Start = 0;
+		for (size_t End; (End = Payload.find('\n', Start)) != std::string::npos; Start = End + 1)
+			ControlServer_t::HandleRequest(std::string_view(Payload).substr(Start, End - Start), &Replies, &IsSubscribed);
+		AppendLineFrames(&Client.Out, Replies);
+		break;
+	}
+	case 0x8:
+		AppendFrame(&Client.Out, 0x8, Payload.substr(0, 2));
+		Client.IsClosing = true;
+		return false;
+	case 0x9:
+		AppendFrame(&Client.Out, 0xA, Payload);
+		break;
+	default:
+		break;
+	}
+	return true;
+}
+
+void RemoteServer_t::Accept() {
+	for (;;) {
+		const Socket_t Socket = AcceptSocket(this->Listener);
+		if (Socket == NoSocket)
+			return;
+
+		if (this->Clients.size() >= MaxClients) {
+			CloseSocket(Socket);
+			continue;
+		}
+		Client_t Client;
+		Client.Socket = Socket;
+		this->Clients.push_back(std::move(Client));
+	}
+}
+
+void RemoteServer_t::Receive(Client_t& Client) {
+	char Buffer[16384];
+	for (;;) {
+		const int Received = ReceiveSocket(Client.Socket, Buffer, sizeof(Buffer));
+		if (Received == 0 || (Received < 0 && !IsWouldBlock())) {
+			Client.IsClosed = true;
+			return;
+		}
+		if (Received < 0)
+			break;
+		Client.In.append(Buffer, Received);
+		if (Received < static_cast<int>(sizeof(Buffer)))
+			break;
+	}
+
+	while (!Client.IsClosed && !Client.IsClosing && (Client.IsWebSocket ? this->HandleFrame(Client) : this->HandleHttp(Client))) {}
+
+	if (Client.Out.size() > MaxPending)
+		Client.IsClosed = true;
+}
+
+void RemoteServer_t::Flush(Client_t& Client) {
+	if (Client.WantsState && Client.Out.size() < MaxPending / 2) {
+		std::string Line;
+		ControlServer_t::AppendState(&Line);
+		AppendLineFrames(&Client.Out, Line);
+		Client.WantsState = false;
+	}
+
+	size_t Sent = 0;
+	while (Sent < Client.Out.size()) {
+		const int Result = SendSocket(Client.Socket, Client.Out.data() + Sent, Client.Out.size() - Sent);
+		if (Result <= 0) {
+			if (!IsWouldBlock())
+				Client.IsClosed = true;
+			break;
+		}
+		Sent += Result;
+	}
+	Client.Out.erase(0, Sent);
+
+	if (Client.IsClosing && Client.Out.empty())
+		Client.IsClosed = true;
+}
+
+void RemoteServer_t::Broadcast(const std::string& Frame) {
+	for (Client_t& Client : this->Clients) {
+		if (!Client.IsWebSocket || Client.IsClosing)
+			continue;
+
+		// Behind already, it gets the latest state once it caught up
+		if (Client.Out.size() < MaxPending / 2) {
+			Client.Out += Frame;
+			this->Pushes.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			Client.WantsState = true;
+		}
+	}
+}
+
+void RemoteServer_t::ServerMain() {
+	using Clock_t = std::chrono::steady_clock;
+	std::vector<PollEntry_t> Entries;
+	std::string Frame, Line;
+	Clock_t::time_point LastPosition = Clock_t::now();
+	while (this->IsRunning) {
+		Entries.clear();
+		Entries.push_back({ this->Listener });
+		Entries.push_back({ this->WakeRead });
+		bool HasWebSockets = false;
+		for (const Client_t& Client : this->Clients) {
+			Entries.push_back({ Client.Socket, !Client.Out.empty() });
+			HasWebSockets |= Client.IsWebSocket;
+		}
+
+		// Only wakes up on its own while someone watches the position move
+		const std::shared_ptr<const PlayerState_t> Playing = MusicPlayer.GetState();
+		const bool IsMoving = HasWebSockets && Playing->IsPlaying && Playing->Clock;
+		int Timeout = -1;
+		if (IsMoving) {
+			const auto Due = LastPosition + std::chrono::milliseconds(PositionMilliseconds);
+			Timeout = static_cast<int>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(Due - Clock_t::now()).count(), 0));
+		}
+
+		if (PollSockets(Entries.data(), Entries.size(), Timeout) < 0 && !IsWouldBlock()) {
+			printf("Remote server poll failed\n");
+			break;
+		}
+
+		if (Entries[1].IsReadable) {
+			char Drain[64];
+			this->IsWakePending = false;
+			while (ReceiveSocket(this->WakeRead, Drain, sizeof(Drain)) > 0) {}
+
+			const uint64_t Version = MusicPlayer.GetState()->Version;
+			if (Version != this->SentVersion) {
+				this->SentVersion = Version;
+				Line.clear();
+				Frame.clear();
+				ControlServer_t::AppendState(&Line);
+				AppendLineFrames(&Frame, Line);
+				this->Broadcast(Frame);
+			}
+		}
+
+		if (IsMoving && Clock_t::now() - LastPosition >= std::chrono::milliseconds(PositionMilliseconds)) {
+			const std::shared_ptr<const PlayerState_t> State = MusicPlayer.GetState();
+			if (State->Clock) {
+				char Position[96];
+				snprintf(Position, sizeof(Position), "{\"event\":\"position\",\"track\":%u,\"position\":%.3f}", State->CurrentTrack,
+					std::min(State->Clock->Peek(), State->Duration));
+				Frame.clear();
+				AppendFrame(&Frame, 0x1, Position);
+				this->Broadcast(Frame);
+			}
+			LastPosition = Clock_t::now();
+		} else if (!IsMoving) {
+			LastPosition = Clock_t::now() - std::chrono::milliseconds(PositionMilliseconds);
+		}
+
+		const size_t Polled = this->Clients.size();
+		for (size_t i = 0; i < Polled; i++) {
+			Client_t& Client = this->Clients[i];
+			if (Entries[i + 2].IsReadable)
+				this->Receive(Client);
+			if (!Client.IsClosed)
+				this->Flush(Client);
+		}
+		if (Entries[0].IsReadable)
+			this->Accept();
+
+		for (size_t i = 0; i < this->Clients.size();) {
+			if (this->Clients[i].IsClosed) {
+				CloseSocket(this->Clients[i].Socket);
+				this->Clients[i] = std::move(this->Clients.back());
+				this->Clients.pop_back();
+			} else {
+				i++;
+			}
+		}
+
+		this->CpuSeconds.store(GetThreadCpuSeconds(), std::memory_order_relaxed);
+	}
+}
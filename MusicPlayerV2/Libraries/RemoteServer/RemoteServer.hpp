@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../Socket/Socket.hpp"
+
+// Remote control over HTTP on 127.0.0.1, for phones and browsers next to the native UI.
+//   GET  /api/library?offset=0&limit=100   A page of the library, with an ETag that changes with the library
+//   GET  /api/state                        The state line of the control socket
+//   POST /api/command                      Body is one control socket request, answered like there.
+//                                          Content-Type has to be application/json
+//   GET  /ws                               WebSocket, text messages are control socket requests. Every new
+//                                          state is pushed without asking, and the position while playing
+// Host has to be 127.0.0.1:<port> or localhost:<port> and an Origin, if any, the same, so other pages
+// in a browser can't drive the player. Requests go through the same command path as the control socket and the UI. One thread serves
+// every connection, pushes are built once and a client that falls behind only gets the latest state.
+class RemoteServer_t {
+public:
+	static constexpr size_t MaxClients = 256;
+	static constexpr size_t MaxRequest = 16 * 1024;
+	static constexpr size_t MaxPending = 256 * 1024;
+	static constexpr int PositionMilliseconds = 250;	// Between position pushes while playing
+	static constexpr size_t MaxPage = 500;				// Tracks per library page
+
+private:
+	struct Client_t {
+		Socket_t Socket = NoSocket;
+		std::string In;
+		std::string Out;
+		bool IsWebSocket = false;
+		bool WantsState = false;
+		bool IsClosing = false;	// Closed once Out is sent
+		bool IsClosed = false;
+	};
+
+	Socket_t Listener = NoSocket;
+	Socket_t WakeRead = NoSocket;
+	Socket_t WakeWrite = NoSocket;
+	uint16_t Port = 0;
+	std::vector<Client_t> Clients;
+	uint64_t SentVersion = 0;
+
+	std::atomic<bool> IsRunning = false;
+	std::atomic<bool> IsWakePending = false;
+	std::mutex WakeLock;
+	bool IsListening = false;
+	std::thread Thread;
+
+	std::atomic<uint64_t> Requests = 0;
+	std::atomic<uint64_t> Pushes = 0;
+	std::atomic<double> CpuSeconds = 0.0;
+
+	void ServerMain();
+	void Wake();
+	void Accept();
+	void Receive(Client_t& Client);
+	void Flush(Client_t& Client);
+	void Broadcast(const std::string& Frame);
+
+	// Both false once the request is incomplete, the client is dropped if it's malformed
+	bool HandleHttp(Client_t& Client);
+	bool HandleFrame(Client_t& Client);
+	void Route(Client_t& Client, std::string_view Method, std::string_view Target, std::string_view Headers, std::string_view Body);
+
+	static void OnState(void* User);
+
+public:
+	~RemoteServer_t();
+
+	// Port 0 picks a free one. Registers for state changes, so call it before MusicPlayer.Start()
+	bool Start(uint16_t Port);
+	void Stop();
+
+	uint16_t GetPort() const;
+	uint64_t GetRequests() const;		// HTTP requests and WebSocket messages
+	uint64_t GetPushes() const;			// Frames pushed to WebSockets without being asked
+	double GetCpuSeconds() const;		// Spent on the server thread
+
+	// For clients, the Sec-WebSocket-Accept value that answers Key
+	static std::string GetAcceptKey(std::string_view Key);
+
+} extern RemoteServer;
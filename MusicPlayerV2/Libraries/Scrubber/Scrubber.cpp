@@ -0,0 +1,352 @@
+#include "Scrubber.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static int64_t GetNanoseconds() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Scrubber_t::~Scrubber_t() {
+	this->Stop();
+}
+
+HSTREAM Scrubber_t::OpenDecoder(uint64_t Offset) const {
+	// Blocks jump around the file, the mapping only reads the pages they touch
+	if (this->Mapping && Offset < this->Mapping->GetSize())
+		return BASS_StreamCreateFile(TRUE, this->Mapping->GetData() + Offset, 0, this->Mapping->GetSize() - Offset, BASS_STREAM_DECODE | BASS_SAMPLE_FLOAT);
+
+#ifdef _WIN32
+	return BASS_StreamCreateFile(FALSE, this->File.c_str(), Offset, 0, BASS_STREAM_DECODE | BASS_SAMPLE_FLOAT | BASS_UNICODE);
+#else
+	return BASS_StreamCreateFile(FALSE, this->File.c_str(), Offset, 0, BASS_STREAM_DECODE | BASS_SAMPLE_FLOAT);
+#endif
+}
+
+bool Scrubber_t::Open() {
+	this->Mapping = MappedFile_t::Map(this->File, false);
+	this->Decoder = this->OpenDecoder(0);
+	BASS_CHANNELINFO Info;
+	if (!this->Decoder || !BASS_ChannelGetInfo(this->Decoder, &Info) || !Info.chans) {
+		printf("Failed to open '%s' for scrubbing\n", this->File.string().c_str());
+		return false;
+	}
+
+	this->SampleRate = Info.freq;
+	this->Channels = Info.chans;
+	this->Length = static_cast<int64_t>(BASS_ChannelGetLength(this->Decoder, BASS_POS_BYTE) / (this->Channels * sizeof(float)));
+
+	// With a table every block is decoded from its own frame, the full stream is only needed without one
+	this->SeekTable = SeekTable_t::Open(this->File);
+	if (this->SeekTable && this->SeekTable->GetSampleRate() != this->SampleRate)
+		this->SeekTable = nullptr;
+	if (this->SeekTable) {
+		BASS_StreamFree(this->Decoder);
+		this->Decoder = NULL;
+	}
+
+	this->DecodeBuffer.assign(BlockFrames * this->Channels, 0.0f);
+	{
+		std::lock_guard<std::mutex> Lock(this->CacheLock);
+		for (Block_t& Block : this->Cache) {
+			Block.Index = -1;
+			Block.Samples.assign(BlockFrames * this->Channels, 0.0f);
+		}
+	}
+
+	// Periodic Hann, two of them half a grain apart add up to exactly one
+	this->Window.resize(GrainFrames);
+	for (uint32_t i = 0; i < GrainFrames; i++)
+		this->Window[i] = 0.5f - 0.5f * cosf(6.2831853f * i / GrainFrames);
+
+	for (std::vector<float>& Grain : this->Grains)
+		Grain.assign(GrainFrames * this->Channels, 0.0f);
+	this->HopPosition = HopFrames;
+	this->GrainTarget = -1;
+	this->MeasuredGeneration = this->Generation.load();
+
+	this->IsReady.store(true, std::memory_order_release);
+
+	if (this->HasOutput) {
+		// No playback buffer, the device pulls grains as it needs them and the cursor is heard right away
+		this->Output = BASS_StreamCreate(this->SampleRate, this->Channels, BASS_SAMPLE_FLOAT, &Scrubber_t::StreamProc, this);
+		if (!this->Output) {
+			printf("Failed to create the scrub stream\n");
+			return false;
+		}
+		BASS_ChannelSetAttribute(this->Output, BASS_ATTRIB_BUFFER, 0.0f);
+		BASS_ChannelPlay(this->Output, FALSE);
+	}
+	return true;
+}
+
+bool Scrubber_t::Decode(int64_t Block) {
+	const DWORD BytesPerFrame = this->Channels * sizeof(float);
+	const DWORD Bytes = BlockFrames * BytesPerFrame;
+	const int64_t First = Block * BlockFrames;
+
+	HSTREAM Stream = this->Decoder;
+	bool IsPositioned = false;
+	if (this->SeekTable) {
+		const SeekTable_t::Point_t Point = this->SeekTable->Find(static_cast<uint64_t>(First));
+		Stream = this->OpenDecoder(Point.Offset);
+		IsPositioned = Stream && BASS_ChannelSetPosition(Stream, Point.Discard * BytesPerFrame, BASS_POS_BYTE | BASS_POS_DECODETO);
+	} else {
+		IsPositioned = BASS_ChannelSetPosition(Stream, static_cast<QWORD>(First) * BytesPerFrame, BASS_POS_BYTE);
+	}
+
+	// The last block of the file comes up short, the rest stays silent
+	std::fill(this->DecodeBuffer.begin(), this->DecodeBuffer.end(), 0.0f);
+	DWORD Read = 0;
+	while (IsPositioned && Read < Bytes) {
+		const DWORD Got = BASS_ChannelGetData(Stream, reinterpret_cast<uint8_t*>(this->DecodeBuffer.data()) + Read, Bytes - Read);
+		if (Got == static_cast<DWORD>(-1) || Got == 0)
+			break;
+		Read += Got;
+	}
+
+	if (this->SeekTable && Stream)
+		BASS_StreamFree(Stream);
+	if (!IsPositioned)
+		return false;
+
+	// Takes the place of whatever is furthest from the cursor, swapped in so the lock is held only briefly
+	const int64_t Center = static_cast<int64_t>(this->Target.load() * this->SampleRate) / BlockFrames;
+	std::lock_guard<std::mutex> Lock(this->CacheLock);
+	Block_t* Victim = &this->Cache[0];
+	for (Block_t& Cached : this->Cache) {
+		if (Cached.Index < 0) {
+			Victim = &Cached;
+			break;
+		}
+		if (std::abs(Cached.Index - Center) > std::abs(Victim->Index - Center))
+			Victim = &Cached;
+	}
+	Victim->Index = Block;
+	Victim->Samples.swap(this->DecodeBuffer);
+	return true;
+}
+
+bool Scrubber_t::CutGrain(int64_t Center, float* Out) {
+	std::unique_lock<std::mutex> Lock(this->CacheLock, std::try_to_lock);
+	if (!Lock.owns_lock())
+		return false;
+
+	const int64_t Start = Center - HopFrames;
+	for (uint32_t Done = 0; Done < GrainFrames;) {
+		const int64_t Frame = Start + Done;
+		if (Frame < 0 || Frame >= this->Length) {
+			const uint32_t Count = Frame < 0 ? static_cast<uint32_t>(std::min<int64_t>(-Frame, GrainFrames - Done)) : GrainFrames - Done;
+			memset(Out + Done * this->Channels, 0, Count * this->Channels * sizeof(float));
+			Done += Count;
+			continue;
+		}
+
+		const int64_t Index = Frame / BlockFrames;
+		const Block_t* Block = nullptr;
+		for (const Block_t& Cached : this->Cache) {
+			if (Cached.Index == Index)
+				Block = &Cached;
+		}
+		if (!Block)
+			return false;
+
+		const uint32_t Offset = static_cast<uint32_t>(Frame - Index * BlockFrames);
+		const uint32_t Count = std::min(GrainFrames - Done, BlockFrames - Offset);
+		memcpy(Out + Done * this->Channels, Block->Samples.data() + Offset * this->Channels, Count * this->Channels * sizeof(float));
+		Done += Count;
+	}
+	Lock.unlock();
+
+	for (uint32_t i = 0; i < GrainFrames; i++) {
+		for (uint32_t Channel = 0; Channel < this->Channels; Channel++)
+			Out[i * this->Channels + Channel] *= this->Window[i];
+	}
+	return true;
+}
+
+void Scrubber_t::StartGrain() {
+	// The newer grain starts fading out, the older one has played in full
+	this->Grains[0].swap(this->Grains[1]);
+	float* Grain = this->Grains[1].data();
+
+	const uint32_t Generation = this->Generation.load(std::memory_order_acquire);
+	const int64_t Center = static_cast<int64_t>(this->Target.load(std::memory_order_relaxed) * this->SampleRate);
+
+	// Holding still is silence rather than the same grain over and over
+	if (Center == this->GrainTarget) {
+		memset(Grain, 0, GrainFrames * this->Channels * sizeof(float));
+		return;
+	}
+
+	if (!this->CutGrain(Center, Grain)) {
+		memset(Grain, 0, GrainFrames * this->Channels * sizeof(float));
+		this->GrainsMissed++;
+		return;
+	}
+	this->GrainTarget = Center;
+
+	if (Generation != this->MeasuredGeneration) {
+		this->MeasuredGeneration = Generation;
+		const double Latency = static_cast<double>(GetNanoseconds() - this->MoveTime.load(std::memory_order_relaxed)) / 1e6;
+		this->LatencyTotal.store(this->LatencyTotal.load(std::memory_order_relaxed) + Latency, std::memory_order_relaxed);
+		this->LatencyMax.store(std::max(this->LatencyMax.load(std::memory_order_relaxed), Latency), std::memory_order_relaxed);
+		this->LatencyCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void Scrubber_t::Render(float* Out, uint32_t Frames) {
+	if (!this->IsReady.load(std::memory_order_acquire)) {
+		memset(Out, 0, Frames * std::max<uint32_t>(this->Channels, 1) * sizeof(float));
+		return;
+	}
+
+	const uint32_t Channels = this->Channels;
+	const float* Fading = this->Grains[0].data();
+	const float* Rising = this->Grains[1].data();
+	for (uint32_t Done = 0; Done < Frames;) {
+		if (this->HopPosition == HopFrames) {
+			this->StartGrain();
+			this->HopPosition = 0;
+			Fading = this->Grains[0].data();
+			Rising = this->Grains[1].data();
+		}
+
+		const uint32_t Count = std::min(Frames - Done, HopFrames - this->HopPosition);
+		const float* From = Fading + (HopFrames + this->HopPosition) * Channels;
+		const float* To = Rising + this->HopPosition * Channels;
+		for (uint32_t i = 0; i < Count * Channels; i++)
+			Out[Done * Channels + i] = From[i] + To[i];
+
+		this->HopPosition += Count;
+		Done += Count;
+	}
+}
+
+DWORD CALLBACK Scrubber_t::StreamProc(HSTREAM, void* Buffer, DWORD Length, void* User) {
+	Scrubber_t* Scrubber = static_cast<Scrubber_t*>(User);
+	Scrubber->Render(static_cast<float*>(Buffer), Length / (Scrubber->Channels * sizeof(float)));
+	return Length;
+}
+
+void Scrubber_t::WorkerMain() {
+	if (!this->Open())
+		return;
+
+	uint32_t Seen = this->Generation.load() - 1;
+	while (this->IsRunning) {
+		{
+			std::unique_lock<std::mutex> Lock(this->WorkLock);
+			this->WorkSignal.wait(Lock, [&] {
+				return !this->IsRunning || this->Generation.load() != Seen;
+			});
+		}
+		Seen = this->Generation.load();
+
+		// Nearest blocks first, a new move starts over from its own cursor
+		const int64_t Center = static_cast<int64_t>(this->Target.load() * this->SampleRate) / BlockFrames;
+		const int64_t LastBlock = (this->Length - 1) / BlockFrames;
+		for (int64_t Distance = 0; Distance <= Lookaround && this->IsRunning && this->Generation.load() == Seen; Distance++) {
+			for (const int64_t Block : { Center + Distance, Center - Distance }) {
+				if (Block < 0 || Block > LastBlock)
+					continue;
+
+				bool IsCached = false;
+				{
+					std::lock_guard<std::mutex> Lock(this->CacheLock);
+					for (const Block_t& Cached : this->Cache)
+						IsCached |= Cached.Index == Block;
+				}
+				if (!IsCached)
+					this->Decode(Block);
+			}
+		}
+	}
+}
+
+bool Scrubber_t::Start(const std::filesystem::path& File, double Seconds, bool HasOutput) {
+	this->Stop();
+
+	this->File = File;
+	this->HasOutput = HasOutput;
+	this->LatencyTotal = 0.0;
+	this->LatencyMax = 0.0;
+	this->LatencyCount = 0;
+	this->GrainsMissed = 0;
+	this->SetPosition(Seconds);
+
+	this->IsRunning = true;
+	this->Worker = std::thread(&Scrubber_t::WorkerMain, this);
+	return true;
+}
+
+void Scrubber_t::Stop() {
+	{
+		std::lock_guard<std::mutex> Lock(this->WorkLock);
+		this->IsRunning = false;
+	}
+	this->WorkSignal.notify_all();
+	if (this->Worker.joinable())
+		this->Worker.join();
+
+	if (this->Output) {
+		BASS_StreamFree(this->Output);
+		this->Output = NULL;
+	}
+	if (this->Decoder) {
+		BASS_StreamFree(this->Decoder);
+		this->Decoder = NULL;
+	}
+	this->IsReady = false;
+	this->SeekTable = nullptr;
+	this->Mapping = nullptr;
+}
+
+void Scrubber_t::SetPosition(double Seconds) {
+	if (Seconds == this->Target.load(std::memory_order_relaxed) && this->IsRunning)
+		return;
+
+	{
+		std::lock_guard<std::mutex> Lock(this->WorkLock);
+		this->MoveTime.store(GetNanoseconds(), std::memory_order_relaxed);
+		this->Target.store(std::max(Seconds, 0.0), std::memory_order_relaxed);
+		this->Generation.fetch_add(1, std::memory_order_release);
+	}
+	this->WorkSignal.notify_one();
+}
+
+bool Scrubber_t::GetIsReady() const {
+	return this->IsReady.load(std::memory_order_acquire);
+}
+
+uint32_t Scrubber_t::GetSampleRate() const {
+	return this->SampleRate;
+}
+
+uint32_t Scrubber_t::GetChannels() const {
+	return this->Channels;
+}
+
+double Scrubber_t::GetLength() const {
+	return this->SampleRate ? static_cast<double>(this->Length) / this->SampleRate : 0.0;
+}
+
+double Scrubber_t::GetAverageLatency() const {
+	const uint64_t Count = this->LatencyCount.load();
+	return Count ? this->LatencyTotal.load() / Count : 0.0;
+}
+
+double Scrubber_t::GetMaxLatency() const {
+	return this->LatencyMax.load();
+}
+
+uint64_t Scrubber_t::GetLatencyCount() const {
+	return this->LatencyCount.load();
+}
+
+uint64_t Scrubber_t::GetGrainsMissed() const {
+	return this->GrainsMissed.load();
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <bass/bass.h>
+
+#include "../SeekTable/SeekTable.hpp"
+#include "../MappedFile/MappedFile.hpp"
+
+// Audible preview while the seek bar is dragged. A worker thread decodes blocks of PCM around
+// the cursor into a small cache, through the seek table when the file has one. The audio side
+// cuts Hann windowed grains centered on the cursor out of that cache and never waits on the
+// decoder, a grain that isn't cached yet plays as silence. Grains overlap by half so the windows
+// sum to a flat gain, and a cursor that stopped moving fades out instead of looping one grain.
+class Scrubber_t {
+public:
+	static constexpr uint32_t GrainFrames = 2048;	// About 46 ms at 44.1 kHz
+	static constexpr uint32_t HopFrames = GrainFrames / 2;
+	static constexpr uint32_t BlockFrames = 16384;	// Decoded at once
+	static constexpr int64_t Lookaround = 2;		// Blocks kept decoded on either side of the cursor
+	static constexpr int Blocks = 8;
+
+private:
+	struct Block_t {
+		int64_t Index = -1;
+		std::vector<float> Samples;
+	};
+
+	// Written by the worker, the audio side only ever try_locks
+	std::mutex CacheLock;
+	Block_t Cache[Blocks];
+
+	// Set up by the worker before IsReady
+	std::filesystem::path File;
+	std::shared_ptr<const SeekTable_t> SeekTable;
+	std::shared_ptr<const MappedFile_t> Mapping;
+	HSTREAM Decoder = NULL;
+	uint32_t SampleRate = 0;
+	uint32_t Channels = 0;
+	int64_t Length = 0;	// Frames
+	std::vector<float> DecodeBuffer;
+	std::atomic<bool> IsReady = false;
+
+	// Cursor from the UI, the generation changes with every move
+	std::atomic<double> Target = 0.0;	// Seconds
+	std::atomic<uint32_t> Generation = 0;
+	std::atomic<int64_t> MoveTime = 0;		// Nanoseconds on steady_clock
+
+	// Only touched by whoever calls Render()
+	std::vector<float> Grains[2];		// The one fading out and the one fading in
+	std::vector<float> Window;
+	uint32_t HopPosition = HopFrames;
+	int64_t GrainTarget = -1;
+	uint32_t MeasuredGeneration = 0;
+
+	// Move to the first grain cut at the new cursor
+	std::atomic<double> LatencyTotal = 0.0;
+	std::atomic<double> LatencyMax = 0.0;
+	std::atomic<uint64_t> LatencyCount = 0;
+	std::atomic<uint64_t> GrainsMissed = 0;
+
+	HSTREAM Output = NULL;
+	bool HasOutput = false;
+
+	std::mutex WorkLock;
+	std::condition_variable WorkSignal;
+	uint32_t WorkGeneration = 0;
+	std::atomic<bool> IsRunning = false;
+	std::thread Worker;
+
+	HSTREAM OpenDecoder(uint64_t Offset) const;
+	bool Open();
+	bool Decode(int64_t Block);
+	bool CutGrain(int64_t Center, float* Out);
+	void StartGrain();
+	void WorkerMain();
+
+	static DWORD CALLBACK StreamProc(HSTREAM Handle, void* Buffer, DWORD Length, void* User);
+
+public:
+	~Scrubber_t();
+
+	// Opens File on the worker thread, plays through its own BASS stream when HasOutput is set,
+	// otherwise whoever wants the sound pulls it with Render()
+	bool Start(const std::filesystem::path& File, double Seconds, bool HasOutput = true);
+	void Stop();
+
+	// Any thread, usually the UI
+	void SetPosition(double Seconds);
+
+	// Interleaved float frames at GetSampleRate() and GetChannels(), silence until the file is open
+	void Render(float* Out, uint32_t Frames);
+
+	bool GetIsReady() const;
+	uint32_t GetSampleRate() const;
+	uint32_t GetChannels() const;
+	double GetLength() const;	// Seconds
+
+	// In milliseconds, from SetPosition() until Render() started a grain there
+	double GetAverageLatency() const;
+	double GetMaxLatency() const;
+	uint64_t GetLatencyCount() const;
+	// Grains that found nothing decoded at the cursor yet
+	uint64_t GetGrainsMissed() const;
+};
@@ -0,0 +1,293 @@
+#include "SeekTable.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace {
+	struct Header_t {
+		uint32_t Length;
+		uint32_t SampleRate;
+		uint32_t SamplesPerFrame;
+		uint32_t SideInfo;
+	};
+
+	// MPEG 1, 2 and 2.5 layer III, free format is not supported
+	bool ParseHeader(const uint8_t* Bytes, Header_t* Header) {
+		if (Bytes[0] != 0xFF || (Bytes[1] & 0xE0) != 0xE0)
+			return false;
+
+		const int Version = (Bytes[1] >> 3) & 3;	// 0 is 2.5, 2 is 2, 3 is 1
+		const int Layer = (Bytes[1] >> 1) & 3;
+		const int BitrateIndex = Bytes[2] >> 4;
+		const int RateIndex = (Bytes[2] >> 2) & 3;
+		if (Version == 1 || Layer != 1 || BitrateIndex == 0 || BitrateIndex == 15 || RateIndex == 3)
+			return false;
+
+		static constexpr uint16_t Bitrates[2][16] = {
+			{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 },
+			{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+		};
+		static constexpr uint32_t Rates[3] = { 44100, 48000, 32000 };
+
+		const bool IsMpeg1 = Version == 3;
+		const bool IsMono = (Bytes[3] >> 6) == 3;
+		const uint32_t Bitrate = Bitrates[IsMpeg1 ? 0 : 1][BitrateIndex] * 1000;
+
+		Header->SampleRate = Rates[RateIndex] >> (IsMpeg1 ? 0 : Version == 2 ? 1 : 2);
+		Header->SamplesPerFrame = IsMpeg1 ? 1152 : 576;
+		Header->Length = (IsMpeg1 ? 144 : 72) * Bitrate / Header->SampleRate + ((Bytes[2] >> 1) & 1);
+		Header->SideInfo = IsMpeg1 ? (IsMono ? 17 : 32) : (IsMono ? 9 : 17);
+		return true;
+	}
+
+	uint32_t ReadBigEndian(const uint8_t* Bytes) {
+		return (static_cast<uint32_t>(Bytes[0]) << 24) | (static_cast<uint32_t>(Bytes[1]) << 16) | (static_cast<uint32_t>(Bytes[2]) << 8) | Bytes[3];
+	}
+
+	// Sequential reads through a window of the file, the frame walk never looks back far
+	class Reader_t {
+	private:
+		std::ifstream Stream;
+		std::vector<uint8_t> Buffer;
+		uint64_t Start = 0;
+		uint64_t Size = 0;
+
+	public:
+		uint64_t FileSize = 0;
+
+		bool Open(const std::filesystem::path& File) {
+			this->Stream.open(File, std::ios::binary);
+			if (!this->Stream)
+				return false;
+
+			this->Stream.seekg(0, std::ios::end);
+			this->FileSize = static_cast<uint64_t>(this->Stream.tellg());
+			this->Buffer.resize(1 << 20);
+			return true;
+		}
+
+		// Bytes at Offset, nullptr if the file ends before Length of them
+		const uint8_t* Peek(uint64_t Offset, size_t Length) {
+			if (Offset + Length > this->FileSize)
+				return nullptr;
+
+			if (Offset < this->Start || Offset + Length > this->Start + this->Size) {
+				this->Start = Offset;
+				this->Size = std::min<uint64_t>(this->Buffer.size(), this->FileSize - Offset);
+				this->Stream.clear();
+				this->Stream.seekg(static_cast<std::streamoff>(Offset));
+				this->Stream.read(reinterpret_cast<char*>(this->Buffer.data()), static_cast<std::streamsize>(this->Size));
+				if (static_cast<uint64_t>(this->Stream.gcount()) != this->Size)
+					return nullptr;
+			}
+			return this->Buffer.data() + (Offset - this->Start);
+		}
+	};
+}
+
+int64_t SeekTable_t::GetFileTime(const std::filesystem::path& File) {
+	std::error_code Error;
+	const auto Time = std::filesystem::last_write_time(File, Error);
+	return Error ? 0 : static_cast<int64_t>(Time.time_since_epoch().count());
+}
+
+bool SeekTable_t::Build(const std::filesystem::path& File) {
+	Reader_t Reader;
+	if (!Reader.Open(File)) {
+		printf("Failed to open %s for a seek table\n", File.string().c_str());
+		return false;
+	}
+
+	this->Offsets.clear();
+	this->SampleRate = 0;
+	this->Delay = 0;
+	uint32_t Padding = 0;
+
+	uint64_t Position = 0;
+	if (const uint8_t* Tag = Reader.Peek(0, 10); Tag && memcmp(Tag, "ID3", 3) == 0) {
+		const uint32_t TagSize = ((Tag[6] & 0x7F) << 21) | ((Tag[7] & 0x7F) << 14) | ((Tag[8] & 0x7F) << 7) | (Tag[9] & 0x7F);
+		Position = 10 + TagSize + ((Tag[5] & 0x10) ? 10 : 0);
+	}
+
+	// Garbage between frames is skipped, but not forever
+	constexpr uint64_t MaxResync = 64 * 1024;
+	uint64_t Resync = 0;
+
+	while (const uint8_t* Bytes = Reader.Peek(Position, 4)) {
+		Header_t Header;
+		if (!ParseHeader(Bytes, &Header) || (this->SampleRate && Header.SampleRate != this->SampleRate)) {
+			// Trailing tags end the audio
+			if (!this->Offsets.empty() && (memcmp(Bytes, "TAG", 3) == 0 || memcmp(Bytes, "APET", 4) == 0 || memcmp(Bytes, "LYRI", 4) == 0))
+				break;
+			if (++Resync > MaxResync)
+				break;
+
+			Position++;
+			continue;
+		}
+		Resync = 0;
+
+		// The first frame may be a Xing/Info frame without audio, LAME puts the gapless info behind it
+		if (!this->SampleRate) {
+			this->SampleRate = Header.SampleRate;
+			this->SamplesPerFrame = Header.SamplesPerFrame;
+
+			const uint8_t* Frame = Reader.Peek(Position, Header.Length);
+			const uint8_t* Xing = Frame ? Frame + 4 + Header.SideInfo : nullptr;
+			if (Xing && 4 + Header.SideInfo + 8 <= Header.Length && (memcmp(Xing, "Xing", 4) == 0 || memcmp(Xing, "Info", 4) == 0)) {
+				const uint32_t Flags = ReadBigEndian(Xing + 4);
+				const uint32_t Lame = 8 + ((Flags & 1) ? 4 : 0) + ((Flags & 2) ? 4 : 0) + ((Flags & 4) ? 100 : 0) + ((Flags & 8) ? 4 : 0);
+				if (4 + Header.SideInfo + Lame + 24 <= Header.Length && memcmp(Xing + Lame, "LAME", 4) == 0) {
+					const uint8_t* Gapless = Xing + Lame + 21;
+					this->Delay = ((Gapless[0] << 4) | (Gapless[1] >> 4)) + 529;
+					Padding = ((Gapless[1] & 0x0F) << 8) | Gapless[2];
+				}
+
+				Position += Header.Length;
+				continue;
+			}
+		}
+
+		if (Position > UINT32_MAX) {
+			printf("%s is too large for a seek table\n", File.string().c_str());
+			return false;
+		}
+
+		this->Offsets.push_back(static_cast<uint32_t>(Position));
+		Position += Header.Length;
+	}
+
+	if (this->Offsets.empty())
+		return false;
+
+	const uint64_t Decoded = static_cast<uint64_t>(this->Offsets.size()) * this->SamplesPerFrame;
+	const uint64_t Trimmed = this->Delay ? this->Delay - 529 + Padding : 0;
+	this->Samples = Decoded > Trimmed ? Decoded - Trimmed : 0;
+	this->FileSize = Reader.FileSize;
+	this->FileTime = GetFileTime(File);
+	return true;
+}
+
+bool SeekTable_t::Save(const std::filesystem::path& CacheFile) const {
+	std::error_code Error;
+	std::filesystem::create_directories(CacheFile.parent_path(), Error);
+
+	std::ofstream Stream(CacheFile, std::ios::binary | std::ios::trunc);
+	if (!Stream) {
+		printf("Failed to write %s\n", CacheFile.string().c_str());
+		return false;
+	}
+
+	const uint64_t Count = this->Offsets.size();
+	Stream.write(reinterpret_cast<const char*>(&Magic), sizeof(Magic));
+	Stream.write(reinterpret_cast<const char*>(&Version), sizeof(Version));
+	Stream.write(reinterpret_cast<const char*>(&this->FileSize), sizeof(this->FileSize));
+	Stream.write(reinterpret_cast<const char*>(&this->FileTime), sizeof(this->FileTime));
+	Stream.write(reinterpret_cast<const char*>(&this->SampleRate), sizeof(this->SampleRate));
+	Stream.write(reinterpret_cast<const char*>(&this->SamplesPerFrame), sizeof(this->SamplesPerFrame));
+	Stream.write(reinterpret_cast<const char*>(&this->Delay), sizeof(this->Delay));
+	Stream.write(reinterpret_cast<const char*>(&this->Samples), sizeof(this->Samples));
+	Stream.write(reinterpret_cast<const char*>(&Count), sizeof(Count));
+	Stream.write(reinterpret_cast<const char*>(this->Offsets.data()), static_cast<std::streamsize>(Count * sizeof(uint32_t)));
+	return static_cast<bool>(Stream);
+}
+
+bool SeekTable_t::Load(const std::filesystem::path& CacheFile, const std::filesystem::path& File) {
+	std::ifstream Stream(CacheFile, std::ios::binary);
+	if (!Stream)
+		return false;
+
+	uint32_t FileMagic = 0, FileVersion = 0;
+	uint64_t Count = 0;
+	Stream.read(reinterpret_cast<char*>(&FileMagic), sizeof(FileMagic));
+	Stream.read(reinterpret_cast<char*>(&FileVersion), sizeof(FileVersion));
+	Stream.read(reinterpret_cast<char*>(&this->FileSize), sizeof(this->FileSize));
+	Stream.read(reinterpret_cast<char*>(&this->FileTime), sizeof(this->FileTime));
+	Stream.read(reinterpret_cast<char*>(&this->SampleRate), sizeof(this->SampleRate));
+	Stream.read(reinterpret_cast<char*>(&this->SamplesPerFrame), sizeof(this->SamplesPerFrame));
+	Stream.read(reinterpret_cast<char*>(&this->Delay), sizeof(this->Delay));
+	Stream.read(reinterpret_cast<char*>(&this->Samples), sizeof(this->Samples));
+	Stream.read(reinterpret_cast<char*>(&Count), sizeof(Count));
+	if (!Stream || FileMagic != Magic || FileVersion != Version || !this->SamplesPerFrame)
+		return false;
+
+	// Stale once the music file changed
+	std::error_code Error;
+	const uint64_t CurrentSize = std::filesystem::file_size(File, Error);
+	if (Error || CurrentSize != this->FileSize || GetFileTime(File) != this->FileTime || Count > CurrentSize)
+		return false;
+
+	this->Offsets.resize(Count);
+	Stream.read(reinterpret_cast<char*>(this->Offsets.data()), static_cast<std::streamsize>(Count * sizeof(uint32_t)));
+	return static_cast<bool>(Stream) && !this->Offsets.empty();
+}
+
+SeekTable_t::Point_t SeekTable_t::Find(uint64_t Sample) const {
+	Point_t Point;
+	if (this->Offsets.empty())
+		return Point;
+
+	const uint64_t Raw = std::min(Sample, this->Samples) + this->Delay;
+	uint64_t Frame = Raw / this->SamplesPerFrame;
+	Frame = Frame > Priming ? Frame - Priming : 0;
+	Frame = std::min<uint64_t>(Frame, this->Offsets.size() - 1);
+
+	Point.Offset = this->Offsets[Frame];
+	Point.StreamStart = static_cast<int64_t>(Frame * this->SamplesPerFrame) - this->Delay;
+	Point.Discard = Raw - Frame * this->SamplesPerFrame;
+	return Point;
+}
+
+uint32_t SeekTable_t::GetSampleRate() const {
+	return this->SampleRate;
+}
+
+uint64_t SeekTable_t::GetSamples() const {
+	return this->Samples;
+}
+
+size_t SeekTable_t::GetFrameCount() const {
+	return this->Offsets.size();
+}
+
+std::filesystem::path SeekTable_t::GetCachePath(const std::filesystem::path& File) {
+#ifdef _WIN32
+	const char* Base = getenv("LOCALAPPDATA");
+	std::filesystem::path Folder = Base ? std::filesystem::path(Base) : std::filesystem::temp_directory_path();
+#else
+	const char* Base = getenv("XDG_CACHE_HOME");
+	const char* Home = getenv("HOME");
+	std::filesystem::path Folder = Base ? std::filesystem::path(Base) : std::filesystem::path(Home ? Home : ".") / ".cache";
+#endif
+
+	// FNV-1a of the path names the cache file
+	uint64_t Hash = 0xCBF29CE484222325ull;
+	for (const char Character : File.string()) {
+		Hash ^= static_cast<uint8_t>(Character);
+		Hash *= 0x100000001B3ull;
+	}
+
+	char Name[32];
+	snprintf(Name, sizeof(Name), "%016llx.seek", static_cast<unsigned long long>(Hash));
+	return Folder / "MusicPlayerV2" / "SeekTables" / Name;
+}
+
+std::shared_ptr<const SeekTable_t> SeekTable_t::Open(const std::filesystem::path& File) {
+	auto Table = std::make_shared<SeekTable_t>();
+	if (!Table->Load(GetCachePath(File), File))
+		return nullptr;
+	return Table;
+}
+
+bool SeekTable_t::Cache(const std::filesystem::path& File) {
+	const std::filesystem::path CacheFile = GetCachePath(File);
+
+	SeekTable_t Table;
+	if (Table.Load(CacheFile, File))
+		return true;
+
+	return Table.Build(File) && Table.Save(CacheFile);
+}
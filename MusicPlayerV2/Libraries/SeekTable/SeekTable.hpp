@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+// File offset of every MPEG audio frame of an MP3, so a seek can open the file right at the
+// frame that holds the target instead of trusting the coarse Xing TOC. Built by walking the
+// frame headers once, then cached on disk next to the other per-user data.
+class SeekTable_t {
+public:
+	// Where to open the file for a seek, and how much of the decoded output to drop
+	struct Point_t {
+		uint64_t Offset = 0;		// File offset of the first frame to decode
+		int64_t StreamStart = 0;	// Track sample at which the decoder output starts
+		uint64_t Discard = 0;		// Samples to decode and drop to land on the target
+	};
+
+	// Frames decoded ahead of the target. A frame may take up to 511 bytes of its data from
+	// the ones before it (the bit reservoir), so decoding has to start a few frames early
+	static constexpr uint32_t Priming = 10;
+
+private:
+	static constexpr uint32_t Magic = 0x5453504D; // "MPST"
+	static constexpr uint32_t Version = 1;
+
+	std::vector<uint32_t> Offsets;
+	uint32_t SampleRate = 0;
+	uint32_t SamplesPerFrame = 0;
+
+	// Samples the decoder outputs before the first one BASS reports, encoder delay plus the
+	// 529 of the MP3 decoder itself. Only trimmed when the file has a LAME tag
+	uint32_t Delay = 0;
+	uint64_t Samples = 0;
+
+	uint64_t FileSize = 0;
+	int64_t FileTime = 0;
+
+	static int64_t GetFileTime(const std::filesystem::path& File);
+
+public:
+	// Walks the whole file, false if it isn't an MPEG layer III stream
+	bool Build(const std::filesystem::path& File);
+
+	bool Save(const std::filesystem::path& CacheFile) const;
+	// Fails if the cache was written for a different version of the file
+	bool Load(const std::filesystem::path& CacheFile, const std::filesystem::path& File);
+
+	Point_t Find(uint64_t Sample) const;
+
+	uint32_t GetSampleRate() const;
+	uint64_t GetSamples() const;
+	size_t GetFrameCount() const;
+
+	// Per-user cache location for a music file's table
+	static std::filesystem::path GetCachePath(const std::filesystem::path& File);
+
+	// Cached table of the file, nullptr if there is none yet. Only reads the cache, never the music file
+	static std::shared_ptr<const SeekTable_t> Open(const std::filesystem::path& File);
+	// Builds and caches the table unless a valid one is cached already
+	static bool Cache(const std::filesystem::path& File);
+};
@@ -0,0 +1,207 @@
+#include "Shuffle.hpp"
+
+#include <algorithm>
+
+Shuffle_t::Shuffle_t(uint64_t Seed) : Random(Seed) {}
+
+void Shuffle_t::SetMode(Mode_t Mode) {
+	if (Mode == this->Mode)
+		return;
+
+	// A peeked fair pick goes back into its cycle
+	if (this->Peeked != NoTrack && this->Mode == Mode_t::Fair && (this->Flags[this->Peeked] & Present)) {
+		this->Flags[this->Peeked] |= Pending;
+		this->Remaining.push_back(this->Peeked);
+	}
+	this->Peeked = NoTrack;
+	this->Mode = Mode;
+}
+
+Shuffle_t::Mode_t Shuffle_t::GetMode() const {
+	return this->Mode;
+}
+
+// A quarter of the library at most. With half, the tracks held back from the start of a cycle
+// would be exactly the ones that ended the last, and each track would stay in its half for good.
+// Still one for a tiny library, so the current track never comes right back
+size_t Shuffle_t::GetWindowLength() const {
+	return this->Ids.size() < 2 ? 0 : std::clamp<size_t>(this->Ids.size() / 4, 1, MaxWindow);
+}
+
+void Shuffle_t::Remember(uint32_t Id) {
+	const size_t Length = this->GetWindowLength();
+	if (Length == 0)
+		return;
+
+	while (this->WindowSize >= Length) {
+		const uint32_t Oldest = this->Window[(this->WindowEnd + MaxWindow - this->WindowSize) % MaxWindow];
+		this->Flags[Oldest] &= ~Recent;
+		this->WindowSize--;
+	}
+	this->Window[this->WindowEnd] = Id;
+	this->WindowEnd = (this->WindowEnd + 1) % MaxWindow;
+	this->WindowSize++;
+	this->Flags[Id] |= Recent;
+}
+
+void Shuffle_t::Refill() {
+	this->Remaining.clear();
+	this->Held.clear();
+	this->CyclePicks = 0;
+	for (const uint32_t Id : this->Ids) {
+		uint8_t& Flag = this->Flags[Id];
+		Flag = static_cast<uint8_t>((Flag & ~Played) | Pending);
+		(Flag & Recent ? this->Held : this->Remaining).push_back(Id);
+	}
+}
+
+uint32_t Shuffle_t::DrawFair() {
+	for (;;) {
+		if (!this->Held.empty() && (this->Remaining.empty() || this->CyclePicks >= this->GetWindowLength())) {
+			this->Remaining.insert(this->Remaining.end(), this->Held.begin(), this->Held.end());
+			this->Held.clear();
+		}
+		if (this->Remaining.empty()) {
+			if (this->Ids.empty())
+				return NoTrack;
+			this->Refill();
+			continue;
+		}
+
+		// One step of Fisher-Yates, the rest of the permutation doesn't exist yet
+		const size_t Index = std::uniform_int_distribution<size_t>(0, this->Remaining.size() - 1)(this->Random);
+		const uint32_t Id = this->Remaining[Index];
+		this->Remaining[Index] = this->Remaining.back();
+		this->Remaining.pop_back();
+
+		uint8_t& Flag = this->Flags[Id];
+		if (!(Flag & Pending))
+			continue;
+		Flag &= ~Pending;
+		if (!(Flag & Present) || (Flag & Played)) {
+			Flag &= ~Played;
+			continue;
+		}
+
+		this->CyclePicks++;
+		return Id;
+	}
+}
+
+uint32_t Shuffle_t::DrawWeighted() {
+	if (this->Ids.empty())
+		return NoTrack;
+
+	// A few tries to get out of the window, a library of one heavy track has to repeat
+	uint32_t Id = NoTrack;
+	for (int Try = 0; Try < 8; Try++) {
+		// The high half picks the column, the low half tosses the coin
+		const uint64_t Bits = this->Random();
+		const size_t Column = static_cast<size_t>(((Bits >> 32) * this->Columns.size()) >> 32);
+		const bool IsColumn = static_cast<float>(static_cast<uint32_t>(Bits) * 0x1p-32) < this->Columns[Column].Probability;
+		Id = this->Ids[IsColumn ? Column : this->Columns[Column].Alias];
+		if (!(this->Flags[Id] & Recent))
+			break;
+	}
+	return Id;
+}
+
+uint32_t Shuffle_t::Draw() {
+	return this->Mode == Mode_t::Fair ? this->DrawFair() : this->Mode == Mode_t::Weighted ? this->DrawWeighted() : NoTrack;
+}
+
+void Shuffle_t::Sync(const std::vector<uint32_t>& Ids, const std::vector<float>& Weights) {
+	const uint32_t Largest = Ids.empty() ? 0 : *std::max_element(Ids.begin(), Ids.end());
+	if (this->Flags.size() <= Largest)
+		this->Flags.resize(static_cast<size_t>(Largest) + 1, 0);
+
+	// Everything drops out first, whatever is still there comes back in
+	const bool IsStarted = !this->Ids.empty();
+	for (const uint32_t Id : this->Ids)
+		this->Flags[Id] = static_cast<uint8_t>((this->Flags[Id] & ~Present) | Listed);
+	for (const uint32_t Id : Ids) {
+		uint8_t& Flag = this->Flags[Id];
+		Flag |= Present;
+
+		// New to a running cycle, it joins the tracks that are left
+		if (IsStarted && !(Flag & Listed) && !(Flag & Pending)) {
+			Flag |= Pending;
+			this->Remaining.push_back(Id);
+		}
+	}
+	// Copies of removed tracks left in the cycle no longer count, should they come back
+	for (const uint32_t Id : this->Ids) {
+		uint8_t& Flag = this->Flags[Id];
+		Flag &= ~Listed;
+		if (!(Flag & Present))
+			Flag &= ~(Pending | Played);
+	}
+	this->Ids = Ids;
+	if (this->Peeked != NoTrack && !(this->Flags[this->Peeked] & Present))
+		this->Peeked = NoTrack;
+
+	// Scaled to an average of 1, every column splits between its own track and one alias
+	const size_t Count = Ids.size();
+	this->Columns.assign(Count, {});
+	if (Weights.size() != Count || Count == 0)
+		return;
+
+	double Total = 0.0;
+	for (const float Weight : Weights)
+		Total += std::max(Weight, 0.0f);
+	if (Total <= 0.0)
+		return;
+
+	std::vector<double> Scaled(Count);
+	std::vector<uint32_t> Small, Large;
+	for (size_t i = 0; i < Count; i++) {
+		Scaled[i] = std::max(Weights[i], 0.0f) * Count / Total;
+		(Scaled[i] < 1.0 ? Small : Large).push_back(static_cast<uint32_t>(i));
+	}
+	while (!Small.empty() && !Large.empty()) {
+		const uint32_t Less = Small.back();
+		const uint32_t More = Large.back();
+		Small.pop_back();
+		this->Columns[Less] = { static_cast<float>(Scaled[Less]), More };
+		Scaled[More] -= 1.0 - Scaled[Less];
+		if (Scaled[More] < 1.0) {
+			Large.pop_back();
+			Small.push_back(More);
+		}
+	}
+	// Leftovers are 1 up to rounding, they keep their own track
+}
+
+uint32_t Shuffle_t::Peek() {
+	if (this->Peeked == NoTrack)
+		this->Peeked = this->Draw();
+	return this->Peeked;
+}
+
+// Only a track that's taken enters the window, a peeked one may still be dropped
+uint32_t Shuffle_t::Take() {
+	const uint32_t Id = this->Peek();
+	this->Peeked = NoTrack;
+	if (Id != NoTrack)
+		this->Remember(Id);
+	return Id;
+}
+
+void Shuffle_t::MarkPlayed(uint32_t Id) {
+	if (Id >= this->Flags.size() || !(this->Flags[Id] & Present))
+		return;
+
+	if (this->Flags[Id] & Pending)
+		this->Flags[Id] |= Played;
+	if (!(this->Flags[Id] & Recent))
+		this->Remember(Id);
+}
+
+void Shuffle_t::Reset() {
+	for (const uint32_t Id : this->Ids)
+		this->Flags[Id] &= ~(Pending | Played);
+	this->Remaining.clear();
+	this->Held.clear();
+	this->Peeked = NoTrack;
+	this->Refill();
+}
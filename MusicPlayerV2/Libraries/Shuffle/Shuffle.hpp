@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Picks what plays next when shuffling.
+//   Fair      A random permutation drawn one track at a time: nothing repeats until every track
+//             has played once. Tracks added meanwhile join the running cycle, removed ones are
+//             skipped when drawn. The last few tracks of a cycle don't come up early in the next one.
+//   Weighted  Independent picks in proportion to each track's weight through an alias table,
+//             skipping tracks within the no-repeat window where it can.
+// Picks are O(1) in both, keeping up with a library change is O(tracks).
+// Not thread-safe, owned by the engine thread.
+class Shuffle_t {
+public:
+	enum class Mode_t {
+		Off,
+		Fair,
+		Weighted,
+	};
+
+	static constexpr uint32_t NoTrack = 0;
+	static constexpr size_t MaxWindow = 32;
+
+private:
+	// Per track id
+	enum Flag_t : uint8_t {
+		Present = 1,	// In the library
+		Pending = 2,	// Waiting in Remaining or Held
+		Played = 4,		// Played outside the shuffle this cycle, skipped when drawn
+		Recent = 8,		// In the no-repeat window
+		Listed = 16,	// Present before the Sync() that's running
+	};
+	std::vector<uint8_t> Flags;
+	std::vector<uint32_t> Ids;
+
+	Mode_t Mode = Mode_t::Off;
+	std::mt19937_64 Random;
+
+	// Fair: what's left of the cycle, and the tracks held back until Window picks into it
+	std::vector<uint32_t> Remaining;
+	std::vector<uint32_t> Held;
+	size_t CyclePicks = 0;
+
+	uint32_t Window[MaxWindow] = {};
+	size_t WindowEnd = 0;
+	size_t WindowSize = 0;
+
+	// Weighted: Vose's alias table over Ids, a column in one cache line
+	struct Column_t {
+		float Probability = 1.0f;	// Of keeping the column's own track
+		uint32_t Alias = 0;
+	};
+	std::vector<Column_t> Columns;
+
+	uint32_t Peeked = NoTrack;
+
+	size_t GetWindowLength() const;
+	void Remember(uint32_t Id);
+	void Refill();
+	uint32_t DrawFair();
+	uint32_t DrawWeighted();
+	uint32_t Draw();
+
+public:
+	explicit Shuffle_t(uint64_t Seed = std::random_device()());
+
+	void SetMode(Mode_t Mode);
+	Mode_t GetMode() const;
+
+	// Makes Ids the set of tracks. Weights line up with Ids, empty weighs them all the same
+	void Sync(const std::vector<uint32_t>& Ids, const std::vector<float>& Weights = {});
+
+	// What Take() will return, NoTrack while off or without tracks
+	uint32_t Peek();
+	uint32_t Take();
+
+	// Counts a track picked by hand as played, so the shuffle doesn't bring it up again soon
+	void MarkPlayed(uint32_t Id);
+
+	// Starts a fresh cycle
+	void Reset();
+};
@@ -0,0 +1,700 @@
+#include "SmartPlaylist.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <immintrin.h>
+#define SMARTPLAYLIST_SSE 1
+#endif
+
+namespace {
+	constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+	// Bit i of every word is set if track i of its 64 lies within Low and High
+	void MatchFloats(const float* Values, float Low, float High, uint64_t* Out, size_t Words) {
+#ifdef SMARTPLAYLIST_SSE
+		const __m128 Lows = _mm_set1_ps(Low);
+		const __m128 Highs = _mm_set1_ps(High);
+		const auto Match = [&](const float* Lanes) {
+			const __m128 Value = _mm_loadu_ps(Lanes);
+			return static_cast<uint64_t>(_mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(Value, Lows), _mm_cmple_ps(Value, Highs))));
+		};
+#endif
+		for (size_t w = 0; w < Words; w++, Values += 64) {
+			uint64_t Word = 0;
+#ifdef SMARTPLAYLIST_SSE
+			for (int i = 0; i < 64; i += 16)
+				Word |= (Match(Values + i) | Match(Values + i + 4) << 4 | Match(Values + i + 8) << 8 | Match(Values + i + 12) << 12) << i;
+#else
+			for (int i = 0; i < 64; i++)
+				Word |= static_cast<uint64_t>(Values[i] >= Low && Values[i] <= High) << i;
+#endif
+			Out[w] = Word;
+		}
+	}
+
+	void MatchInts(const uint32_t* Values, uint32_t Low, uint32_t High, uint64_t* Out, size_t Words) {
+#ifdef SMARTPLAYLIST_SSE
+		// SSE2 only compares signed, flipping the top bit keeps unsigned values in order
+		const __m128i Flip = _mm_set1_epi32(INT32_MIN);
+		const __m128i Lows = _mm_set1_epi32(static_cast<int32_t>(Low ^ 0x80000000u));
+		const __m128i Highs = _mm_set1_epi32(static_cast<int32_t>(High ^ 0x80000000u));
+		const auto Outside = [&](const uint32_t* Lanes) {
+			const __m128i Value = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Lanes)), Flip);
+			return static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(_mm_cmpgt_epi32(Lows, Value), _mm_cmpgt_epi32(Value, Highs)))));
+		};
+#endif
+		for (size_t w = 0; w < Words; w++, Values += 64) {
+			uint64_t Word = 0;
+#ifdef SMARTPLAYLIST_SSE
+			for (int i = 0; i < 64; i += 16)
+				Word |= (Outside(Values + i) | Outside(Values + i + 4) << 4 | Outside(Values + i + 8) << 8 | Outside(Values + i + 12) << 12) << i;
+			Word = ~Word;
+#else
+			for (int i = 0; i < 64; i++)
+				Word |= static_cast<uint64_t>(Values[i] >= Low && Values[i] <= High) << i;
+#endif
+			Out[w] = Word;
+		}
+	}
+
+	bool IsKeyword(const std::string& Token, const char* Keyword) {
+		if (Token.size() != strlen(Keyword))
+			return false;
+		for (size_t i = 0; i < Token.size(); i++) {
+			if (tolower(static_cast<unsigned char>(Token[i])) != Keyword[i])
+				return false;
+		}
+		return true;
+	}
+
+	bool IsQuoted(const std::string& Token) {
+		return !Token.empty() && Token[0] == '"';
+	}
+
+	bool ToNumber(const std::string& Token, double* Number) {
+		if (Token.empty() || IsQuoted(Token))
+			return false;
+		char* End = nullptr;
+		*Number = strtod(Token.c_str(), &End);
+		return End == Token.c_str() + Token.size() && std::isfinite(*Number);
+	}
+
+	// Quoted text keeps a leading quote, so it's never taken for a keyword or an operator
+	bool Tokenize(std::string_view Rule, std::vector<std::string>* Tokens, std::string* Error) {
+		constexpr std::string_view Operators = "=!<>()";
+		size_t i = 0;
+		while (i < Rule.size()) {
+			const char c = Rule[i];
+			if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+				i++;
+			} else if (c == '"' || c == '\'') {
+				const size_t End = Rule.find(c, i + 1);
+				if (End == std::string_view::npos) {
+					*Error = "unterminated quote";
+					return false;
+				}
+				Tokens->push_back("\"" + std::string(Rule.substr(i + 1, End - i - 1)));
+				i = End + 1;
+			} else if (Operators.find(c) != std::string_view::npos) {
+				const size_t Length = (c == '!' || c == '<' || c == '>') && i + 1 < Rule.size() && Rule[i + 1] == '=' ? 2 : 1;
+				Tokens->emplace_back(Rule.substr(i, Length));
+				i += Length;
+			} else {
+				const size_t Start = i;
+				while (i < Rule.size() && Rule[i] != ' ' && Rule[i] != '\t' && Rule[i] != '"' && Rule[i] != '\'' && Operators.find(Rule[i]) == std::string_view::npos)
+					i++;
+				Tokens->emplace_back(Rule.substr(Start, i - Start));
+			}
+		}
+		return true;
+	}
+}
+
+size_t TrackColumns_t::GetWords(size_t Count) {
+	return (Count + 63) / 64;
+}
+
+void TrackColumns_t::Fold(std::string_view Text, std::string* Folded) {
+	Folded->assign(Text);
+	for (char& Character : *Folded)
+		Character = static_cast<char>(tolower(static_cast<unsigned char>(Character)));
+}
+
+uint32_t TrackColumns_t::Find(Text_t Field, std::string_view Value) const {
+	std::string Folded;
+	Fold(Value, &Folded);
+	const auto Found = this->Lookup[Field].find(Folded);
+	return Found != this->Lookup[Field].end() ? Found->second : Unknown;
+}
+
+std::shared_ptr<const TrackColumns_t> TrackColumns_t::Build(const std::vector<LibraryTrack_t>& Tracks) {
+	auto Columns = std::make_shared<TrackColumns_t>();
+	const size_t Padded = GetWords(Tracks.size()) * 64;
+	Columns->Count = Tracks.size();
+	Columns->Bpm.assign(Padded, 0.0f);
+	Columns->Duration.assign(Padded, 0.0f);
+	for (int Field = 0; Field < TextFields; Field++) {
+		Columns->Codes[Field].assign(Padded, NoValue);
+		Columns->Values[Field].emplace_back();
+		Columns->Lookup[Field].emplace(std::string(), NoValue);
+	}
+
+	std::string Folded;
+	for (size_t i = 0; i < Tracks.size(); i++) {
+		const LibraryTrack_t& Track = Tracks[i];
+		Columns->Bpm[i] = Track.Bpm;
+		Columns->Duration[i] = static_cast<float>(Track.Duration);
+
+		const std::string* Texts[TextFields] = { &Track.Genre, &Track.Artist, &Track.Album };
+		for (int Field = 0; Field < TextFields; Field++) {
+			Fold(*Texts[Field], &Folded);
+			const auto [Code, IsNew] = Columns->Lookup[Field].try_emplace(Folded, static_cast<uint32_t>(Columns->Values[Field].size()));
+			if (IsNew)
+				Columns->Values[Field].push_back(*Texts[Field]);
+			Columns->Codes[Field][i] = Code->second;
+		}
+	}
+	return Columns;
+}
+
+bool Query_t::ParseAny(std::vector<std::string>& Tokens, size_t* Next, std::string* Error) {
+	if (!this->ParseAll(Tokens, Next, Error))
+		return false;
+
+	while (*Next < Tokens.size() && IsKeyword(Tokens[*Next], "or")) {
+		(*Next)++;
+		if (!this->ParseAll(Tokens, Next, Error))
+			return false;
+		this->Program.push_back({ Op_t::Type_t::Or });
+	}
+	return true;
+}
+
+bool Query_t::ParseAll(std::vector<std::string>& Tokens, size_t* Next, std::string* Error) {
+	if (!this->ParseUnary(Tokens, Next, Error))
+		return false;
+
+	while (*Next < Tokens.size() && IsKeyword(Tokens[*Next], "and")) {
+		(*Next)++;
+		if (!this->ParseUnary(Tokens, Next, Error))
+			return false;
+		this->Program.push_back({ Op_t::Type_t::And });
+	}
+	return true;
+}
+
+bool Query_t::ParseUnary(std::vector<std::string>& Tokens, size_t* Next, std::string* Error) {
+	if (*Next >= Tokens.size()) {
+		*Error = "rule ends early";
+		return false;
+	}
+
+	if (IsKeyword(Tokens[*Next], "not")) {
+		(*Next)++;
+		if (!this->ParseUnary(Tokens, Next, Error))
+			return false;
+		this->Program.push_back({ Op_t::Type_t::Not });
+		return true;
+	}
+
+	if (Tokens[*Next] == "(") {
+		(*Next)++;
+		if (!this->ParseAny(Tokens, Next, Error))
+			return false;
+		if (*Next >= Tokens.size() || Tokens[*Next] != ")") {
+			*Error = "missing ')'";
+			return false;
+		}
+		(*Next)++;
+		return true;
+	}
+	return this->ParsePredicate(Tokens, Next, Error);
+}
+
+bool Query_t::ParsePredicate(std::vector<std::string>& Tokens, size_t* Next, std::string* Error) {
+	const std::string& Name = Tokens[(*Next)++];
+	const auto Peek = [&]() -> const std::string& {
+		static const std::string End;
+		return *Next < Tokens.size() ? Tokens[*Next] : End;
+	};
+
+	Op_t Op;
+	double Number = 0.0;
+	if (IsKeyword(Name, "played")) {
+		if (!IsKeyword(Peek(), "in") || ((*Next)++, !ToNumber(Peek(), &Number)) || Number < 0.0) {
+			*Error = "expected 'played in <number> days'";
+			return false;
+		}
+		(*Next)++;
+		if (!IsKeyword(Peek(), "days") && !IsKeyword(Peek(), "day")) {
+			*Error = "expected 'days' after 'played in " + Tokens[*Next - 1] + "'";
+			return false;
+		}
+		(*Next)++;
+		Op.Field = Field_t::LastPlayed;
+		Op.Days = static_cast<uint32_t>(std::min(Number, 100000.0));
+		this->Program.push_back(Op);
+		return true;
+	}
+
+	static constexpr struct {
+		const char* Name;
+		Field_t Field;
+	} Fields[] = {
+		{ "genre", Field_t::Genre }, { "artist", Field_t::Artist }, { "album", Field_t::Album }, { "bpm", Field_t::Bpm },
+		{ "duration", Field_t::Duration }, { "plays", Field_t::Plays }, { "skips", Field_t::Skips },
+	};
+	const auto Field = std::find_if(std::begin(Fields), std::end(Fields), [&](const auto& Field) {
+		return !IsQuoted(Name) && IsKeyword(Name, Field.Name);
+	});
+	if (Field == std::end(Fields)) {
+		*Error = "unknown field '" + (IsQuoted(Name) ? Name.substr(1) : Name) + "'";
+		return false;
+	}
+	Op.Field = Field->Field;
+
+	const std::string Operator = Peek();
+	const bool IsText = Op.Field == Field_t::Genre || Op.Field == Field_t::Artist || Op.Field == Field_t::Album;
+	if (IsText) {
+		if ((Operator != "=" && Operator != "!=") || *Next + 1 >= Tokens.size()) {
+			*Error = std::string("expected '=' or '!=' and a value after '") + Field->Name + "'";
+			return false;
+		}
+		const std::string& Value = Tokens[*Next + 1];
+		*Next += 2;
+		Op.Text = IsQuoted(Value) ? Value.substr(1) : Value;
+		this->Program.push_back(Op);
+		if (Operator == "!=")
+			this->Program.push_back({ Op_t::Type_t::Not });
+		return true;
+	}
+
+	// Everything numeric comes down to an inclusive range, open ends are nudged inwards
+	double Low = -std::numeric_limits<double>::infinity();
+	double High = std::numeric_limits<double>::infinity();
+	bool IsLowOpen = false;
+	bool IsHighOpen = false;
+	bool IsNegated = false;
+	if (Operator == "=" || Operator == "!=" || Operator == "<" || Operator == "<=" || Operator == ">" || Operator == ">=") {
+		(*Next)++;
+		if (!ToNumber(Peek(), &Number)) {
+			*Error = "expected a number after '" + Operator + "'";
+			return false;
+		}
+		(*Next)++;
+		if (Operator[0] == '=' || Operator[0] == '!')
+			Low = High = Number;
+		else if (Operator[0] == '<')
+			High = Number;
+		else
+			Low = Number;
+		IsLowOpen = Operator == ">";
+		IsHighOpen = Operator == "<";
+		IsNegated = Operator == "!=";
+	} else {
+		// "120-126", or "120 - 126" split into words
+		std::string Range = Operator;
+		(*Next)++;
+		if (Range.find('-', 1) == std::string::npos && *Next + 1 < Tokens.size() && Tokens[*Next] == "-") {
+			Range += "-" + Tokens[*Next + 1];
+			*Next += 2;
+		}
+		const size_t Dash = Range.find('-', 1);
+		if (IsQuoted(Range) || Dash == std::string::npos || !ToNumber(Range.substr(0, Dash), &Low) || !ToNumber(Range.substr(Dash + 1), &High)) {
+			*Error = std::string("expected a comparison or a range like 120-126 after '") + Field->Name + "'";
+			return false;
+		}
+	}
+
+	if (Op.Field == Field_t::Bpm || Op.Field == Field_t::Duration) {
+		Op.Low = IsLowOpen ? std::nextafter(static_cast<float>(Low), Infinity) : static_cast<float>(Low);
+		Op.High = IsHighOpen ? std::nextafter(static_cast<float>(High), -Infinity) : static_cast<float>(High);
+	} else {
+		Low = std::max(IsLowOpen ? std::floor(Low) + 1.0 : std::ceil(Low), 0.0);
+		High = std::min(IsHighOpen ? std::ceil(High) - 1.0 : std::floor(High), static_cast<double>(UINT32_MAX));
+		Op.LowInt = Low > High ? 1 : static_cast<uint32_t>(Low);
+		Op.HighInt = Low > High ? 0 : static_cast<uint32_t>(High);
+	}
+	this->Program.push_back(Op);
+	if (IsNegated)
+		this->Program.push_back({ Op_t::Type_t::Not });
+	return true;
+}
+
+bool Query_t::Parse(std::string_view Rule, std::string* Error) {
+	this->Program.clear();
+	this->Depth = 0;
+
+	std::vector<std::string> Tokens;
+	if (!Tokenize(Rule, &Tokens, Error))
+		return false;
+	if (Tokens.empty()) {
+		*Error = "empty rule";
+		return false;
+	}
+
+	size_t Next = 0;
+	if (!this->ParseAny(Tokens, &Next, Error))
+		return false;
+	if (Next != Tokens.size()) {
+		*Error = "expected AND or OR before '" + (IsQuoted(Tokens[Next]) ? Tokens[Next].substr(1) : Tokens[Next]) + "'";
+		return false;
+	}
+	if (this->Program.size() > MaxProgram) {
+		*Error = "rule is too long";
+		return false;
+	}
+
+	size_t Size = 0;
+	for (const Op_t& Op : this->Program) {
+		if (Op.Type == Op_t::Type_t::Match)
+			this->Depth = std::max(this->Depth, ++Size);
+		else if (Op.Type != Op_t::Type_t::Not)
+			Size--;
+	}
+	return true;
+}
+
+bool Query_t::UsesStats() const {
+	return std::any_of(this->Program.begin(), this->Program.end(), [](const Op_t& Op) {
+		return Op.Type == Op_t::Type_t::Match && (Op.Field == Field_t::Plays || Op.Field == Field_t::Skips || Op.Field == Field_t::LastPlayed);
+	});
+}
+
+bool Query_t::UsesClock() const {
+	return std::any_of(this->Program.begin(), this->Program.end(), [](const Op_t& Op) {
+		return Op.Type == Op_t::Type_t::Match && Op.Field == Field_t::LastPlayed;
+	});
+}
+
+void Query_t::Evaluate(const TrackColumns_t& Columns, const StatsColumns_t& Stats, int64_t Now, size_t First, size_t Last, uint64_t* Bits,
+	std::vector<uint64_t>* Scratch) const {
+	// Whatever doesn't change from track to track is looked up once. No columns at all matches nothing
+	Bound_t Bounds[MaxProgram];
+	for (size_t i = 0; i < this->Program.size(); i++) {
+		const Op_t& Op = this->Program[i];
+		Bound_t& Bound = Bounds[i];
+		if (Op.Type != Op_t::Type_t::Match)
+			continue;
+
+		switch (Op.Field) {
+		case Field_t::Genre:
+		case Field_t::Artist:
+		case Field_t::Album: {
+			const TrackColumns_t::Text_t Text = Op.Field == Field_t::Genre ? TrackColumns_t::Genre : Op.Field == Field_t::Artist ? TrackColumns_t::Artist : TrackColumns_t::Album;
+			const uint32_t Code = Columns.Find(Text, Op.Text);
+			if (Code != TrackColumns_t::Unknown)
+				Bound = { nullptr, Columns.Codes[Text].data(), 0.0f, 0.0f, Code, Code };
+			break;
+		}
+		case Field_t::Bpm:
+		case Field_t::Duration:
+			Bound = { Op.Field == Field_t::Bpm ? Columns.Bpm.data() : Columns.Duration.data(), nullptr, Op.Low, Op.High };
+			break;
+		case Field_t::Plays:
+		case Field_t::Skips:
+			if (Op.LowInt <= Op.HighInt && !Stats.Plays.empty())
+				Bound = { nullptr, Op.Field == Field_t::Plays ? Stats.Plays.data() : Stats.Skips.data(), 0.0f, 0.0f, Op.LowInt, Op.HighInt };
+			break;
+		case Field_t::LastPlayed: {
+			// Never played is 0, which no window reaches back to
+			const int64_t Since = std::clamp<int64_t>(Now - static_cast<int64_t>(Op.Days) * 86400, 1, UINT32_MAX);
+			if (!Stats.LastPlayed.empty())
+				Bound = { nullptr, Stats.LastPlayed.data(), 0.0f, 0.0f, static_cast<uint32_t>(Since), UINT32_MAX };
+			break;
+		}
+		}
+	}
+
+	// One bitmap per stack level, a block at a time so the stack stays in the cache
+	if (Scratch->size() < this->Depth * BlockWords)
+		Scratch->resize(this->Depth * BlockWords);
+
+	for (size_t Block = First; Block < Last; Block += BlockWords) {
+		const size_t Words = std::min(BlockWords, Last - Block);
+		uint64_t* Top = nullptr;
+		size_t Level = 0;
+		for (size_t i = 0; i < this->Program.size(); i++) {
+			const Op_t& Op = this->Program[i];
+			const Bound_t& Bound = Bounds[i];
+			switch (Op.Type) {
+			case Op_t::Type_t::Match:
+				Top = Scratch->data() + Level++ * BlockWords;
+				if (Bound.Floats)
+					MatchFloats(Bound.Floats + Block * 64, Bound.Low, Bound.High, Top, Words);
+				else if (Bound.Ints)
+					MatchInts(Bound.Ints + Block * 64, Bound.LowInt, Bound.HighInt, Top, Words);
+				else
+					std::fill(Top, Top + Words, 0);
+				break;
+			case Op_t::Type_t::And:
+			case Op_t::Type_t::Or: {
+				const uint64_t* Right = Top;
+				Top = Scratch->data() + (--Level - 1) * BlockWords;
+				for (size_t w = 0; w < Words; w++)
+					Top[w] = Op.Type == Op_t::Type_t::And ? Top[w] & Right[w] : Top[w] | Right[w];
+				break;
+			}
+			case Op_t::Type_t::Not:
+				for (size_t w = 0; w < Words; w++)
+					Top[w] = ~Top[w];
+				break;
+			}
+		}
+		memcpy(Bits + (Block - First), Top, Words * sizeof(uint64_t));
+	}
+
+	// The padding after the last track may have matched, a NOT makes sure of it
+	const size_t Count = Columns.Count;
+	if (Count % 64 && First < Last && Last == TrackColumns_t::GetWords(Count))
+		Bits[Last - 1 - First] &= (1ull << (Count % 64)) - 1;
+}
+
+SmartPlaylists_t::SmartPlaylists_t(const PlayStats_t* Source) : Source(Source) {
+	this->DirtyWords.reserve(64);
+}
+
+void SmartPlaylists_t::MirrorStats() {
+	const size_t Padded = TrackColumns_t::GetWords(this->Columns->Count) * 64;
+	this->Stats.Plays.assign(Padded, 0);
+	this->Stats.Skips.assign(Padded, 0);
+	this->Stats.LastPlayed.assign(Padded, 0);
+	this->IsMirrored = true;
+
+	const std::shared_ptr<const PlayStats_t::Table_t> Table = this->Source ? this->Source->GetTable() : nullptr;
+	if (!Table)
+		return;
+
+	PlayStats_t::Stats_t Played;
+	for (size_t i = 0; i < this->Columns->Count; i++) {
+		if (!Table->Find(this->Library->Tracks[i].Key, &Played))
+			continue;
+		this->Stats.Plays[i] = Played.Plays;
+		this->Stats.Skips[i] = Played.Skips;
+		this->Stats.LastPlayed[i] = static_cast<uint32_t>(std::clamp<int64_t>(Played.LastPlayed, 0, UINT32_MAX));
+	}
+}
+
+bool SmartPlaylists_t::Evaluate(Entry_t& Playlist, size_t First, size_t Last, int64_t Now) {
+	if (!this->Columns || First >= Last)
+		return false;
+
+	if (Playlist.Query.UsesStats() && !this->IsMirrored)
+		this->MirrorStats();
+
+	this->Evaluated.resize(Last - First);
+	Playlist.Query.Evaluate(*this->Columns, this->Stats, Now, First, Last, this->Evaluated.data(), &this->Scratch);
+	if (std::equal(this->Evaluated.begin(), this->Evaluated.end(), Playlist.Bits.begin() + First))
+		return false;
+
+	std::copy(this->Evaluated.begin(), this->Evaluated.end(), Playlist.Bits.begin() + First);
+	Playlist.Published.reset();
+	return true;
+}
+
+bool SmartPlaylists_t::Open(const std::filesystem::path& File, int64_t Now) {
+	this->File.clear();
+
+	// One playlist per line, its name and its rule split by a tab
+	std::ifstream Stream(File, std::ios::binary);
+	std::string Line;
+	std::string Error;
+	while (std::getline(Stream, Line)) {
+		const size_t Tab = Line.find('\t');
+		if (Tab == std::string::npos)
+			continue;
+		if (!this->Set(std::string_view(Line).substr(0, Tab), std::string_view(Line).substr(Tab + 1), &Error, Now))
+			printf("Skipping playlist '%s': %s\n", Line.substr(0, Tab).c_str(), Error.c_str());
+	}
+
+	std::error_code Ignored;
+	std::filesystem::create_directories(File.parent_path(), Ignored);
+	this->File = File;
+	return true;
+}
+
+bool SmartPlaylists_t::Save() const {
+	if (this->File.empty())
+		return true;
+
+	std::filesystem::path Temporary = this->File;
+	Temporary += ".tmp";
+	{
+		std::ofstream Stream(Temporary, std::ios::binary | std::ios::trunc);
+		for (const Entry_t& Playlist : this->Playlists)
+			Stream << Playlist.Name << '\t' << Playlist.Rule << '\n';
+		Stream.flush();
+		if (!Stream) {
+			printf("Failed to write %s\n", Temporary.string().c_str());
+			return false;
+		}
+	}
+
+	std::error_code Error;
+	std::filesystem::rename(Temporary, this->File, Error);
+	if (Error)
+		printf("Failed to replace %s\n", this->File.string().c_str());
+	return !Error;
+}
+
+void SmartPlaylists_t::SetLibrary(const std::shared_ptr<const Library_t>& Library, int64_t Now) {
+	// With no file added or removed every track keeps its row, and only the retagged ones can match differently
+	const std::shared_ptr<const Library_t> Previous = std::move(this->Library);
+	const bool IsSameRows = Previous && this->Columns && Library->Version == Previous->Version + 1 && Library->Tracks.size() == Previous->Tracks.size() &&
+		std::all_of(Library->Added.begin(), Library->Added.end(), [&](uint32_t Row) {
+			return Previous->IndexOf(Library->Tracks[Row].Id) == static_cast<int>(Row);
+		});
+	this->Library = Library;
+	this->Columns = Library->Columns ? Library->Columns : TrackColumns_t::Build(Library->Tracks);
+	const size_t Words = TrackColumns_t::GetWords(this->Columns->Count);
+
+	if (IsSameRows) {
+		std::vector<uint32_t> Changed;
+		Changed.reserve(Library->Added.size());
+		for (const uint32_t Row : Library->Added)
+			Changed.push_back(Row / 64);
+		std::sort(Changed.begin(), Changed.end());
+		Changed.erase(std::unique(Changed.begin(), Changed.end()), Changed.end());
+
+		// Runs of neighbouring words in one go, past a quarter of the library it's one pass anyway
+		const bool IsWhole = Changed.size() > Words / 4;
+		for (Entry_t& Playlist : this->Playlists) {
+			if (IsWhole) {
+				this->IsChanged |= this->Evaluate(Playlist, 0, Words, Now);
+				continue;
+			}
+			for (size_t i = 0; i < Changed.size();) {
+				size_t End = i + 1;
+				while (End < Changed.size() && Changed[End] == Changed[End - 1] + 1)
+					End++;
+				this->IsChanged |= this->Evaluate(Playlist, Changed[i], Changed[End - 1] + 1, Now);
+				i = End;
+			}
+		}
+		return;
+	}
+
+	this->IsMirrored = false;
+	this->DirtyWords.clear();
+	for (Entry_t& Playlist : this->Playlists) {
+		Playlist.Bits.assign(Words, 0);
+		Playlist.Published.reset();
+		this->Evaluate(Playlist, 0, Words, Now);
+	}
+	this->ClockTime = Now;
+	this->IsChanged = true;
+}
+
+bool SmartPlaylists_t::Set(std::string_view Name, std::string_view Rule, std::string* Error, int64_t Now) {
+	const auto Found = std::find_if(this->Playlists.begin(), this->Playlists.end(), [&](const Entry_t& Playlist) {
+		return Playlist.Name == Name;
+	});
+
+	if (Rule.empty()) {
+		if (Found == this->Playlists.end())
+			return true;
+		this->Playlists.erase(Found);
+		this->IsChanged = true;
+		this->Save();
+		return true;
+	}
+
+	if (Name.empty() || Name.find_first_of("\t\r\n") != std::string_view::npos || Rule.find_first_of("\r\n") != std::string_view::npos) {
+		*Error = "names and rules have to fit on one line";
+		return false;
+	}
+
+	Query_t Query;
+	if (!Query.Parse(Rule, Error))
+		return false;
+
+	Entry_t& Playlist = Found != this->Playlists.end() ? *Found : this->Playlists.emplace_back();
+	Playlist.Name = Name;
+	Playlist.Rule = Rule;
+	Playlist.Query = std::move(Query);
+	Playlist.Published.reset();
+
+	const size_t Words = this->Columns ? TrackColumns_t::GetWords(this->Columns->Count) : 0;
+	Playlist.Bits.assign(Words, 0);
+	this->Evaluate(Playlist, 0, Words, Now);
+	this->IsChanged = true;
+	this->Save();
+	return true;
+}
+
+void SmartPlaylists_t::Record(size_t Row, PlayStats_t::Event_t Event, int64_t Now) {
+	if (!this->IsMirrored || Row >= this->Columns->Count)
+		return;
+
+	if (Event == PlayStats_t::Event_t::Finished)
+		this->Stats.Plays[Row]++;
+	else
+		this->Stats.Skips[Row]++;
+	this->Stats.LastPlayed[Row] = static_cast<uint32_t>(std::clamp<int64_t>(Now, this->Stats.LastPlayed[Row], UINT32_MAX));
+
+	const uint32_t Word = static_cast<uint32_t>(Row / 64);
+	if (std::find(this->DirtyWords.begin(), this->DirtyWords.end(), Word) == this->DirtyWords.end())
+		this->DirtyWords.push_back(Word);
+}
+
+void SmartPlaylists_t::Update(int64_t Now) {
+	const bool IsClockDue = Now - this->ClockTime >= ClockInterval;
+	if (this->DirtyWords.empty() && !IsClockDue)
+		return;
+
+	const size_t Words = this->Columns ? TrackColumns_t::GetWords(this->Columns->Count) : 0;
+	for (Entry_t& Playlist : this->Playlists) {
+		if (IsClockDue && Playlist.Query.UsesClock()) {
+			this->IsChanged |= this->Evaluate(Playlist, 0, Words, Now);
+		} else if (Playlist.Query.UsesStats()) {
+			for (const uint32_t Word : this->DirtyWords)
+				this->IsChanged |= this->Evaluate(Playlist, Word, Word + 1, Now);
+		}
+	}
+
+	this->DirtyWords.clear();
+	if (IsClockDue)
+		this->ClockTime = Now;
+}
+
+const std::shared_ptr<const std::vector<std::shared_ptr<const Playlist_t>>>& SmartPlaylists_t::GetPlaylists() {
+	if (!this->IsChanged)
+		return this->Published;
+
+	auto Playlists = std::make_shared<std::vector<std::shared_ptr<const Playlist_t>>>();
+	Playlists->reserve(this->Playlists.size());
+	for (Entry_t& Entry : this->Playlists) {
+		if (!Entry.Published) {
+			auto Playlist = std::make_shared<Playlist_t>();
+			Playlist->Name = Entry.Name;
+			Playlist->Rule = Entry.Rule;
+
+			size_t Count = 0;
+			for (const uint64_t Word : Entry.Bits)
+				Count += std::popcount(Word);
+			Playlist->Tracks.reserve(Count);
+			for (size_t w = 0; w < Entry.Bits.size(); w++) {
+				for (uint64_t Word = Entry.Bits[w]; Word; Word &= Word - 1)
+					Playlist->Tracks.push_back(this->Library->Tracks[w * 64 + std::countr_zero(Word)].Id);
+			}
+			Entry.Published = std::move(Playlist);
+		}
+		Playlists->push_back(Entry.Published);
+	}
+
+	this->Published = std::move(Playlists);
+	this->IsChanged = false;
+	return this->Published;
+}
+
+std::filesystem::path SmartPlaylists_t::GetDefaultPath() {
+	return PlayStats_t::GetDefaultFolder().parent_path() / "Playlists.txt";
+}
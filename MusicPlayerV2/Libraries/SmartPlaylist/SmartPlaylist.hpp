@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../PlayerState/PlayerState.hpp"
+#include "../PlayStats/PlayStats.hpp"
+
+// The library's tags with one array per field, built by the scanner along with the library.
+// Text fields hold a code per track into a dictionary of the field's values, compared
+// case-insensitively. Every array is padded to whole words of 64 tracks.
+class TrackColumns_t {
+public:
+	enum Text_t {
+		Genre,
+		Artist,
+		Album,
+		TextFields,
+	};
+
+	static constexpr uint32_t NoValue = 0;			// Code of an empty field
+	static constexpr uint32_t Unknown = UINT32_MAX;	// What Find() returns for a value no track has
+
+	size_t Count = 0;
+	std::vector<float> Bpm;
+	std::vector<float> Duration;
+	std::vector<uint32_t> Codes[TextFields];
+
+	// By code, spelled like the first track that had the value
+	std::vector<std::string> Values[TextFields];
+	// Folded value to code
+	std::unordered_map<std::string, uint32_t> Lookup[TextFields];
+
+	uint32_t Find(Text_t Field, std::string_view Value) const;
+
+	static size_t GetWords(size_t Count);
+	// Lower case, for comparing
+	static void Fold(std::string_view Text, std::string* Folded);
+	static std::shared_ptr<const TrackColumns_t> Build(const std::vector<LibraryTrack_t>& Tracks);
+};
+
+// Play stats in library order, mirrored by the engine as tracks are played
+struct StatsColumns_t {
+	std::vector<uint32_t> Plays;
+	std::vector<uint32_t> Skips;
+	std::vector<uint32_t> LastPlayed;	// Unix seconds, 0 if never
+};
+
+// One rule, compiled into a postfix program of range predicates and boolean operators.
+//   rule       any ("OR" any)*
+//   any        all ("AND" all)*
+//   all        "NOT" all | "(" rule ")" | predicate
+//   predicate  genre|artist|album ("=" | "!=") text
+//              bpm|duration|plays|skips ("=" | "!=" | "<" | "<=" | ">" | ">=") number
+//              bpm|duration|plays|skips number-number
+//              "played in" number "days"
+// Text is a single word or quoted, and matches regardless of case. Durations are in seconds.
+// Predicates run over a block of tracks at a time, four tracks per SSE compare, into bitmaps.
+class Query_t {
+public:
+	enum class Field_t : uint8_t {
+		Genre,
+		Artist,
+		Album,
+		Bpm,
+		Duration,
+		Plays,
+		Skips,
+		LastPlayed,
+	};
+
+private:
+	struct Op_t {
+		enum class Type_t : uint8_t {
+			Match,
+			And,
+			Or,
+			Not,
+		};
+
+		Type_t Type = Type_t::Match;
+		Field_t Field = Field_t::Genre;
+		// Inclusive bounds, per the field's type
+		float Low = 0.0f;
+		float High = 0.0f;
+		uint32_t LowInt = 0;
+		uint32_t HighInt = 0;
+		uint32_t Days = 0;
+		std::string Text = {};
+	};
+
+	// Resolved against the columns and the clock once per evaluation
+	struct Bound_t {
+		const float* Floats = nullptr;
+		const uint32_t* Ints = nullptr;
+		float Low = 0.0f;
+		float High = 0.0f;
+		uint32_t LowInt = 0;
+		uint32_t HighInt = 0;
+	};
+
+	std::vector<Op_t> Program;
+	size_t Depth = 0;
+
+	bool ParseAny(std::vector<std::string>& Tokens, size_t* Next, std::string* Error);
+	bool ParseAll(std::vector<std::string>& Tokens, size_t* Next, std::string* Error);
+	bool ParseUnary(std::vector<std::string>& Tokens, size_t* Next, std::string* Error);
+	bool ParsePredicate(std::vector<std::string>& Tokens, size_t* Next, std::string* Error);
+
+public:
+	// Tracks per block, the evaluation stack holds one bitmap of this many per level
+	static constexpr size_t BlockWords = 16;
+	// Longer rules are refused, so evaluating needs no allocation
+	static constexpr size_t MaxProgram = 64;
+
+	bool Parse(std::string_view Rule, std::string* Error);
+
+	bool UsesStats() const;
+	// Matches change as time passes without anything being played
+	bool UsesClock() const;
+
+	// Writes words First to Last of the result to Bits[0] onwards, tracks past the last one come out cleared
+	void Evaluate(const TrackColumns_t& Columns, const StatsColumns_t& Stats, int64_t Now, size_t First, size_t Last, uint64_t* Bits,
+		std::vector<uint64_t>* Scratch) const;
+};
+
+// Named rules kept up to date against the library and the play stats, each one a bitmap over
+// the library's tracks. A library that only got tags evaluates the words of 64 tracks holding the
+// retagged ones, one whose files changed everything. A play only evaluates the word around it,
+// and rules on the time since the last play catch up every ClockInterval.
+// Not thread-safe, owned by the engine thread.
+class SmartPlaylists_t {
+public:
+	static constexpr int64_t ClockInterval = 60; // Seconds
+
+private:
+	struct Entry_t {
+		std::string Name;
+		std::string Rule;
+		Query_t Query;
+		std::vector<uint64_t> Bits;
+		// Built from Bits when the playlists are asked for, dropped whenever they change
+		std::shared_ptr<const Playlist_t> Published;
+	};
+
+	std::vector<Entry_t> Playlists;
+	std::shared_ptr<const Library_t> Library;
+	std::shared_ptr<const TrackColumns_t> Columns;
+
+	// Only filled in once a rule asks for them
+	const PlayStats_t* Source = nullptr;
+	StatsColumns_t Stats;
+	bool IsMirrored = false;
+	void MirrorStats();
+
+	std::vector<uint32_t> DirtyWords;
+	std::vector<uint64_t> Scratch;
+	std::vector<uint64_t> Evaluated;
+	int64_t ClockTime = 0;
+
+	std::shared_ptr<const std::vector<std::shared_ptr<const Playlist_t>>> Published;
+	bool IsChanged = true;
+
+	std::filesystem::path File;
+	bool Save() const;
+
+	// True if any of the words changed
+	bool Evaluate(Entry_t& Playlist, size_t First, size_t Last, int64_t Now);
+
+public:
+	explicit SmartPlaylists_t(const PlayStats_t* Source);
+
+	// Loads the playlists saved in File and saves them there after every change
+	bool Open(const std::filesystem::path& File, int64_t Now);
+
+	void SetLibrary(const std::shared_ptr<const Library_t>& Library, int64_t Now);
+
+	// An empty rule removes the playlist
+	bool Set(std::string_view Name, std::string_view Rule, std::string* Error, int64_t Now);
+
+	// Row of the track in the library
+	void Record(size_t Row, PlayStats_t::Event_t Event, int64_t Now);
+	// Catches up with what was recorded and the clock
+	void Update(int64_t Now);
+
+	// Track ids per playlist in library order. Only playlists whose tracks changed are built again,
+	// the rest are shared with the previous list
+	const std::shared_ptr<const std::vector<std::shared_ptr<const Playlist_t>>>& GetPlaylists();
+
+	static std::filesystem::path GetDefaultPath();
+};
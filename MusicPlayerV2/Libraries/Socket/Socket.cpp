@@ -0,0 +1,233 @@
+#include "Socket.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+
+using Address_t = int;
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using Address_t = socklen_t;
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+bool InitSockets() {
+#ifdef _WIN32
+	static const bool IsReady = [] {
+		WSADATA Data;
+		return WSAStartup(MAKEWORD(2, 2), &Data) == 0;
+	}();
+	return IsReady;
+#else
+	return true;
+#endif
+}
+
+void CloseSocket(Socket_t Socket) {
+	if (Socket == NoSocket)
+		return;
+#ifdef _WIN32
+	closesocket(Socket);
+#else
+	close(Socket);
+#endif
+}
+
+bool SetNonBlocking(Socket_t Socket) {
+#ifdef _WIN32
+	u_long On = 1;
+	return ioctlsocket(Socket, FIONBIO, &On) == 0;
+#else
+	const int Flags = fcntl(Socket, F_GETFL, 0);
+	return Flags >= 0 && fcntl(Socket, F_SETFL, Flags | O_NONBLOCK) == 0;
+#endif
+}
+
+bool IsWouldBlock() {
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+int PollSockets(PollEntry_t* Entries, size_t Count, int Timeout) {
+#ifdef _WIN32
+	thread_local std::vector<WSAPOLLFD> Native;
+#else
+	thread_local std::vector<pollfd> Native;
+#endif
+	Native.resize(Count);
+	for (size_t i = 0; i < Count; i++) {
+		Native[i] = {};
+		Native[i].fd = Entries[i].Socket;
+		Native[i].events = static_cast<short>(POLLIN | (Entries[i].WantsWrite ? POLLOUT : 0));
+	}
+
+#ifdef _WIN32
+	const int Result = WSAPoll(Native.data(), static_cast<ULONG>(Count), Timeout);
+#else
+	const int Result = poll(Native.data(), Count, Timeout);
+#endif
+	for (size_t i = 0; i < Count; i++) {
+		Entries[i].IsReadable = Result > 0 && (Native[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+		Entries[i].IsWritable = Result > 0 && (Native[i].revents & POLLOUT) != 0;
+	}
+	return Result;
+}
+
+int SendSocket(Socket_t Socket, const char* Data, size_t Length) {
+	return static_cast<int>(send(Socket, Data, static_cast<int>(Length), MSG_NOSIGNAL));
+}
+
+int ReceiveSocket(Socket_t Socket, char* Buffer, size_t Length) {
+	return static_cast<int>(recv(Socket, Buffer, static_cast<int>(Length), 0));
+}
+
+Socket_t AcceptSocket(Socket_t Listener) {
+	const Socket_t Socket = accept(Listener, nullptr, nullptr);
+	if (Socket != NoSocket && !SetNonBlocking(Socket)) {
+		CloseSocket(Socket);
+		return NoSocket;
+	}
+	return Socket;
+}
+
+static bool MakeAddress(const std::filesystem::path& Path, sockaddr_un* Address) {
+	const std::string Text = Path.string();
+	*Address = {};
+	Address->sun_family = AF_UNIX;
+	if (Text.size() >= sizeof(Address->sun_path)) {
+		printf("Socket path '%s' is too long\n", Text.c_str());
+		return false;
+	}
+	memcpy(Address->sun_path, Text.c_str(), Text.size() + 1);
+	return true;
+}
+
+static Socket_t Listen(Socket_t Socket, const sockaddr* Address, Address_t Length) {
+	if (Socket == NoSocket)
+		return NoSocket;
+	if (bind(Socket, Address, Length) != 0 || listen(Socket, 128) != 0 || !SetNonBlocking(Socket)) {
+		CloseSocket(Socket);
+		return NoSocket;
+	}
+	return Socket;
+}
+
+static Socket_t Connect(Socket_t Socket, const sockaddr* Address, Address_t Length) {
+	if (Socket != NoSocket && connect(Socket, Address, Length) != 0) {
+		CloseSocket(Socket);
+		return NoSocket;
+	}
+	return Socket;
+}
+
+Socket_t ListenUnix(const std::filesystem::path& Path) {
+	sockaddr_un Address;
+	if (!InitSockets() || !MakeAddress(Path, &Address))
+		return NoSocket;
+
+	// A socket file left behind by a crash would make bind() fail
+	std::error_code Error;
+	std::filesystem::remove(Path, Error);
+
+	const Socket_t Socket = Listen(socket(AF_UNIX, SOCK_STREAM, 0), reinterpret_cast<const sockaddr*>(&Address), sizeof(Address));
+#ifndef _WIN32
+	// Anyone who can connect can control playback
+	if (Socket != NoSocket)
+		chmod(Path.c_str(), 0600);
+#endif
+	return Socket;
+}
+
+Socket_t ConnectUnix(const std::filesystem::path& Path) {
+	sockaddr_un Address;
+	if (!InitSockets() || !MakeAddress(Path, &Address))
+		return NoSocket;
+	return Connect(socket(AF_UNIX, SOCK_STREAM, 0), reinterpret_cast<const sockaddr*>(&Address), sizeof(Address));
+}
+
+static sockaddr_in MakeLoopback(uint16_t Port) {
+	sockaddr_in Address = {};
+	Address.sin_family = AF_INET;
+	Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	Address.sin_port = htons(Port);
+	return Address;
+}
+
+Socket_t ListenLoopback(uint16_t* Port) {
+	if (!InitSockets())
+		return NoSocket;
+
+	const sockaddr_in Address = MakeLoopback(*Port);
+	Socket_t Socket = socket(AF_INET, SOCK_STREAM, 0);
+#ifndef _WIN32
+	// Restarting right away shouldn't have to wait out TIME_WAIT
+	const int On = 1;
+	if (Socket != NoSocket)
+		setsockopt(Socket, SOL_SOCKET, SO_REUSEADDR, &On, sizeof(On));
+#endif
+	Socket = Listen(Socket, reinterpret_cast<const sockaddr*>(&Address), sizeof(Address));
+
+	sockaddr_in Bound;
+	Address_t Length = sizeof(Bound);
+	if (Socket != NoSocket && getsockname(Socket, reinterpret_cast<sockaddr*>(&Bound), &Length) == 0)
+		*Port = ntohs(Bound.sin_port);
+	return Socket;
+}
+
+Socket_t ConnectLoopback(uint16_t Port) {
+	if (!InitSockets())
+		return NoSocket;
+
+	const sockaddr_in Address = MakeLoopback(Port);
+	const Socket_t Socket = Connect(socket(AF_INET, SOCK_STREAM, 0), reinterpret_cast<const sockaddr*>(&Address), sizeof(Address));
+	if (Socket != NoSocket) {
+		// Small request and reply lines, Nagle would only add latency
+		const int On = 1;
+		setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&On), sizeof(On));
+	}
+	return Socket;
+}
+
+bool MakeSocketPair(Socket_t* Read, Socket_t* Write) {
+	// No socketpair() on Windows, a loopback connection works everywhere
+	uint16_t Port = 0;
+	const Socket_t Listener = ListenLoopback(&Port);
+	*Write = Listener != NoSocket ? ConnectLoopback(Port) : NoSocket;
+	*Read = NoSocket;
+	for (int Attempt = 0; *Write != NoSocket && *Read == NoSocket && Attempt < 100; Attempt++) {
+		PollEntry_t Entry = { Listener };
+		PollSockets(&Entry, 1, 10);
+		*Read = AcceptSocket(Listener);
+	}
+	CloseSocket(Listener);
+
+	if (*Read == NoSocket || !SetNonBlocking(*Write)) {
+		CloseSocket(*Read);
+		CloseSocket(*Write);
+		*Read = *Write = NoSocket;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// The little of BSD sockets and Winsock the servers need, behind one interface.
+// Every socket made here is non-blocking unless it's a client connection.
+#ifdef _WIN32
+using Socket_t = uintptr_t;	// SOCKET
+#else
+using Socket_t = int;
+#endif
+
+// Also INVALID_SOCKET
+constexpr Socket_t NoSocket = static_cast<Socket_t>(-1);
+
+struct PollEntry_t {
+	Socket_t Socket = NoSocket;
+	bool WantsWrite = false;
+	bool IsReadable = false;	// Also set on hangups and errors, the next recv() tells which
+	bool IsWritable = false;
+};
+
+bool InitSockets();
+void CloseSocket(Socket_t Socket);
+bool SetNonBlocking(Socket_t Socket);
+// After a failed call, true if it only would have blocked
+bool IsWouldBlock();
+
+// Timeout in milliseconds, -1 waits for good
+int PollSockets(PollEntry_t* Entries, size_t Count, int Timeout);
+
+// Send and receive without SIGPIPE, the result of send() and recv()
+int SendSocket(Socket_t Socket, const char* Data, size_t Length);
+int ReceiveSocket(Socket_t Socket, char* Buffer, size_t Length);
+Socket_t AcceptSocket(Socket_t Listener);
+
+// Unix domain socket at Path, replacing a stale socket file
+Socket_t ListenUnix(const std::filesystem::path& Path);
+// Blocking
+Socket_t ConnectUnix(const std::filesystem::path& Path);
+
+// On 127.0.0.1 only, port 0 picks a free one and writes it back
+Socket_t ListenLoopback(uint16_t* Port);
+Socket_t ConnectLoopback(uint16_t Port);
+
+// Connected pair, for waking a thread that sleeps in PollSockets()
+bool MakeSocketPair(Socket_t* Read, Socket_t* Write);
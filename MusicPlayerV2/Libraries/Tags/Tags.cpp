@@ -0,0 +1,292 @@
+#include "Tags.hpp"
+#include "../SeekTable/SeekTable.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+	// Frames longer than this aren't text anyone wants to filter by
+	constexpr uint32_t MaxText = 4096;
+
+	// ID3v1 genre numbers, still used by ID3v2 as "(17)" or just "17"
+	constexpr const char* Genres[] = {
+		"Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop", "Jazz", "Metal",
+		"New Age", "Oldies", "Other", "Pop", "R&B", "Rap", "Reggae", "Rock", "Techno", "Industrial",
+		"Alternative", "Ska", "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk",
+		"Fusion", "Trance", "Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+		"Alternative Rock", "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic",
+		"Darkwave", "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream", "Southern Rock", "Comedy", "Cult", "Gangsta",
+		"Top 40", "Christian Rap", "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave", "Psychedelic", "Rave", "Showtunes",
+		"Trailer", "Lo-Fi", "Tribal", "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock",
+	};
+
+	uint32_t ReadSyncSafe(const uint8_t* Bytes) {
+		return ((Bytes[0] & 0x7F) << 21) | ((Bytes[1] & 0x7F) << 14) | ((Bytes[2] & 0x7F) << 7) | (Bytes[3] & 0x7F);
+	}
+
+	uint32_t ReadBigEndian(const uint8_t* Bytes) {
+		return (static_cast<uint32_t>(Bytes[0]) << 24) | (static_cast<uint32_t>(Bytes[1]) << 16) | (static_cast<uint32_t>(Bytes[2]) << 8) | Bytes[3];
+	}
+
+	uint32_t ReadLittleEndian(const uint8_t* Bytes) {
+		return (static_cast<uint32_t>(Bytes[3]) << 24) | (static_cast<uint32_t>(Bytes[2]) << 16) | (static_cast<uint32_t>(Bytes[1]) << 8) | Bytes[0];
+	}
+
+	void AppendUtf8(std::string* Out, uint32_t Code) {
+		if (Code < 0x80) {
+			Out->push_back(static_cast<char>(Code));
+		} else if (Code < 0x800) {
+			Out->push_back(static_cast<char>(0xC0 | (Code >> 6)));
+			Out->push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+		} else if (Code < 0x10000) {
+			Out->push_back(static_cast<char>(0xE0 | (Code >> 12)));
+			Out->push_back(static_cast<char>(0x80 | ((Code >> 6) & 0x3F)));
+			Out->push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+		} else {
+			Out->push_back(static_cast<char>(0xF0 | (Code >> 18)));
+			Out->push_back(static_cast<char>(0x80 | ((Code >> 12) & 0x3F)));
+			Out->push_back(static_cast<char>(0x80 | ((Code >> 6) & 0x3F)));
+			Out->push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+		}
+	}
+
+	void Trim(std::string* Text) {
+		while (!Text->empty() && (Text->back() == ' ' || Text->back() == '\0'))
+			Text->pop_back();
+	}
+
+	// Latin-1 up to the first terminator
+	std::string DecodeLatin1(const uint8_t* Bytes, size_t Length) {
+		std::string Text;
+		for (size_t i = 0; i < Length && Bytes[i]; i++)
+			AppendUtf8(&Text, Bytes[i]);
+		Trim(&Text);
+		return Text;
+	}
+
+	// Text frame body: an encoding byte, then the first of possibly several values
+	std::string DecodeText(const uint8_t* Bytes, size_t Length) {
+		if (Length < 1)
+			return {};
+
+		const uint8_t Encoding = Bytes[0];
+		Bytes++;
+		Length--;
+		if (Encoding == 0)
+			return DecodeLatin1(Bytes, Length);
+
+		std::string Text;
+		if (Encoding == 3) {
+			Text.assign(reinterpret_cast<const char*>(Bytes), strnlen(reinterpret_cast<const char*>(Bytes), Length));
+			Trim(&Text);
+			return Text;
+		}
+
+		// UTF-16, with a byte order mark for encoding 1 and big endian for 2
+		bool IsBigEndian = Encoding == 2;
+		if (Encoding == 1 && Length >= 2 && (Bytes[0] == 0xFE || Bytes[0] == 0xFF)) {
+			IsBigEndian = Bytes[0] == 0xFE;
+			Bytes += 2;
+			Length -= 2;
+		}
+
+		uint32_t High = 0;
+		for (size_t i = 0; i + 1 < Length; i += 2) {
+			const uint32_t Unit = IsBigEndian ? (Bytes[i] << 8 | Bytes[i + 1]) : (Bytes[i + 1] << 8 | Bytes[i]);
+			if (Unit == 0)
+				break;
+			if (Unit >= 0xD800 && Unit < 0xDC00) {
+				High = Unit;
+				continue;
+			}
+			if (Unit >= 0xDC00 && Unit < 0xE000) {
+				if (High)
+					AppendUtf8(&Text, 0x10000 + ((High - 0xD800) << 10) + (Unit - 0xDC00));
+				High = 0;
+				continue;
+			}
+			High = 0;
+			AppendUtf8(&Text, Unit);
+		}
+		Trim(&Text);
+		return Text;
+	}
+
+	// "(17)", "17" and "(17)Rock" all name a genre by number
+	std::string ResolveGenre(const std::string& Genre) {
+		size_t i = Genre.size() > 1 && Genre[0] == '(' ? 1 : 0;
+		const size_t Start = i;
+		while (i < Genre.size() && Genre[i] >= '0' && Genre[i] <= '9')
+			i++;
+		if (i == Start || (Start && (i >= Genre.size() || Genre[i] != ')')) || (!Start && i != Genre.size()))
+			return Genre;
+
+		const std::string Rest = Start ? Genre.substr(i + 1) : std::string();
+		const size_t Number = static_cast<size_t>(atoi(Genre.c_str() + Start));
+		if (!Rest.empty())
+			return Rest;
+		return Number < std::size(Genres) ? Genres[Number] : Genre;
+	}
+}
+
+void Tags_t::ReadId3v2(std::ifstream& Stream, const uint8_t* Header) {
+	const int Major = Header[3];
+	if (Major != 3 && Major != 4)
+		return;
+
+	uint64_t Position = 10;
+	const uint64_t End = 10 + ReadSyncSafe(Header + 6);
+	if (Header[5] & 0x40) {
+		uint8_t Extended[4];
+		Stream.seekg(static_cast<std::streamoff>(Position));
+		if (!Stream.read(reinterpret_cast<char*>(Extended), sizeof(Extended)))
+			return;
+		Position += Major == 4 ? ReadSyncSafe(Extended) : ReadBigEndian(Extended) + 4;
+	}
+
+	std::string Bpm;
+	std::string Length;
+	std::vector<uint8_t> Body;
+	while (Position + 10 <= End) {
+		uint8_t Frame[10];
+		Stream.seekg(static_cast<std::streamoff>(Position));
+		if (!Stream.read(reinterpret_cast<char*>(Frame), sizeof(Frame)) || Frame[0] == 0)
+			break;
+
+		const uint32_t Size = Major == 4 ? ReadSyncSafe(Frame + 4) : ReadBigEndian(Frame + 4);
+		Position += 10;
+		if (Size == 0 || Position + Size > End)
+			break;
+
+		std::string* Field = nullptr;
+		if (memcmp(Frame, "TIT2", 4) == 0)
+			Field = &this->Title;
+		else if (memcmp(Frame, "TPE1", 4) == 0)
+			Field = &this->Artist;
+		else if (memcmp(Frame, "TALB", 4) == 0)
+			Field = &this->Album;
+		else if (memcmp(Frame, "TCON", 4) == 0)
+			Field = &this->Genre;
+		else if (memcmp(Frame, "TBPM", 4) == 0)
+			Field = &Bpm;
+		else if (memcmp(Frame, "TLEN", 4) == 0)
+			Field = &Length;
+
+		// Compressed, encrypted or unsynchronised frames aren't worth decoding for a few words
+		const bool IsPlain = Major == 4 ? (Frame[9] & 0x0F) == 0 : (Frame[9] & 0xC0) == 0;
+		if (Field && IsPlain && Size <= MaxText) {
+			Body.resize(Size);
+			if (!Stream.read(reinterpret_cast<char*>(Body.data()), Size))
+				break;
+			*Field = DecodeText(Body.data(), Body.size());
+		}
+		Position += Size;
+	}
+
+	this->Genre = ResolveGenre(this->Genre);
+	this->Bpm = static_cast<float>(atof(Bpm.c_str()));
+	this->Duration = atof(Length.c_str()) / 1000.0;
+}
+
+void Tags_t::ReadId3v1(std::ifstream& Stream, uint64_t FileSize) {
+	if (FileSize < 128)
+		return;
+
+	uint8_t Tag[128];
+	Stream.clear();
+	Stream.seekg(static_cast<std::streamoff>(FileSize - 128));
+	if (!Stream.read(reinterpret_cast<char*>(Tag), sizeof(Tag)) || memcmp(Tag, "TAG", 3) != 0)
+		return;
+
+	// Only what the ID3v2 tag left out
+	if (this->Title.empty())
+		this->Title = DecodeLatin1(Tag + 3, 30);
+	if (this->Artist.empty())
+		this->Artist = DecodeLatin1(Tag + 33, 30);
+	if (this->Album.empty())
+		this->Album = DecodeLatin1(Tag + 63, 30);
+	if (this->Genre.empty() && Tag[127] < std::size(Genres))
+		this->Genre = Genres[Tag[127]];
+}
+
+void Tags_t::ReadWave(std::ifstream& Stream, uint64_t FileSize) {
+	uint32_t ByteRate = 0;
+	uint64_t DataSize = 0;
+	uint64_t Position = 12;
+	std::vector<uint8_t> Body;
+	while (Position + 8 <= FileSize) {
+		uint8_t Chunk[8];
+		Stream.clear();
+		Stream.seekg(static_cast<std::streamoff>(Position));
+		if (!Stream.read(reinterpret_cast<char*>(Chunk), sizeof(Chunk)))
+			break;
+
+		const uint32_t Size = ReadLittleEndian(Chunk + 4);
+		Position += 8;
+		if (memcmp(Chunk, "fmt ", 4) == 0 && Size >= 16) {
+			uint8_t Format[16];
+			if (Stream.read(reinterpret_cast<char*>(Format), sizeof(Format)))
+				ByteRate = ReadLittleEndian(Format + 8);
+		} else if (memcmp(Chunk, "data", 4) == 0) {
+			// Files still being written may claim more than there is
+			DataSize = std::min<uint64_t>(Size, FileSize - Position);
+		} else if (memcmp(Chunk, "LIST", 4) == 0 && Size >= 4 && Size <= 64 * 1024) {
+			Body.resize(Size);
+			if (Stream.read(reinterpret_cast<char*>(Body.data()), Size) && memcmp(Body.data(), "INFO", 4) == 0) {
+				for (size_t i = 4; i + 8 <= Body.size();) {
+					const uint8_t* Entry = Body.data() + i;
+					const uint32_t Length = std::min<uint32_t>(ReadLittleEndian(Entry + 4), static_cast<uint32_t>(Body.size() - i - 8));
+					std::string Text(reinterpret_cast<const char*>(Entry + 8), strnlen(reinterpret_cast<const char*>(Entry + 8), Length));
+					Trim(&Text);
+					if (memcmp(Entry, "INAM", 4) == 0)
+						this->Title = std::move(Text);
+					else if (memcmp(Entry, "IART", 4) == 0)
+						this->Artist = std::move(Text);
+					else if (memcmp(Entry, "IPRD", 4) == 0)
+						this->Album = std::move(Text);
+					else if (memcmp(Entry, "IGNR", 4) == 0)
+						this->Genre = std::move(Text);
+					i += 8 + Length + (Length & 1);
+				}
+			}
+		}
+
+		// Chunks are padded to an even size
+		Position += Size + (Size & 1);
+	}
+
+	if (ByteRate)
+		this->Duration = static_cast<double>(DataSize) / ByteRate;
+}
+
+bool Tags_t::Read(const std::filesystem::path& File) {
+	*this = {};
+
+	std::ifstream Stream(File, std::ios::binary);
+	if (!Stream)
+		return false;
+
+	Stream.seekg(0, std::ios::end);
+	const uint64_t FileSize = static_cast<uint64_t>(Stream.tellg());
+	Stream.seekg(0);
+
+	uint8_t Header[12];
+	if (!Stream.read(reinterpret_cast<char*>(Header), sizeof(Header)))
+		return true;
+
+	if (memcmp(Header, "RIFF", 4) == 0 && memcmp(Header + 8, "WAVE", 4) == 0) {
+		this->ReadWave(Stream, FileSize);
+		return true;
+	}
+
+	if (memcmp(Header, "ID3", 3) == 0)
+		this->ReadId3v2(Stream, Header);
+	this->ReadId3v1(Stream, FileSize);
+
+	// Exact down to the sample once the scanner walked the file, TLEN is only a hint
+	if (const std::shared_ptr<const SeekTable_t> Table = SeekTable_t::Open(File); Table && Table->GetSampleRate())
+		this->Duration = static_cast<double>(Table->GetSamples()) / Table->GetSampleRate();
+	return true;
+}
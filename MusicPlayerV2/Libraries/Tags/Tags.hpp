@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// What a music file says about itself: ID3v2.3/2.4 text frames with ID3v1 filling the gaps,
+// or the INFO list of a WAV file. Only the tag areas and headers are read, never the audio.
+// Text comes out as UTF-8, whatever encoding the tag used.
+class Tags_t {
+private:
+	void ReadId3v2(std::ifstream& Stream, const uint8_t* Header);
+	void ReadId3v1(std::ifstream& Stream, uint64_t FileSize);
+	void ReadWave(std::ifstream& Stream, uint64_t FileSize);
+
+public:
+	std::string Title;
+	std::string Artist;
+	std::string Album;
+	std::string Genre;
+	float Bpm = 0.0f;
+	double Duration = 0.0;	// Seconds, 0 if unknown. MP3s take theirs from the cached seek table
+
+	// False if the file can't be read, a file without tags just leaves the fields empty
+	bool Read(const std::filesystem::path& File);
+};
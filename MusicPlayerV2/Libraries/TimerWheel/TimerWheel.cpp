@@ -0,0 +1,177 @@
+#include "TimerWheel.hpp"
+
+#include <algorithm>
+
+void TimerWheel_t::PushFront(Handle_t Handle, Handle_t* List, int Level) {
+	Timer_t* Timer = this->Timers.Get(Handle);
+	Timer->List = List;
+	Timer->Level = Level;
+	Timer->Prev = {};
+	Timer->Next = *List;
+	if (Timer_t* Head = this->Timers.Get(*List))
+		Head->Prev = Handle;
+	*List = Handle;
+
+	if (Level >= 0)
+		this->LevelUsed[Level]++;
+}
+
+void TimerWheel_t::Unlink(Handle_t Handle) {
+	Timer_t* Timer = this->Timers.Get(Handle);
+	if (Timer_t* Prev = this->Timers.Get(Timer->Prev))
+		Prev->Next = Timer->Next;
+	else
+		*Timer->List = Timer->Next;
+	if (Timer_t* Next = this->Timers.Get(Timer->Next))
+		Next->Prev = Timer->Prev;
+
+	if (Timer->Level >= 0)
+		this->LevelUsed[Timer->Level]--;
+
+	Timer->List = nullptr;
+	Timer->Level = -1;
+	Timer->Prev = {};
+	Timer->Next = {};
+}
+
+Handle_t TimerWheel_t::PopFront(Handle_t* List) {
+	const Handle_t Handle = *List;
+	if (this->Timers.Get(Handle))
+		this->Unlink(Handle);
+	return Handle;
+}
+
+void TimerWheel_t::MoveList(Handle_t* From, Handle_t* To) {
+	while (this->Timers.Get(*From)) {
+		const Handle_t Handle = this->PopFront(From);
+		this->PushFront(Handle, To, -1);
+	}
+}
+
+void TimerWheel_t::Link(Handle_t Handle) {
+	Timer_t* Timer = this->Timers.Get(Handle);
+	if (Timer->Deadline <= this->Current) {
+		this->PushFront(Handle, &this->Due, -1);
+		return;
+	}
+
+	// Lowest level whose range still covers the deadline, the top level takes everything beyond
+	const uint64_t Delta = Timer->Deadline - this->Current;
+	uint64_t Deadline = Timer->Deadline;
+	int Level = 0;
+	while (Level < Levels - 1 && Delta >= (Slots << (SlotBits * Level)))
+		Level++;
+	if (Delta >= (Slots << (SlotBits * Level)))
+		Deadline = this->Current + (Slots << (SlotBits * Level)) - 1;
+
+	const uint64_t Slot = (Deadline >> (SlotBits * Level)) & (Slots - 1);
+	this->PushFront(Handle, &this->Wheel[Level][Slot], Level);
+}
+
+Handle_t TimerWheel_t::Schedule(uint64_t Deadline, Callback_t Callback, void* User, uint64_t Data) {
+	const Handle_t Handle = this->Timers.Acquire();
+	Timer_t* Timer = this->Timers.Get(Handle);
+	if (!Timer) {
+		printf("Out of timers\n");
+		return {};
+	}
+
+	Timer->Deadline = Deadline;
+	Timer->Callback = Callback;
+	Timer->User = User;
+	Timer->Data = Data;
+	this->Link(Handle);
+	return Handle;
+}
+
+bool TimerWheel_t::Cancel(Handle_t Timer) {
+	if (!this->Timers.Get(Timer))
+		return false;
+
+	this->Unlink(Timer);
+	this->Timers.Release(Timer);
+	return true;
+}
+
+void TimerWheel_t::FireList(Handle_t* List) {
+	// Callbacks may schedule into the list being fired, those wait for the next round
+	Handle_t Firing;
+	this->MoveList(List, &Firing);
+
+	while (this->Timers.Get(Firing)) {
+		const Handle_t Handle = this->PopFront(&Firing);
+		const Timer_t Timer = *this->Timers.Get(Handle);
+		this->Timers.Release(Handle);
+		Timer.Callback(Timer.User, Timer.Data);
+	}
+}
+
+void TimerWheel_t::Cascade(int Level) {
+	const uint64_t Slot = (this->Current >> (SlotBits * Level)) & (Slots - 1);
+	Handle_t Moving;
+	this->MoveList(&this->Wheel[Level][Slot], &Moving);
+
+	while (this->Timers.Get(Moving))
+		this->Link(this->PopFront(&Moving));
+}
+
+void TimerWheel_t::Advance(uint64_t Now) {
+	this->FireList(&this->Due);
+
+	while (this->Current < Now) {
+		if (!this->Timers.GetUsed()) {
+			this->Current = Now;
+			break;
+		}
+
+		// Nothing in the lowest level, skip ahead to the next cascade
+		if (!this->LevelUsed[0] && !this->Timers.Get(this->Due)) {
+			const uint64_t Boundary = (this->Current | (Slots - 1)) + 1;
+			if (Boundary > Now) {
+				this->Current = Now;
+				break;
+			}
+			this->Current = Boundary - 1;
+		}
+
+		this->Current++;
+
+		// Higher levels first, they can drop timers into the lower slots due right now
+		for (int Level = Levels - 1; Level > 0; Level--) {
+			if ((this->Current & ((1ull << (SlotBits * Level)) - 1)) == 0)
+				this->Cascade(Level);
+		}
+
+		this->FireList(&this->Due);
+		this->FireList(&this->Wheel[0][this->Current & (Slots - 1)]);
+	}
+}
+
+uint64_t TimerWheel_t::GetNextDeadline() const {
+	if (this->Timers.Get(this->Due))
+		return this->Current;
+
+	uint64_t Next = Never;
+	for (int Level = 0; Level < Levels; Level++) {
+		if (!this->LevelUsed[Level])
+			continue;
+
+		for (uint64_t Slot = 0; Slot < Slots; Slot++) {
+			for (const Timer_t* Timer = this->Timers.Get(this->Wheel[Level][Slot]); Timer; Timer = this->Timers.Get(Timer->Next))
+				Next = std::min(Next, Timer->Deadline);
+		}
+	}
+	return Next;
+}
+
+uint64_t TimerWheel_t::GetNow() const {
+	return this->Current;
+}
+
+size_t TimerWheel_t::GetPending() const {
+	return this->Timers.GetUsed();
+}
+
+void TimerWheel_t::Reset(uint64_t Now) {
+	this->Current = Now;
+}
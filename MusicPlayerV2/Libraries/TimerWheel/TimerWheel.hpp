@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../Pool/Pool.hpp"
+
+// Hierarchical timing wheel with millisecond ticks. Four levels of 64 slots cover about
+// 4.6 hours, later deadlines wait in the top level and get placed again as it comes around.
+// Scheduling and cancelling are O(1), Advance() costs one slot check per elapsed tick plus
+// whatever fires. Not thread-safe, owned by the thread that calls Advance().
+class TimerWheel_t {
+public:
+	// Called from Advance(). May schedule and cancel timers, including scheduling itself again
+	using Callback_t = void (*)(void* User, uint64_t Data);
+
+	static constexpr size_t Capacity = 256;
+	static constexpr uint64_t Never = UINT64_MAX;
+
+private:
+	static constexpr int Levels = 4;
+	static constexpr int SlotBits = 6;
+	static constexpr uint64_t Slots = 1ull << SlotBits;
+
+	struct Timer_t {
+		uint64_t Deadline = 0;
+		Callback_t Callback = nullptr;
+		void* User = nullptr;
+		uint64_t Data = 0;
+
+		// Links of the list the timer sits in, Level is -1 outside the wheel
+		Handle_t* List = nullptr;
+		int Level = -1;
+		Handle_t Prev;
+		Handle_t Next;
+	};
+
+	HandlePool_t<Timer_t, Capacity> Timers;
+	Handle_t Wheel[Levels][Slots];
+	Handle_t Due;			// Deadline already reached when scheduled, fired on the next Advance()
+	size_t LevelUsed[Levels] = {};
+
+	uint64_t Current = 0;	// Last tick that was processed
+
+	void Link(Handle_t Handle);
+	void Unlink(Handle_t Handle);
+	void PushFront(Handle_t Handle, Handle_t* List, int Level);
+	Handle_t PopFront(Handle_t* List);
+	void MoveList(Handle_t* From, Handle_t* To);
+	void FireList(Handle_t* List);
+	void Cascade(int Level);
+
+public:
+	// Deadline in ticks (milliseconds) on the same scale as Advance(). Invalid handle if every timer is in use
+	Handle_t Schedule(uint64_t Deadline, Callback_t Callback, void* User, uint64_t Data = 0);
+
+	// False if the timer already fired or was cancelled
+	bool Cancel(Handle_t Timer);
+
+	// Fires everything due up to and including Now
+	void Advance(uint64_t Now);
+
+	// Earliest pending deadline, Never if nothing is scheduled
+	uint64_t GetNextDeadline() const;
+
+	uint64_t GetNow() const;
+	size_t GetPending() const;
+
+	// Starts counting at Now, only valid while nothing is scheduled
+	void Reset(uint64_t Now);
+};
@@ -0,0 +1,255 @@
+#include "TrackSort.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <numeric>
+#include <unordered_map>
+#include <thread>
+
+namespace {
+	// Latin-1 Supplement and Latin Extended-A down to their base letters.
+	// Anything else outside ASCII keeps its UTF-8 bytes and sorts after the letters
+	struct Folding_t {
+		uint16_t First;
+		uint16_t Last;
+		const char* Base;
+	};
+
+	constexpr Folding_t Foldings[] = {
+		{ 0xC0, 0xC5, "a" }, { 0xC6, 0xC6, "ae" }, { 0xC7, 0xC7, "c" }, { 0xC8, 0xCB, "e" }, { 0xCC, 0xCF, "i" }, { 0xD0, 0xD0, "d" },
+		{ 0xD1, 0xD1, "n" }, { 0xD2, 0xD6, "o" }, { 0xD8, 0xD8, "o" }, { 0xD9, 0xDC, "u" }, { 0xDD, 0xDD, "y" }, { 0xDE, 0xDE, "th" },
+		{ 0xDF, 0xDF, "ss" }, { 0xE0, 0xE5, "a" }, { 0xE6, 0xE6, "ae" }, { 0xE7, 0xE7, "c" }, { 0xE8, 0xEB, "e" }, { 0xEC, 0xEF, "i" },
+		{ 0xF0, 0xF0, "d" }, { 0xF1, 0xF1, "n" }, { 0xF2, 0xF6, "o" }, { 0xF8, 0xF8, "o" }, { 0xF9, 0xFC, "u" }, { 0xFD, 0xFD, "y" },
+		{ 0xFE, 0xFE, "th" }, { 0xFF, 0xFF, "y" },
+		{ 0x100, 0x105, "a" }, { 0x106, 0x10D, "c" }, { 0x10E, 0x111, "d" }, { 0x112, 0x11B, "e" }, { 0x11C, 0x123, "g" }, { 0x124, 0x127, "h" },
+		{ 0x128, 0x131, "i" }, { 0x132, 0x133, "ij" }, { 0x134, 0x135, "j" }, { 0x136, 0x138, "k" }, { 0x139, 0x142, "l" }, { 0x143, 0x14B, "n" },
+		{ 0x14C, 0x151, "o" }, { 0x152, 0x153, "oe" }, { 0x154, 0x159, "r" }, { 0x15A, 0x161, "s" }, { 0x162, 0x167, "t" }, { 0x168, 0x173, "u" },
+		{ 0x174, 0x175, "w" }, { 0x176, 0x178, "y" }, { 0x179, 0x17E, "z" }, { 0x17F, 0x17F, "s" },
+	};
+
+	constexpr char EmptyKey[] = "\xFF";
+
+	template <typename Function_t>
+	void RunParallel(size_t Tasks, const Function_t& Function) {
+		std::vector<std::thread> Threads;
+		Threads.reserve(Tasks);
+		for (size_t Task = 1; Task < Tasks; Task++)
+			Threads.emplace_back(Function, Task);
+		Function(0);
+		for (std::thread& Thread : Threads)
+			Thread.join();
+	}
+}
+
+void SortKeys_t::Collate(std::string_view Text, std::string* Key) {
+	Key->clear();
+	for (size_t i = 0; i < Text.size();) {
+		const uint8_t Lead = static_cast<uint8_t>(Text[i]);
+		const size_t Length = Lead < 0x80 ? 1 : (Lead >> 5) == 0x06 ? 2 : (Lead >> 4) == 0x0E ? 3 : (Lead >> 3) == 0x1E ? 4 : 0;
+		if (!Length || i + Length > Text.size()) {
+			i++;	// Not UTF-8, dropped
+			continue;
+		}
+
+		if (Length == 1) {
+			if (Lead >= 0x20)
+				Key->push_back(static_cast<char>(Lead >= 'A' && Lead <= 'Z' ? Lead + ('a' - 'A') : Lead));
+		} else {
+			const uint32_t Point = Length == 2 ? ((Lead & 0x1F) << 6) | (Text[i + 1] & 0x3F) : 0;
+			const auto Folding = std::find_if(std::begin(Foldings), std::end(Foldings), [Point](const Folding_t& Folding) {
+				return Point >= Folding.First && Point <= Folding.Last;
+			});
+			if (Folding != std::end(Foldings))
+				Key->append(Folding->Base);
+			else
+				Key->append(Text.substr(i, Length));
+		}
+		i += Length;
+	}
+
+	// "(Untitled)" next to "Untitled", "The Beatles" under B
+	const auto IsPunctuation = [](char Character) {
+		return static_cast<uint8_t>(Character) < 0x80 && !(Character >= 'a' && Character <= 'z') && !(Character >= '0' && Character <= '9');
+	};
+	size_t Start = 0;
+	while (Start < Key->size() && IsPunctuation((*Key)[Start]))
+		Start++;
+	if (Key->compare(Start, 4, "the ") == 0 && Key->size() > Start + 4) {
+		Start += 4;
+		while (Start < Key->size() && IsPunctuation((*Key)[Start]))
+			Start++;
+	}
+	Key->erase(0, Start);
+
+	if (Key->empty())
+		Key->assign(EmptyKey);
+}
+
+std::shared_ptr<const SortKeys_t> SortKeys_t::Build(const std::vector<LibraryTrack_t>& Tracks) {
+	auto Keys = std::make_shared<SortKeys_t>();
+	const size_t Count = Tracks.size();
+
+	// Keys are sorted as integers next to their rows, IsLess only settles the ones that are equal
+	std::vector<std::pair<uint64_t, uint32_t>> Items(Count);
+	const auto Rank = [&](Field_t Field, const auto& IsLess) {
+		const auto Compare = [&](const std::pair<uint64_t, uint32_t>& Left, const std::pair<uint64_t, uint32_t>& Right) {
+			return Left.first != Right.first ? Left.first < Right.first : IsLess(Left.second, Right.second);
+		};
+		std::sort(Items.begin(), Items.end(), Compare);
+
+		std::vector<uint32_t>& Ranks = Keys->Ranks[Field];
+		Ranks.resize(Items.size());
+		uint32_t Rank = 0;
+		for (size_t i = 0; i < Items.size(); i++) {
+			if (i && Compare(Items[i - 1], Items[i]))
+				Rank++;
+			Ranks[Items[i].second] = Rank;
+		}
+		Keys->Bits[Field] = std::bit_width(Rank);
+	};
+
+	// Every distinct text key is sorted once, its first eight bytes as a big endian integer
+	std::unordered_map<std::string, uint32_t> Lookup;
+	std::vector<const std::string*> Values;
+	std::vector<uint32_t> Codes(Count);
+	std::vector<uint32_t> ValueRanks;
+	std::string Key;
+	Lookup.reserve(Count);
+	for (const Field_t Field : { Title, Artist, Album }) {
+		Lookup.clear();
+		Values.clear();
+		for (size_t Row = 0; Row < Count; Row++) {
+			const LibraryTrack_t& Track = Tracks[Row];
+			Collate(Field == Title ? Track.Title : Field == Artist ? Track.Artist : Track.Album, &Key);
+			const auto [Found, IsNew] = Lookup.try_emplace(Key, static_cast<uint32_t>(Values.size()));
+			if (IsNew)
+				Values.push_back(&Found->first);
+			Codes[Row] = Found->second;
+		}
+
+		Items.resize(Values.size());
+		for (size_t Code = 0; Code < Values.size(); Code++) {
+			const std::string& Value = *Values[Code];
+			uint64_t Prefix = 0;
+			for (size_t i = 0; i < 8; i++)
+				Prefix = (Prefix << 8) | (i < Value.size() ? static_cast<uint8_t>(Value[i]) : 0);
+			Items[Code] = { Prefix, static_cast<uint32_t>(Code) };
+		}
+		Rank(Field, [&](uint32_t Left, uint32_t Right) {
+			return *Values[Left] < *Values[Right];
+		});
+
+		// Ranked by code so far
+		ValueRanks.swap(Keys->Ranks[Field]);
+		Keys->Ranks[Field].resize(Count);
+		for (size_t Row = 0; Row < Count; Row++)
+			Keys->Ranks[Field][Row] = ValueRanks[Codes[Row]];
+	}
+
+	// Durations keep their fractions, the bits of a double order like an integer once the sign is flipped
+	const auto IsEqual = [](uint32_t, uint32_t) {
+		return false;
+	};
+	Items.resize(Count);
+	for (size_t Row = 0; Row < Count; Row++) {
+		const uint64_t Bits = std::bit_cast<uint64_t>(Tracks[Row].Duration);
+		Items[Row] = { Bits & (1ull << 63) ? ~Bits : Bits | (1ull << 63), static_cast<uint32_t>(Row) };
+	}
+	Rank(Duration, IsEqual);
+	for (size_t Row = 0; Row < Count; Row++)
+		Items[Row] = { static_cast<uint64_t>(Tracks[Row].Added) ^ (1ull << 63), static_cast<uint32_t>(Row) };
+	Rank(Added, IsEqual);
+	return Keys;
+}
+
+void TrackViews_t::Sync(const std::shared_ptr<const Library_t>& Library) {
+	if (Library == this->Library)
+		return;
+
+	this->Library = Library;
+	this->Keys = nullptr;
+	std::fill(std::begin(this->IsSorted), std::end(this->IsSorted), false);
+}
+
+const std::vector<uint32_t>* TrackViews_t::Get(View_t View) {
+	if (View == View_t::File || !this->Library)
+		return nullptr;
+
+	const int Index = static_cast<int>(View);
+	if (!this->IsSorted[Index]) {
+		// Libraries put together by hand come without keys
+		if (!this->Keys)
+			this->Keys = this->Library->SortKeys ? this->Library->SortKeys : SortKeys_t::Build(this->Library->Tracks);
+		Sort(*this->Keys, View, &this->Orders[Index]);
+		this->IsSorted[Index] = true;
+	}
+	return &this->Orders[Index];
+}
+
+void TrackViews_t::Sort(const SortKeys_t& Keys, View_t View, std::vector<uint32_t>* Order, unsigned Threads) {
+	// Most significant first
+	static constexpr SortKeys_t::Field_t Chains[][3] = {
+		{ SortKeys_t::Fields, SortKeys_t::Fields, SortKeys_t::Fields },
+		{ SortKeys_t::Title, SortKeys_t::Artist, SortKeys_t::Album },
+		{ SortKeys_t::Artist, SortKeys_t::Album, SortKeys_t::Title },
+		{ SortKeys_t::Album, SortKeys_t::Artist, SortKeys_t::Title },
+		{ SortKeys_t::Duration, SortKeys_t::Fields, SortKeys_t::Fields },
+		{ SortKeys_t::Added, SortKeys_t::Fields, SortKeys_t::Fields },
+	};
+
+	const size_t Count = Keys.Ranks[SortKeys_t::Title].size();
+	Order->resize(Count);
+	std::iota(Order->begin(), Order->end(), 0);
+	if (View == View_t::File || !Count)
+		return;
+
+	if (!Threads)
+		Threads = std::max(std::thread::hardware_concurrency(), 1u);
+	const size_t Chunks = std::clamp<size_t>(Count / MinChunk, 1, Threads);
+	std::vector<size_t> Bounds(Chunks + 1);
+	for (size_t Chunk = 0; Chunk <= Chunks; Chunk++)
+		Bounds[Chunk] = Count * Chunk / Chunks;
+
+	std::vector<uint32_t> Buffer(Count);
+	std::vector<uint32_t> Histograms;
+	const auto& Chain = Chains[static_cast<int>(View)];
+	for (int i = 2; i >= 0; i--) {
+		if (Chain[i] == SortKeys_t::Fields)
+			continue;
+		const uint32_t* Ranks = Keys.Ranks[Chain[i]].data();
+		const int Bits = Keys.Bits[Chain[i]];
+		const int Passes = (Bits + MaxDigitBits - 1) / MaxDigitBits;
+		const int Width = Passes ? (Bits + Passes - 1) / Passes : 0;
+		const uint32_t Digits = 1u << Width;
+
+		for (int Shift = 0; Shift < Bits; Shift += Width) {
+			const uint32_t Mask = Digits - 1;
+			const uint32_t* From = Order->data();
+			uint32_t* To = Buffer.data();
+
+			// Each chunk counts its own digits, then scatters behind the chunks before it
+			Histograms.assign(Chunks * Digits, 0);
+			RunParallel(Chunks, [&](size_t Chunk) {
+				uint32_t* Histogram = Histograms.data() + Chunk * Digits;
+				for (size_t j = Bounds[Chunk]; j < Bounds[Chunk + 1]; j++)
+					Histogram[(Ranks[From[j]] >> Shift) & Mask]++;
+			});
+
+			uint32_t Offset = 0;
+			for (uint32_t Digit = 0; Digit < Digits; Digit++) {
+				for (size_t Chunk = 0; Chunk < Chunks; Chunk++) {
+					const uint32_t Size = Histograms[Chunk * Digits + Digit];
+					Histograms[Chunk * Digits + Digit] = Offset;
+					Offset += Size;
+				}
+			}
+
+			RunParallel(Chunks, [&](size_t Chunk) {
+				uint32_t* Histogram = Histograms.data() + Chunk * Digits;
+				for (size_t j = Bounds[Chunk]; j < Bounds[Chunk + 1]; j++)
+					To[Histogram[(Ranks[From[j]] >> Shift) & Mask]++] = From[j];
+			});
+			Order->swap(Buffer);
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../PlayerState/PlayerState.hpp"
+
+// Binary collation keys of every track, built by the scanner along with the library. Text is
+// folded so plain byte order sorts it: lower case, Latin accents stripped (ß to ss, æ to ae and
+// so on), leading punctuation and a leading "The " skipped, empty values last. The keys of a
+// field are sorted once when they're built and every track keeps the rank of its own, so the
+// views sort integers and never compare strings.
+class SortKeys_t {
+public:
+	enum Field_t {
+		Title,
+		Artist,
+		Album,
+		Duration,
+		Added,
+		Fields,
+	};
+
+	// By library row, equal keys share a rank
+	std::vector<uint32_t> Ranks[Fields];
+	int Bits[Fields] = {};		// Enough for the highest rank
+
+	static void Collate(std::string_view Text, std::string* Key);
+	static std::shared_ptr<const SortKeys_t> Build(const std::vector<LibraryTrack_t>& Tracks);
+};
+
+// Library rows in the order of each view, sorted the first time a view is asked for and
+// kept until the library changes. A view is an LSD radix sort over the ranks of its fields,
+// the last tie breaker first, with every pass counted and scattered in chunks on several
+// threads. The passes are stable, so ties end up in library order. Not thread-safe.
+class TrackViews_t {
+public:
+	enum class View_t {
+		File,		// Library order, by path
+		Title,
+		Artist,		// Then album and title
+		Album,		// Then artist and title
+		Duration,
+		Added,
+		Views,
+	};
+
+	// Chunks smaller than this aren't worth a thread
+	static constexpr size_t MinChunk = 64 * 1024;
+	// Wider ranks take more than one pass
+	static constexpr int MaxDigitBits = 16;
+
+private:
+	std::shared_ptr<const Library_t> Library;
+	std::shared_ptr<const SortKeys_t> Keys;
+	std::vector<uint32_t> Orders[static_cast<int>(View_t::Views)];
+	bool IsSorted[static_cast<int>(View_t::Views)] = {};
+
+public:
+	// Forgets the cached orders if Library is another one
+	void Sync(const std::shared_ptr<const Library_t>& Library);
+
+	// Null for File, the library's own order
+	const std::vector<uint32_t>* Get(View_t View);
+
+	// Threads 0 picks as many as the machine has
+	static void Sort(const SortKeys_t& Keys, View_t View, std::vector<uint32_t>* Order, unsigned Threads = 0);
+};
@@ -0,0 +1,68 @@
+#include "WaveFile.hpp"
+
+#include <cstdio>
+
+WaveFile_t::~WaveFile_t() {
+	this->Close();
+}
+
+bool WaveFile_t::Open(const std::filesystem::path& Path, uint32_t SampleRate, uint32_t Channels) {
+	this->Close();
+
+	this->Stream.open(Path, std::ios::binary | std::ios::trunc);
+	if (!this->Stream) {
+		printf("Failed to open %s for writing\n", Path.string().c_str());
+		return false;
+	}
+
+	this->IsRaw = Path.extension() == ".raw";
+	this->Channels = Channels;
+	this->Frames = 0;
+	if (this->IsRaw)
+		return true;
+
+	const auto WriteValue = [this](uint32_t Value, int Bytes) {
+		this->Stream.write(reinterpret_cast<const char*>(&Value), Bytes);
+	};
+	this->Stream.write("RIFF", 4);
+	WriteValue(0, 4);
+	this->Stream.write("WAVEfmt ", 8);
+	WriteValue(16, 4);
+	WriteValue(3, 2);	// IEEE float
+	WriteValue(Channels, 2);
+	WriteValue(SampleRate, 4);
+	WriteValue(SampleRate * Channels * sizeof(float), 4);
+	WriteValue(Channels * sizeof(float), 2);
+	WriteValue(32, 2);
+	this->Stream.write("data", 4);
+	WriteValue(0, 4);
+	return static_cast<bool>(this->Stream);
+}
+
+bool WaveFile_t::Write(const float* Samples, uint64_t Frames) {
+	this->Stream.write(reinterpret_cast<const char*>(Samples), static_cast<std::streamsize>(Frames * this->Channels * sizeof(float)));
+	this->Frames += Frames;
+	return static_cast<bool>(this->Stream);
+}
+
+bool WaveFile_t::Close() {
+	if (!this->Stream.is_open())
+		return false;
+
+	if (!this->IsRaw) {
+		const uint32_t DataBytes = static_cast<uint32_t>(this->Frames * this->Channels * sizeof(float));
+		const uint32_t RiffBytes = 36 + DataBytes;
+		this->Stream.seekp(4);
+		this->Stream.write(reinterpret_cast<const char*>(&RiffBytes), 4);
+		this->Stream.seekp(40);
+		this->Stream.write(reinterpret_cast<const char*>(&DataBytes), 4);
+	}
+
+	const bool IsGood = static_cast<bool>(this->Stream);
+	this->Stream.close();
+	return IsGood;
+}
+
+uint64_t WaveFile_t::GetFrames() const {
+	return this->Frames;
+}
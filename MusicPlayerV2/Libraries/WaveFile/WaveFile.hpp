@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+// Interleaved 32 bit float samples to a WAV file, or headerless to a ".raw" file.
+// The header is written with zero sizes and patched once the length is known.
+class WaveFile_t {
+private:
+	std::ofstream Stream;
+	bool IsRaw = false;
+	uint32_t Channels = 0;
+	uint64_t Frames = 0;
+
+public:
+	~WaveFile_t();
+
+	bool Open(const std::filesystem::path& Path, uint32_t SampleRate, uint32_t Channels);
+	bool Write(const float* Samples, uint64_t Frames);
+	// Fills in the sizes, false if anything failed to write
+	bool Close();
+
+	uint64_t GetFrames() const;
+};
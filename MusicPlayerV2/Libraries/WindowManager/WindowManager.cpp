@@ -2,10 +2,10 @@
 #include "WindowManager.hpp"
 #include "../ImGui/imgui_impl_dx11.h"
 #include "../ImGui/imgui_impl_win32.h"
+#include "../FrameScheduler/FrameScheduler.hpp"
 
 #include <iostream>
 #include <dwmapi.h>
-#include <filesystem>
 
 WindowManager_t WindowManager;
 
@@ -198,22 +198,6 @@ bool WindowManager_t::Init(const std::string& WindowName, const ImVec2 WindowSiz
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 
-	ImGuiIO* io = &ImGui::GetIO();
-	
-	std::string CurDir = std::filesystem::current_path().string() + "\\Fonts\\";
-	if (std::filesystem::exists(CurDir)) {
-		for (const auto& Entry : std::filesystem::directory_iterator(CurDir)) {
-			const std::string& Name = Entry.path().filename().string();
-			if (Name.find("Bold") != std::string::npos) {
-				Fonts["SanFranciscoBold"] = io->Fonts->AddFontFromFileTTF(Entry.path().string().c_str(), 24.0f);
-			}
-
-			if (Name.find("Medium") != std::string::npos) {
-				Fonts["SanFranciscoMedium"] = io->Fonts->AddFontFromFileTTF(Entry.path().string().c_str(), 18.0f);
-			}
-		}
-	}
-
 	if (!ImGui_ImplWin32_Init(this->WindowHandle)) {
 		this->IsRunning = false;
 		return false;
@@ -223,6 +207,12 @@ bool WindowManager_t::Init(const std::string& WindowName, const ImVec2 WindowSiz
 		return false;
 	}
 
+	// Lets the engine request frames from its own threads
+	this->WakeEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+	FrameScheduler.WakeCallback = []() {
+		SetEvent(WindowManager.WakeEvent);
+	};
+
 	// Show window
 	ShowWindow(this->WindowHandle, SW_SHOWDEFAULT);
 	UpdateWindow(this->WindowHandle);
@@ -232,7 +222,65 @@ bool WindowManager_t::Init(const std::string& WindowName, const ImVec2 WindowSiz
 	return true;
 }
 
+void WindowManager_t::PumpMessages() {
+	MSG Message;
+	while (::PeekMessage(&Message, nullptr, 0U, 0U, PM_REMOVE)) {
+		if (Message.message == WM_QUIT) {
+			this->IsRunning = false;
+			continue;
+		}
+
+		::TranslateMessage(&Message);
+		::DispatchMessage(&Message);
+
+		// Input can change what ImGui shows, give it a couple of frames to settle
+		this->InputFrames = 2;
+		FrameScheduler.RequestFrame();
+	}
+}
+
+bool WindowManager_t::WaitForFrame() {
+	while (true) {
+		this->PumpMessages();
+		if (!this->IsRunning)
+			return false;
+
+		auto Now = std::chrono::steady_clock::now();
+
+		// Present tells us when the window is fully covered, check every now and then if it's back
+		if (this->IsOccluded && Now >= this->NextOcclusionTest) {
+			this->NextOcclusionTest = Now + std::chrono::milliseconds(250);
+			if (this->DXGISwapChain->Present(0, DXGI_PRESENT_TEST) == S_OK) {
+				this->IsOccluded = false;
+				FrameScheduler.RequestFrame();
+			}
+		}
+
+		// Nothing gets drawn while minimized or occluded, the backend keeps running
+		bool CanRender = !IsIconic(this->WindowHandle) && !this->IsOccluded;
+		if (CanRender && FrameScheduler.IsFrameDue(Now))
+			return true;
+
+		if (Now >= this->NextUpdate) {
+			this->NextUpdate = Now + this->UpdateInterval;
+			return false;
+		}
+
+		auto Timeout = this->NextUpdate - Now;
+		if (CanRender)
+			Timeout = std::min(Timeout, FrameScheduler.GetTimeUntilFrame(Now));
+		if (this->IsOccluded)
+			Timeout = std::min(Timeout, this->NextOcclusionTest - Now);
+
+		auto Milliseconds = std::chrono::ceil<std::chrono::milliseconds>(Timeout).count();
+		MsgWaitForMultipleObjectsEx(1, &this->WakeEvent, static_cast<DWORD>(Milliseconds), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		FrameScheduler.CountWakeup();
+	}
+}
+
 void WindowManager_t::Begin() {
+	FrameScheduler.BeginFrame(std::chrono::steady_clock::now());
+
 	ImGui_ImplDX11_NewFrame();
 	ImGui_ImplWin32_NewFrame();
 	ImGui::NewFrame();
@@ -247,22 +295,37 @@ void WindowManager_t::End() {
 	this->D3D11DeviceContext->OMSetRenderTargets(1, &this->D3D11RenderTargetView, nullptr);
 
 	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
-	this->DXGISwapChain->Present(this->VSync, 0);
+	if (this->DXGISwapChain->Present(this->VSync, 0) == DXGI_STATUS_OCCLUDED) {
+		this->IsOccluded = true;
+		this->NextOcclusionTest = std::chrono::steady_clock::now() + std::chrono::milliseconds(250);
+	}
 
-	MSG Message;
-	while (::PeekMessage(&Message, nullptr, 0U, 0U, PM_REMOVE)) {
-		switch (Message.message) {
-			case WM_QUIT || !this->IsRunning: {
-				this->D3D11Device->Release();
-				this->D3D11DeviceContext->Release();
-				this->D3D11RenderTargetView->Release();
-				this->IsRunning = false;
-				exit(0);
-				break;
-			}
-		}
+	if (this->InputFrames > 0) {
+		this->InputFrames--;
+		FrameScheduler.RequestAnimationFrame();
+	}
+}
 
-		::TranslateMessage(&Message);
-		::DispatchMessage(&Message);
+void WindowManager_t::LogStats() {
+	if (!this->PrintFrameStats)
+		return;
+
+	auto Now = std::chrono::steady_clock::now();
+	if (Now - this->LastStats < std::chrono::seconds(5))
+		return;
+
+	FILETIME Creation, Exit, Kernel, User;
+	GetProcessTimes(GetCurrentProcess(), &Creation, &Exit, &Kernel, &User);
+	ULONGLONG CpuTime = (static_cast<ULONGLONG>(Kernel.dwHighDateTime) << 32 | Kernel.dwLowDateTime) + (static_cast<ULONGLONG>(User.dwHighDateTime) << 32 | User.dwLowDateTime);
+
+	uint64_t Frames = FrameScheduler.GetStats().Frames;
+	if (this->LastCpuTime) {
+		double Seconds = std::chrono::duration<double>(Now - this->LastStats).count();
+		double CpuSeconds = static_cast<double>(CpuTime - this->LastCpuTime) / 10000000.0;
+		printf("%.1f fps, %.2f%% cpu (%s)\n", (Frames - this->LastStatsFrames) / Seconds, CpuSeconds / Seconds * 100.0, IsIconic(this->WindowHandle) ? "minimized" : this->IsOccluded ? "occluded" : "visible");
 	}
-}
\ No newline at end of file
+
+	this->LastStats = Now;
+	this->LastCpuTime = CpuTime;
+	this->LastStatsFrames = Frames;
+}
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <Windows.h>
+#include <chrono>
 #include <string>
-#include <unordered_map>
 #include <d3d11.h>
 #pragma comment(lib, "d3d11.lib")
 #include "../ImGui/imgui.h"
@@ -13,23 +13,46 @@ private:
     bool CreateRenderTarget();
     bool CreateDeviceD3D(HWND hWnd);
 
+    void PumpMessages();
+
+    // Signalled when another thread requests a frame while the loop sleeps
+    HANDLE WakeEvent = NULL;
+
+    bool IsOccluded = false;
+    int InputFrames = 0;
+    std::chrono::steady_clock::time_point NextOcclusionTest;
+    std::chrono::steady_clock::time_point NextUpdate;
+
+    std::chrono::steady_clock::time_point LastStats;
+    ULONGLONG LastCpuTime = 0;
+    uint64_t LastStatsFrames = 0;
+
 public:
     inline static ID3D11Device* D3D11Device = nullptr;
     inline static ID3D11DeviceContext* D3D11DeviceContext = nullptr;
     inline static IDXGISwapChain* DXGISwapChain = nullptr;
     inline static ID3D11RenderTargetView* D3D11RenderTargetView = nullptr;
 
-    std::unordered_map<std::string, ImFont*> Fonts = {};
-
     inline static ImVec2 WindowSize = { 0.0f, 0.0f };
     HWND WindowHandle = NULL;
     bool IsRunning = false;
     float CanvasColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
     bool VSync = false;
 
+    // How often the loop wakes up for housekeeping while no frames are drawn, playback has its own thread
+    std::chrono::milliseconds UpdateInterval = std::chrono::milliseconds(1000);
+    bool PrintFrameStats = false;
+
     bool Init(const std::string& WindowName, const ImVec2 WindowSize);
-    
+
+    // Sleeps until input arrives, a frame is requested or the backend needs an update.
+    // Returns true if a frame should be drawn, false for a backend update only
+    bool WaitForFrame();
+
     void Begin();
     void End();
 
+    // Prints frame rate and process CPU usage every few seconds if PrintFrameStats is set
+    void LogStats();
+
 } extern WindowManager;
\ No newline at end of file